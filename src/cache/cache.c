@@ -14,6 +14,8 @@
 #include "../tag/tag.h"
 #include "../tag/tag_fourcc.h"
 #include "../tag_groups/scenario.h"
+#include "cache_compression.h"
+#include "../thread/thread_output.h"
 
 static bool cache_file_verify_header(struct cache_file_header *header) {
     assert(header);
@@ -24,7 +26,7 @@ static bool cache_file_verify_header(struct cache_file_header *header) {
         return false;
     }
 
-    if(header->version == CACHE_FILE_VERSION_PC_RETAIL || header->version == CACHE_FILE_VERSION_CUSTOM_EDITION) {
+    if(header->version == CACHE_FILE_VERSION_XBOX || header->version == CACHE_FILE_VERSION_PC_RETAIL || header->version == CACHE_FILE_VERSION_CUSTOM_EDITION) {
         return true;
     }
 
@@ -127,13 +129,15 @@ static bool cache_file_checksum(uint32_t *crc_reference, struct cache_file_insta
         crc_checksum_buffer(crc_reference, cache_file->data + bsp->offset, bsp->size);
     }
 
-    size_t model_data_offset = cache_file->tag_data.header->vertex_buffers_offset;
-    size_t model_data_size = cache_file->tag_data.header->model_data_size;
-    if(model_data_offset > cache_file->size || (uint64_t)model_data_offset + (uint64_t)model_data_size > cache_file->size) {
-        return false;
+    if(cache_file_has_model_data(cache_file)) {
+        size_t model_data_offset = cache_file->tag_data.header->vertex_buffers_offset;
+        size_t model_data_size = cache_file->tag_data.header->model_data_size;
+        if(model_data_offset > cache_file->size || (uint64_t)model_data_offset + (uint64_t)model_data_size > cache_file->size) {
+            return false;
+        }
+        crc_checksum_buffer(crc_reference, cache_file->data + model_data_offset, model_data_size);
     }
 
-    crc_checksum_buffer(crc_reference, cache_file->data + model_data_offset, model_data_size);
     crc_checksum_buffer(crc_reference, cache_file->tag_data.data, cache_file->tag_data.size);
 
     return true;
@@ -142,6 +146,11 @@ static bool cache_file_checksum(uint32_t *crc_reference, struct cache_file_insta
 void cache_file_forge_checksum(uint32_t new_crc, struct cache_file_instance *cache_file) {
     assert(cache_file && cache_file->valid);
     assert(!cache_file->dirty);
+
+    // Never changed, see cache_file_load
+    if(cache_file->header->version == CACHE_FILE_VERSION_XBOX) {
+        return;
+    }
     uint32_t *crc = &cache_file->header->checksum;
     size_t field_offset = offsetof(struct tag_data_header, tag_data_checksum);
     crc_force_buffer_checksum(crc, new_crc, cache_file->tag_data.data, cache_file->tag_data.size, field_offset);
@@ -159,9 +168,74 @@ uint16_t cache_file_resolve_build(struct cache_file_header *header) {
     return CACHE_FILE_TRACKED_BUILD_UNTRACKED;
 }
 
+// Whether the vertices and indices of models are between the raw data and the tag data. Xbox maps keep them in the tag
+// data instead, and their tag data header has no offsets to them.
+bool cache_file_has_model_data(const struct cache_file_instance *cache_file) {
+    assert(cache_file && cache_file->valid);
+    return cache_file->header->version != CACHE_FILE_VERSION_XBOX;
+}
+
+// Xbox cache files are inflated as they are read, so the compressed data is never all in memory at once
+static void cache_file_read(const char *path, struct cache_file_instance *cache_file) {
+    FILE *file = fopen(path, "rb");
+    if(!file) {
+        thread_output_error("%s: Failed to open\n", path);
+        return;
+    }
+
+    struct cache_file_header header;
+    if(fread(&header, sizeof(struct cache_file_header), 1, file) != 1 || header.version != CACHE_FILE_VERSION_XBOX) {
+        fclose(file);
+        file_read_into_buffer(path, &cache_file->data, &cache_file->size);
+        return;
+    }
+
+    if(header.size < CACHE_FILE_MINIMUM_SIZE || header.size > CACHE_FILE_MAXIMUM_SIZE) {
+        thread_output_error("%s: Compressed cache file has an invalid size\n", path);
+        fclose(file);
+        return;
+    }
+
+    uint8_t *data = malloc(header.size);
+    if(!data) {
+        abort();
+    }
+    memcpy(data, &header, sizeof(struct cache_file_header));
+    bool inflated = cache_compression_inflate(file, data + sizeof(struct cache_file_header), header.size - sizeof(struct cache_file_header));
+    fclose(file);
+    if(!inflated) {
+        thread_output_error("%s: Failed to inflate compressed cache file\n", path);
+        free(data);
+        return;
+    }
+
+    cache_file->data = data;
+    cache_file->size = header.size;
+}
+
+// How much memory the cache file takes once loaded, without loading it. Compressed cache files are inflated. 0 if it can
+// not be opened.
+size_t cache_file_get_load_size(const char *path) {
+    assert(path);
+    FILE *file = fopen(path, "rb");
+    if(!file) {
+        return 0;
+    }
+
+    struct cache_file_header header;
+    bool compressed = fread(&header, sizeof(struct cache_file_header), 1, file) == 1 && header.version == CACHE_FILE_VERSION_XBOX;
+    long file_size = fseek(file, 0, SEEK_END) == 0 ? ftell(file) : -1;
+    fclose(file);
+    if(file_size < 0) {
+        return 0;
+    }
+
+    return compressed ? MAX((size_t)file_size, (size_t)header.size) : (size_t)file_size;
+}
+
 void cache_file_load(const char *path, struct cache_file_instance *cache_file) {
     assert(cache_file && !cache_file->data);
-    file_read_into_buffer(path, &cache_file->data, &cache_file->size);
+    cache_file_read(path, cache_file);
     if(!cache_file->data) {
         memset(cache_file, 0, sizeof(struct cache_file_instance));
         return;
@@ -179,30 +253,37 @@ void cache_file_load(const char *path, struct cache_file_instance *cache_file) {
 
     // Check tag data
     if(cache_file->header->tags_size < sizeof(struct tag_data_header)) {
-        fprintf(stderr, "%s: Tag data size is too small to have valid tag data\n", cache_file->header->name);
+        thread_output_error("%s: Tag data size is too small to have valid tag data\n", cache_file->header->name);
         goto cleanup;
     }
 
     uint64_t end_of_tag_data = cache_file->header->tags_offset + cache_file->header->tags_size;
     if(end_of_tag_data > cache_file->size) {
-        fprintf(stderr, "%s: Tag data size is out of bounds for the cache file\n", cache_file->header->name);
+        thread_output_error("%s: Tag data size is out of bounds for the cache file\n", cache_file->header->name);
         goto cleanup;
     }
 
     // This should be at the end if the cache file was made by regular tool.exe
     if(!TEST_FLAG(global_option_flags, GLOBAL_OPTON_FLAGS_RELAXED_BIT) && end_of_tag_data != cache_file->size) {
-        fprintf(stderr, "%s: Tag data is not at the end of the cache file\n", cache_file->header->name);
+        thread_output_error("%s: Tag data is not at the end of the cache file\n", cache_file->header->name);
         goto cleanup;
     }
 
     cache_file->tag_data.data = cache_file->data + cache_file->header->tags_offset;
     if(cache_file->tag_data.header->tag_count > INT16_MAX) {
-        fprintf(stderr, "%s: Too many tags to have valid tag data\n", cache_file->header->name);
+        thread_output_error("%s: Too many tags to have valid tag data\n", cache_file->header->name);
         goto cleanup;
     }
 
     cache_file->tag_data.size = cache_file->header->tags_size;
-    cache_file->tag_data.data_load_address = TAG_DATA_LOAD_ADDRESS;
+    if(cache_file->header->version == CACHE_FILE_VERSION_XBOX) {
+        cache_file->tag_data.header_size = sizeof(struct tag_data_header_xbox);
+        cache_file->tag_data.data_load_address = TAG_DATA_LOAD_ADDRESS_XBOX;
+    }
+    else {
+        cache_file->tag_data.header_size = sizeof(struct tag_data_header);
+        cache_file->tag_data.data_load_address = TAG_DATA_LOAD_ADDRESS;
+    }
 
     // We do not allow this on non-mp maps because the other map types can hit conditions where stale tag data pointers are used (i.e. checkpoints)
     if(cache_file->header->version == CACHE_FILE_VERSION_CUSTOM_EDITION && cache_file->header->scenario_type == SCENARIO_TYPE_MULTIPLAYER) {
@@ -211,7 +292,7 @@ void cache_file_load(const char *path, struct cache_file_instance *cache_file) {
 
     cache_file->tag_data.tags = tag_resolve_pointer(cache_file->tag_data.header->tag_instances, sizeof(struct tag_instance) * cache_file->tag_data.header->tag_count, &cache_file->tag_data);
     if(!cache_file->tag_data.tags) {
-        fprintf(stderr, "%s: Tag array is out of bounds\n", cache_file->header->name);
+        thread_output_error("%s: Tag array is out of bounds\n", cache_file->header->name);
         goto cleanup;
     }
 
@@ -221,14 +302,20 @@ void cache_file_load(const char *path, struct cache_file_instance *cache_file) {
 
     // Check for basic corruption
     if(cache_file_tag_data_is_corrupt(&cache_file->tag_data)) {
-        fprintf(stderr, "%s: Tag data appears to be corrupt\n", cache_file->header->name);
+        thread_output_error("%s: Tag data appears to be corrupt\n", cache_file->header->name);
         goto cleanup;
     }
 
+    // Xbox maps have no model data to checksum the way the PC ones do, so theirs is not checked, and it is carried over
+    // as it is when saving
+    if(cache_file->header->version == CACHE_FILE_VERSION_XBOX) {
+        return;
+    }
+
     // Check the CRC
     uint32_t checksum;
     if(!cache_file_checksum(&checksum, cache_file)) {
-        fprintf(stderr, "%s: Failed to calculate cache file checksum\n", cache_file->header->name);
+        thread_output_error("%s: Failed to calculate cache file checksum\n", cache_file->header->name);
         goto cleanup;
     }
 
@@ -237,7 +324,7 @@ void cache_file_load(const char *path, struct cache_file_instance *cache_file) {
         cache_file->header->checksum = checksum;
     }
     else if(checksum != cache_file->header->checksum) {
-        fprintf(stderr, "%s: Cache file checksum does not match header\n", cache_file->header->name);
+        thread_output_error("%s: Cache file checksum does not match header\n", cache_file->header->name);
         goto cleanup;
     }
 
@@ -253,20 +340,21 @@ bool cache_file_update_header(struct cache_file_instance *cache_file, bool updat
 
     // Make sure the size is correct
     if(cache_file->size > CACHE_FILE_MAXIMUM_SIZE) {
-        fprintf(stderr, "%s: Cache file data is too large\n", cache_file->header->name);
+        thread_output_error("%s: Cache file data is too large\n", cache_file->header->name);
         return false;
     }
 
     cache_file->header->size = cache_file->size;
 
-    // Set build number to a specific value if we need to know we touched the cache file
-    if(update_build_number) {
+    // Set build number to a specific value if we need to know we touched the cache file. Xbox maps keep theirs, since
+    // it is not known what the game does with it, so they are not seen as squished and can be processed again.
+    if(update_build_number && cache_file->header->version != CACHE_FILE_VERSION_XBOX) {
         strncpy(cache_file->header->build_number,
             cache_file_tracked_builds[CACHE_FILE_TRACKED_BUILD_TOOL_SQUISHER], sizeof(cache_file->header->build_number));
     }
 
-    if(!cache_file_checksum(&cache_file->header->checksum, cache_file)) {
-        fprintf(stderr, "%s: Failed to calculate cache file checksum\n", cache_file->header->name);
+    if(cache_file->header->version != CACHE_FILE_VERSION_XBOX && !cache_file_checksum(&cache_file->header->checksum, cache_file)) {
+        thread_output_error("%s: Failed to calculate cache file checksum\n", cache_file->header->name);
         return false;
     }
 
@@ -274,10 +362,148 @@ bool cache_file_update_header(struct cache_file_instance *cache_file, bool updat
     return true;
 }
 
+// Cuts the end off of the tag data. Only works if the tag data is at the end of the cache file.
+bool cache_file_shrink_tag_data(struct cache_file_instance *cache_file, size_t tags_size) {
+    assert(cache_file && cache_file->valid);
+    assert(tags_size >= cache_file->tag_data.header_size && tags_size <= cache_file->tag_data.size);
+
+    if((uint64_t)cache_file->header->tags_offset + cache_file->header->tags_size != cache_file->size) {
+        thread_output_error("%s: Tag data is not at the end of the cache file\n", cache_file->header->name);
+        return false;
+    }
+
+    cache_file->header->tags_size = tags_size;
+    cache_file->tag_data.size = tags_size;
+    cache_file->size = cache_file->header->tags_offset + tags_size;
+    cache_file->dirty = true;
+    return true;
+}
+
+// Swaps in new tag data with the same load address. Only works if the tag data is at the end of the cache file.
+bool cache_file_replace_tag_data(struct cache_file_instance *cache_file, const uint8_t *tag_data, size_t tags_size) {
+    assert(cache_file && cache_file->valid && tag_data);
+    assert(tags_size >= cache_file->tag_data.header_size);
+
+    uint32_t tags_offset = cache_file->header->tags_offset;
+    if((uint64_t)tags_offset + cache_file->header->tags_size != cache_file->size) {
+        thread_output_error("%s: Tag data is not at the end of the cache file\n", cache_file->header->name);
+        return false;
+    }
+    if((uint64_t)tags_offset + tags_size > CACHE_FILE_MAXIMUM_SIZE) {
+        thread_output_error("%s: Tag data is too big for the cache file\n", cache_file->header->name);
+        return false;
+    }
+
+    uint8_t *data = realloc(cache_file->data, tags_offset + tags_size);
+    if(!data) {
+        abort();
+    }
+    memcpy(data + tags_offset, tag_data, tags_size);
+
+    cache_file->data = data;
+    cache_file->size = tags_offset + tags_size;
+    cache_file->header->tags_size = tags_size;
+    cache_file->tag_data.data = data + tags_offset;
+    cache_file->tag_data.size = tags_size;
+    cache_file->tag_data.tags = tag_resolve_pointer(cache_file->tag_data.header->tag_instances, sizeof(struct tag_instance) * cache_file->tag_data.header->tag_count, &cache_file->tag_data);
+    assert(cache_file->tag_data.tags);
+    cache_file->dirty = true;
+    return true;
+}
+
+// Cuts ranges out of the raw data between the header and the tag data, moving everything after them down. Anything
+// pointing to data that moved has to be fixed by the caller. Ranges must be sorted and not overlap.
+bool cache_file_remove_ranges(struct cache_file_instance *cache_file, const struct cache_file_range *ranges, size_t range_count) {
+    assert(cache_file && cache_file->valid && (ranges || range_count == 0));
+
+    uint32_t tags_offset = cache_file->header->tags_offset;
+    for(size_t r = 0; r < range_count; r++) {
+        uint32_t previous_end = r > 0 ? ranges[r - 1].end : sizeof(struct cache_file_header);
+        if(ranges[r].start < previous_end || ranges[r].end < ranges[r].start || ranges[r].end > tags_offset) {
+            thread_output_error("%s: Raw data range %#x-%#x can not be removed\n", cache_file->header->name, ranges[r].start, ranges[r].end);
+            return false;
+        }
+    }
+
+    size_t write_offset = range_count > 0 ? ranges[0].start : cache_file->size;
+    for(size_t r = 0; r < range_count; r++) {
+        size_t next_start = r + 1 < range_count ? ranges[r + 1].start : cache_file->size;
+        memmove(cache_file->data + write_offset, cache_file->data + ranges[r].end, next_start - ranges[r].end);
+        write_offset += next_start - ranges[r].end;
+    }
+
+    size_t removed_size = cache_file->size - write_offset;
+    cache_file->header->tags_offset = tags_offset - removed_size;
+    cache_file->tag_data.data -= removed_size;
+    cache_file->tag_data.tags = (struct tag_instance *)((uint8_t *)cache_file->tag_data.tags - removed_size);
+    cache_file->size = write_offset;
+    cache_file->dirty = true;
+    return true;
+}
+
+// Opens up size zeroed bytes at offset in the raw data, moving everything after it up. The buffer can be reallocated,
+// so pointers into it have to be found again. Anything pointing to data that moved has to be fixed by the caller.
+bool cache_file_insert_range(struct cache_file_instance *cache_file, uint32_t offset, uint32_t size) {
+    assert(cache_file && cache_file->valid);
+
+    uint32_t tags_offset = cache_file->header->tags_offset;
+    if(offset < sizeof(struct cache_file_header) || offset > tags_offset || (uint64_t)cache_file->size + size > CACHE_FILE_MAXIMUM_SIZE) {
+        thread_output_error("%s: Raw data can not be inserted at %#x\n", cache_file->header->name, offset);
+        return false;
+    }
+
+    size_t tags_array_offset = (uint8_t *)cache_file->tag_data.tags - cache_file->data;
+    uint8_t *data = realloc(cache_file->data, cache_file->size + size);
+    if(!data) {
+        abort();
+    }
+    memmove(data + offset + size, data + offset, cache_file->size - offset);
+    memset(data + offset, 0, size);
+
+    cache_file->data = data;
+    cache_file->size += size;
+    cache_file->header->tags_offset = tags_offset + size;
+    cache_file->tag_data.data = data + tags_offset + size;
+    cache_file->tag_data.tags = (struct tag_instance *)(data + tags_array_offset + size);
+    cache_file->dirty = true;
+    return true;
+}
+
+// The header is written again once the padding after the compressed data is known
+static bool cache_file_write_compressed(const char *path, struct cache_file_instance *cache_file) {
+    FILE *file = fopen(path, "wb");
+    if(!file) {
+        thread_output_error("%s: Can not open file for writing\n", path);
+        return false;
+    }
+
+    uint64_t compressed_size;
+    bool success = fwrite(cache_file->header, sizeof(struct cache_file_header), 1, file) == 1 &&
+        cache_compression_deflate(file, cache_file->data + sizeof(struct cache_file_header), cache_file->size - sizeof(struct cache_file_header), &compressed_size);
+    if(success) {
+        static const uint8_t zeroes[CACHE_COMPRESSION_PADDING_ALIGNMENT] = {};
+        uint64_t end = sizeof(struct cache_file_header) + compressed_size;
+        uint32_t padding = (CACHE_COMPRESSION_PADDING_ALIGNMENT - end % CACHE_COMPRESSION_PADDING_ALIGNMENT) % CACHE_COMPRESSION_PADDING_ALIGNMENT;
+        cache_file->header->compressed_file_padding = padding;
+        success = (padding == 0 || fwrite(zeroes, padding, 1, file) == 1) &&
+            fseek(file, 0, SEEK_SET) == 0 &&
+            fwrite(cache_file->header, sizeof(struct cache_file_header), 1, file) == 1;
+    }
+
+    success = fclose(file) == 0 && success;
+    if(!success) {
+        thread_output_error("%s: Write failed. The map is likely fucked now! LOL\n", path);
+    }
+    return success;
+}
+
 bool cache_file_save(const char *path, struct cache_file_instance *cache_file) {
     assert(cache_file && cache_file->valid);
     assert(!cache_file->dirty);
 
+    if(cache_file->header->version == CACHE_FILE_VERSION_XBOX) {
+        return cache_file_write_compressed(path, cache_file);
+    }
     return file_write_from_buffer(path, cache_file->data, cache_file->size);
 }
 
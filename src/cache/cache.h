@@ -21,7 +21,8 @@ static const char *cache_file_tracked_builds[] = {
     "01.00.00.0563", // Released with dedicated server
     "01.00.00.0564", // Final retail release
     "01.00.00.0609", // Custom Edition 1.0
-    "01.00.10.0621"  // 1.10, likely the digsite build
+    "01.00.10.0621", // 1.10, likely the digsite build
+    "01.10.12.2276"  // Xbox retail
 };
 
 enum {
@@ -30,6 +31,7 @@ enum {
     CACHE_FILE_TRACKED_BUILD_0564,
     CACHE_FILE_TRACKED_BUILD_0609,
     CACHE_FILE_TRACKED_BUILD_0621,
+    CACHE_FILE_TRACKED_BUILD_XBOX,
     CACHE_FILE_TRACKED_BUILD_UNTRACKED,
     NUMBER_OF_CACHE_FILE_TRACKED_BUILDS = CACHE_FILE_TRACKED_BUILD_UNTRACKED
 };
@@ -69,6 +71,12 @@ static_assert(sizeof(struct cache_file_structure_bsp_header) == 24);
 
 #pragma pack(pop)
 
+// A range of file offsets, end not included
+struct cache_file_range {
+    uint32_t start;
+    uint32_t end;
+};
+
 struct cache_file_instance {
     union {
         uint8_t *data;
@@ -81,8 +89,14 @@ struct cache_file_instance {
 };
 
 uint16_t cache_file_resolve_build(struct cache_file_header *header);
+bool cache_file_has_model_data(const struct cache_file_instance *cache_file);
 void cache_file_forge_checksum(uint32_t new_crc, struct cache_file_instance *cache_file);
 void cache_file_load(const char *path, struct cache_file_instance *cache_file);
+size_t cache_file_get_load_size(const char *path);
 bool cache_file_update_header(struct cache_file_instance *cache_file, bool update_build_number);
+bool cache_file_shrink_tag_data(struct cache_file_instance *cache_file, size_t tags_size);
+bool cache_file_replace_tag_data(struct cache_file_instance *cache_file, const uint8_t *tag_data, size_t tags_size);
+bool cache_file_remove_ranges(struct cache_file_instance *cache_file, const struct cache_file_range *ranges, size_t range_count);
+bool cache_file_insert_range(struct cache_file_instance *cache_file, uint32_t offset, uint32_t size);
 bool cache_file_save(const char *path, struct cache_file_instance *cache_file);
 void cache_file_unload(struct cache_file_instance *cache_file);
@@ -0,0 +1,154 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <zlib.h>
+
+#include "cache_compression.h"
+
+#include "../data_types.h"
+#include "../thread/thread_pool.h"
+
+// How much of the data before a block it can refer back to
+#define CACHE_COMPRESSION_WINDOW_SIZE 0x8000
+
+struct cache_compression_block {
+    uint8_t *output;
+    size_t output_size;
+    uLong adler;
+    bool failed;
+};
+
+struct cache_compression_job_context {
+    const uint8_t *data;
+    size_t size;
+    size_t first_block;
+    struct cache_compression_block *blocks;
+};
+
+// Everything but the last block is sync flushed, which ends it on a byte boundary without ending the stream
+static void cache_compression_deflate_job(size_t job_index, void *context) {
+    struct cache_compression_job_context *job = context;
+    struct cache_compression_block *block = &job->blocks[job_index];
+    size_t start = (job->first_block + job_index) * CACHE_COMPRESSION_BLOCK_SIZE;
+    size_t size = MIN(CACHE_COMPRESSION_BLOCK_SIZE, job->size - start);
+    bool last = start + size == job->size;
+
+    *block = (struct cache_compression_block){ .failed = true };
+    block->adler = adler32(adler32(0, nullptr, 0), job->data + start, size);
+
+    z_stream stream = {};
+    if(deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return;
+    }
+    if(start > 0) {
+        size_t dictionary_size = MIN(start, CACHE_COMPRESSION_WINDOW_SIZE);
+        if(deflateSetDictionary(&stream, job->data + start - dictionary_size, dictionary_size) != Z_OK) {
+            deflateEnd(&stream);
+            return;
+        }
+    }
+
+    // Room for the flush marker too
+    size_t capacity = deflateBound(&stream, size) + 16;
+    block->output = malloc(capacity);
+    if(!block->output) {
+        abort();
+    }
+
+    stream.next_in = (Bytef *)(job->data + start);
+    stream.avail_in = size;
+    stream.next_out = block->output;
+    stream.avail_out = capacity;
+    int result = deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+    block->failed = last ? result != Z_STREAM_END : result != Z_OK || stream.avail_in != 0 || stream.avail_out == 0;
+    block->output_size = stream.total_out;
+    deflateEnd(&stream);
+}
+
+bool cache_compression_deflate(FILE *file, const uint8_t *data, size_t size, uint64_t *compressed_size) {
+    assert(file && data && compressed_size);
+
+    // zlib header for the best compression level and a 32 KiB window
+    static const uint8_t zlib_header[] = { 0x78, 0xDA };
+    if(fwrite(zlib_header, sizeof(zlib_header), 1, file) != 1) {
+        return false;
+    }
+    uint64_t written = sizeof(zlib_header);
+
+    // One batch of blocks per thread is in memory at a time
+    size_t block_count = MAX((size + CACHE_COMPRESSION_BLOCK_SIZE - 1) / CACHE_COMPRESSION_BLOCK_SIZE, 1);
+    size_t batch_size = thread_pool_get_thread_count();
+    struct cache_compression_block *blocks = calloc(batch_size, sizeof(struct cache_compression_block));
+    if(!blocks) {
+        abort();
+    }
+
+    uLong adler = adler32(0, nullptr, 0);
+    bool success = true;
+    for(size_t first_block = 0; first_block < block_count && success; first_block += batch_size) {
+        struct cache_compression_job_context job = {
+            .data = data,
+            .size = size,
+            .first_block = first_block,
+            .blocks = blocks
+        };
+        size_t batch_count = MIN(batch_size, block_count - first_block);
+        thread_pool_run(batch_count, cache_compression_deflate_job, &job);
+
+        for(size_t b = 0; b < batch_count; b++) {
+            size_t block_size = MIN(CACHE_COMPRESSION_BLOCK_SIZE, size - (first_block + b) * CACHE_COMPRESSION_BLOCK_SIZE);
+            success = success && !blocks[b].failed && fwrite(blocks[b].output, blocks[b].output_size, 1, file) == 1;
+            written += blocks[b].output_size;
+            adler = adler32_combine(adler, blocks[b].adler, block_size);
+            free(blocks[b].output);
+        }
+    }
+    free(blocks);
+    if(!success) {
+        return false;
+    }
+
+    uint8_t zlib_trailer[] = { adler >> 24, adler >> 16, adler >> 8, adler };
+    if(fwrite(zlib_trailer, sizeof(zlib_trailer), 1, file) != 1) {
+        return false;
+    }
+
+    *compressed_size = written + sizeof(zlib_trailer);
+    return true;
+}
+
+bool cache_compression_inflate(FILE *file, uint8_t *data, size_t size) {
+    assert(file && data);
+
+    z_stream stream = {};
+    if(inflateInit(&stream) != Z_OK) {
+        return false;
+    }
+
+    uint8_t *input = malloc(CACHE_COMPRESSION_BLOCK_SIZE);
+    if(!input) {
+        abort();
+    }
+
+    stream.next_out = data;
+    stream.avail_out = size;
+    int result = Z_OK;
+    while(result == Z_OK) {
+        if(stream.avail_in == 0) {
+            size_t read_size = fread(input, 1, CACHE_COMPRESSION_BLOCK_SIZE, file);
+            if(read_size == 0) {
+                break;
+            }
+            stream.next_in = input;
+            stream.avail_in = read_size;
+        }
+        result = inflate(&stream, Z_NO_FLUSH);
+    }
+
+    bool success = result == Z_STREAM_END && stream.total_out == size;
+    inflateEnd(&stream);
+    free(input);
+    return success;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// Xbox cache files are the header, then everything after it as one zlib stream, then zeroes up to a multiple of
+// CACHE_COMPRESSION_PADDING_ALIGNMENT. The header's size is the size once inflated, and its compressed_file_padding is
+// how many zeroes there are.
+//
+// Deflating splits the data into blocks that are compressed at the same time. Each block is primed with the end of the
+// one before it and ends on a byte boundary, so put together they are still one stream the engine can inflate.
+#define CACHE_COMPRESSION_PADDING_ALIGNMENT 0x800
+#define CACHE_COMPRESSION_BLOCK_SIZE 0x100000
+
+// Inflates the rest of the file into data, which has to be exactly big enough
+bool cache_compression_inflate(FILE *file, uint8_t *data, size_t size);
+
+// Writes data to the file as a zlib stream, a few blocks at a time
+bool cache_compression_deflate(FILE *file, const uint8_t *data, size_t size, uint64_t *compressed_size);
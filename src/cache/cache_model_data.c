@@ -0,0 +1,685 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "cache_model_data.h"
+
+#include "../data_types.h"
+#include "../tag/tag.h"
+#include "../tag/tag_fix_plan.h"
+#include "../tag/tag_fourcc.h"
+#include "../tag_groups/tag_groups.h"
+#include "../geometry/triangle_strip.h"
+#include "cache.h"
+#include "cache_raw_data.h"
+#include "../thread/thread_output.h"
+
+// Custom Edition only has uncompressed model vertices, and triangle strips of 16-bit indices
+#define CACHE_MODEL_DATA_VERTEX_SIZE 68
+#define CACHE_MODEL_DATA_INDEX_SIZE sizeof(uint16_t)
+
+// Strips are only replaced if they do better with a cache this small, which older hardware has
+#define CACHE_MODEL_DATA_VERTEX_CACHE_SIZE 16
+
+// The vertices or indices of a geometry part. In a cache file, a part's vertex buffer has the offset of its vertices
+// from the start of the vertex buffers in its hardware format, and its triangle buffer has the offset of its indices
+// from the start of the index buffers in both its base address and hardware format.
+struct cache_model_data_buffer {
+    uint32_t *offsets[2]; // Where the offset is, the second one being nullptr for vertices
+    uint32_t *count; // Vertex count, or triangle count for indices
+    TagID tag;
+    uint32_t offset;
+    uint32_t size;
+    uint64_t hash;
+    size_t canonical; // First buffer found with the same contents
+    uint32_t new_offset;
+};
+
+struct cache_model_data_buffers {
+    struct cache_model_data_buffer *buffers;
+    size_t count;
+    size_t capacity;
+    uint8_t *data; // Where the offsets are from
+};
+
+// Eight bytes at a time, with a splitmix64 finalizer
+static uint64_t cache_model_data_hash(const uint8_t *data, size_t size) {
+    uint64_t hash = 0xCBF29CE484222325 ^ size;
+    size_t i = 0;
+    for(; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * 0x9E3779B97F4A7C15;
+        hash ^= hash >> 29;
+    }
+    for(; i < size; i++) {
+        hash = (hash ^ data[i]) * 0x100000001B3;
+    }
+
+    hash ^= hash >> 30;
+    hash *= 0xBF58476D1CE4E5B9;
+    hash ^= hash >> 27;
+    hash *= 0x94D049BB133111EB;
+    hash ^= hash >> 31;
+    return hash;
+}
+
+static void cache_model_data_add(struct cache_model_data_buffers *buffers, uint32_t *offset, uint32_t *offset2, uint32_t *count, uint32_t size, TagID tag) {
+    if(buffers->count == buffers->capacity) {
+        buffers->capacity = MAX(buffers->capacity * 2, 1024);
+        buffers->buffers = realloc(buffers->buffers, buffers->capacity * sizeof(struct cache_model_data_buffer));
+        if(!buffers->buffers) {
+            abort();
+        }
+    }
+    buffers->buffers[buffers->count++] = (struct cache_model_data_buffer){
+        .offsets = { offset, offset2 },
+        .count = count,
+        .tag = tag,
+        .offset = *offset,
+        .size = size
+    };
+}
+
+static bool cache_model_data_collect_gbxmodel(
+    TagID tag,
+    struct tag_data_instance *tag_data,
+    struct cache_model_data_buffers *vertices,
+    struct cache_model_data_buffers *indices,
+    uint32_t vertex_size,
+    uint32_t index_size) {
+
+    struct model *gbxmodel = tag_get(tag, TAG_FOURCC_GBXMODEL, tag_data);
+    const char *tag_path = tag_path_get(tag, tag_data);
+    if(!gbxmodel) {
+        thread_output_error("tag data for \"%s.%s\" is invalid\n", tag_path, tag_fourcc_to_extension(TAG_FOURCC_GBXMODEL));
+        return false;
+    }
+
+    for(size_t g = 0; g < gbxmodel->geometries.count; g++) {
+        struct model_geometry *geometry = model_get_geometry(gbxmodel, g, tag_data);
+        if(!geometry) {
+            thread_output_error("geometry %zu in \"%s.%s\" is out of bounds\n", g, tag_path, tag_fourcc_to_extension(TAG_FOURCC_GBXMODEL));
+            return false;
+        }
+
+        for(size_t p = 0; p < geometry->parts.count; p++) {
+            struct gbxmodel_geometry_part *part = gbxmodel_get_geometry_part(geometry, p, tag_data);
+            if(!part) {
+                thread_output_error("geometry part %zu of geometry %zu in \"%s.%s\" is out of bounds\n",
+                    p, g, tag_path, tag_fourcc_to_extension(TAG_FOURCC_GBXMODEL));
+                return false;
+            }
+
+            // A strip of n triangles has n + 2 indices
+            uint64_t part_vertex_size = (uint64_t)part->vertex_buffer.count * CACHE_MODEL_DATA_VERTEX_SIZE;
+            uint64_t part_index_size = ((uint64_t)part->triangle_buffer.count + 2) * CACHE_MODEL_DATA_INDEX_SIZE;
+            if(part->vertex_buffer.hardware_format + part_vertex_size > vertex_size || part->triangle_buffer.base_address + part_index_size > index_size) {
+                thread_output_error("model data of geometry part %zu of geometry %zu in \"%s.%s\" is out of bounds\n",
+                    p, g, tag_path, tag_fourcc_to_extension(TAG_FOURCC_GBXMODEL));
+                return false;
+            }
+
+            cache_model_data_add(vertices, &part->vertex_buffer.hardware_format, nullptr, &part->vertex_buffer.count, part_vertex_size, tag);
+            cache_model_data_add(indices, &part->triangle_buffer.base_address, &part->triangle_buffer.hardware_format, &part->triangle_buffer.count, part_index_size, tag);
+        }
+    }
+
+    return true;
+}
+
+static thread_local const struct cache_model_data_buffers *cache_model_data_sort_buffers;
+
+static int cache_model_data_compare_buffers(const void *a, const void *b) {
+    const struct cache_model_data_buffers *buffers = cache_model_data_sort_buffers;
+    size_t index_a = *(const size_t *)a;
+    size_t index_b = *(const size_t *)b;
+    const struct cache_model_data_buffer *buffer_a = &buffers->buffers[index_a];
+    const struct cache_model_data_buffer *buffer_b = &buffers->buffers[index_b];
+    if(buffer_a->hash != buffer_b->hash) {
+        return buffer_a->hash > buffer_b->hash ? 1 : -1;
+    }
+    if(buffer_a->size != buffer_b->size) {
+        return buffer_a->size > buffer_b->size ? 1 : -1;
+    }
+
+    int contents = memcmp(buffers->data + buffer_a->offset, buffers->data + buffer_b->offset, buffer_a->size);
+    if(contents != 0) {
+        return contents;
+    }
+    return (index_a > index_b) - (index_a < index_b);
+}
+
+// Gives every buffer its offset in the new model data, with the first of each set of identical buffers being placed in
+// the order they were found. Returns how many bytes the buffers take up now. Buffers that overlap without being the
+// same each get a copy, so this can be more than before.
+static uint64_t cache_model_data_place(struct cache_model_data_buffers *buffers, size_t *duplicate_count) {
+    size_t *order = calloc(MAX(buffers->count, 1), sizeof(size_t));
+    if(!order) {
+        abort();
+    }
+    for(size_t b = 0; b < buffers->count; b++) {
+        order[b] = b;
+        buffers->buffers[b].hash = cache_model_data_hash(buffers->data + buffers->buffers[b].offset, buffers->buffers[b].size);
+    }
+
+    cache_model_data_sort_buffers = buffers;
+    qsort(order, buffers->count, sizeof(size_t), cache_model_data_compare_buffers);
+    cache_model_data_sort_buffers = nullptr;
+
+    for(size_t o = 0; o < buffers->count; o++) {
+        struct cache_model_data_buffer *buffer = &buffers->buffers[order[o]];
+        const struct cache_model_data_buffer *previous = o > 0 ? &buffers->buffers[order[o - 1]] : nullptr;
+        bool same = previous &&
+            previous->hash == buffer->hash &&
+            previous->size == buffer->size &&
+            memcmp(buffers->data + previous->offset, buffers->data + buffer->offset, buffer->size) == 0;
+        buffer->canonical = same ? previous->canonical : order[o];
+    }
+    free(order);
+
+    uint64_t size = 0;
+    *duplicate_count = 0;
+    for(size_t b = 0; b < buffers->count; b++) {
+        struct cache_model_data_buffer *buffer = &buffers->buffers[b];
+        if(buffer->canonical != b) {
+            const struct cache_model_data_buffer *canonical = &buffers->buffers[buffer->canonical];
+            buffer->new_offset = canonical->new_offset;
+            *duplicate_count += canonical->offset != buffer->offset;
+            continue;
+        }
+
+        buffer->new_offset = size;
+        size += buffer->size;
+    }
+    return size;
+}
+
+// Copies every placed buffer to where cache_model_data_place() put it
+static void cache_model_data_copy(const struct cache_model_data_buffers *buffers, uint8_t *new_data) {
+    for(size_t b = 0; b < buffers->count; b++) {
+        const struct cache_model_data_buffer *buffer = &buffers->buffers[b];
+        if(buffer->canonical == b) {
+            memcpy(new_data + buffer->new_offset, buffers->data + buffer->offset, buffer->size);
+        }
+    }
+}
+
+static void cache_model_data_plan_offsets(const struct cache_model_data_buffers *buffers, struct tag_fix_plan *plan) {
+    TagID plan_tag = plan->tag;
+    for(size_t b = 0; b < buffers->count; b++) {
+        const struct cache_model_data_buffer *buffer = &buffers->buffers[b];
+        plan->tag = buffer->tag;
+        for(size_t o = 0; o < sizeof(buffer->offsets) / sizeof(buffer->offsets[0]) && buffer->offsets[o]; o++) {
+            if(*buffer->offsets[o] != buffer->new_offset) {
+                TAG_FIX_PLAN_SET(plan, *buffer->offsets[o], buffer->new_offset, "model data was deduplicated");
+            }
+        }
+    }
+    plan->tag = plan_tag;
+}
+
+// Xbox models are laid out differently, and Xbox maps keep them in the tag data, so maps with them are left alone
+static bool cache_model_data_has_xbox_models(struct cache_file_instance *cache_file) {
+    struct tag_data_instance *tag_data = &cache_file->tag_data;
+    if(!cache_file_has_model_data(cache_file)) {
+        return true;
+    }
+    for(size_t t = 0; t < tag_data->header->tag_count; t++) {
+        if(tag_data->tags[t].primary_group == TAG_FOURCC_MODEL) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// The vertices and indices of every geometry part, with the same index in both
+static bool cache_model_data_collect(struct cache_file_instance *cache_file, struct cache_model_data_buffers *vertices, struct cache_model_data_buffers *indices) {
+    struct tag_data_instance *tag_data = &cache_file->tag_data;
+    struct tag_data_header *header = tag_data->header;
+    uint32_t vertex_size = header->index_buffers_offset;
+    if((uint64_t)header->vertex_buffers_offset + header->model_data_size > cache_file->header->tags_offset || vertex_size > header->model_data_size) {
+        thread_output_error("model data is out of bounds\n");
+        return false;
+    }
+
+    uint8_t *model_data = cache_file->data + header->vertex_buffers_offset;
+    *vertices = (struct cache_model_data_buffers){ .data = model_data };
+    *indices = (struct cache_model_data_buffers){ .data = model_data + vertex_size };
+    for(size_t t = 0; t < header->tag_count; t++) {
+        struct tag_instance *tag = &tag_data->tags[t];
+        if(tag->primary_group == TAG_FOURCC_GBXMODEL && !cache_model_data_collect_gbxmodel(tag->tag_id, tag_data, vertices, indices, vertex_size, header->model_data_size - vertex_size)) {
+            free(vertices->buffers);
+            free(indices->buffers);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool cache_model_data_get_ranges(struct cache_file_instance *cache_file, struct cache_model_data_range **ranges, size_t *range_count) {
+    assert(cache_file && cache_file->valid && ranges && range_count);
+    *ranges = nullptr;
+    *range_count = 0;
+
+    struct cache_model_data_buffers vertices;
+    struct cache_model_data_buffers indices;
+    if(cache_model_data_has_xbox_models(cache_file)) {
+        return true;
+    }
+    if(!cache_model_data_collect(cache_file, &vertices, &indices)) {
+        return false;
+    }
+
+    *ranges = calloc(MAX(vertices.count + indices.count, 1), sizeof(struct cache_model_data_range));
+    if(!*ranges) {
+        abort();
+    }
+    uint32_t vertices_offset = vertices.data - cache_file->data;
+    uint32_t indices_offset = indices.data - cache_file->data;
+    for(size_t b = 0; b < vertices.count; b++) {
+        const struct cache_model_data_buffer *buffer = &vertices.buffers[b];
+        (*ranges)[(*range_count)++] = (struct cache_model_data_range){ buffer->tag, vertices_offset + buffer->offset, vertices_offset + buffer->offset + buffer->size };
+    }
+    for(size_t b = 0; b < indices.count; b++) {
+        const struct cache_model_data_buffer *buffer = &indices.buffers[b];
+        (*ranges)[(*range_count)++] = (struct cache_model_data_range){ buffer->tag, indices_offset + buffer->offset, indices_offset + buffer->offset + buffer->size };
+    }
+
+    free(vertices.buffers);
+    free(indices.buffers);
+    return true;
+}
+
+bool cache_model_data_deduplicate(struct cache_file_instance *cache_file, struct tag_fix_plan *plan, struct cache_model_data_result *result) {
+    assert(cache_file && cache_file->valid && plan && result);
+    struct tag_data_instance *tag_data = &cache_file->tag_data;
+    struct tag_data_header *header = tag_data->header;
+    memset(result, 0, sizeof(struct cache_model_data_result));
+    if(cache_model_data_has_xbox_models(cache_file)) {
+        return true;
+    }
+    result->old_size = header->model_data_size;
+    result->new_size = header->model_data_size;
+
+    struct cache_model_data_buffers vertices;
+    struct cache_model_data_buffers indices;
+    if(!cache_model_data_collect(cache_file, &vertices, &indices)) {
+        return false;
+    }
+
+    // If nothing would be dropped, the buffers are left where they are
+    uint64_t new_vertex_size = cache_model_data_place(&vertices, &result->vertex_buffer_count);
+    uint64_t new_index_size = cache_model_data_place(&indices, &result->index_buffer_count);
+    if(new_vertex_size + new_index_size >= result->old_size) {
+        result->vertex_buffer_count = 0;
+        result->index_buffer_count = 0;
+        free(vertices.buffers);
+        free(indices.buffers);
+        return true;
+    }
+
+    result->new_size = new_vertex_size + new_index_size;
+    uint8_t *new_data = malloc(MAX(result->new_size, 1));
+    if(!new_data) {
+        abort();
+    }
+    cache_model_data_copy(&vertices, new_data);
+    cache_model_data_copy(&indices, new_data + new_vertex_size);
+
+    // Nothing but the parts points into here, so the offsets are planned against the old contents along with the new
+    // contents to write over them
+    cache_model_data_plan_offsets(&vertices, plan);
+    cache_model_data_plan_offsets(&indices, plan);
+    TAG_FIX_PLAN_SET(plan, header->index_buffers_offset, new_vertex_size, "model data was deduplicated");
+    TAG_FIX_PLAN_SET(plan, header->model_data_size, result->new_size, "model data was deduplicated");
+    uint8_t *model_data = cache_file->data + header->vertex_buffers_offset;
+    tag_fix_plan_write(plan, model_data, new_data, result->new_size, "model data was deduplicated");
+    tag_fix_plan_zero(plan, model_data + result->new_size, result->old_size - result->new_size, "model data was deduplicated");
+
+    free(new_data);
+    free(vertices.buffers);
+    free(indices.buffers);
+    return true;
+}
+
+static thread_local const struct cache_model_data_buffers *cache_model_data_sort_offset_buffers;
+
+static int cache_model_data_compare_offsets(const void *a, const void *b) {
+    const struct cache_model_data_buffer *buffers = cache_model_data_sort_offset_buffers->buffers;
+    size_t index_a = *(const size_t *)a;
+    size_t index_b = *(const size_t *)b;
+    if(buffers[index_a].offset != buffers[index_b].offset) {
+        return buffers[index_a].offset > buffers[index_b].offset ? 1 : -1;
+    }
+    return (index_a > index_b) - (index_a < index_b);
+}
+
+// Buffers sorted by offset, so the ones that are the same or overlap are next to each other
+static size_t *cache_model_data_sort_by_offset(const struct cache_model_data_buffers *buffers) {
+    size_t *order = calloc(MAX(buffers->count, 1), sizeof(size_t));
+    if(!order) {
+        abort();
+    }
+    for(size_t b = 0; b < buffers->count; b++) {
+        order[b] = b;
+    }
+
+    cache_model_data_sort_offset_buffers = buffers;
+    qsort(order, buffers->count, sizeof(size_t), cache_model_data_compare_offsets);
+    cache_model_data_sort_offset_buffers = nullptr;
+    return order;
+}
+
+// Number of buffers in order starting at start that overlap each other. They can only be rewritten together if they
+// are all the same buffer.
+static size_t cache_model_data_overlapping(const struct cache_model_data_buffers *buffers, const size_t *order, size_t start, bool *same) {
+    const struct cache_model_data_buffer *first = &buffers->buffers[order[start]];
+    uint64_t end = (uint64_t)first->offset + first->size;
+    *same = true;
+
+    size_t count = 1;
+    for(; start + count < buffers->count; count++) {
+        const struct cache_model_data_buffer *buffer = &buffers->buffers[order[start + count]];
+        if(buffer->offset >= end) {
+            break;
+        }
+        end = MAX(end, (uint64_t)buffer->offset + buffer->size);
+        *same = *same && buffer->offset == first->offset && buffer->size == first->size;
+    }
+    return count;
+}
+
+// Puts the vertices in the order the strip first uses them in new_vertex_data and renumbers the strip to match
+static void cache_model_data_renumber_vertices(uint16_t *strip, size_t index_count, const uint8_t *vertex_data, uint32_t vertex_count, uint8_t *new_vertex_data) {
+    uint16_t *new_numbers = malloc(MAX(vertex_count, 1) * sizeof(uint16_t));
+    bool *numbered = calloc(MAX(vertex_count, 1), sizeof(bool));
+    if(!new_numbers || !numbered) {
+        abort();
+    }
+
+    uint32_t next = 0;
+    for(size_t i = 0; i < index_count; i++) {
+        if(!numbered[strip[i]]) {
+            numbered[strip[i]] = true;
+            new_numbers[strip[i]] = next++;
+        }
+    }
+    for(uint32_t v = 0; v < vertex_count; v++) {
+        if(!numbered[v]) {
+            new_numbers[v] = next++;
+        }
+        memcpy(new_vertex_data + new_numbers[v] * CACHE_MODEL_DATA_VERTEX_SIZE, vertex_data + v * CACHE_MODEL_DATA_VERTEX_SIZE, CACHE_MODEL_DATA_VERTEX_SIZE);
+    }
+    for(size_t i = 0; i < index_count; i++) {
+        strip[i] = new_numbers[strip[i]];
+    }
+
+    free(new_numbers);
+    free(numbered);
+}
+
+// A strip in vertex cache order that transforms fewer vertices than the one at the given buffer, or nullptr if there is
+// none. The strip has to work with vertex_count vertices.
+static uint16_t *cache_model_data_optimize_strip(
+    const uint8_t *strip_data,
+    size_t index_count,
+    uint32_t vertex_count,
+    size_t *new_index_count,
+    struct cache_model_data_optimization_result *result) {
+
+    if(index_count < 3) {
+        return nullptr;
+    }
+
+    // Model data is not necessarily aligned
+    uint16_t *strip = calloc(index_count, sizeof(uint16_t));
+    if(!strip) {
+        abort();
+    }
+    memcpy(strip, strip_data, index_count * sizeof(uint16_t));
+
+    uint16_t highest = 0;
+    for(size_t i = 0; i < index_count; i++) {
+        highest = MAX(highest, strip[i]);
+    }
+    if(highest >= vertex_count) {
+        free(strip);
+        return nullptr;
+    }
+
+    size_t maximum_triangles = index_count - 2;
+    uint16_t *triangles = calloc(TRIANGLE_LIST_INDICES(maximum_triangles), sizeof(uint16_t));
+    uint16_t *new_strip = calloc(TRIANGLE_STRIP_MAX_INDICES(maximum_triangles), sizeof(uint16_t));
+    if(!triangles || !new_strip) {
+        abort();
+    }
+
+    size_t triangle_count = triangle_strip_to_list(strip, index_count, triangles);
+    triangle_list_optimize_vertex_cache(triangles, triangle_count, (size_t)highest + 1);
+    *new_index_count = triangle_strip_from_list(triangles, triangle_count, new_strip);
+
+    double old_ratio = triangle_strip_cache_miss_ratio(strip, index_count, CACHE_MODEL_DATA_VERTEX_CACHE_SIZE);
+    double new_ratio = triangle_strip_cache_miss_ratio(new_strip, *new_index_count, CACHE_MODEL_DATA_VERTEX_CACHE_SIZE);
+    bool better = *new_index_count >= 3 && new_ratio < old_ratio;
+    result->old_misses += old_ratio * triangle_count;
+    result->new_misses += (better ? new_ratio : old_ratio) * triangle_count;
+    result->triangle_count += triangle_count;
+
+    free(strip);
+    free(triangles);
+    if(!better) {
+        free(new_strip);
+        return nullptr;
+    }
+    return new_strip;
+}
+
+// Strips used by more than one part are replaced once, for all of them
+struct cache_model_data_strip_group {
+    size_t first; // Position in the index order
+    size_t count;
+    uint16_t *new_strip; // nullptr if it is left alone
+    size_t new_index_count;
+    bool renumber; // Whether the vertices are only used with this strip and can be put in its order
+    uint32_t size; // Of the new strip, or of every strip in the group as they are
+    uint32_t new_offset;
+};
+
+// Moves everything from the end of the model data on up by size bytes to make room for more indices. The cache file
+// buffer can move, so nothing can be planned before this.
+static bool cache_model_data_grow(struct cache_file_instance *cache_file, struct tag_fix_plan *plan, uint32_t size) {
+    assert(plan->fix_count == 0);
+    struct tag_data_header *header = cache_file->tag_data.header;
+    uint32_t end = header->vertex_buffers_offset + header->model_data_size;
+    if(!cache_file_insert_range(cache_file, end, size)) {
+        return false;
+    }
+    plan->base = cache_file->data;
+
+    struct cache_raw_data raw_data;
+    if(!cache_raw_data_collect(&raw_data, cache_file)) {
+        return false;
+    }
+
+    TagID plan_tag = plan->tag;
+    for(size_t r = 0; r < raw_data.count; r++) {
+        const struct cache_raw_data_reference *reference = &raw_data.references[r];
+        if(reference->file_offset >= end && reference->size > 0) {
+            plan->tag = reference->tag;
+            TAG_FIX_PLAN_SET(plan, *reference->offset, reference->file_offset + size, "raw data was moved up");
+        }
+    }
+    plan->tag = plan_tag;
+    cache_raw_data_free(&raw_data);
+
+    header = cache_file->tag_data.header;
+    TAG_FIX_PLAN_SET(plan, header->model_data_size, header->model_data_size + size, "triangle strips were added for the vertex cache");
+    return true;
+}
+
+bool cache_model_data_optimize(struct cache_file_instance *cache_file, struct tag_fix_plan *plan, struct cache_model_data_optimization_result *result) {
+    assert(cache_file && cache_file->valid && plan && result);
+    memset(result, 0, sizeof(struct cache_model_data_optimization_result));
+
+    struct cache_model_data_buffers vertices;
+    struct cache_model_data_buffers indices;
+    if(cache_model_data_has_xbox_models(cache_file)) {
+        return true;
+    }
+    if(!cache_model_data_collect(cache_file, &vertices, &indices)) {
+        return false;
+    }
+
+    // Vertices can only be renumbered if nothing else uses them with other indices
+    bool *vertices_shared = calloc(MAX(vertices.count, 1), sizeof(bool));
+    size_t *vertex_order = cache_model_data_sort_by_offset(&vertices);
+    if(!vertices_shared) {
+        abort();
+    }
+    for(size_t o = 0; o < vertices.count;) {
+        bool same;
+        size_t count = cache_model_data_overlapping(&vertices, vertex_order, o, &same);
+        for(size_t i = 0; i < count; i++) {
+            const struct cache_model_data_buffer *partner = &indices.buffers[vertex_order[o + i]];
+            const struct cache_model_data_buffer *first_partner = &indices.buffers[vertex_order[o]];
+            same = same && partner->offset == first_partner->offset && partner->size == first_partner->size;
+        }
+        for(size_t i = 0; i < count; i++) {
+            vertices_shared[vertex_order[o + i]] = !same;
+        }
+        o += count;
+    }
+    free(vertex_order);
+
+    // Work out the new strips first, since making room for the ones that are longer moves everything
+    size_t *index_order = cache_model_data_sort_by_offset(&indices);
+    struct cache_model_data_strip_group *groups = calloc(MAX(indices.count, 1), sizeof(struct cache_model_data_strip_group));
+    if(!groups) {
+        abort();
+    }
+    size_t group_count = 0;
+    for(size_t o = 0; o < indices.count;) {
+        bool same;
+        struct cache_model_data_strip_group *group = &groups[group_count++];
+        group->first = o;
+        group->count = cache_model_data_overlapping(&indices, index_order, o, &same);
+        o += group->count;
+
+        // Strips that overlap without being the same are kept as they are, with the space between them
+        const struct cache_model_data_buffer *index_buffer = &indices.buffers[index_order[group->first]];
+        for(size_t i = 0; i < group->count; i++) {
+            const struct cache_model_data_buffer *buffer = &indices.buffers[index_order[group->first + i]];
+            group->size = MAX(group->size, buffer->offset + buffer->size - index_buffer->offset);
+        }
+        if(!same) {
+            continue;
+        }
+
+        // The strip has to work with the vertices of every part using it
+        uint32_t vertex_count = UINT32_MAX;
+        group->renumber = true;
+        for(size_t i = 0; i < group->count; i++) {
+            size_t part = index_order[group->first + i];
+            vertex_count = MIN(vertex_count, *vertices.buffers[part].count);
+            group->renumber = group->renumber && !vertices_shared[part] && vertices.buffers[part].offset == vertices.buffers[index_order[group->first]].offset;
+        }
+
+        size_t index_count = index_buffer->size / CACHE_MODEL_DATA_INDEX_SIZE;
+        result->strip_count++;
+        group->new_strip = cache_model_data_optimize_strip(indices.data + index_buffer->offset, index_count, vertex_count, &group->new_index_count, result);
+        if(group->new_strip) {
+            group->size = group->new_index_count * CACHE_MODEL_DATA_INDEX_SIZE;
+            result->optimized_count++;
+        }
+    }
+    free(vertices_shared);
+
+    // The strips are laid out again in the same order, so ones that got longer take the space of ones that got shorter
+    // and of the ones they replace. The model data only grows if they do not fit altogether.
+    struct tag_data_header *header = cache_file->tag_data.header;
+    uint32_t index_size = header->model_data_size - header->index_buffers_offset;
+    uint64_t new_index_size = 0;
+    for(size_t g = 0; g < group_count; g++) {
+        groups[g].new_offset = new_index_size;
+        new_index_size += groups[g].size;
+    }
+    result->old_size = header->model_data_size;
+    result->new_size = header->model_data_size;
+
+    bool success = true;
+    if(result->optimized_count > 0 && new_index_size > index_size) {
+        uint32_t added_size = (new_index_size - index_size + 3) / 4 * 4;
+        free(vertices.buffers);
+        free(indices.buffers);
+        success = cache_model_data_grow(cache_file, plan, added_size) && cache_model_data_collect(cache_file, &vertices, &indices);
+        header = cache_file->tag_data.header;
+        index_size += added_size;
+        result->new_size += added_size;
+    }
+    else if(result->optimized_count > 0 && new_index_size < index_size) {
+        result->new_size = header->index_buffers_offset + new_index_size;
+        TAG_FIX_PLAN_SET(plan, header->model_data_size, result->new_size, "triangle strips were reordered for the vertex cache");
+    }
+
+    uint8_t *new_indices = malloc(MAX(new_index_size, 1));
+    if(!new_indices) {
+        abort();
+    }
+    TagID plan_tag = plan->tag;
+    for(size_t g = 0; g < group_count && success && result->optimized_count > 0; g++) {
+        const struct cache_model_data_strip_group *group = &groups[g];
+        const struct cache_model_data_buffer *index_buffer = &indices.buffers[index_order[group->first]];
+        if(!group->new_strip) {
+            memcpy(new_indices + group->new_offset, indices.data + index_buffer->offset, group->size);
+        }
+        else {
+            if(group->renumber) {
+                const struct cache_model_data_buffer *vertex_buffer = &vertices.buffers[index_order[group->first]];
+                uint8_t *new_vertices = malloc(MAX(vertex_buffer->size, 1));
+                if(!new_vertices) {
+                    abort();
+                }
+                plan->tag = vertex_buffer->tag;
+                cache_model_data_renumber_vertices(group->new_strip, group->new_index_count, vertices.data + vertex_buffer->offset, *vertex_buffer->count, new_vertices);
+                tag_fix_plan_write(plan, vertices.data + vertex_buffer->offset, new_vertices, vertex_buffer->size, "vertices were put in triangle strip order");
+                free(new_vertices);
+            }
+            memcpy(new_indices + group->new_offset, group->new_strip, group->size);
+        }
+
+        for(size_t i = 0; i < group->count; i++) {
+            const struct cache_model_data_buffer *buffer = &indices.buffers[index_order[group->first + i]];
+            uint32_t offset = group->new_offset + (buffer->offset - index_buffer->offset);
+            plan->tag = buffer->tag;
+            if(group->new_strip) {
+                TAG_FIX_PLAN_SET(plan, *buffer->count, group->new_index_count - 2, "triangle strip was reordered for the vertex cache");
+            }
+            for(size_t b = 0; b < sizeof(buffer->offsets) / sizeof(buffer->offsets[0]); b++) {
+                if(offset != buffer->offset) {
+                    TAG_FIX_PLAN_SET(plan, *buffer->offsets[b], offset, "triangle strip was moved");
+                }
+            }
+        }
+    }
+    plan->tag = plan_tag;
+
+    if(success && result->optimized_count > 0) {
+        tag_fix_plan_write(plan, indices.data, new_indices, new_index_size, "triangle strips were reordered for the vertex cache");
+        tag_fix_plan_zero(plan, indices.data + new_index_size, index_size - new_index_size, "triangle strips were reordered for the vertex cache");
+    }
+    free(new_indices);
+
+    for(size_t g = 0; g < group_count; g++) {
+        free(groups[g].new_strip);
+    }
+    free(groups);
+    free(index_order);
+    if(success) {
+        free(vertices.buffers);
+        free(indices.buffers);
+    }
+    return success;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "../data_types.h"
+#include "../tag/tag_fix_plan.h"
+#include "cache.h"
+
+// Model data is the raw data the game loads into vertex and index buffers for gbxmodels: the vertices of every
+// geometry part, then the triangle strip indices of every geometry part. Parts often have the same vertices or indices
+// as another part, such as detail levels and permutations that share a mesh, so each distinct buffer only needs to be
+// stored once.
+// Model data used by a geometry part of a gbxmodel, as file offsets
+struct cache_model_data_range {
+    TagID tag;
+    uint32_t start;
+    uint32_t end; // Not included
+};
+
+// Returns the vertices and indices of every geometry part, in tag order. Parts that share a buffer each get a range.
+// Maps with Xbox models have none.
+bool cache_model_data_get_ranges(struct cache_file_instance *cache_file, struct cache_model_data_range **ranges, size_t *range_count);
+
+struct cache_model_data_result {
+    size_t vertex_buffer_count; // Buffers that are now shared with a part that has the same ones
+    size_t index_buffer_count;
+    uint32_t old_size;
+    uint32_t new_size;
+};
+
+// Plans rewriting the model data with one copy of each distinct buffer, pointing the geometry parts and the header at
+// it. The model data then ends at new_size, and what is past it is left for cache_raw_data_plan_removal() to remove.
+// Nothing is planned unless that makes it smaller.
+bool cache_model_data_deduplicate(struct cache_file_instance *cache_file, struct tag_fix_plan *plan, struct cache_model_data_result *result);
+
+// How many vertices are transformed per triangle, summed over all strips
+struct cache_model_data_optimization_result {
+    size_t strip_count;
+    size_t optimized_count; // Strips that were replaced
+    uint32_t old_size; // Of the model data
+    uint32_t new_size;
+    size_t triangle_count;
+    double old_misses;
+    double new_misses;
+};
+
+// Reorders the triangles of every strip for the post-transform vertex cache and strips them again, keeping the new strip
+// if it transforms fewer vertices. The strips are then planned to be written back one after the other, so the model data
+// only grows if the new ones do not fit where the old ones were altogether. Growing moves the cache file buffer. If it
+// shrinks, what is past new_size is left for cache_raw_data_plan_removal() to remove. Vertices are put in the order the
+// new strip uses them unless another strip uses them too. The triangle counts and offsets of the parts are planned to
+// match.
+bool cache_model_data_optimize(struct cache_file_instance *cache_file, struct tag_fix_plan *plan, struct cache_model_data_optimization_result *result);
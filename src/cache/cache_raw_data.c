@@ -0,0 +1,242 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "cache_raw_data.h"
+
+#include "../data_types.h"
+#include "../tag/tag.h"
+#include "../tag/tag_fix_plan.h"
+#include "../tag/tag_fourcc.h"
+#include "../tag_groups/tag_groups.h"
+#include "cache.h"
+#include "../thread/thread_output.h"
+
+// Raw data is kept 4 byte aligned when moved
+#define CACHE_RAW_DATA_ALIGNMENT 4
+
+static void cache_raw_data_add(struct cache_raw_data *raw_data, uint32_t *offset, uint32_t size, TagID tag) {
+    if(raw_data->count == raw_data->capacity) {
+        raw_data->capacity = MAX(raw_data->capacity * 2, 1024);
+        raw_data->references = realloc(raw_data->references, raw_data->capacity * sizeof(struct cache_raw_data_reference));
+        if(!raw_data->references) {
+            abort();
+        }
+    }
+    raw_data->references[raw_data->count++] = (struct cache_raw_data_reference){ offset, *offset, size, tag };
+}
+
+static bool cache_raw_data_collect_bitmap(struct cache_raw_data *raw_data, TagID tag, struct tag_data_instance *tag_data) {
+    struct bitmap *bitmap_group = tag_get(tag, TAG_FOURCC_BITMAP, tag_data);
+    if(!bitmap_group) {
+        thread_output_error("tag data for \"%s.%s\" is invalid\n", tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_BITMAP));
+        return false;
+    }
+
+    for(size_t i = 0; i < bitmap_group->bitmaps.count; i++) {
+        struct bitmap_data *bitmap = bitmap_get_data(bitmap_group, i, tag_data);
+        if(!bitmap) {
+            thread_output_error("bitmap data %zu in \"%s.%s\" is out of bounds\n",
+                i, tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_BITMAP));
+            return false;
+        }
+        if(!TEST_FLAG(bitmap->flags, BITMAP_DATA_FLAGS_EXTERNAL_BIT)) {
+            cache_raw_data_add(raw_data, &bitmap->pixels_offset, bitmap->pixels_size, tag);
+        }
+    }
+    return true;
+}
+
+static bool cache_raw_data_collect_sound(struct cache_raw_data *raw_data, TagID tag, struct tag_data_instance *tag_data) {
+    struct sound *sound = tag_get(tag, TAG_FOURCC_SOUND, tag_data);
+    if(!sound) {
+        thread_output_error("tag data for \"%s.%s\" is invalid\n", tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_SOUND));
+        return false;
+    }
+
+    for(size_t pr = 0; pr < sound->pitch_ranges.count; pr++) {
+        struct sound_pitch_range *pitch_range = sound_get_pitch_range(sound, pr, tag_data);
+        if(!pitch_range) {
+            thread_output_error("sound pitch range %zu in \"%s.%s\" is out of bounds\n",
+                pr, tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_SOUND));
+            return false;
+        }
+
+        for(size_t p = 0; p < pitch_range->permutations.count; p++) {
+            struct sound_permutation *permutation = sound_get_permutation(pitch_range, p, tag_data);
+            if(!permutation) {
+                thread_output_error("sound permutation %zu of pitch range %zu in \"%s.%s\" is out of bounds\n",
+                    p, pr, tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_SOUND));
+                return false;
+            }
+            if(!TEST_FLAG(permutation->samples.flags, TAG_DATA_FLAGS_EXTERNAL_BIT)) {
+                cache_raw_data_add(raw_data, &permutation->samples.file_offset, permutation->samples.size, tag);
+            }
+        }
+    }
+    return true;
+}
+
+bool cache_raw_data_collect(struct cache_raw_data *raw_data, struct cache_file_instance *cache_file) {
+    assert(raw_data && cache_file && cache_file->valid);
+    struct tag_data_instance *tag_data = &cache_file->tag_data;
+    memset(raw_data, 0, sizeof(struct cache_raw_data));
+
+    auto scenario_id = tag_data->header->scenario_tag;
+    struct scenario *scenario = tag_get(scenario_id, TAG_FOURCC_SCENARIO, tag_data);
+    if(!scenario) {
+        thread_output_error("scenario tag is missing or invalid\n");
+        return false;
+    }
+
+    for(size_t i = 0; i < scenario->structure_bsp_references.count; i++) {
+        struct scenario_structure_bsp_reference *bsp_reference = scenario_get_bsp_reference(scenario, i, tag_data);
+        if(!bsp_reference) {
+            thread_output_error("BSP reference %zu in \"%s.%s\" is out of bounds\n",
+                i, tag_path_get(scenario_id, tag_data), tag_fourcc_to_extension(TAG_FOURCC_SCENARIO));
+            cache_raw_data_free(raw_data);
+            return false;
+        }
+        cache_raw_data_add(raw_data, &bsp_reference->offset, bsp_reference->size, scenario_id);
+    }
+
+    if(cache_file_has_model_data(cache_file)) {
+        cache_raw_data_add(raw_data, &tag_data->header->vertex_buffers_offset, tag_data->header->model_data_size, scenario_id);
+    }
+
+    // Resource tags have nothing in this map
+    for(size_t t = 0; t < tag_data->header->tag_count; t++) {
+        struct tag_instance *tag = &tag_data->tags[t];
+        bool success = true;
+        if(tag->primary_group == TAG_FOURCC_BITMAP && !tag_is_external(tag->tag_id, tag_data)) {
+            success = cache_raw_data_collect_bitmap(raw_data, tag->tag_id, tag_data);
+        }
+        else if(tag->primary_group == TAG_FOURCC_SOUND && !tag_is_external(tag->tag_id, tag_data)) {
+            success = cache_raw_data_collect_sound(raw_data, tag->tag_id, tag_data);
+        }
+
+        if(!success) {
+            cache_raw_data_free(raw_data);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void cache_raw_data_free(struct cache_raw_data *raw_data) {
+    assert(raw_data);
+    free(raw_data->references);
+    memset(raw_data, 0, sizeof(struct cache_raw_data));
+}
+
+static int cache_raw_data_compare_ranges(const void *a, const void *b) {
+    const struct cache_file_range *range_a = a;
+    const struct cache_file_range *range_b = b;
+    if(range_a->start != range_b->start) {
+        return range_a->start > range_b->start ? 1 : -1;
+    }
+    return (range_a->end > range_b->end) - (range_a->end < range_b->end);
+}
+
+// Sorted ranges of the raw data that is pointed to, with ranges that touch or overlap merged
+static struct cache_file_range *cache_raw_data_get_ranges(const struct cache_raw_data *raw_data, size_t *range_count) {
+    struct cache_file_range *ranges = calloc(MAX(raw_data->count, 1), sizeof(struct cache_file_range));
+    if(!ranges) {
+        abort();
+    }
+
+    size_t count = 0;
+    for(size_t r = 0; r < raw_data->count; r++) {
+        const struct cache_raw_data_reference *reference = &raw_data->references[r];
+        if(reference->size > 0) {
+            uint64_t end = (uint64_t)reference->file_offset + reference->size;
+            ranges[count++] = (struct cache_file_range){ reference->file_offset, MIN(end, UINT32_MAX) };
+        }
+    }
+    qsort(ranges, count, sizeof(struct cache_file_range), cache_raw_data_compare_ranges);
+
+    size_t merged = 0;
+    for(size_t r = 1; r < count; r++) {
+        if(ranges[r].start <= ranges[merged].end) {
+            ranges[merged].end = MAX(ranges[merged].end, ranges[r].end);
+        }
+        else {
+            ranges[++merged] = ranges[r];
+        }
+    }
+
+    *range_count = count > 0 ? merged + 1 : 0;
+    return ranges;
+}
+
+// How far an offset moves once the ranges are removed
+static uint32_t cache_raw_data_removed_before(const struct cache_file_range *ranges, size_t range_count, uint32_t offset) {
+    uint32_t removed = 0;
+    for(size_t r = 0; r < range_count && ranges[r].start < offset; r++) {
+        removed += MIN(offset, ranges[r].end) - ranges[r].start;
+    }
+    return removed;
+}
+
+size_t cache_raw_data_plan_removal(
+    const struct cache_raw_data *before,
+    const struct cache_raw_data *after,
+    struct cache_file_instance *cache_file,
+    struct tag_fix_plan *plan,
+    struct cache_file_range **ranges,
+    size_t *range_count) {
+
+    assert(before && after && cache_file && cache_file->valid && plan && ranges && range_count);
+    size_t before_count;
+    size_t after_count;
+    struct cache_file_range *before_ranges = cache_raw_data_get_ranges(before, &before_count);
+    struct cache_file_range *after_ranges = cache_raw_data_get_ranges(after, &after_count);
+
+    // Everything before pointed to that nothing points to now, staying clear of the header and the tag data
+    struct cache_file_range *removed = calloc(MAX(before_count + after_count, 1), sizeof(struct cache_file_range));
+    if(!removed) {
+        abort();
+    }
+
+    uint32_t lowest = sizeof(struct cache_file_header);
+    uint32_t highest = cache_file->header->tags_offset;
+    size_t removed_count = 0;
+    size_t a = 0;
+    for(size_t b = 0; b < before_count; b++) {
+        uint32_t start = MAX(before_ranges[b].start, lowest);
+        uint32_t end = MIN(before_ranges[b].end, highest);
+        while(start < end) {
+            while(a < after_count && after_ranges[a].end <= start) {
+                a++;
+            }
+
+            uint32_t hole_end = a < after_count ? MIN(end, MAX(after_ranges[a].start, start)) : end;
+            uint32_t hole_size = (hole_end - start) / CACHE_RAW_DATA_ALIGNMENT * CACHE_RAW_DATA_ALIGNMENT;
+            if(hole_size > 0) {
+                removed[removed_count++] = (struct cache_file_range){ start, start + hole_size };
+            }
+            start = a < after_count ? MAX(hole_end, after_ranges[a].end) : end;
+        }
+    }
+
+    TagID plan_tag = plan->tag;
+    for(size_t r = 0; r < after->count; r++) {
+        const struct cache_raw_data_reference *reference = &after->references[r];
+        uint32_t moved = cache_raw_data_removed_before(removed, removed_count, reference->file_offset);
+        if(moved > 0) {
+            plan->tag = reference->tag;
+            TAG_FIX_PLAN_SET(plan, *reference->offset, reference->file_offset - moved, "raw data was moved down");
+        }
+    }
+    plan->tag = plan_tag;
+
+    size_t removed_size = cache_raw_data_removed_before(removed, removed_count, UINT32_MAX);
+    free(before_ranges);
+    free(after_ranges);
+    *ranges = removed;
+    *range_count = removed_count;
+    return removed_size;
+}
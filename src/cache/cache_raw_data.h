@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "../data_types.h"
+#include "../tag/tag_fix_plan.h"
+#include "cache.h"
+
+// Raw data is what a cache file has between its header and its tag data: BSPs, model vertices and indices, and the
+// pixels and samples of bitmaps and sounds that are not in a resource map. Everything that points into it does so by
+// file offset.
+struct cache_raw_data_reference {
+    uint32_t *offset; // Where the file offset is, in the tag data
+    uint32_t file_offset; // What it was when collected, since externalizing zeroes it
+    uint32_t size;
+    TagID tag;
+};
+
+struct cache_raw_data {
+    struct cache_raw_data_reference *references;
+    size_t count;
+    size_t capacity;
+};
+
+bool cache_raw_data_collect(struct cache_raw_data *raw_data, struct cache_file_instance *cache_file);
+void cache_raw_data_free(struct cache_raw_data *raw_data);
+
+// Finds the raw data that only before points to and plans to move everything in after down over it. The ranges to pass
+// to cache_file_remove_ranges once the plan is applied are returned in ranges. Returns how many bytes are removed.
+size_t cache_raw_data_plan_removal(
+    const struct cache_raw_data *before,
+    const struct cache_raw_data *after,
+    struct cache_file_instance *cache_file,
+    struct tag_fix_plan *plan,
+    struct cache_file_range **ranges,
+    size_t *range_count);
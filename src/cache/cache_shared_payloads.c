@@ -0,0 +1,307 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <assert.h>
+
+#include "cache_shared_payloads.h"
+
+#include "../data_types.h"
+#include "../file/file.h"
+#include "../resources/resource_map.h"
+#include "../tag/tag.h"
+#include "../tag/tag_fourcc.h"
+#include "../thread/thread_pool.h"
+#include "cache.h"
+#include "cache_raw_data.h"
+#include "../thread/thread_output.h"
+
+// What one job found in its map. Asset numbers are local to the map until they are put together.
+struct cache_shared_payloads_map {
+    struct cache_shared_payload *payloads;
+    size_t count;
+    struct cache_shared_payload_asset *assets;
+    size_t asset_count;
+};
+
+struct cache_shared_payloads_job_context {
+    const char **map_paths;
+    struct cache_shared_payloads_map *maps;
+    atomic_bool failed;
+};
+
+// What two maps have in common, added up as the payloads are gone through
+struct cache_shared_payloads_pair {
+    size_t count;
+    uint64_t size;
+};
+
+static int cache_shared_payloads_compare_references(const void *a, const void *b) {
+    const struct cache_raw_data_reference *reference_a = a;
+    const struct cache_raw_data_reference *reference_b = b;
+    if(reference_a->file_offset != reference_b->file_offset) {
+        return reference_a->file_offset > reference_b->file_offset ? 1 : -1;
+    }
+    if(reference_a->size != reference_b->size) {
+        return reference_a->size > reference_b->size ? 1 : -1;
+    }
+    return (reference_a->tag.index > reference_b->tag.index) - (reference_a->tag.index < reference_b->tag.index);
+}
+
+// Raw data pointed to more than once in a map is only stored once, so it is only counted once, for the first tag
+static bool cache_shared_payloads_collect_map(const char *path, struct cache_file_instance *cache_file, struct cache_shared_payloads_map *map) {
+    struct tag_data_instance *tag_data = &cache_file->tag_data;
+    struct cache_raw_data raw_data;
+    if(!cache_raw_data_collect(&raw_data, cache_file)) {
+        return false;
+    }
+    qsort(raw_data.references, raw_data.count, sizeof(struct cache_raw_data_reference), cache_shared_payloads_compare_references);
+
+    size_t *tag_assets = malloc(MAX(tag_data->header->tag_count, 1) * sizeof(size_t));
+    map->payloads = calloc(MAX(raw_data.count, 1), sizeof(struct cache_shared_payload));
+    map->assets = calloc(MAX(tag_data->header->tag_count, 1), sizeof(struct cache_shared_payload_asset));
+    if(!tag_assets || !map->payloads || !map->assets) {
+        abort();
+    }
+    for(size_t t = 0; t < tag_data->header->tag_count; t++) {
+        tag_assets[t] = SIZE_MAX;
+    }
+
+    bool success = true;
+    for(size_t r = 0; r < raw_data.count; r++) {
+        const struct cache_raw_data_reference *reference = &raw_data.references[r];
+        struct tag_instance *tag = &tag_data->tags[reference->tag.index];
+        bool repeated = r > 0 && reference->file_offset == raw_data.references[r - 1].file_offset && reference->size == raw_data.references[r - 1].size;
+        if(repeated || reference->size == 0 || (tag->primary_group != TAG_FOURCC_BITMAP && tag->primary_group != TAG_FOURCC_SOUND)) {
+            continue;
+        }
+
+        if((uint64_t)reference->file_offset + reference->size > cache_file->size) {
+            thread_output_error("%s: Raw data of \"%s.%s\" is out of bounds\n",
+                path, tag_path_get(reference->tag, tag_data), tag_fourcc_to_extension(tag->primary_group));
+            success = false;
+            break;
+        }
+
+        if(tag_assets[reference->tag.index] == SIZE_MAX) {
+            const char *tag_path = tag_path_get(reference->tag, tag_data);
+            const char *extension = tag_fourcc_to_extension(tag->primary_group);
+            size_t length = strlen(tag_path) + 1 + strlen(extension) + 1;
+            char *asset_path = malloc(length);
+            if(!asset_path) {
+                abort();
+            }
+            snprintf(asset_path, length, "%s.%s", tag_path, extension);
+            map->assets[map->asset_count].tag_path = asset_path;
+            tag_assets[reference->tag.index] = map->asset_count++;
+        }
+
+        struct cache_shared_payload *payload = &map->payloads[map->count++];
+        payload->hash = resource_map_hash(RESOURCE_MAP_HASH_NEW, cache_file->data + reference->file_offset, reference->size);
+        payload->size = reference->size;
+        payload->asset = tag_assets[reference->tag.index];
+    }
+
+    free(tag_assets);
+    cache_raw_data_free(&raw_data);
+    return success;
+}
+
+static void cache_shared_payloads_collect_job(size_t job_index, void *context) {
+    struct cache_shared_payloads_job_context *job_context = context;
+    const char *path = job_context->map_paths[job_index];
+
+    // It's less annoying to just skip these
+    if(file_path_is_resource_map(path)) {
+        thread_output_error("%s: Skipped (assuming it's a resource map)\n", path);
+        return;
+    }
+
+    struct cache_file_instance cache_file = {};
+    cache_file_load(path, &cache_file);
+    if(!cache_file.valid) {
+        thread_output_error("%s: Not a valid cache file\n", path);
+        atomic_store(&job_context->failed, true);
+        return;
+    }
+
+    if(!cache_shared_payloads_collect_map(path, &cache_file, &job_context->maps[job_index])) {
+        thread_output_error("%s: Could not read the bitmap and sound data\n", path);
+        atomic_store(&job_context->failed, true);
+    }
+    cache_file_unload(&cache_file);
+}
+
+bool cache_shared_payloads_collect(struct cache_shared_payloads *payloads, const char **map_paths, size_t map_count) {
+    assert(payloads && (map_paths || map_count == 0));
+    memset(payloads, 0, sizeof(struct cache_shared_payloads));
+    payloads->map_paths = map_paths;
+    payloads->map_count = map_count;
+
+    struct cache_shared_payloads_job_context context = {
+        .map_paths = map_paths,
+        .maps = calloc(MAX(map_count, 1), sizeof(struct cache_shared_payloads_map))
+    };
+    if(!context.maps) {
+        abort();
+    }
+    atomic_init(&context.failed, false);
+    thread_pool_run(map_count, cache_shared_payloads_collect_job, &context);
+
+    // Put them together in map order
+    size_t payload_count = 0;
+    size_t asset_count = 0;
+    for(size_t m = 0; m < map_count; m++) {
+        payload_count += context.maps[m].count;
+        asset_count += context.maps[m].asset_count;
+    }
+    payloads->payloads = calloc(MAX(payload_count, 1), sizeof(struct cache_shared_payload));
+    payloads->assets = calloc(MAX(asset_count, 1), sizeof(struct cache_shared_payload_asset));
+    if(!payloads->payloads || !payloads->assets) {
+        abort();
+    }
+    for(size_t m = 0; m < map_count; m++) {
+        struct cache_shared_payloads_map *map = &context.maps[m];
+        for(size_t p = 0; p < map->count; p++) {
+            struct cache_shared_payload *payload = &payloads->payloads[payloads->count++];
+            *payload = map->payloads[p];
+            payload->asset += payloads->asset_count;
+        }
+        for(size_t a = 0; a < map->asset_count; a++) {
+            payloads->assets[payloads->asset_count++] = (struct cache_shared_payload_asset){ map->assets[a].tag_path, m };
+        }
+        free(map->payloads);
+        free(map->assets);
+    }
+    free(context.maps);
+
+    return !atomic_load(&context.failed);
+}
+
+void cache_shared_payloads_free(struct cache_shared_payloads *payloads) {
+    assert(payloads);
+    for(size_t a = 0; a < payloads->asset_count; a++) {
+        free(payloads->assets[a].tag_path);
+    }
+    free(payloads->payloads);
+    free(payloads->assets);
+    memset(payloads, 0, sizeof(struct cache_shared_payloads));
+}
+
+// qsort has no context argument
+static thread_local const struct cache_shared_payloads *cache_shared_payloads_sort_payloads;
+
+static int cache_shared_payloads_compare(const void *a, const void *b) {
+    const struct cache_shared_payload *payload_a = &cache_shared_payloads_sort_payloads->payloads[*(const size_t *)a];
+    const struct cache_shared_payload *payload_b = &cache_shared_payloads_sort_payloads->payloads[*(const size_t *)b];
+    if(payload_a->hash != payload_b->hash) {
+        return payload_a->hash > payload_b->hash ? 1 : -1;
+    }
+    if(payload_a->size != payload_b->size) {
+        return payload_a->size > payload_b->size ? 1 : -1;
+    }
+    return (payload_a->asset > payload_b->asset) - (payload_a->asset < payload_b->asset);
+}
+
+// Pairs are kept in a triangular matrix, every map followed by the maps after it
+static size_t cache_shared_payloads_pair_index(size_t map_count, size_t map, size_t other_map) {
+    assert(map < other_map && other_map < map_count);
+    return map * (2 * map_count - map - 1) / 2 + (other_map - map - 1);
+}
+
+void cache_shared_payloads_print(FILE *stream, const struct cache_shared_payloads *payloads) {
+    assert(stream && payloads);
+
+    // Identical payloads end up next to each other, in map order since assets are numbered in map order
+    size_t *order = calloc(MAX(payloads->count, 1), sizeof(size_t));
+    size_t *maps = calloc(MAX(payloads->map_count, 1), sizeof(size_t));
+    size_t *asset_counts = calloc(MAX(payloads->asset_count, 1), sizeof(size_t));
+    uint64_t *asset_sizes = calloc(MAX(payloads->asset_count, 1), sizeof(uint64_t));
+    uint64_t *asset_duplicated_sizes = calloc(MAX(payloads->asset_count, 1), sizeof(uint64_t));
+    size_t pair_count = payloads->map_count > 1 ? payloads->map_count * (payloads->map_count - 1) / 2 : 0;
+    struct cache_shared_payloads_pair *pairs = calloc(MAX(pair_count, 1), sizeof(struct cache_shared_payloads_pair));
+    if(!order || !maps || !asset_counts || !asset_sizes || !asset_duplicated_sizes || !pairs) {
+        abort();
+    }
+    for(size_t p = 0; p < payloads->count; p++) {
+        order[p] = p;
+    }
+    cache_shared_payloads_sort_payloads = payloads;
+    qsort(order, payloads->count, sizeof(size_t), cache_shared_payloads_compare);
+    cache_shared_payloads_sort_payloads = nullptr;
+
+    uint64_t total_size = 0;
+    uint64_t unique_size = 0;
+    for(size_t o = 0; o < payloads->count;) {
+        const struct cache_shared_payload *first = &payloads->payloads[order[o]];
+        size_t copies = 1;
+        while(o + copies < payloads->count) {
+            const struct cache_shared_payload *copy = &payloads->payloads[order[o + copies]];
+            if(copy->hash != first->hash || copy->size != first->size) {
+                break;
+            }
+            copies++;
+        }
+
+        size_t map_count = 0;
+        for(size_t c = 0; c < copies; c++) {
+            size_t asset = payloads->payloads[order[o + c]].asset;
+            asset_counts[asset]++;
+            asset_sizes[asset] += first->size;
+            asset_duplicated_sizes[asset] += copies > 1 ? first->size : 0;
+            if(map_count == 0 || maps[map_count - 1] != payloads->assets[asset].map) {
+                maps[map_count++] = payloads->assets[asset].map;
+            }
+        }
+        for(size_t m = 0; m < map_count; m++) {
+            for(size_t other = m + 1; other < map_count; other++) {
+                struct cache_shared_payloads_pair *pair = &pairs[cache_shared_payloads_pair_index(payloads->map_count, maps[m], maps[other])];
+                pair->count++;
+                pair->size += first->size;
+            }
+        }
+
+        total_size += (uint64_t)first->size * copies;
+        unique_size += first->size;
+        o += copies;
+    }
+
+    // Assets are in map order too
+    for(size_t m = 0, a = 0; m < payloads->map_count; m++) {
+        size_t first_asset = a;
+        uint64_t map_size = 0;
+        uint64_t map_duplicated_size = 0;
+        for(; a < payloads->asset_count && payloads->assets[a].map == m; a++) {
+            map_size += asset_sizes[a];
+            map_duplicated_size += asset_duplicated_sizes[a];
+        }
+
+        fprintf(stream, "map\t%zu\t%s\t%" PRIu64 "\t%" PRIu64 "\n", m, payloads->map_paths[m], map_size, map_duplicated_size);
+        for(size_t asset = first_asset; asset < a; asset++) {
+            if(asset_duplicated_sizes[asset] > 0) {
+                fprintf(stream, "asset\t%zu\t%s\t%zu\t%" PRIu64 "\t%" PRIu64 "\n",
+                    m, payloads->assets[asset].tag_path, asset_counts[asset], asset_sizes[asset], asset_duplicated_sizes[asset]);
+            }
+        }
+    }
+
+    for(size_t m = 0; m < payloads->map_count; m++) {
+        for(size_t other = m + 1; other < payloads->map_count; other++) {
+            const struct cache_shared_payloads_pair *pair = &pairs[cache_shared_payloads_pair_index(payloads->map_count, m, other)];
+            if(pair->count > 0) {
+                fprintf(stream, "pair\t%zu\t%zu\t%zu\t%" PRIu64 "\n", m, other, pair->count, pair->size);
+            }
+        }
+    }
+
+    fprintf(stream, "total\t%zu\t%" PRIu64 "\t%" PRIu64 "\n", payloads->map_count, total_size, unique_size);
+
+    free(pairs);
+    free(order);
+    free(maps);
+    free(asset_counts);
+    free(asset_sizes);
+    free(asset_duplicated_sizes);
+}
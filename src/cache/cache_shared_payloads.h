@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// The pixels of bitmaps and the samples of sounds that are stored in a map rather than in a resource map. Maps made
+// with the same custom tags carry the same payloads, so comparing them across a set of maps shows what could be stored
+// once or moved into shared resource maps.
+struct cache_shared_payload {
+    uint64_t hash;
+    uint32_t size;
+    uint32_t asset; // Which asset it belongs to
+};
+
+// A bitmap or sound tag in one of the maps
+struct cache_shared_payload_asset {
+    char *tag_path; // With the extension
+    size_t map; // Which of the paths it is in
+};
+
+struct cache_shared_payloads {
+    struct cache_shared_payload *payloads;
+    size_t count;
+    struct cache_shared_payload_asset *assets;
+    size_t asset_count;
+    const char **map_paths;
+    size_t map_count;
+};
+
+// Hashes the payloads of every map, a map per thread pool job. Payloads are told apart by hash and size. Maps that can
+// not be read are reported, and false is returned once the rest are done.
+bool cache_shared_payloads_collect(struct cache_shared_payloads *payloads, const char **map_paths, size_t map_count);
+void cache_shared_payloads_free(struct cache_shared_payloads *payloads);
+
+// Prints a tab separated line per record, starting with the record type:
+//   map    <map> <path> <payload bytes> <duplicated bytes>
+//   asset  <map> <tag path> <payload count> <payload bytes> <duplicated bytes>
+//   pair   <map> <other map> <shared payload count> <shared bytes>
+//   total  <map count> <payload bytes> <unique bytes>
+// Maps are numbered in the order they were given. Duplicated bytes are those of payloads that have another copy in the
+// set, in any map. Only assets and pairs with something duplicated or shared are printed.
+void cache_shared_payloads_print(FILE *stream, const struct cache_shared_payloads *payloads);
@@ -0,0 +1,455 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <assert.h>
+
+#include "cache_size_report.h"
+
+#include "../data_types.h"
+#include "../tag/tag.h"
+#include "../tag/tag_fourcc.h"
+#include "../tag/tag_schema.h"
+#include "../tag_groups/tag_groups.h"
+#include "cache.h"
+#include "cache_model_data.h"
+#include "cache_raw_data.h"
+#include "../thread/thread_output.h"
+
+#define CACHE_SIZE_REPORT_NO_TAG SIZE_MAX
+
+static const char *cache_size_report_category_names[] = {
+    "cache header",
+    "structure bsps",
+    "bitmap data",
+    "sound data",
+    "model data",
+    "tag data header",
+    "tag array",
+    "tag paths",
+    "base structs",
+    "reflexives",
+    "data",
+    "gaps"
+};
+static_assert(sizeof(cache_size_report_category_names) / sizeof(char *) == NUMBER_OF_CACHE_SIZE_REPORT_CATEGORIES);
+
+static const char *cache_size_report_region_names[] = {
+    "raw data",
+    "model data",
+    "tag data",
+    "outside"
+};
+static_assert(sizeof(cache_size_report_region_names) / sizeof(char *) == NUMBER_OF_CACHE_SIZE_REPORT_REGIONS);
+
+// Something using a range of file offsets
+struct cache_size_report_range {
+    uint32_t start;
+    uint32_t end;
+    size_t tag;
+    uint8_t category;
+};
+
+struct cache_size_report_walk {
+    struct cache_file_instance *cache_file;
+    struct cache_size_report_range *ranges;
+    size_t range_count;
+    size_t range_capacity;
+};
+
+static void cache_size_report_add_range(struct cache_size_report_walk *walk, uint64_t start, uint64_t end, size_t tag, uint8_t category) {
+    end = MIN(end, walk->cache_file->size);
+    if(start >= end) {
+        return;
+    }
+
+    if(walk->range_count == walk->range_capacity) {
+        walk->range_capacity = MAX(walk->range_capacity * 2, 1024);
+        walk->ranges = realloc(walk->ranges, walk->range_capacity * sizeof(struct cache_size_report_range));
+        if(!walk->ranges) {
+            abort();
+        }
+    }
+    walk->ranges[walk->range_count++] = (struct cache_size_report_range){ start, end, tag, category };
+}
+
+// Blocks of BSPs are left to the BSP they are in
+static void cache_size_report_visit_block(const struct tag_schema_block *block, void *context) {
+    struct cache_size_report_walk *walk = context;
+    struct tag_data_instance *tag_data = &walk->cache_file->tag_data;
+    if(block->space->data != tag_data->data || !block->data || block->size == 0) {
+        return;
+    }
+
+    uint8_t category;
+    switch(block->type) {
+        case TAG_SCHEMA_BLOCK_TYPE_BASE_STRUCT:
+            category = CACHE_SIZE_REPORT_CATEGORY_BASE_STRUCTS;
+            break;
+        case TAG_SCHEMA_BLOCK_TYPE_REFLEXIVE:
+            category = CACHE_SIZE_REPORT_CATEGORY_REFLEXIVES;
+            break;
+        case TAG_SCHEMA_BLOCK_TYPE_DATA:
+            category = CACHE_SIZE_REPORT_CATEGORY_DATA;
+            break;
+        default:
+            return;
+    }
+
+    uint32_t start = block->data - walk->cache_file->data;
+    cache_size_report_add_range(walk, start, (uint64_t)start + block->size, block->tag.index, category);
+}
+
+static bool cache_size_report_collect_raw_data(struct cache_size_report_walk *walk) {
+    struct cache_file_instance *cache_file = walk->cache_file;
+    struct tag_data_instance *tag_data = &cache_file->tag_data;
+
+    struct scenario *scenario = tag_get(tag_data->header->scenario_tag, TAG_FOURCC_SCENARIO, tag_data);
+    if(!scenario) {
+        thread_output_error("scenario tag is missing or invalid\n");
+        return false;
+    }
+    for(size_t i = 0; i < scenario->structure_bsp_references.count; i++) {
+        struct scenario_structure_bsp_reference *bsp_reference = scenario_get_bsp_reference(scenario, i, tag_data);
+        if(!bsp_reference) {
+            thread_output_error("BSP reference %zu in \"%s.%s\" is out of bounds\n",
+                i, tag_path_get(tag_data->header->scenario_tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_SCENARIO));
+            return false;
+        }
+        size_t bsp = tag_id_is_valid_tag(bsp_reference->structure_bsp.index, tag_data) ? bsp_reference->structure_bsp.index.index : CACHE_SIZE_REPORT_NO_TAG;
+        cache_size_report_add_range(walk, bsp_reference->offset, (uint64_t)bsp_reference->offset + bsp_reference->size, bsp, CACHE_SIZE_REPORT_CATEGORY_STRUCTURE_BSPS);
+    }
+
+    // BSPs and the model data are done separately so they are attributed to the right tags
+    struct cache_raw_data raw_data;
+    if(!cache_raw_data_collect(&raw_data, cache_file)) {
+        return false;
+    }
+    for(size_t r = 0; r < raw_data.count; r++) {
+        const struct cache_raw_data_reference *reference = &raw_data.references[r];
+        uint32_t tag_group = tag_data->tags[reference->tag.index].primary_group;
+        if(tag_group == TAG_FOURCC_BITMAP || tag_group == TAG_FOURCC_SOUND) {
+            uint8_t category = tag_group == TAG_FOURCC_BITMAP ? CACHE_SIZE_REPORT_CATEGORY_BITMAP_DATA : CACHE_SIZE_REPORT_CATEGORY_SOUND_DATA;
+            cache_size_report_add_range(walk, reference->file_offset, (uint64_t)reference->file_offset + reference->size, reference->tag.index, category);
+        }
+    }
+    cache_raw_data_free(&raw_data);
+
+    // Leaving it to the gaps is more useful than no report at all
+    struct cache_model_data_range *model_ranges;
+    size_t model_range_count;
+    if(!cache_model_data_get_ranges(cache_file, &model_ranges, &model_range_count)) {
+        thread_output_error("model data is reported as gaps\n");
+        return true;
+    }
+    for(size_t r = 0; r < model_range_count; r++) {
+        const struct cache_model_data_range *range = &model_ranges[r];
+        cache_size_report_add_range(walk, range->start, range->end, range->tag.index, CACHE_SIZE_REPORT_CATEGORY_MODEL_DATA);
+    }
+    free(model_ranges);
+    return true;
+}
+
+static int cache_size_report_compare_ranges(const void *a, const void *b) {
+    const struct cache_size_report_range *range_a = a;
+    const struct cache_size_report_range *range_b = b;
+    if(range_a->start != range_b->start) {
+        return range_a->start > range_b->start ? 1 : -1;
+    }
+    return (range_a->end < range_b->end) - (range_a->end > range_b->end);
+}
+
+static void cache_size_report_add_gap(struct cache_size_report *report, size_t *gap_capacity, const struct cache_file_instance *cache_file, uint32_t start, uint32_t end) {
+    // Xbox maps have no model data region, so the raw data goes up to the tag data
+    const struct tag_data_header *header = cache_file->tag_data.header;
+    uint64_t model_data_start = cache_file->header->tags_offset;
+    uint64_t model_data_end = model_data_start;
+    if(cache_file_has_model_data(cache_file)) {
+        model_data_start = header->vertex_buffers_offset;
+        model_data_end = model_data_start + header->model_data_size;
+    }
+    uint64_t tag_data_end = (uint64_t)cache_file->header->tags_offset + cache_file->header->tags_size;
+    const struct {
+        uint64_t start;
+        uint64_t end;
+        uint8_t region;
+    } regions[] = {
+        { sizeof(struct cache_file_header), model_data_start, CACHE_SIZE_REPORT_REGION_RAW_DATA },
+        { model_data_start, model_data_end, CACHE_SIZE_REPORT_REGION_MODEL_DATA },
+        { cache_file->header->tags_offset, tag_data_end, CACHE_SIZE_REPORT_REGION_TAG_DATA }
+    };
+
+    // Split up where the gap crosses into another region
+    while(start < end) {
+        uint8_t region = CACHE_SIZE_REPORT_REGION_OUTSIDE;
+        uint64_t piece_end = end;
+        for(size_t r = 0; r < sizeof(regions) / sizeof(regions[0]); r++) {
+            if(start >= regions[r].start && start < regions[r].end) {
+                region = regions[r].region;
+                piece_end = MIN(piece_end, regions[r].end);
+            }
+            else if(regions[r].start > start) {
+                piece_end = MIN(piece_end, regions[r].start);
+            }
+        }
+
+        if(report->gap_count == *gap_capacity) {
+            *gap_capacity = MAX(*gap_capacity * 2, 64);
+            report->gaps = realloc(report->gaps, *gap_capacity * sizeof(struct cache_size_report_gap));
+            if(!report->gaps) {
+                abort();
+            }
+        }
+        report->gaps[report->gap_count++] = (struct cache_size_report_gap){ start, piece_end - start, region };
+        report->category_sizes[CACHE_SIZE_REPORT_CATEGORY_GAPS] += piece_end - start;
+        start = piece_end;
+    }
+}
+
+bool cache_size_report_build(struct cache_size_report *report, struct cache_file_instance *cache_file) {
+    assert(report && cache_file && cache_file->valid);
+    struct tag_data_instance *tag_data = &cache_file->tag_data;
+    memset(report, 0, sizeof(struct cache_size_report));
+    report->size = cache_file->size;
+    report->tag_count = tag_data->header->tag_count;
+    report->tag_sizes = calloc(MAX(report->tag_count, 1), sizeof(report->tag_sizes[0]));
+    if(!report->tag_sizes) {
+        abort();
+    }
+
+    struct cache_size_report_walk walk = {
+        .cache_file = cache_file
+    };
+    uint32_t tags_offset = cache_file->header->tags_offset;
+    uint32_t tag_array_offset = (uint8_t *)tag_data->tags - cache_file->data;
+    cache_size_report_add_range(&walk, 0, sizeof(struct cache_file_header), CACHE_SIZE_REPORT_NO_TAG, CACHE_SIZE_REPORT_CATEGORY_CACHE_HEADER);
+    cache_size_report_add_range(&walk, tags_offset, (uint64_t)tags_offset + tag_data->header_size, CACHE_SIZE_REPORT_NO_TAG, CACHE_SIZE_REPORT_CATEGORY_TAG_DATA_HEADER);
+    cache_size_report_add_range(&walk, tag_array_offset, tag_array_offset + (uint64_t)report->tag_count * sizeof(struct tag_instance), CACHE_SIZE_REPORT_NO_TAG, CACHE_SIZE_REPORT_CATEGORY_TAG_ARRAY);
+    for(size_t t = 0; t < report->tag_count; t++) {
+        if(tag_data->tags[t].tag_id.index != t) {
+            continue;
+        }
+        const char *tag_path = tag_path_get_maybe(tag_data->tags[t].tag_id, tag_data);
+        if(tag_path) {
+            uint32_t start = (const uint8_t *)tag_path - cache_file->data;
+            cache_size_report_add_range(&walk, start, (uint64_t)start + strlen(tag_path) + 1, t, CACHE_SIZE_REPORT_CATEGORY_TAG_PATHS);
+        }
+    }
+
+    struct tag_schema_visitor visitor = {
+        .block = cache_size_report_visit_block,
+        .context = &walk
+    };
+    if(!tag_schema_walk(&visitor, cache_file) || !cache_size_report_collect_raw_data(&walk)) {
+        free(walk.ranges);
+        cache_size_report_free(report);
+        return false;
+    }
+
+    // Whatever starts first gets the bytes, and anything before the next range that nothing got is a gap
+    qsort(walk.ranges, walk.range_count, sizeof(struct cache_size_report_range), cache_size_report_compare_ranges);
+    size_t gap_capacity = 0;
+    uint32_t position = 0;
+    for(size_t r = 0; r < walk.range_count; r++) {
+        const struct cache_size_report_range *range = &walk.ranges[r];
+        if(range->start > position) {
+            cache_size_report_add_gap(report, &gap_capacity, cache_file, position, range->start);
+            position = range->start;
+        }
+        if(range->end <= position) {
+            continue;
+        }
+
+        uint32_t size = range->end - position;
+        report->category_sizes[range->category] += size;
+        if(range->tag != CACHE_SIZE_REPORT_NO_TAG) {
+            report->tag_sizes[range->tag][range->category] += size;
+        }
+        position = range->end;
+    }
+    cache_size_report_add_gap(report, &gap_capacity, cache_file, position, cache_file->size);
+
+    free(walk.ranges);
+    return true;
+}
+
+void cache_size_report_free(struct cache_size_report *report) {
+    assert(report);
+    free(report->tag_sizes);
+    free(report->gaps);
+    memset(report, 0, sizeof(struct cache_size_report));
+}
+
+// Sorting from biggest to smallest. qsort has no context argument.
+static thread_local const uint64_t *cache_size_report_sort_sizes;
+
+static int cache_size_report_compare_sizes(const void *a, const void *b) {
+    size_t index_a = *(const size_t *)a;
+    size_t index_b = *(const size_t *)b;
+    uint64_t size_a = cache_size_report_sort_sizes[index_a];
+    uint64_t size_b = cache_size_report_sort_sizes[index_b];
+    if(size_a != size_b) {
+        return size_a < size_b ? 1 : -1;
+    }
+    return (index_a > index_b) - (index_a < index_b);
+}
+
+static int cache_size_report_compare_gaps(const void *a, const void *b) {
+    const struct cache_size_report_gap *gap_a = a;
+    const struct cache_size_report_gap *gap_b = b;
+    if(gap_a->size != gap_b->size) {
+        return gap_a->size < gap_b->size ? 1 : -1;
+    }
+    return (gap_a->offset > gap_b->offset) - (gap_a->offset < gap_b->offset);
+}
+
+static size_t *cache_size_report_sort(const uint64_t *sizes, size_t count) {
+    size_t *order = calloc(MAX(count, 1), sizeof(size_t));
+    if(!order) {
+        abort();
+    }
+    for(size_t i = 0; i < count; i++) {
+        order[i] = i;
+    }
+    cache_size_report_sort_sizes = sizes;
+    qsort(order, count, sizeof(size_t), cache_size_report_compare_sizes);
+    cache_size_report_sort_sizes = nullptr;
+    return order;
+}
+
+// Tag paths are not necessarily UTF-8, so anything outside of ASCII is escaped as if it is Latin-1
+static void cache_size_report_print_json_string(FILE *stream, const char *string) {
+    fputc('"', stream);
+    for(const uint8_t *c = (const uint8_t *)string; *c; c++) {
+        if(*c == '"' || *c == '\\') {
+            fprintf(stream, "\\%c", *c);
+        }
+        else if(*c < 0x20 || *c >= 0x7F) {
+            fprintf(stream, "\\u%04x", *c);
+        }
+        else {
+            fputc(*c, stream);
+        }
+    }
+    fputc('"', stream);
+}
+
+void cache_size_report_print(FILE *stream, const struct cache_size_report *report, const char *path, struct cache_file_instance *cache_file, bool json) {
+    assert(stream && report && path && cache_file && cache_file->valid);
+    struct tag_data_instance *tag_data = &cache_file->tag_data;
+    double percent = report->size > 0 ? 100.0 / report->size : 0.0;
+
+    // Groups are gathered by primary group, in the order they first appear
+    uint64_t *tag_totals = calloc(MAX(report->tag_count, 1), sizeof(uint64_t));
+    uint32_t *groups = calloc(MAX(report->tag_count, 1), sizeof(uint32_t));
+    uint64_t *group_sizes = calloc(MAX(report->tag_count, 1), sizeof(uint64_t));
+    size_t *group_tag_counts = calloc(MAX(report->tag_count, 1), sizeof(size_t));
+    if(!tag_totals || !groups || !group_sizes || !group_tag_counts) {
+        abort();
+    }
+    size_t group_count = 0;
+    for(size_t t = 0; t < report->tag_count; t++) {
+        for(size_t c = 0; c < NUMBER_OF_CACHE_SIZE_REPORT_CATEGORIES; c++) {
+            tag_totals[t] += report->tag_sizes[t][c];
+        }
+        if(tag_totals[t] == 0) {
+            continue;
+        }
+
+        size_t g = 0;
+        while(g < group_count && groups[g] != tag_data->tags[t].primary_group) {
+            g++;
+        }
+        if(g == group_count) {
+            groups[group_count++] = tag_data->tags[t].primary_group;
+        }
+        group_sizes[g] += tag_totals[t];
+        group_tag_counts[g]++;
+    }
+
+    size_t *category_order = cache_size_report_sort(report->category_sizes, NUMBER_OF_CACHE_SIZE_REPORT_CATEGORIES);
+    size_t *group_order = cache_size_report_sort(group_sizes, group_count);
+    size_t *tag_order = cache_size_report_sort(tag_totals, report->tag_count);
+    struct cache_size_report_gap *gaps = calloc(MAX(report->gap_count, 1), sizeof(struct cache_size_report_gap));
+    if(!gaps) {
+        abort();
+    }
+    memcpy(gaps, report->gaps, report->gap_count * sizeof(struct cache_size_report_gap));
+    qsort(gaps, report->gap_count, sizeof(struct cache_size_report_gap), cache_size_report_compare_gaps);
+
+    if(json) {
+        fprintf(stream, "{\"path\":");
+        cache_size_report_print_json_string(stream, path);
+        fprintf(stream, ",\"size\":%" PRIu64 ",\"categories\":[", report->size);
+        for(size_t i = 0; i < NUMBER_OF_CACHE_SIZE_REPORT_CATEGORIES; i++) {
+            size_t c = category_order[i];
+            fprintf(stream, "%s{\"category\":\"%s\",\"size\":%" PRIu64 "}", i > 0 ? "," : "", cache_size_report_category_names[c], report->category_sizes[c]);
+        }
+
+        fprintf(stream, "],\"groups\":[");
+        for(size_t i = 0; i < group_count; i++) {
+            size_t g = group_order[i];
+            fprintf(stream, "%s{\"group\":\"%s\",\"tags\":%zu,\"size\":%" PRIu64 "}",
+                i > 0 ? "," : "", tag_fourcc_to_extension(groups[g]), group_tag_counts[g], group_sizes[g]);
+        }
+
+        fprintf(stream, "],\"tags\":[");
+        for(size_t i = 0; i < report->tag_count && tag_totals[tag_order[i]] > 0; i++) {
+            size_t t = tag_order[i];
+            fprintf(stream, "%s{\"path\":", i > 0 ? "," : "");
+            cache_size_report_print_json_string(stream, tag_path_get(tag_data->tags[t].tag_id, tag_data));
+            fprintf(stream, ",\"group\":\"%s\",\"size\":%" PRIu64 ",\"categories\":{", tag_fourcc_to_extension(tag_data->tags[t].primary_group), tag_totals[t]);
+            bool first = true;
+            for(size_t c = 0; c < NUMBER_OF_CACHE_SIZE_REPORT_CATEGORIES; c++) {
+                if(report->tag_sizes[t][c] > 0) {
+                    fprintf(stream, "%s\"%s\":%" PRIu64, first ? "" : ",", cache_size_report_category_names[c], report->tag_sizes[t][c]);
+                    first = false;
+                }
+            }
+            fprintf(stream, "}}");
+        }
+
+        fprintf(stream, "],\"gaps\":[");
+        for(size_t i = 0; i < report->gap_count; i++) {
+            fprintf(stream, "%s{\"region\":\"%s\",\"offset\":%u,\"size\":%u}",
+                i > 0 ? "," : "", cache_size_report_region_names[gaps[i].region], gaps[i].offset, gaps[i].size);
+        }
+        fprintf(stream, "]}");
+    }
+    else {
+        fprintf(stream, "%s: %" PRIu64 " bytes\n", path, report->size);
+        fprintf(stream, "Categories:\n");
+        for(size_t i = 0; i < NUMBER_OF_CACHE_SIZE_REPORT_CATEGORIES; i++) {
+            size_t c = category_order[i];
+            fprintf(stream, "  %12" PRIu64 " %6.2f%%  %s\n", report->category_sizes[c], report->category_sizes[c] * percent, cache_size_report_category_names[c]);
+        }
+
+        fprintf(stream, "Tag groups:\n");
+        for(size_t i = 0; i < group_count; i++) {
+            size_t g = group_order[i];
+            fprintf(stream, "  %12" PRIu64 " %6.2f%%  %s (%zu tags)\n", group_sizes[g], group_sizes[g] * percent, tag_fourcc_to_extension(groups[g]), group_tag_counts[g]);
+        }
+
+        fprintf(stream, "Tags:\n");
+        for(size_t i = 0; i < report->tag_count && tag_totals[tag_order[i]] > 0; i++) {
+            size_t t = tag_order[i];
+            fprintf(stream, "  %12" PRIu64 " %6.2f%%  %s.%s\n", tag_totals[t], tag_totals[t] * percent,
+                tag_path_get(tag_data->tags[t].tag_id, tag_data), tag_fourcc_to_extension(tag_data->tags[t].primary_group));
+        }
+
+        fprintf(stream, "Gaps:\n");
+        for(size_t i = 0; i < report->gap_count; i++) {
+            fprintf(stream, "  %12u %6.2f%%  at %#x in %s\n", gaps[i].size, gaps[i].size * percent, gaps[i].offset, cache_size_report_region_names[gaps[i].region]);
+        }
+    }
+
+    free(tag_totals);
+    free(groups);
+    free(group_sizes);
+    free(group_tag_counts);
+    free(category_order);
+    free(group_order);
+    free(tag_order);
+    free(gaps);
+}
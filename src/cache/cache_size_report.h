@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "../data_types.h"
+#include "cache.h"
+
+// A size report attributes every byte of a cache file to what uses it. Where two things use the same bytes, such as
+// blocks shared by deduplication, the one that starts first (or is bigger) gets them. Bytes nothing uses are gaps.
+enum cache_size_report_category {
+    CACHE_SIZE_REPORT_CATEGORY_CACHE_HEADER,
+    CACHE_SIZE_REPORT_CATEGORY_STRUCTURE_BSPS,
+    CACHE_SIZE_REPORT_CATEGORY_BITMAP_DATA,
+    CACHE_SIZE_REPORT_CATEGORY_SOUND_DATA,
+    CACHE_SIZE_REPORT_CATEGORY_MODEL_DATA,
+    CACHE_SIZE_REPORT_CATEGORY_TAG_DATA_HEADER,
+    CACHE_SIZE_REPORT_CATEGORY_TAG_ARRAY,
+    CACHE_SIZE_REPORT_CATEGORY_TAG_PATHS,
+    CACHE_SIZE_REPORT_CATEGORY_BASE_STRUCTS,
+    CACHE_SIZE_REPORT_CATEGORY_REFLEXIVES,
+    CACHE_SIZE_REPORT_CATEGORY_DATA,
+    CACHE_SIZE_REPORT_CATEGORY_GAPS,
+    NUMBER_OF_CACHE_SIZE_REPORT_CATEGORIES
+};
+
+// Which part of the cache file a gap is in
+enum cache_size_report_region {
+    CACHE_SIZE_REPORT_REGION_RAW_DATA,
+    CACHE_SIZE_REPORT_REGION_MODEL_DATA,
+    CACHE_SIZE_REPORT_REGION_TAG_DATA,
+    CACHE_SIZE_REPORT_REGION_OUTSIDE, // Between the model data and the tag data, or after the tag data
+    NUMBER_OF_CACHE_SIZE_REPORT_REGIONS
+};
+
+struct cache_size_report_gap {
+    uint32_t offset;
+    uint32_t size;
+    uint8_t region;
+};
+
+struct cache_size_report {
+    uint64_t size;
+    uint64_t category_sizes[NUMBER_OF_CACHE_SIZE_REPORT_CATEGORIES];
+    uint64_t (*tag_sizes)[NUMBER_OF_CACHE_SIZE_REPORT_CATEGORIES]; // Per tag, by index
+    size_t tag_count;
+    struct cache_size_report_gap *gaps;
+    size_t gap_count;
+};
+
+// Attributes the whole cache file in one pass over everything that points into it
+bool cache_size_report_build(struct cache_size_report *report, struct cache_file_instance *cache_file);
+void cache_size_report_free(struct cache_size_report *report);
+
+// Prints the categories, tag groups, tags and gaps, each sorted from biggest to smallest, either as text or as a JSON
+// object
+void cache_size_report_print(FILE *stream, const struct cache_size_report *report, const char *path, struct cache_file_instance *cache_file, bool json);
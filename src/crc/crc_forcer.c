@@ -27,6 +27,7 @@
 #include <assert.h>
 
 #include "crc_forcer.h"
+#include "../thread/thread_output.h"
 
 /* Forward declarations */
 
@@ -81,7 +82,7 @@ static uint64_t pow_mod(uint64_t x, uint64_t y) {
 // Computes polynomial x divided by polynomial y, returning the quotient and remainder.
 static void divide_and_remainder(uint64_t x, uint64_t y, uint64_t q[static 1], uint64_t r[static 1]) {
     if (y == 0) {
-        fprintf(stderr, "Division by zero\n");
+        thread_output_error("Division by zero\n");
         exit(EXIT_FAILURE);
     }
     if (x == 0) {
@@ -121,7 +122,7 @@ static uint64_t reciprocal_mod(uint64_t x) {
     if (x == 1)
         return a;
     else {
-        fprintf(stderr, "Reciprocal does not exist\n");
+        thread_output_error("Reciprocal does not exist\n");
         exit(EXIT_FAILURE);
     }
 }
@@ -3,14 +3,24 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
 
 #include "file.h"
+#include "../thread/thread_output.h"
 
 void file_read_into_buffer(const char *path, uint8_t **buffer, size_t *buffer_size) {
     assert(path && buffer && buffer_size);
     FILE *f = fopen(path, "rb");
     if(!f) {
-        fprintf(stderr, "%s: Failed to open\n", path);
+        thread_output_error("%s: Failed to open\n", path);
         *buffer = nullptr;
         return;
     }
@@ -20,7 +30,7 @@ void file_read_into_buffer(const char *path, uint8_t **buffer, size_t *buffer_si
     fseek(f, 0, SEEK_SET);
     uint8_t *input_buffer = calloc(input_buffer_size, 1);
     if(!input_buffer) {
-        fprintf(stderr, "%s: Failed to allocate memory\n", path);
+        thread_output_error("%s: Failed to allocate memory\n", path);
         fclose(f);
         *buffer = nullptr;
         return;
@@ -38,13 +48,13 @@ bool file_write_from_buffer(const char *path, uint8_t *buffer, size_t buffer_siz
     FILE *f = fopen(path, "wb");
     if(f) {
         if(!fwrite(buffer, buffer_size, 1, f)) {
-            fprintf(stderr, "%s: Write failed. The map is likely fucked now! LOL\n", path);
+            thread_output_error("%s: Write failed. The map is likely fucked now! LOL\n", path);
             success = false;
         }
         fclose(f);
     }
     else {
-        fprintf(stderr, "%s: Can not open file for writing\n", path);
+        thread_output_error("%s: Can not open file for writing\n", path);
         success = false;
     }
 
@@ -65,3 +75,60 @@ bool file_path_is_resource_map(const char *path) {
     }
     return false;
 }
+
+// Quiet if the file can not be opened, since callers may not need it to exist
+bool file_map_read_only(const char *path, struct file_mapping *mapping) {
+    assert(path && mapping);
+    memset(mapping, 0, sizeof(struct file_mapping));
+
+    struct stat file_status;
+    if(stat(path, &file_status) != 0 || file_status.st_size <= 0) {
+        return false;
+    }
+    mapping->size = file_status.st_size;
+    mapping->modified_time = file_status.st_mtime;
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    HANDLE file_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if(!file_mapping) {
+        return false;
+    }
+    mapping->data = MapViewOfFile(file_mapping, FILE_MAP_READ, 0, 0, 0);
+    if(!mapping->data) {
+        CloseHandle(file_mapping);
+        return false;
+    }
+    mapping->handle = file_mapping;
+#else
+    int file = open(path, O_RDONLY);
+    if(file < 0) {
+        return false;
+    }
+    void *data = mmap(nullptr, mapping->size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if(data == MAP_FAILED) {
+        return false;
+    }
+    mapping->data = data;
+#endif
+
+    return true;
+}
+
+void file_unmap(struct file_mapping *mapping) {
+    assert(mapping);
+    if(mapping->data) {
+#ifdef _WIN32
+        UnmapViewOfFile(mapping->data);
+        CloseHandle(mapping->handle);
+#else
+        munmap((void *)mapping->data, mapping->size);
+#endif
+    }
+    memset(mapping, 0, sizeof(struct file_mapping));
+}
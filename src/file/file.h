@@ -1,7 +1,18 @@
 #pragma once
 
 #include <stdint.h>
+#include <stddef.h>
+
+// A read only view of a whole file
+struct file_mapping {
+    const uint8_t *data;
+    size_t size;
+    int64_t modified_time;
+    void *handle;
+};
 
 void file_read_into_buffer(const char *path, uint8_t **buffer, size_t *buffer_size);
 bool file_write_from_buffer(const char *path, uint8_t *buffer, size_t buffer_size);
 bool file_path_is_resource_map(const char *path);
+bool file_map_read_only(const char *path, struct file_mapping *mapping);
+void file_unmap(struct file_mapping *mapping);
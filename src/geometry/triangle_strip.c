@@ -0,0 +1,328 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "triangle_strip.h"
+
+#include "../data_types.h"
+
+#define TRIANGLE_STRIP_NONE SIZE_MAX
+
+// How far past the first triangle left in the list a strip can take a triangle from to keep going. Further than this
+// and the strip wanders off from the vertices the list order keeps in the cache.
+#define TRIANGLE_STRIP_LOOKAHEAD 8
+
+// The optimizer models a least recently used cache of this many vertices. Vertices used by more triangles than the
+// valence table covers score the same as the last entry.
+#define TRIANGLE_STRIP_OPTIMIZER_CACHE_SIZE 32
+#define TRIANGLE_STRIP_OPTIMIZER_MAX_VALENCE 32
+
+// 0.75 for the last triangle's vertices, then (1 - (position - 3) / (cache size - 3)) ^ 1.5
+static const float triangle_strip_cache_position_scores[TRIANGLE_STRIP_OPTIMIZER_CACHE_SIZE] = {
+    0.750000f, 0.750000f, 0.750000f, 1.000000f, 0.948724f, 0.898356f, 0.848913f, 0.800411f,
+    0.752870f, 0.706309f, 0.660750f, 0.616215f, 0.572727f, 0.530314f, 0.489003f, 0.448824f,
+    0.409810f, 0.371997f, 0.335425f, 0.300136f, 0.266180f, 0.233610f, 0.202490f, 0.172889f,
+    0.144890f, 0.118591f, 0.094109f, 0.071591f, 0.051226f, 0.033272f, 0.018111f, 0.006403f
+};
+
+// 2 / sqrt(triangles left), so vertices with few triangles left get finished off
+static const float triangle_strip_valence_scores[TRIANGLE_STRIP_OPTIMIZER_MAX_VALENCE + 1] = {
+    0.000000f, 2.000000f, 1.414214f, 1.154701f, 1.000000f, 0.894427f, 0.816497f, 0.755929f,
+    0.707107f, 0.666667f, 0.632456f, 0.603023f, 0.577350f, 0.554700f, 0.534522f, 0.516398f,
+    0.500000f, 0.485071f, 0.471405f, 0.458831f, 0.447214f, 0.436436f, 0.426401f, 0.417029f,
+    0.408248f, 0.400000f, 0.392232f, 0.384900f, 0.377964f, 0.371391f, 0.365148f, 0.359211f,
+    0.353553f
+};
+
+struct triangle_strip_vertex {
+    size_t first_triangle; // Where this vertex's triangles start in the adjacency list
+    uint32_t remaining; // Triangles not added yet, which are kept first in the adjacency list
+    int32_t cache_position; // -1 if not in the cache
+    float score;
+};
+
+static bool triangle_strip_is_degenerate(uint16_t a, uint16_t b, uint16_t c) {
+    return a == b || b == c || a == c;
+}
+
+size_t triangle_strip_to_list(const uint16_t *strip, size_t index_count, uint16_t *triangles) {
+    assert(strip || index_count == 0);
+    size_t triangle_count = 0;
+    for(size_t i = 0; i + 2 < index_count; i++) {
+        uint16_t a = strip[i];
+        uint16_t b = strip[i + 1];
+        uint16_t c = strip[i + 2];
+        if(triangle_strip_is_degenerate(a, b, c)) {
+            continue;
+        }
+
+        uint16_t *triangle = triangles + TRIANGLE_LIST_INDICES(triangle_count++);
+        triangle[0] = i % 2 == 0 ? a : b;
+        triangle[1] = i % 2 == 0 ? b : a;
+        triangle[2] = c;
+    }
+    return triangle_count;
+}
+
+// The vertex that finishes the triangle if it has the edge from a to b, otherwise TRIANGLE_STRIP_NONE
+static size_t triangle_strip_find_edge(const uint16_t *triangle, uint16_t a, uint16_t b) {
+    for(size_t i = 0; i < 3; i++) {
+        if(triangle[i] == a && triangle[(i + 1) % 3] == b) {
+            return triangle[(i + 2) % 3];
+        }
+    }
+    return TRIANGLE_STRIP_NONE;
+}
+
+// An edge of a triangle, going the way the triangle is wound
+struct triangle_strip_edge {
+    uint32_t key; // From vertex, then to vertex
+    uint32_t triangle;
+};
+
+static int triangle_strip_compare_edges(const void *a, const void *b) {
+    const struct triangle_strip_edge *edge_a = a;
+    const struct triangle_strip_edge *edge_b = b;
+    if(edge_a->key != edge_b->key) {
+        return edge_a->key > edge_b->key ? 1 : -1;
+    }
+    return (edge_a->triangle > edge_b->triangle) - (edge_a->triangle < edge_b->triangle);
+}
+
+// The first triangle before limit not drawn yet that has the edge from a to b, otherwise TRIANGLE_STRIP_NONE
+static size_t triangle_strip_next_with_edge(const struct triangle_strip_edge *edges, size_t edge_count, const bool *drawn, uint16_t a, uint16_t b, size_t limit) {
+    uint32_t key = ((uint32_t)a << 16) | b;
+    size_t low = 0;
+    size_t high = edge_count;
+    while(low < high) {
+        size_t middle = low + (high - low) / 2;
+        if(edges[middle].key < key) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+
+    for(size_t e = low; e < edge_count && edges[e].key == key && edges[e].triangle < limit; e++) {
+        if(!drawn[edges[e].triangle]) {
+            return edges[e].triangle;
+        }
+    }
+    return TRIANGLE_STRIP_NONE;
+}
+
+size_t triangle_strip_from_list(const uint16_t *triangles, size_t triangle_count, uint16_t *strip) {
+    assert(triangles || triangle_count == 0);
+    struct triangle_strip_edge *edges = calloc(MAX(TRIANGLE_LIST_INDICES(triangle_count), 1), sizeof(struct triangle_strip_edge));
+    bool *drawn = calloc(MAX(triangle_count, 1), sizeof(bool));
+    if(!edges || !drawn) {
+        abort();
+    }
+
+    size_t edge_count = TRIANGLE_LIST_INDICES(triangle_count);
+    for(size_t t = 0; t < triangle_count; t++) {
+        const uint16_t *triangle = triangles + TRIANGLE_LIST_INDICES(t);
+        for(size_t i = 0; i < 3; i++) {
+            edges[t * 3 + i] = (struct triangle_strip_edge){ ((uint32_t)triangle[i] << 16) | triangle[(i + 1) % 3], t };
+        }
+    }
+    qsort(edges, edge_count, sizeof(struct triangle_strip_edge), triangle_strip_compare_edges);
+
+    size_t index_count = 0;
+    size_t next_start = 0;
+    for(size_t drawn_count = 0; drawn_count < triangle_count; drawn_count++) {
+        while(drawn[next_start]) {
+            next_start++;
+        }
+
+        // Continue the strip with a triangle that has the last edge, wound the way the next triangle in the strip is
+        if(index_count >= 3) {
+            bool odd = (index_count - 2) % 2 == 1;
+            uint16_t a = strip[index_count - (odd ? 1 : 2)];
+            uint16_t b = strip[index_count - (odd ? 2 : 1)];
+            size_t next = triangle_strip_next_with_edge(edges, edge_count, drawn, a, b, next_start + TRIANGLE_STRIP_LOOKAHEAD);
+            if(next != TRIANGLE_STRIP_NONE) {
+                drawn[next] = true;
+                strip[index_count++] = triangle_strip_find_edge(triangles + TRIANGLE_LIST_INDICES(next), a, b);
+                continue;
+            }
+        }
+
+        // Otherwise repeat the last index and the first index of the next triangle to restart the strip. The winding
+        // of the triangle depends on where it lands.
+        const uint16_t *triangle = triangles + TRIANGLE_LIST_INDICES(next_start);
+        drawn[next_start] = true;
+        if(index_count > 0) {
+            strip[index_count] = strip[index_count - 1];
+            strip[index_count + 1] = triangle[0];
+            index_count += 2;
+        }
+        bool odd = index_count % 2 == 1;
+        strip[index_count++] = triangle[0];
+        strip[index_count++] = odd ? triangle[2] : triangle[1];
+        strip[index_count++] = odd ? triangle[1] : triangle[2];
+    }
+
+    free(edges);
+    free(drawn);
+    return index_count;
+}
+
+static float triangle_strip_vertex_score(const struct triangle_strip_vertex *vertex) {
+    if(vertex->remaining == 0) {
+        return -1.0f;
+    }
+
+    float score = vertex->cache_position >= 0 ? triangle_strip_cache_position_scores[vertex->cache_position] : 0.0f;
+    return score + triangle_strip_valence_scores[MIN(vertex->remaining, TRIANGLE_STRIP_OPTIMIZER_MAX_VALENCE)];
+}
+
+void triangle_list_optimize_vertex_cache(uint16_t *triangles, size_t triangle_count, size_t vertex_count) {
+    assert(triangles || triangle_count == 0);
+    if(triangle_count == 0) {
+        return;
+    }
+
+    size_t index_count = TRIANGLE_LIST_INDICES(triangle_count);
+    struct triangle_strip_vertex *vertices = calloc(vertex_count, sizeof(struct triangle_strip_vertex));
+    size_t *adjacency = calloc(index_count, sizeof(size_t));
+    float *triangle_scores = calloc(triangle_count, sizeof(float));
+    bool *added = calloc(triangle_count, sizeof(bool));
+    uint16_t *ordered = calloc(index_count, sizeof(uint16_t));
+    if(!vertices || !adjacency || !triangle_scores || !added || !ordered) {
+        abort();
+    }
+
+    for(size_t i = 0; i < index_count; i++) {
+        assert(triangles[i] < vertex_count);
+        vertices[triangles[i]].remaining++;
+    }
+    size_t first_triangle = 0;
+    for(size_t v = 0; v < vertex_count; v++) {
+        vertices[v].first_triangle = first_triangle;
+        first_triangle += vertices[v].remaining;
+        vertices[v].remaining = 0;
+        vertices[v].cache_position = -1;
+    }
+    for(size_t i = 0; i < index_count; i++) {
+        struct triangle_strip_vertex *vertex = &vertices[triangles[i]];
+        adjacency[vertex->first_triangle + vertex->remaining++] = i / 3;
+    }
+    for(size_t v = 0; v < vertex_count; v++) {
+        vertices[v].score = triangle_strip_vertex_score(&vertices[v]);
+    }
+
+    size_t best = 0;
+    for(size_t t = 0; t < triangle_count; t++) {
+        const uint16_t *triangle = triangles + TRIANGLE_LIST_INDICES(t);
+        triangle_scores[t] = vertices[triangle[0]].score + vertices[triangle[1]].score + vertices[triangle[2]].score;
+        if(triangle_scores[t] > triangle_scores[best]) {
+            best = t;
+        }
+    }
+
+    // The cache has room for the last triangle's vertices to be pushed on before the ones past the end fall out
+    uint16_t cache[TRIANGLE_STRIP_OPTIMIZER_CACHE_SIZE + 3];
+    size_t cache_count = 0;
+    for(size_t o = 0; o < triangle_count; o++) {
+        // Nothing in the cache has triangles left, so start over from the best triangle anywhere
+        if(best == TRIANGLE_STRIP_NONE) {
+            for(size_t t = 0; t < triangle_count; t++) {
+                if(!added[t] && (best == TRIANGLE_STRIP_NONE || triangle_scores[t] > triangle_scores[best])) {
+                    best = t;
+                }
+            }
+        }
+
+        const uint16_t *triangle = triangles + TRIANGLE_LIST_INDICES(best);
+        memcpy(ordered + TRIANGLE_LIST_INDICES(o), triangle, TRIANGLE_LIST_INDICES(1) * sizeof(uint16_t));
+        added[best] = true;
+
+        for(size_t i = 0; i < 3; i++) {
+            struct triangle_strip_vertex *vertex = &vertices[triangle[i]];
+            size_t *vertex_triangles = adjacency + vertex->first_triangle;
+            for(size_t a = 0; a < vertex->remaining; a++) {
+                if(vertex_triangles[a] == best) {
+                    vertex_triangles[a] = vertex_triangles[--vertex->remaining];
+                    vertex_triangles[vertex->remaining] = best;
+                    break;
+                }
+            }
+        }
+
+        // Move this triangle's vertices to the front of the cache
+        uint16_t new_cache[TRIANGLE_STRIP_OPTIMIZER_CACHE_SIZE + 3];
+        size_t new_cache_count = 0;
+        for(size_t i = 0; i < 3; i++) {
+            new_cache[new_cache_count++] = triangle[i];
+        }
+        for(size_t c = 0; c < cache_count; c++) {
+            if(cache[c] != triangle[0] && cache[c] != triangle[1] && cache[c] != triangle[2]) {
+                new_cache[new_cache_count++] = cache[c];
+            }
+        }
+
+        for(size_t c = 0; c < new_cache_count; c++) {
+            struct triangle_strip_vertex *vertex = &vertices[new_cache[c]];
+            vertex->cache_position = c < TRIANGLE_STRIP_OPTIMIZER_CACHE_SIZE ? (int32_t)c : -1;
+            vertex->score = triangle_strip_vertex_score(vertex);
+        }
+
+        // Only triangles using vertices whose score changed need to be looked at for the next one
+        best = TRIANGLE_STRIP_NONE;
+        for(size_t c = 0; c < new_cache_count; c++) {
+            const struct triangle_strip_vertex *vertex = &vertices[new_cache[c]];
+            for(size_t a = 0; a < vertex->remaining; a++) {
+                size_t t = adjacency[vertex->first_triangle + a];
+                const uint16_t *next = triangles + TRIANGLE_LIST_INDICES(t);
+                triangle_scores[t] = vertices[next[0]].score + vertices[next[1]].score + vertices[next[2]].score;
+                if(best == TRIANGLE_STRIP_NONE || triangle_scores[t] > triangle_scores[best]) {
+                    best = t;
+                }
+            }
+        }
+
+        cache_count = MIN(new_cache_count, TRIANGLE_STRIP_OPTIMIZER_CACHE_SIZE);
+        memcpy(cache, new_cache, cache_count * sizeof(uint16_t));
+    }
+
+    memcpy(triangles, ordered, index_count * sizeof(uint16_t));
+    free(vertices);
+    free(adjacency);
+    free(triangle_scores);
+    free(added);
+    free(ordered);
+}
+
+double triangle_strip_cache_miss_ratio(const uint16_t *strip, size_t index_count, size_t cache_size) {
+    assert((strip || index_count == 0) && cache_size > 0);
+    uint16_t *cache = calloc(cache_size, sizeof(uint16_t));
+    if(!cache) {
+        abort();
+    }
+
+    size_t cache_count = 0;
+    size_t next = 0;
+    size_t misses = 0;
+    size_t triangle_count = 0;
+    for(size_t i = 0; i < index_count; i++) {
+        bool hit = false;
+        for(size_t c = 0; c < cache_count && !hit; c++) {
+            hit = cache[c] == strip[i];
+        }
+        if(!hit) {
+            misses++;
+            cache[next] = strip[i];
+            next = (next + 1) % cache_size;
+            cache_count = MIN(cache_count + 1, cache_size);
+        }
+        if(i >= 2 && !triangle_strip_is_degenerate(strip[i - 2], strip[i - 1], strip[i])) {
+            triangle_count++;
+        }
+    }
+
+    free(cache);
+    return triangle_count > 0 ? (double)misses / triangle_count : 0.0;
+}
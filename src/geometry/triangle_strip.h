@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Triangle strips are drawn the way the game draws them: every three indices in a row are a triangle, every other one
+// is wound the other way, and triangles that repeat an index are not drawn.
+
+// Sizes of the buffers the functions below need for a given number of triangles
+#define TRIANGLE_STRIP_MAX_INDICES(triangle_count) ((triangle_count) * 5)
+#define TRIANGLE_LIST_INDICES(triangle_count) ((triangle_count) * 3)
+
+// Triangles of a strip in the order and winding they are drawn in, skipping degenerate ones. Returns how many there are.
+size_t triangle_strip_to_list(const uint16_t *strip, size_t index_count, uint16_t *triangles);
+
+// A strip drawing all of the triangles in about the order they are listed. Strips are started with the first triangle
+// left in the list and continued with a triangle a little further on that shares their last edge, if there is one.
+// Strips are joined with degenerate triangles. Returns the number of indices.
+size_t triangle_strip_from_list(const uint16_t *triangles, size_t triangle_count, uint16_t *strip);
+
+// Reorders triangles so that the vertices they use are more likely to still be in the post-transform vertex cache, using
+// Tom Forsyth's linear-speed vertex cache optimization. vertex_count must be more than the highest index.
+void triangle_list_optimize_vertex_cache(uint16_t *triangles, size_t triangle_count, size_t vertex_count);
+
+// Average number of vertices transformed per triangle drawn with a first in, first out cache of cache_size vertices
+double triangle_strip_cache_miss_ratio(const uint16_t *strip, size_t index_count, size_t cache_size);
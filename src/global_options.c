@@ -3,27 +3,76 @@
 #include "global_options.h"
 
 const char *global_option_long_names[] = {
+    GLOBAL_OPTION_ARG_COMPACT_STRING,
+    GLOBAL_OPTION_ARG_DRY_RUN_STRING,
+    GLOBAL_OPTION_ARG_EXTERNALIZE_STRING,
     GLOBAL_OPTION_ARG_HELP_STRING,
+    GLOBAL_OPTION_ARG_JOBS_STRING,
+    GLOBAL_OPTION_ARG_MEMORY_BUDGET_STRING,
+    GLOBAL_OPTION_ARG_MERGE_DUPLICATES_STRING,
+    GLOBAL_OPTION_ARG_MERGE_MODEL_DATA_STRING,
     GLOBAL_OPTION_ARG_NO_PRESERVE_CRC_STRING,
+    GLOBAL_OPTION_ARG_OPTIMIZE_STRIPS_STRING,
+    GLOBAL_OPTION_ARG_PACK_TAG_PATHS_STRING,
+    GLOBAL_OPTION_ARG_PRUNE_ORPHANS_STRING,
+    GLOBAL_OPTION_ARG_REBUILD_TAG_DATA_STRING,
     GLOBAL_OPTION_ARG_RELAXED_STRING,
-    GLOBAL_OPTION_ARG_VERSION_STRING
+    GLOBAL_OPTION_ARG_RESOURCES_STRING,
+    GLOBAL_OPTION_ARG_SHARED_PAYLOADS_STRING,
+    GLOBAL_OPTION_ARG_SIZE_REPORT_STRING,
+    GLOBAL_OPTION_ARG_VERSION_STRING,
+    GLOBAL_OPTION_ARG_ZERO_POINTERS_STRING
 };
 static_assert(sizeof(global_option_long_names) / sizeof(char *) == NUMBER_OF_GLOBAL_OPTION_ARGS);
 
 const char *global_option_short_names[] = {
+    "c",
+    "d",
+    "e",
     "h",
+    "j",
+    "B",
+    "m",
+    "M",
     "n",
+    "o",
+    "P",
+    "p",
+    "b",
     "r",
-    "v"
+    "R",
+    "s",
+    "S",
+    "v",
+    "z"
 };
 static_assert(sizeof(global_option_long_names) / sizeof(char *) == NUMBER_OF_GLOBAL_OPTION_ARGS);
 
 const char *global_option_help[] = {
+    "Move tag data into space freed by other fixes and shrink the map",
+    "Print the fixes that would be made without saving",
+    "Use bitmaps.map and sounds.map for bitmaps and sounds that are the same as the ones in them",
     "Print this help text",
+    "Process up to this many maps at once, splitting the threads between them",
+    "With --jobs, keep the maps being processed at once under this many bytes (K, M or G suffix)",
+    "Point identical tag data blocks at one copy, leaving the rest for --compact",
+    "Store identical model vertex and index buffers once and shrink the model data",
     "Do not forge the cache file crc32 after processing",
+    "Reorder model triangle strips and vertices for the vertex cache",
+    "Store each tag path once in a packed table, leaving the rest for --compact",
+    "Remove tags that nothing in the map references",
+    "Lay the tag data out again without the zeroed space left between blocks",
     "Relax some cache file integrity checks",
-    "Print the version"
+    "Use the bitmaps.map and sounds.map in this directory instead of the stock resource lists",
+    "Print bitmap and sound data the maps have in common as tab separated records instead of processing them",
+    "Print what takes up the space in each map, as text or json, instead of processing them",
+    "Print the version",
+    "Zero pointers to empty blocks and runtime pointers left from a previous load instead of only counting them"
 };
 static_assert(sizeof(global_option_long_names) / sizeof(char *) == NUMBER_OF_GLOBAL_OPTION_ARGS);
 
 uint32_t global_option_flags = 0;
+const char *global_option_resources_directory = nullptr;
+const char *global_option_size_report_format = nullptr;
+size_t global_option_jobs = 1;
+size_t global_option_memory_budget = 0;
@@ -1,29 +1,75 @@
 #pragma once
 
 #include <stdint.h>
+#include <stddef.h>
 #include <limits.h>
 
+#define GLOBAL_OPTION_ARG_COMPACT_STRING "compact"
+#define GLOBAL_OPTION_ARG_DRY_RUN_STRING "dry-run"
+#define GLOBAL_OPTION_ARG_EXTERNALIZE_STRING "externalize"
 #define GLOBAL_OPTION_ARG_HELP_STRING "help"
+#define GLOBAL_OPTION_ARG_JOBS_STRING "jobs"
+#define GLOBAL_OPTION_ARG_MEMORY_BUDGET_STRING "memory-budget"
+#define GLOBAL_OPTION_ARG_MERGE_DUPLICATES_STRING "merge-duplicates"
+#define GLOBAL_OPTION_ARG_MERGE_MODEL_DATA_STRING "merge-model-data"
 #define GLOBAL_OPTION_ARG_NO_PRESERVE_CRC_STRING "no-preserve-crc"
+#define GLOBAL_OPTION_ARG_OPTIMIZE_STRIPS_STRING "optimize-strips"
+#define GLOBAL_OPTION_ARG_PACK_TAG_PATHS_STRING "pack-tag-paths"
+#define GLOBAL_OPTION_ARG_PRUNE_ORPHANS_STRING "prune-orphans"
+#define GLOBAL_OPTION_ARG_REBUILD_TAG_DATA_STRING "rebuild-tag-data"
 #define GLOBAL_OPTION_ARG_RELAXED_STRING "relaxed"
+#define GLOBAL_OPTION_ARG_RESOURCES_STRING "resources"
+#define GLOBAL_OPTION_ARG_SHARED_PAYLOADS_STRING "shared-payloads"
+#define GLOBAL_OPTION_ARG_SIZE_REPORT_STRING "size-report"
 #define GLOBAL_OPTION_ARG_VERSION_STRING "version"
+#define GLOBAL_OPTION_ARG_ZERO_POINTERS_STRING "zero-pointers"
 
 enum {
+    GLOBAL_OPTON_FLAGS_COMPACT_BIT,
+    GLOBAL_OPTON_FLAGS_DRY_RUN_BIT,
+    GLOBAL_OPTON_FLAGS_EXTERNALIZE_BIT,
+    GLOBAL_OPTON_FLAGS_MERGE_DUPLICATES_BIT,
+    GLOBAL_OPTON_FLAGS_MERGE_MODEL_DATA_BIT,
     GLOBAL_OPTON_FLAGS_NO_PRESERVE_CRC_BIT,
+    GLOBAL_OPTON_FLAGS_OPTIMIZE_STRIPS_BIT,
+    GLOBAL_OPTON_FLAGS_PACK_TAG_PATHS_BIT,
+    GLOBAL_OPTON_FLAGS_PRUNE_ORPHANS_BIT,
+    GLOBAL_OPTON_FLAGS_REBUILD_TAG_DATA_BIT,
     GLOBAL_OPTON_FLAGS_RELAXED_BIT,
+    GLOBAL_OPTON_FLAGS_SHARED_PAYLOADS_BIT,
+    GLOBAL_OPTON_FLAGS_ZERO_POINTERS_BIT,
     NUMBER_OF_GLOBAL_OPTION_FLAGS
 };
 static_assert(NUMBER_OF_GLOBAL_OPTION_FLAGS <= sizeof(uint32_t) * CHAR_BIT);
 
 enum {
+    GLOBAL_OPTION_ARG_COMPACT,
+    GLOBAL_OPTION_ARG_DRY_RUN,
+    GLOBAL_OPTION_ARG_EXTERNALIZE,
     GLOBAL_OPTION_ARG_HELP,
+    GLOBAL_OPTION_ARG_JOBS,
+    GLOBAL_OPTION_ARG_MEMORY_BUDGET,
+    GLOBAL_OPTION_ARG_MERGE_DUPLICATES,
+    GLOBAL_OPTION_ARG_MERGE_MODEL_DATA,
     GLOBAL_OPTION_ARG_NO_PRESERVE_CRC,
+    GLOBAL_OPTION_ARG_OPTIMIZE_STRIPS,
+    GLOBAL_OPTION_ARG_PACK_TAG_PATHS,
+    GLOBAL_OPTION_ARG_PRUNE_ORPHANS,
+    GLOBAL_OPTION_ARG_REBUILD_TAG_DATA,
     GLOBAL_OPTION_ARG_RELAXED,
+    GLOBAL_OPTION_ARG_RESOURCES,
+    GLOBAL_OPTION_ARG_SHARED_PAYLOADS,
+    GLOBAL_OPTION_ARG_SIZE_REPORT,
     GLOBAL_OPTION_ARG_VERSION,
+    GLOBAL_OPTION_ARG_ZERO_POINTERS,
     NUMBER_OF_GLOBAL_OPTION_ARGS
 };
 
 extern uint32_t global_option_flags;
+extern const char *global_option_resources_directory;
+extern const char *global_option_size_report_format;
+extern size_t global_option_jobs;
+extern size_t global_option_memory_budget;
 extern const char *global_option_long_names[];
 extern const char *global_option_short_names[];
 extern const char *global_option_help[];
@@ -13,20 +13,74 @@
 #include <libgen.h>
 #include <getopt.h>
 #include <assert.h>
+#include <stdatomic.h>
+#include <pthread.h>
 
 #include "data_types.h"
 #include "global_options.h"
 #include "cache/cache.h"
+#include "cache/cache_model_data.h"
+#include "cache/cache_raw_data.h"
+#include "cache/cache_shared_payloads.h"
+#include "cache/cache_size_report.h"
 #include "crc/crc.h"
 #include "file/file.h"
+#include "resources/resource_index.h"
 #include "tag/tag.h"
+#include "tag/tag_compaction.h"
+#include "tag/tag_data_builder.h"
+#include "tag/tag_deduplication.h"
+#include "tag/tag_externalization.h"
+#include "tag/tag_fix_plan.h"
 #include "tag/tag_fourcc.h"
+#include "tag/tag_path_table.h"
+#include "tag/tag_pointer_audit.h"
+#include "tag/tag_reference_graph.h"
+#include "tag/tag_scheduler.h"
 #include "tag_groups/tag_groups.h"
+#include "thread/thread_admission.h"
+#include "thread/thread_output.h"
+#include "thread/thread_pool.h"
 #include "version.h"
 
+struct postprocess_tag_job_context {
+    struct tag_data_instance *tag_data;
+    struct tag_fix_plan *plans;
+    struct tag_schedule *schedule;
+    size_t wave_offset;
+    atomic_bool failed;
+};
+
+struct postprocess_map_job_context {
+    const char **paths;
+    const struct resource_index *resource_index;
+    struct thread_admission admission;
+    size_t thread_count; // For each map
+    atomic_bool success;
+};
+
+// Loading the resource maps next to a map can write the resource index cache there, which maps processed at once in the
+// same directory would otherwise do at the same time
+static pthread_mutex_t resource_maps_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 static void print_usage(const char *executable);
-static bool postprocess_map(const char *path);
+static bool report_shared_payloads(const char **paths, size_t path_count);
+static bool report_map_sizes(const char **paths, size_t path_count, bool json);
+static bool parse_size(const char *string, size_t *size);
+static bool postprocess_maps(const char **paths, size_t path_count, const struct resource_index *resource_index);
+static bool postprocess_map(const char *path, const struct resource_index *resource_index);
+static bool postprocess_tag(struct tag_instance *tag, struct tag_data_instance *tag_data, struct tag_fix_plan *plan);
 static bool postprocess_tag_data(struct cache_file_instance *cache_file);
+static bool use_resource_maps(const char *path, struct cache_file_instance *cache_file, const struct resource_index *resource_index, struct resource_index **map_resource_index);
+static bool externalize_tags(struct cache_file_instance *cache_file);
+static bool merge_model_data(struct cache_file_instance *cache_file);
+static bool optimize_model_strips(struct cache_file_instance *cache_file);
+static bool remove_unused_raw_data(struct cache_file_instance *cache_file, struct cache_raw_data *raw_data_before, size_t *removed_size);
+static bool prune_orphan_tags(struct cache_file_instance *cache_file);
+static void merge_duplicate_blocks(struct cache_file_instance *cache_file);
+static void pack_tag_paths(struct cache_file_instance *cache_file);
+static bool compact_tag_data(struct cache_file_instance *cache_file, struct tag_compaction *compaction);
+static bool rebuild_tag_data(struct cache_file_instance *cache_file);
 
 int main(int argc, char **argv) {
     if(argc == 1) {
@@ -35,12 +89,27 @@ int main(int argc, char **argv) {
         return EXIT_FAILURE;
     }
 
-    static const char *short_options = ":hnrv";
+    static const char *short_options = ":bB:cdehj:mMnoPprR:sS:vz";
     static struct option long_options[] = {
-        {GLOBAL_OPTION_ARG_HELP_STRING,            no_argument, nullptr, 'h'},
-        {GLOBAL_OPTION_ARG_NO_PRESERVE_CRC_STRING, no_argument, nullptr, 'n'},
-        {GLOBAL_OPTION_ARG_RELAXED_STRING,         no_argument, nullptr, 'r'},
-        {GLOBAL_OPTION_ARG_VERSION_STRING,         no_argument, nullptr, 'v'},
+        {GLOBAL_OPTION_ARG_COMPACT_STRING,          no_argument, nullptr, 'c'},
+        {GLOBAL_OPTION_ARG_DRY_RUN_STRING,          no_argument, nullptr, 'd'},
+        {GLOBAL_OPTION_ARG_EXTERNALIZE_STRING,      no_argument, nullptr, 'e'},
+        {GLOBAL_OPTION_ARG_HELP_STRING,             no_argument, nullptr, 'h'},
+        {GLOBAL_OPTION_ARG_JOBS_STRING,             required_argument, nullptr, 'j'},
+        {GLOBAL_OPTION_ARG_MEMORY_BUDGET_STRING,    required_argument, nullptr, 'B'},
+        {GLOBAL_OPTION_ARG_MERGE_DUPLICATES_STRING, no_argument, nullptr, 'm'},
+        {GLOBAL_OPTION_ARG_MERGE_MODEL_DATA_STRING, no_argument, nullptr, 'M'},
+        {GLOBAL_OPTION_ARG_NO_PRESERVE_CRC_STRING,  no_argument, nullptr, 'n'},
+        {GLOBAL_OPTION_ARG_OPTIMIZE_STRIPS_STRING,  no_argument, nullptr, 'o'},
+        {GLOBAL_OPTION_ARG_PACK_TAG_PATHS_STRING,   no_argument, nullptr, 'P'},
+        {GLOBAL_OPTION_ARG_PRUNE_ORPHANS_STRING,    no_argument, nullptr, 'p'},
+        {GLOBAL_OPTION_ARG_REBUILD_TAG_DATA_STRING, no_argument, nullptr, 'b'},
+        {GLOBAL_OPTION_ARG_RELAXED_STRING,          no_argument, nullptr, 'r'},
+        {GLOBAL_OPTION_ARG_RESOURCES_STRING,        required_argument, nullptr, 'R'},
+        {GLOBAL_OPTION_ARG_SHARED_PAYLOADS_STRING,  no_argument, nullptr, 's'},
+        {GLOBAL_OPTION_ARG_SIZE_REPORT_STRING,      required_argument, nullptr, 'S'},
+        {GLOBAL_OPTION_ARG_VERSION_STRING,          no_argument, nullptr, 'v'},
+        {GLOBAL_OPTION_ARG_ZERO_POINTERS_STRING,    no_argument, nullptr, 'z'},
         {0, 0, 0, 0}
     };
 
@@ -52,33 +121,111 @@ int main(int argc, char **argv) {
         }
 
         switch(opt) {
+            case 'b':
+                SET_FLAG(global_option_flags, GLOBAL_OPTON_FLAGS_REBUILD_TAG_DATA_BIT, true);
+                break;
+            case 'B':
+                if(!parse_size(optarg, &global_option_memory_budget) || global_option_memory_budget == 0) {
+                    fprintf(stderr, "Invalid memory budget: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'c':
+                SET_FLAG(global_option_flags, GLOBAL_OPTON_FLAGS_COMPACT_BIT, true);
+                break;
+            case 'd':
+                SET_FLAG(global_option_flags, GLOBAL_OPTON_FLAGS_DRY_RUN_BIT, true);
+                break;
+            case 'e':
+                SET_FLAG(global_option_flags, GLOBAL_OPTON_FLAGS_EXTERNALIZE_BIT, true);
+                break;
             case 'h':
                 print_usage(argv[0]);
                 return EXIT_SUCCESS;
+            case 'j': {
+                char *end = nullptr;
+                unsigned long jobs = strtoul(optarg, &end, 10);
+                if(end == optarg || *end != '\0' || jobs == 0 || jobs > THREAD_POOL_MAXIMUM_THREADS) {
+                    fprintf(stderr, "Invalid job count: %s\nUse 1 to %d\n", optarg, THREAD_POOL_MAXIMUM_THREADS);
+                    return 1;
+                }
+                global_option_jobs = jobs;
+                break;
+            }
+            case 'm':
+                SET_FLAG(global_option_flags, GLOBAL_OPTON_FLAGS_MERGE_DUPLICATES_BIT, true);
+                break;
+            case 'M':
+                SET_FLAG(global_option_flags, GLOBAL_OPTON_FLAGS_MERGE_MODEL_DATA_BIT, true);
+                break;
             case 'n':
                 SET_FLAG(global_option_flags, GLOBAL_OPTON_FLAGS_NO_PRESERVE_CRC_BIT, true);
                 break;
+            case 'o':
+                SET_FLAG(global_option_flags, GLOBAL_OPTON_FLAGS_OPTIMIZE_STRIPS_BIT, true);
+                break;
+            case 'P':
+                SET_FLAG(global_option_flags, GLOBAL_OPTON_FLAGS_PACK_TAG_PATHS_BIT, true);
+                break;
+            case 'p':
+                SET_FLAG(global_option_flags, GLOBAL_OPTON_FLAGS_PRUNE_ORPHANS_BIT, true);
+                break;
             case 'r':
                 SET_FLAG(global_option_flags, GLOBAL_OPTON_FLAGS_RELAXED_BIT, true);
                 break;
+            case 'R':
+                global_option_resources_directory = optarg;
+                break;
+            case 's':
+                SET_FLAG(global_option_flags, GLOBAL_OPTON_FLAGS_SHARED_PAYLOADS_BIT, true);
+                break;
+            case 'S':
+                if(strcmp(optarg, "text") != 0 && strcmp(optarg, "json") != 0) {
+                    fprintf(stderr, "Unknown size report format: %s\nUse text or json\n", optarg);
+                    return 1;
+                }
+                global_option_size_report_format = optarg;
+                break;
             case 'v':
                     printf("tool-squisher %s, by Aerocatia\n", TOOL_SQUISHER_VERSION);
                     return EXIT_SUCCESS;
                 break;
+            case 'z':
+                SET_FLAG(global_option_flags, GLOBAL_OPTON_FLAGS_ZERO_POINTERS_BIT, true);
+                break;
             case '?':
                 fprintf(stderr, "Unknown option: %s\nUse --%s for usage\n",
                     argv[optind - 1], global_option_long_names[GLOBAL_OPTION_ARG_HELP]);
                 return 1;
+            case ':':
+                fprintf(stderr, "Option %s needs a value\nUse --%s for usage\n",
+                    argv[optind - 1], global_option_long_names[GLOBAL_OPTION_ARG_HELP]);
+                return 1;
             default:
                 abort();
         }
     }
 
-    bool success = false;
-    for(int i = optind; i < argc; i++) {
-        success = postprocess_map(argv[i]) || success;
+    // Nothing is changed, the maps are only compared
+    if(TEST_FLAG(global_option_flags, GLOBAL_OPTON_FLAGS_SHARED_PAYLOADS_BIT)) {
+        return report_shared_payloads((const char **)(argv + optind), argc - optind) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if(global_option_size_report_format) {
+        return report_map_sizes((const char **)(argv + optind), argc - optind, strcmp(global_option_size_report_format, "json") == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
     }
 
+    // Loaded once for every map
+    static struct resource_index resource_index = {};
+    if(global_option_resources_directory && !resource_index_load(&resource_index, global_option_resources_directory)) {
+        fprintf(stderr, "%s: Could not load the resource maps\n", global_option_resources_directory);
+        return EXIT_FAILURE;
+    }
+
+    bool success = postprocess_maps((const char **)(argv + optind), argc - optind, global_option_resources_directory ? &resource_index : nullptr);
+
+    if(global_option_resources_directory) {
+        resource_index_free(&resource_index);
+    }
     return success ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
@@ -98,19 +245,168 @@ static void print_usage(const char *executable_path) {
     free(path_copy);
 }
 
-static bool postprocess_map(const char *path) {
+static bool report_shared_payloads(const char **paths, size_t path_count) {
+    assert(paths || path_count == 0);
+    struct cache_shared_payloads payloads;
+    bool success = cache_shared_payloads_collect(&payloads, paths, path_count);
+    cache_shared_payloads_print(stdout, &payloads);
+    cache_shared_payloads_free(&payloads);
+    return success;
+}
+
+// As JSON, the reports of all the maps are put in one array
+static bool report_map_sizes(const char **paths, size_t path_count, bool json) {
+    assert(paths || path_count == 0);
+    bool success = true;
+    size_t reported = 0;
+    if(json) {
+        printf("[");
+    }
+    for(size_t i = 0; i < path_count; i++) {
+        if(file_path_is_resource_map(paths[i])) {
+            fprintf(stderr, "%s: Skipped (assuming it's a resource map)\n", paths[i]);
+            continue;
+        }
+
+        struct cache_file_instance cache_file = {};
+        cache_file_load(paths[i], &cache_file);
+        if(!cache_file.valid) {
+            fprintf(stderr, "%s: Not a valid cache file\n", paths[i]);
+            success = false;
+            continue;
+        }
+
+        struct cache_size_report report;
+        if(cache_size_report_build(&report, &cache_file)) {
+            if(json && reported > 0) {
+                printf(",");
+            }
+            cache_size_report_print(stdout, &report, paths[i], &cache_file, json);
+            cache_size_report_free(&report);
+            reported++;
+        }
+        else {
+            fprintf(stderr, "%s: Could not attribute the cache file\n", paths[i]);
+            success = false;
+        }
+        cache_file_unload(&cache_file);
+    }
+    if(json) {
+        printf("]\n");
+    }
+    return success;
+}
+
+// Sizes are in bytes, or KiB, MiB or GiB with a K, M or G suffix
+static bool parse_size(const char *string, size_t *size) {
+    assert(string && size);
+    char *end = nullptr;
+    unsigned long long value = strtoull(string, &end, 10);
+    if(end == string || *string == '-') {
+        return false;
+    }
+
+    unsigned shift = 0;
+    switch(*end) {
+        case '\0':
+            break;
+        case 'K':
+        case 'k':
+            shift = 10;
+            end++;
+            break;
+        case 'M':
+        case 'm':
+            shift = 20;
+            end++;
+            break;
+        case 'G':
+        case 'g':
+            shift = 30;
+            end++;
+            break;
+        default:
+            return false;
+    }
+    if(*end != '\0' || value > (SIZE_MAX >> shift)) {
+        return false;
+    }
+
+    *size = (size_t)value << shift;
+    return true;
+}
+
+static void postprocess_map_job(size_t job_index, void *context) {
+    (void)job_index;
+    struct postprocess_map_job_context *job = context;
+
+    // The threads are split between the maps being processed
+    thread_pool_set_local_thread_count(job->thread_count);
+    size_t map;
+    while((map = thread_admission_acquire(&job->admission)) != THREAD_ADMISSION_DONE) {
+        // Printed in one go once the map is done, so it is not mixed up with the other maps
+        thread_output_begin();
+        if(postprocess_map(job->paths[map], job->resource_index)) {
+            atomic_store_explicit(&job->success, true, memory_order_relaxed);
+        }
+        thread_output_end();
+        thread_admission_release(&job->admission, map);
+    }
+    thread_pool_set_local_thread_count(0);
+}
+
+// Succeeds if any map was processed. With --jobs, a few maps are processed at once, largest first so one big map is not
+// left running alone at the end, and no more than fit in the memory budget.
+static bool postprocess_maps(const char **paths, size_t path_count, const struct resource_index *resource_index) {
+    assert(paths || path_count == 0);
+    size_t job_count = MIN(global_option_jobs, path_count);
+    if(job_count <= 1) {
+        bool success = false;
+        for(size_t i = 0; i < path_count; i++) {
+            success = postprocess_map(paths[i], resource_index) || success;
+        }
+        return success;
+    }
+
+    size_t *costs = calloc(path_count, sizeof(size_t));
+    if(!costs) {
+        abort();
+    }
+    for(size_t i = 0; i < path_count; i++) {
+        costs[i] = cache_file_get_load_size(paths[i]);
+    }
+
+    struct postprocess_map_job_context job = {
+        .paths = paths,
+        .resource_index = resource_index,
+        .thread_count = MAX(thread_pool_get_thread_count() / job_count, 1)
+    };
+    atomic_init(&job.success, false);
+    thread_admission_init(&job.admission, costs, path_count, global_option_memory_budget);
+
+    // Every job gets a thread of its own, even with more jobs than cores
+    thread_pool_set_local_thread_count(job_count);
+    thread_pool_run(job_count, postprocess_map_job, &job);
+    thread_pool_set_local_thread_count(0);
+
+    thread_admission_free(&job.admission);
+    free(costs);
+    return atomic_load(&job.success);
+}
+
+static bool postprocess_map(const char *path, const struct resource_index *resource_index) {
     assert(path);
 
     // It's less annoying to just skip these
     if(file_path_is_resource_map(path)) {
-        fprintf(stderr, "%s: Skipped (assuming it's a resource map)\n", path);
+        thread_output_error("%s: Skipped (assuming it's a resource map)\n", path);
         return true;
     }
 
-    static struct cache_file_instance cache_file = {};
+    struct cache_file_instance cache_file = {};
     cache_file_load(path, &cache_file);
     if(!cache_file.valid) {
-        fprintf(stderr, "%s: Not a valid cache file\n", path);
+        thread_output_error("%s: Not a valid cache file\n", path);
         return false;
     }
 
@@ -118,19 +414,21 @@ static bool postprocess_map(const char *path) {
     uint32_t original_checksum = cache_file.header->checksum;
 
     bool success = true;
+    struct resource_index *map_resource_index = nullptr;
     auto cache_build = cache_file_resolve_build(cache_file.header);
     switch(cache_build) {
         case CACHE_FILE_TRACKED_BUILD_TOOL_SQUISHER:
-            fprintf(stderr, "%s: Has already been squished\n", path);
+            thread_output_error("%s: Has already been squished\n", path);
             goto exit;
         case CACHE_FILE_TRACKED_BUILD_0563:
         case CACHE_FILE_TRACKED_BUILD_0564:
         case CACHE_FILE_TRACKED_BUILD_0609:
         case CACHE_FILE_TRACKED_BUILD_0621:
-            success = postprocess_tag_data(&cache_file);
+        case CACHE_FILE_TRACKED_BUILD_XBOX:
+            success = use_resource_maps(path, &cache_file, resource_index, &map_resource_index) && postprocess_tag_data(&cache_file);
             break;
         case CACHE_FILE_TRACKED_BUILD_UNTRACKED:
-            fprintf(stderr, "%s: Unsupported build \"%s\"\n", path, cache_file.header->build_number);
+            thread_output_error("%s: Unsupported build \"%s\"\n", path, cache_file.header->build_number);
             success = false;
             goto exit;
         default:
@@ -138,13 +436,19 @@ static bool postprocess_map(const char *path) {
     }
 
     if(!success) {
-        fprintf(stderr, "%s: Could not process\n", path);
+        thread_output_error("%s: Could not process\n", path);
+        goto exit;
+    }
+
+    // The fix plan was printed, leave the file alone
+    if(TEST_FLAG(global_option_flags, GLOBAL_OPTON_FLAGS_DRY_RUN_BIT)) {
+        thread_output_print("%s: Dry run, not saved\n", path);
         goto exit;
     }
 
     success = cache_file_update_header(&cache_file, true);
     if(!success) {
-        fprintf(stderr, "%s: Could not update cache header\n", path);
+        thread_output_error("%s: Could not update cache header\n", path);
         goto exit;
     }
 
@@ -156,114 +460,553 @@ static bool postprocess_map(const char *path) {
     // Save
     success = cache_file_save(path, &cache_file);
     if(success) {
-        printf("%s: Saved!\n", path);
+        thread_output_print("%s: Saved!\n", path);
     }
 
     exit:
+    if(map_resource_index) {
+        resource_index_free(map_resource_index);
+        free(map_resource_index);
+    }
     cache_file_unload(&cache_file);
     return success;
 }
 
+// The resource maps given with --resources are used for every map. Otherwise the ones next to the map are loaded if
+// they are needed.
+static bool use_resource_maps(const char *path, struct cache_file_instance *cache_file, const struct resource_index *resource_index, struct resource_index **map_resource_index) {
+    assert(path && cache_file && cache_file->valid && map_resource_index);
+    *map_resource_index = nullptr;
+    cache_file->tag_data.resource_index = resource_index;
+
+    // Other maps do not look tags up in the resource maps by index and path
+    bool externalize = TEST_FLAG(global_option_flags, GLOBAL_OPTON_FLAGS_EXTERNALIZE_BIT);
+    if(externalize && !cache_file->tag_data.indexed_external_tags) {
+        thread_output_print("%s: Not a Custom Edition multiplayer map, nothing will be externalized\n", path);
+        return true;
+    }
+    if(resource_index || !externalize) {
+        return true;
+    }
+
+    char *path_copy = strdup(path);
+    *map_resource_index = calloc(1, sizeof(struct resource_index));
+    if(!path_copy || !*map_resource_index) {
+        abort();
+    }
+
+    pthread_mutex_lock(&resource_maps_mutex);
+    bool success = resource_index_load(*map_resource_index, dirname(path_copy));
+    pthread_mutex_unlock(&resource_maps_mutex);
+    if(success) {
+        cache_file->tag_data.resource_index = *map_resource_index;
+    }
+    else {
+        thread_output_error("%s: Could not load the resource maps\n", path);
+        free(*map_resource_index);
+        *map_resource_index = nullptr;
+    }
+    free(path_copy);
+    return success;
+}
+
+static bool postprocess_tag(struct tag_instance *tag, struct tag_data_instance *tag_data, struct tag_fix_plan *plan) {
+    assert(tag && tag_data && tag_data->valid && plan);
+
+    // Process shaders
+    if(tag->primary_group == TAG_FOURCC_SHADER ||
+        tag->secondary_group == TAG_FOURCC_SHADER ||
+        tag->tertiary_group == TAG_FOURCC_SHADER
+    ) {
+        if(!shader_postprocess(tag->tag_id, tag_data, plan)) {
+            return false;
+        }
+    }
+    // Process units
+    else if(tag->secondary_group == TAG_FOURCC_UNIT && tag->tertiary_group == TAG_FOURCC_OBJECT) {
+        if(!uint_postprocess(tag->tag_id, tag_data, plan)) {
+            return false;
+        }
+    }
+
+    // Process other base tags
+    switch(tag->primary_group) {
+        case TAG_FOURCC_ACTOR_VARIANT:
+            if(!actor_variant_postprocess(tag->tag_id, tag_data, plan)) {
+                return false;
+            }
+            break;
+        case TAG_FOURCC_BITMAP:
+            if(!bitmap_postprocess(tag->tag_id, tag_data, plan)) {
+                return false;
+            }
+            break;
+        case TAG_FOURCC_DECAL:
+            if(!decal_postprocess(tag->tag_id, tag_data, plan)) {
+                return false;
+            }
+            break;
+        case TAG_FOURCC_LENS_FLARE:
+            if(!lens_flare_postprocess(tag->tag_id, tag_data, plan)) {
+                return false;
+            }
+            break;
+        case TAG_FOURCC_METER:
+            if(!meter_postprocess(tag->tag_id, tag_data, plan)) {
+                return false;
+            }
+            break;
+        case TAG_FOURCC_GBXMODEL:
+            if(!gbxmodel_postprocess(tag->tag_id, tag_data, plan)) {
+                return false;
+            }
+            break;
+        case TAG_FOURCC_SCENARIO:
+            if(!scenario_postprocess(tag->tag_id, tag_data, plan)) {
+                return false;
+            }
+            break;
+        case TAG_FOURCC_SHADER_MODEL:
+            if(!shader_model_postprocess(tag->tag_id, tag_data, plan)) {
+                return false;
+            }
+            break;
+        case TAG_FOURCC_SOUND:
+            if(!sound_postprocess(tag->tag_id, tag_data, plan)) {
+                return false;
+            }
+            break;
+        case TAG_FOURCC_GRENADE_HUD_INTERFACE:
+            if(!grenade_hud_interface_postprocess(tag->tag_id, tag_data, plan)) {
+                return false;
+            }
+            break;
+        case TAG_FOURCC_HUD_GLOBALS:
+            if(!hud_globals_postprocess(tag->tag_id, tag_data, plan)) {
+                return false;
+            }
+            break;
+        case TAG_FOURCC_UNIT_HUD_INTERFACE:
+            if(!unit_hud_interface_postprocess(tag->tag_id, tag_data, plan)) {
+                return false;
+            }
+            break;
+        case TAG_FOURCC_WEAPON_HUD_INTERFACE:
+            if(!weapon_hud_interface_postprocess(tag->tag_id, tag_data, plan)) {
+                return false;
+            }
+    }
+
+    return true;
+}
+
+static void postprocess_tag_job(size_t job_index, void *context) {
+    struct postprocess_tag_job_context *job = context;
+
+    // Serial runs stopped at the first broken tag, so do not bother with the rest
+    if(atomic_load_explicit(&job->failed, memory_order_relaxed)) {
+        return;
+    }
+
+    // Only reads tag data, so all tags in a wave can be looked at at the same time
+    uint16_t tag_index = job->schedule->tag_indices[job->wave_offset + job_index];
+    if(!postprocess_tag(&job->tag_data->tags[tag_index], job->tag_data, &job->plans[tag_index])) {
+        atomic_store_explicit(&job->failed, true, memory_order_relaxed);
+    }
+}
+
 static bool postprocess_tag_data(struct cache_file_instance *cache_file) {
     assert(cache_file && cache_file->valid);
     cache_file->dirty = true;
 
+    struct tag_data_instance *tag_data = &cache_file->tag_data;
+    assert(tag_data->valid);
+    bool dry_run = TEST_FLAG(global_option_flags, GLOBAL_OPTON_FLAGS_DRY_RUN_BIT);
+
     // Fix the BSPs
-    if(!scenario_structure_bsp_postprocess_all_in_cache(cache_file)) {
+    struct tag_fix_plan bsp_plan;
+    tag_fix_plan_init(&bsp_plan, cache_file->data, tag_data->header->scenario_tag);
+    if(!scenario_structure_bsp_postprocess_all_in_cache(cache_file, &bsp_plan)) {
+        tag_fix_plan_free(&bsp_plan);
+        return false;
+    }
+
+    tag_fix_plan_apply(&bsp_plan);
+    if(dry_run) {
+        tag_fix_plan_print(&bsp_plan, tag_data);
+    }
+    tag_fix_plan_free(&bsp_plan);
+
+    // Go through tag array and fix tags. Tags in the same wave do not depend on each other and can be done in any order
+    struct tag_schedule schedule;
+    if(!tag_schedule_build(&schedule, tag_data)) {
+        return false;
+    }
+
+    // Xbox vertex buffers point into the tag data, and only the tag data builder follows them, so blocks are not moved
+    // or merged there
+    bool compact = TEST_FLAG(global_option_flags, GLOBAL_OPTON_FLAGS_COMPACT_BIT);
+    bool merge_duplicates = TEST_FLAG(global_option_flags, GLOBAL_OPTON_FLAGS_MERGE_DUPLICATES_BIT);
+    if(!cache_file_has_model_data(cache_file) && (compact || merge_duplicates)) {
+        thread_output_print("%s: Xbox map, blocks will not be moved or merged\n", cache_file->header->name);
+        compact = false;
+        merge_duplicates = false;
+    }
+
+    // Compaction needs to know what was there before anything was freed
+    struct tag_compaction compaction = {};
+    if(compact) {
+        tag_compaction_begin(&compaction, cache_file);
+    }
+
+    // Before anything else looks at bitmaps and sounds, since there is nothing left to fix in ones that are external
+    bool externalize = TEST_FLAG(global_option_flags, GLOBAL_OPTON_FLAGS_EXTERNALIZE_BIT) && tag_data->indexed_external_tags;
+    if(externalize && !externalize_tags(cache_file)) {
+        tag_schedule_free(&schedule);
+        tag_compaction_free(&compaction);
+        return false;
+    }
+
+    // Raw data is moved here too, so this also goes before the fixers
+    if(TEST_FLAG(global_option_flags, GLOBAL_OPTON_FLAGS_OPTIMIZE_STRIPS_BIT) && !optimize_model_strips(cache_file)) {
+        tag_schedule_free(&schedule);
+        tag_compaction_free(&compaction);
+        return false;
+    }
+
+    // After reordering, so the strips that were replaced by longer ones are dropped
+    if(TEST_FLAG(global_option_flags, GLOBAL_OPTON_FLAGS_MERGE_MODEL_DATA_BIT) && !merge_model_data(cache_file)) {
+        tag_schedule_free(&schedule);
+        tag_compaction_free(&compaction);
+        return false;
+    }
+
+    size_t tag_count = tag_data->header->tag_count;
+    struct tag_fix_plan *plans = calloc(tag_count + 1, sizeof(struct tag_fix_plan));
+    if(!plans) {
+        abort();
+    }
+    for(size_t t = 0; t < tag_count; t++) {
+        tag_fix_plan_init(&plans[t], cache_file->data, tag_data->tags[t].tag_id);
+    }
+
+    struct decal_extent_cache decal_extent_cache;
+    if(!decal_extent_cache_init(&decal_extent_cache, tag_count)) {
+        abort();
+    }
+    tag_data->decal_extent_cache = &decal_extent_cache;
+
+    struct postprocess_tag_job_context job = {
+        .tag_data = tag_data,
+        .plans = plans,
+        .schedule = &schedule
+    };
+    atomic_init(&job.failed, false);
+
+    // Each wave is looked at first, then its plans are applied in tag order before the next wave reads them
+    for(size_t w = 0; w < schedule.wave_count; w++) {
+        job.wave_offset = schedule.wave_offsets[w];
+        thread_pool_run(schedule.wave_offsets[w + 1] - schedule.wave_offsets[w], postprocess_tag_job, &job);
+        if(atomic_load(&job.failed)) {
+            break;
+        }
+
+        for(size_t i = schedule.wave_offsets[w]; i < schedule.wave_offsets[w + 1]; i++) {
+            tag_fix_plan_apply(&plans[schedule.tag_indices[i]]);
+        }
+    }
+
+    bool success = !atomic_load(&job.failed);
+    for(size_t t = 0; t < tag_count; t++) {
+        if(success && dry_run) {
+            tag_fix_plan_print(&plans[t], tag_data);
+        }
+        tag_fix_plan_free(&plans[t]);
+    }
+
+    tag_data->decal_extent_cache = nullptr;
+    decal_extent_cache_free(&decal_extent_cache);
+    free(plans);
+    tag_schedule_free(&schedule);
+    if(!success) {
+        tag_compaction_free(&compaction);
         return false;
     }
 
+    // Last, look for stale pointers the fixers did not already deal with
+    if(TEST_FLAG(global_option_flags, GLOBAL_OPTON_FLAGS_ZERO_POINTERS_BIT)) {
+        struct tag_fix_plan pointer_plan;
+        tag_fix_plan_init(&pointer_plan, cache_file->data, tag_data->header->scenario_tag);
+        success = tag_pointer_audit(cache_file, &pointer_plan);
+        tag_fix_plan_apply(&pointer_plan);
+        if(success && dry_run) {
+            tag_fix_plan_print(&pointer_plan, tag_data);
+        }
+        tag_fix_plan_free(&pointer_plan);
+    }
+    else {
+        success = tag_pointer_audit(cache_file, nullptr);
+    }
+
+    if(success && TEST_FLAG(global_option_flags, GLOBAL_OPTON_FLAGS_PRUNE_ORPHANS_BIT)) {
+        success = prune_orphan_tags(cache_file);
+    }
+
+    if(success && merge_duplicates) {
+        merge_duplicate_blocks(cache_file);
+    }
+
+    // After pruning, so the paths of removed tags that are left between the others are zeroed with the old table
+    if(success && TEST_FLAG(global_option_flags, GLOBAL_OPTON_FLAGS_PACK_TAG_PATHS_BIT)) {
+        pack_tag_paths(cache_file);
+    }
+
+    // Removed tags and merged blocks free up space too, so this goes last
+    if(success && compact) {
+        success = compact_tag_data(cache_file, &compaction);
+    }
+
+    // Compaction only fills holes it knew of before fixing, so this picks up what is left
+    if(success && TEST_FLAG(global_option_flags, GLOBAL_OPTON_FLAGS_REBUILD_TAG_DATA_BIT)) {
+        success = rebuild_tag_data(cache_file);
+    }
+
+    tag_compaction_free(&compaction);
+    return success;
+}
+
+static bool externalize_tags(struct cache_file_instance *cache_file) {
+    assert(cache_file && cache_file->valid);
     struct tag_data_instance *tag_data = &cache_file->tag_data;
-    assert(tag_data->valid);
+    assert(tag_data->resource_index);
+    bool dry_run = TEST_FLAG(global_option_flags, GLOBAL_OPTON_FLAGS_DRY_RUN_BIT);
 
-    // Go through tag array and fix tags
-    for(size_t i = 0; i < tag_data->header->tag_count; i++) {
-        struct tag_instance *tag = &tag_data->tags[i];
+    // The raw data that was pointed to before is needed to tell what is no longer pointed to after
+    struct cache_raw_data raw_data_before;
+    if(!cache_raw_data_collect(&raw_data_before, cache_file)) {
+        return false;
+    }
 
-        // Process shaders
-        if(tag->primary_group == TAG_FOURCC_SHADER ||
-            tag->secondary_group == TAG_FOURCC_SHADER ||
-            tag->tertiary_group == TAG_FOURCC_SHADER
-        ) {
-            if(!shader_postprocess(tag->tag_id, tag_data)) {
-                return false;
-            }
+    struct tag_fix_plan plan;
+    struct tag_externalization_result result;
+    tag_fix_plan_init(&plan, cache_file->data, tag_data->header->scenario_tag);
+    bool success = tag_externalization_plan(tag_data->resource_index, cache_file, &plan, &result);
+    if(success) {
+        tag_fix_plan_apply(&plan);
+        if(dry_run) {
+            tag_fix_plan_print(&plan, tag_data);
         }
-        // Process units
-        else if(tag->secondary_group == TAG_FOURCC_UNIT && tag->tertiary_group == TAG_FOURCC_OBJECT) {
-            if(!uint_postprocess(tag->tag_id, tag_data)) {
-                return false;
-            }
+    }
+    tag_fix_plan_free(&plan);
+
+    size_t removed_size;
+    success = success && remove_unused_raw_data(cache_file, &raw_data_before, &removed_size);
+    cache_raw_data_free(&raw_data_before);
+    if(success && result.bitmap_count + result.sound_count > 0) {
+        thread_output_print("%zu bitmaps and %zu sounds were externalized, removing %zu bytes of raw data\n", result.bitmap_count, result.sound_count, removed_size);
+    }
+    return success;
+}
+
+static bool merge_model_data(struct cache_file_instance *cache_file) {
+    assert(cache_file && cache_file->valid);
+    struct tag_data_instance *tag_data = &cache_file->tag_data;
+    bool dry_run = TEST_FLAG(global_option_flags, GLOBAL_OPTON_FLAGS_DRY_RUN_BIT);
+
+    struct cache_raw_data raw_data_before;
+    if(!cache_raw_data_collect(&raw_data_before, cache_file)) {
+        return false;
+    }
+
+    struct tag_fix_plan plan;
+    struct cache_model_data_result result;
+    tag_fix_plan_init(&plan, cache_file->data, tag_data->header->scenario_tag);
+    bool success = cache_model_data_deduplicate(cache_file, &plan, &result);
+    if(success) {
+        tag_fix_plan_apply(&plan);
+        if(dry_run) {
+            tag_fix_plan_print(&plan, tag_data);
         }
+    }
+    tag_fix_plan_free(&plan);
 
-        // Process other base tags
-        switch(tag->primary_group) {
-            case TAG_FOURCC_ACTOR_VARIANT:
-                if(!actor_variant_postprocess(tag->tag_id, tag_data)) {
-                    return false;
-                }
-                break;
-            case TAG_FOURCC_BITMAP:
-                if(!bitmap_postprocess(tag->tag_id, tag_data)) {
-                    return false;
-                }
-                break;
-            case TAG_FOURCC_DECAL:
-                if(!decal_postprocess(tag->tag_id, tag_data)) {
-                    return false;
-                }
-                break;
-            case TAG_FOURCC_LENS_FLARE:
-                if(!lens_flare_postprocess(tag->tag_id, tag_data)) {
-                    return false;
-                }
-                break;
-            case TAG_FOURCC_METER:
-                if(!meter_postprocess(tag->tag_id, tag_data)) {
-                    return false;
-                }
-                break;
-            case TAG_FOURCC_GBXMODEL:
-                if(!gbxmodel_postprocess(tag->tag_id, tag_data)) {
-                    return false;
-                }
-                break;
-            case TAG_FOURCC_SCENARIO:
-                if(!scenario_postprocess(tag->tag_id, tag_data)) {
-                    return false;
-                }
-                break;
-            case TAG_FOURCC_SHADER_MODEL:
-                if(!shader_model_postprocess(tag->tag_id, tag_data)) {
-                    return false;
-                }
-                break;
-            case TAG_FOURCC_SOUND:
-                if(!sound_postprocess(tag->tag_id, tag_data)) {
-                    return false;
-                }
-                break;
-            case TAG_FOURCC_GRENADE_HUD_INTERFACE:
-                if(!grenade_hud_interface_postprocess(tag->tag_id, tag_data)) {
-                    return false;
-                }
-                break;
-            case TAG_FOURCC_HUD_GLOBALS:
-                if(!hud_globals_postprocess(tag->tag_id, tag_data)) {
-                    return false;
-                }
-                break;
-            case TAG_FOURCC_UNIT_HUD_INTERFACE:
-                if(!unit_hud_interface_postprocess(tag->tag_id, tag_data)) {
-                    return false;
-                }
-                break;
-            case TAG_FOURCC_WEAPON_HUD_INTERFACE:
-                if(!weapon_hud_interface_postprocess(tag->tag_id, tag_data)) {
-                    return false;
-                }
+    size_t removed_size;
+    success = success && remove_unused_raw_data(cache_file, &raw_data_before, &removed_size);
+    cache_raw_data_free(&raw_data_before);
+    if(success && result.new_size != result.old_size) {
+        thread_output_print("%zu vertex buffers and %zu index buffers were merged, shrinking the model data from %u to %u bytes\n",
+            result.vertex_buffer_count, result.index_buffer_count, result.old_size, result.new_size);
+    }
+    return success;
+}
+
+static bool optimize_model_strips(struct cache_file_instance *cache_file) {
+    assert(cache_file && cache_file->valid);
+    struct tag_data_instance *tag_data = &cache_file->tag_data;
+    bool dry_run = TEST_FLAG(global_option_flags, GLOBAL_OPTON_FLAGS_DRY_RUN_BIT);
+
+    struct cache_raw_data raw_data_before;
+    if(!cache_raw_data_collect(&raw_data_before, cache_file)) {
+        return false;
+    }
+
+    struct tag_fix_plan plan;
+    struct cache_model_data_optimization_result result;
+    tag_fix_plan_init(&plan, cache_file->data, tag_data->header->scenario_tag);
+    bool success = cache_model_data_optimize(cache_file, &plan, &result);
+    if(success) {
+        tag_fix_plan_apply(&plan);
+        if(dry_run) {
+            tag_fix_plan_print(&plan, tag_data);
         }
     }
+    tag_fix_plan_free(&plan);
 
+    // Growing already moved everything after the model data up
+    size_t removed_size;
+    success = success && (result.new_size >= result.old_size || remove_unused_raw_data(cache_file, &raw_data_before, &removed_size));
+    cache_raw_data_free(&raw_data_before);
+    if(success && result.triangle_count > 0) {
+        thread_output_print("%zu of %zu model strips were reordered, going from %.3f to %.3f vertices transformed per triangle, with the model data going from %u to %u bytes\n",
+            result.optimized_count, result.strip_count, result.old_misses / result.triangle_count, result.new_misses / result.triangle_count, result.old_size, result.new_size);
+    }
+    return success;
+}
+
+// Moves the raw data left over down over what only raw_data_before points to
+static bool remove_unused_raw_data(struct cache_file_instance *cache_file, struct cache_raw_data *raw_data_before, size_t *removed_size) {
+    assert(cache_file && cache_file->valid && raw_data_before && removed_size);
+    struct tag_data_instance *tag_data = &cache_file->tag_data;
+    bool dry_run = TEST_FLAG(global_option_flags, GLOBAL_OPTON_FLAGS_DRY_RUN_BIT);
+
+    struct cache_raw_data raw_data_after;
+    if(!cache_raw_data_collect(&raw_data_after, cache_file)) {
+        return false;
+    }
+
+    struct tag_fix_plan plan;
+    struct cache_file_range *ranges;
+    size_t range_count;
+    tag_fix_plan_init(&plan, cache_file->data, tag_data->header->scenario_tag);
+    *removed_size = cache_raw_data_plan_removal(raw_data_before, &raw_data_after, cache_file, &plan, &ranges, &range_count);
+    tag_fix_plan_apply(&plan);
+    if(dry_run) {
+        tag_fix_plan_print(&plan, tag_data);
+    }
+    tag_fix_plan_free(&plan);
+    cache_raw_data_free(&raw_data_after);
+
+    bool success = cache_file_remove_ranges(cache_file, ranges, range_count);
+    free(ranges);
+    return success;
+}
+
+static bool prune_orphan_tags(struct cache_file_instance *cache_file) {
+    assert(cache_file && cache_file->valid);
+    struct tag_data_instance *tag_data = &cache_file->tag_data;
+    bool dry_run = TEST_FLAG(global_option_flags, GLOBAL_OPTON_FLAGS_DRY_RUN_BIT);
+
+    struct tag_reference_graph graph;
+    if(!tag_reference_graph_build(&graph, cache_file)) {
+        return false;
+    }
+
+    size_t orphan_count = tag_reference_graph_print_orphans(&graph, tag_data);
+    struct tag_fix_plan plan;
+    tag_fix_plan_init(&plan, cache_file->data, tag_data->header->scenario_tag);
+    size_t removed_count = tag_reference_graph_plan_prune(&graph, cache_file, &plan);
+
+    // Print first, since moved tags have a different ID afterwards
+    if(dry_run) {
+        tag_fix_plan_print(&plan, tag_data);
+    }
+    tag_fix_plan_apply(&plan);
+    tag_fix_plan_free(&plan);
+    tag_reference_graph_free(&graph);
+
+    if(removed_count < orphan_count) {
+        thread_output_print("%zu of %zu unreferenced tags can not be removed, since tags after them could not be moved\n", orphan_count - removed_count, orphan_count);
+    }
     return true;
 }
+
+static void merge_duplicate_blocks(struct cache_file_instance *cache_file) {
+    assert(cache_file && cache_file->valid);
+    struct tag_data_instance *tag_data = &cache_file->tag_data;
+    bool dry_run = TEST_FLAG(global_option_flags, GLOBAL_OPTON_FLAGS_DRY_RUN_BIT);
+
+    struct tag_fix_plan plan;
+    struct tag_deduplication_result result;
+    tag_fix_plan_init(&plan, cache_file->data, tag_data->header->scenario_tag);
+    tag_deduplication_plan(cache_file, &plan, &result);
+    tag_fix_plan_apply(&plan);
+    if(dry_run) {
+        tag_fix_plan_print(&plan, tag_data);
+    }
+    tag_fix_plan_free(&plan);
+
+    if(result.block_count > 0) {
+        thread_output_print("%zu duplicate blocks (%zu bytes) are no longer used\n", result.block_count, result.byte_count);
+    }
+}
+
+static void pack_tag_paths(struct cache_file_instance *cache_file) {
+    assert(cache_file && cache_file->valid);
+    struct tag_data_instance *tag_data = &cache_file->tag_data;
+    bool dry_run = TEST_FLAG(global_option_flags, GLOBAL_OPTON_FLAGS_DRY_RUN_BIT);
+
+    struct tag_fix_plan plan;
+    struct tag_path_table_result result;
+    tag_fix_plan_init(&plan, cache_file->data, tag_data->header->scenario_tag);
+    tag_path_table_plan(cache_file, &plan, &result);
+    tag_fix_plan_apply(&plan);
+    if(dry_run) {
+        tag_fix_plan_print(&plan, tag_data);
+    }
+    tag_fix_plan_free(&plan);
+
+    if(result.new_size < result.old_size) {
+        thread_output_print("%zu tag paths were packed into %zu, shrinking the table from %u to %u bytes\n", result.path_count, result.packed_count, result.old_size, result.new_size);
+    }
+}
+
+static bool compact_tag_data(struct cache_file_instance *cache_file, struct tag_compaction *compaction) {
+    assert(cache_file && cache_file->valid && compaction);
+    struct tag_data_instance *tag_data = &cache_file->tag_data;
+    bool dry_run = TEST_FLAG(global_option_flags, GLOBAL_OPTON_FLAGS_DRY_RUN_BIT);
+
+    struct tag_fix_plan plan;
+    tag_fix_plan_init(&plan, cache_file->data, tag_data->header->scenario_tag);
+    size_t old_size = tag_data->size;
+    size_t new_size = tag_compaction_plan(compaction, cache_file, &plan);
+    tag_fix_plan_apply(&plan);
+    if(dry_run) {
+        tag_fix_plan_print(&plan, tag_data);
+    }
+    tag_fix_plan_free(&plan);
+
+    if(new_size == old_size) {
+        return true;
+    }
+    if(!cache_file_shrink_tag_data(cache_file, new_size)) {
+        return false;
+    }
+
+    thread_output_print("tag data was compacted from %zu to %zu bytes\n", old_size, new_size);
+    return true;
+}
+
+static bool rebuild_tag_data(struct cache_file_instance *cache_file) {
+    assert(cache_file && cache_file->valid);
+    size_t old_size = cache_file->tag_data.size;
+
+    struct tag_data_builder builder;
+    tag_data_builder_init(&builder, cache_file);
+    bool success = tag_data_builder_commit(&builder);
+    tag_data_builder_free(&builder);
+
+    if(success && cache_file->tag_data.size != old_size) {
+        thread_output_print("tag data was rebuilt from %zu to %zu bytes\n", old_size, cache_file->tag_data.size);
+    }
+    return success;
+}
@@ -0,0 +1,351 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "resource_index.h"
+
+#include "../data_types.h"
+#include "../file/file.h"
+#include "../tag_groups/bitmap.h"
+#include "../tag_groups/sound.h"
+#include "resources.h"
+#include "../thread/thread_output.h"
+
+#define RESOURCE_INDEX_CACHE_SIGNATURE 0x69727173 // "sqri"
+#define RESOURCE_INDEX_CACHE_VERSION 2
+
+enum {
+    RESOURCE_INDEX_CACHE_MAP_BITMAPS,
+    RESOURCE_INDEX_CACHE_MAP_SOUNDS,
+    NUMBER_OF_RESOURCE_INDEX_CACHE_MAPS
+};
+
+enum {
+    RESOURCE_INDEX_TABLE_BITMAP_PATHS,
+    RESOURCE_INDEX_TABLE_BITMAP_PIXEL_RANGES,
+    RESOURCE_INDEX_TABLE_BITMAP_CONTENTS,
+    RESOURCE_INDEX_TABLE_SOUND_PATHS,
+    NUMBER_OF_RESOURCE_INDEX_TABLES
+};
+
+#pragma pack(push, 1)
+
+struct resource_index_cache_map {
+    uint64_t size;
+    int64_t modified_time;
+    uint64_t hash; // Of the header, resource list and paths
+};
+static_assert(sizeof(struct resource_index_cache_map) == 24);
+
+// Followed by the keys and then the resources of each table, in order
+struct resource_index_cache_header {
+    uint32_t signature;
+    uint32_t version;
+    struct resource_index_cache_map maps[NUMBER_OF_RESOURCE_INDEX_CACHE_MAPS];
+    uint64_t table_counts[NUMBER_OF_RESOURCE_INDEX_TABLES];
+};
+static_assert(sizeof(struct resource_index_cache_header) == 88);
+
+#pragma pack(pop)
+
+static struct resource_map_index *resource_index_get_table(struct resource_index *index, size_t table) {
+    switch(table) {
+        case RESOURCE_INDEX_TABLE_BITMAP_PATHS:
+            return &index->bitmap_paths;
+        case RESOURCE_INDEX_TABLE_BITMAP_PIXEL_RANGES:
+            return &index->bitmap_pixel_ranges;
+        case RESOURCE_INDEX_TABLE_BITMAP_CONTENTS:
+            return &index->bitmap_contents;
+        case RESOURCE_INDEX_TABLE_SOUND_PATHS:
+            return &index->sound_paths;
+        default:
+            abort();
+    }
+}
+
+static uint64_t resource_index_hash_path(const char *path) {
+    uint64_t hash = resource_map_hash(RESOURCE_MAP_HASH_NEW, path, strlen(path));
+    return hash != 0 ? hash : 1;
+}
+
+// Anything that changes where resources are is in here. Changing what is in them without changing the size or the
+// modification time is not something anything does.
+static struct resource_index_cache_map resource_index_describe_map(const struct resource_map *map) {
+    uint64_t hash = resource_map_hash(RESOURCE_MAP_HASH_NEW, map->header, sizeof(struct resource_map_header));
+    hash = resource_map_hash(hash, map->resources, map->resource_count * sizeof(struct resource_map_resource));
+    for(uint32_t r = 0; r < map->resource_count; r++) {
+        const char *path = resource_map_get_path(map, r);
+        hash = resource_map_hash(hash, path, strlen(path) + 1);
+    }
+
+    return (struct resource_index_cache_map){ map->size, map->file.modified_time, hash };
+}
+
+static char *resource_index_get_path(const char *directory, const char *name) {
+    size_t path_size = strlen(directory) + strlen(name) + 2;
+    char *path = malloc(path_size);
+    if(!path) {
+        abort();
+    }
+    snprintf(path, path_size, "%s/%s", directory, name);
+    return path;
+}
+
+static bool resource_index_load_map(const char *directory, const char *name, uint32_t type, struct resource_map *map) {
+    char *path = resource_index_get_path(directory, name);
+    bool success = resource_map_load(path, type, map);
+    free(path);
+    return success;
+}
+
+static bool resource_index_read_cache(struct resource_index *index, const char *path, const struct resource_index_cache_map *maps) {
+    struct file_mapping cache;
+    if(!file_map_read_only(path, &cache)) {
+        return false;
+    }
+
+    const struct resource_index_cache_header *header = (const struct resource_index_cache_header *)cache.data;
+    bool valid = cache.size >= sizeof(struct resource_index_cache_header) &&
+        header->signature == RESOURCE_INDEX_CACHE_SIGNATURE &&
+        header->version == RESOURCE_INDEX_CACHE_VERSION &&
+        memcmp(header->maps, maps, sizeof(header->maps)) == 0;
+
+    uint64_t expected_size = sizeof(struct resource_index_cache_header);
+    for(size_t t = 0; valid && t < NUMBER_OF_RESOURCE_INDEX_TABLES; t++) {
+        valid = header->table_counts[t] <= UINT32_MAX;
+        expected_size += header->table_counts[t] * (sizeof(uint64_t) + sizeof(uint32_t));
+    }
+    valid = valid && expected_size == cache.size;
+
+    const uint8_t *cursor = cache.data + sizeof(struct resource_index_cache_header);
+    for(size_t t = 0; valid && t < NUMBER_OF_RESOURCE_INDEX_TABLES; t++) {
+        struct resource_map_index *table = resource_index_get_table(index, t);
+        size_t count = header->table_counts[t];
+        table->keys = calloc(MAX(count, 1), sizeof(uint64_t));
+        table->resources = calloc(MAX(count, 1), sizeof(uint32_t));
+        if(!table->keys || !table->resources) {
+            abort();
+        }
+        table->count = count;
+        memcpy(table->keys, cursor, count * sizeof(uint64_t));
+        cursor += count * sizeof(uint64_t);
+        memcpy(table->resources, cursor, count * sizeof(uint32_t));
+        cursor += count * sizeof(uint32_t);
+
+        // Lookups binary search these and then read the resources, so a bad cache must not get through
+        uint32_t resource_count = t == RESOURCE_INDEX_TABLE_SOUND_PATHS ? index->sounds.resource_count : index->bitmaps.resource_count;
+        for(size_t i = 0; valid && i < count; i++) {
+            valid = table->resources[i] < resource_count && (i == 0 || table->keys[i - 1] <= table->keys[i]);
+        }
+    }
+
+    file_unmap(&cache);
+    return valid;
+}
+
+static void resource_index_write_cache(struct resource_index *index, const char *path, const struct resource_index_cache_map *maps) {
+    struct resource_index_cache_header header = {
+        .signature = RESOURCE_INDEX_CACHE_SIGNATURE,
+        .version = RESOURCE_INDEX_CACHE_VERSION
+    };
+    memcpy(header.maps, maps, sizeof(header.maps));
+
+    size_t size = sizeof(header);
+    for(size_t t = 0; t < NUMBER_OF_RESOURCE_INDEX_TABLES; t++) {
+        header.table_counts[t] = resource_index_get_table(index, t)->count;
+        size += header.table_counts[t] * (sizeof(uint64_t) + sizeof(uint32_t));
+    }
+
+    uint8_t *cache = malloc(size);
+    if(!cache) {
+        abort();
+    }
+    memcpy(cache, &header, sizeof(header));
+    uint8_t *cursor = cache + sizeof(header);
+    for(size_t t = 0; t < NUMBER_OF_RESOURCE_INDEX_TABLES; t++) {
+        const struct resource_map_index *table = resource_index_get_table(index, t);
+        memcpy(cursor, table->keys, table->count * sizeof(uint64_t));
+        cursor += table->count * sizeof(uint64_t);
+        memcpy(cursor, table->resources, table->count * sizeof(uint32_t));
+        cursor += table->count * sizeof(uint32_t);
+    }
+
+    // Not being able to save it only makes the next run slower
+    if(!file_write_from_buffer(path, cache, size)) {
+        thread_output_error("%s: The resource map index will be rebuilt next time\n", path);
+    }
+    free(cache);
+}
+
+static int resource_index_compare_resources(const void *a, const void *b) {
+    uint32_t resource_a = *(const uint32_t *)a;
+    uint32_t resource_b = *(const uint32_t *)b;
+    return (resource_a > resource_b) - (resource_a < resource_b);
+}
+
+static void resource_index_build_paths(struct resource_map_index *table, const struct resource_map *map, const struct resource_map_index *tags) {
+    uint64_t *keys = calloc(MAX(tags->count, 1), sizeof(uint64_t));
+    uint32_t *resources = calloc(MAX(tags->count, 1), sizeof(uint32_t));
+    if(!keys || !resources) {
+        abort();
+    }
+
+    // Ordered by resource so ties go to the first resource with the path
+    for(size_t i = 0; i < tags->count; i++) {
+        resources[i] = tags->resources[i];
+    }
+    qsort(resources, tags->count, sizeof(uint32_t), resource_index_compare_resources);
+    for(size_t i = 0; i < tags->count; i++) {
+        keys[i] = resource_index_hash_path(resource_map_get_path(map, resources[i]));
+    }
+    resource_map_index_init(table, keys, resources, tags->count);
+}
+
+// Ranges are keyed by their start and then their size, so the last range starting at or before an offset is found with
+// one search
+#define RESOURCE_INDEX_RANGE_KEY(start, size) (((uint64_t)(start) << 32) | (uint32_t)(size))
+
+// Position of the range that all of the data is in, or ranges->count if there is none
+static size_t resource_index_find_range(const struct resource_map_index *ranges, uint32_t offset, uint32_t size) {
+    size_t i = resource_map_index_find_last(ranges, RESOURCE_INDEX_RANGE_KEY(offset, UINT32_MAX));
+    if(i == ranges->count) {
+        return ranges->count;
+    }
+
+    uint64_t range_start = ranges->keys[i] >> 32;
+    uint64_t range_size = ranges->keys[i] & UINT32_MAX;
+    return (uint64_t)offset + size <= range_start + range_size ? i : ranges->count;
+}
+
+static void resource_index_build_bitmap_pixel_ranges(struct resource_index *index) {
+    const struct resource_map *map = &index->bitmaps;
+    uint64_t *keys = calloc(MAX(map->resource_count, 1), sizeof(uint64_t));
+    uint32_t *resources = calloc(MAX(map->resource_count, 1), sizeof(uint32_t));
+    uint32_t *owners = calloc(MAX(map->resource_count, 1), sizeof(uint32_t));
+    if(!keys || !resources || !owners) {
+        abort();
+    }
+
+    size_t entry_count = 0;
+    for(uint32_t r = 0; r < map->resource_count; r++) {
+        owners[r] = RESOURCE_MAP_NO_MATCH;
+        if(map->resources[r].size > 0) {
+            keys[entry_count] = RESOURCE_INDEX_RANGE_KEY(map->resources[r].data_offset, map->resources[r].size);
+            resources[entry_count++] = r;
+        }
+    }
+    struct resource_map_index entries;
+    resource_map_index_init(&entries, keys, resources, entry_count);
+
+    // Only tags that are in bitmap_contents have all of their pixels in bounds. If tags share pixels, the first one
+    // gets them.
+    for(size_t i = 0; i < index->bitmap_contents.count; i++) {
+        uint32_t tag = index->bitmap_contents.resources[i];
+        const struct bitmap *bitmap_group = resource_map_get_data(map, tag, 0, sizeof(struct bitmap));
+        const struct bitmap_data *bitmaps = resource_map_get_data(map, tag, bitmap_group->bitmaps.address, bitmap_group->bitmaps.count * sizeof(struct bitmap_data));
+        for(size_t b = 0; b < bitmap_group->bitmaps.count; b++) {
+            size_t entry = resource_index_find_range(&entries, bitmaps[b].pixels_offset, bitmaps[b].pixels_size);
+            if(entry < entries.count) {
+                uint32_t *owner = &owners[entries.resources[entry]];
+                *owner = MIN(*owner, tag);
+            }
+        }
+    }
+
+    keys = calloc(MAX(entries.count, 1), sizeof(uint64_t));
+    resources = calloc(MAX(entries.count, 1), sizeof(uint32_t));
+    if(!keys || !resources) {
+        abort();
+    }
+    size_t range_count = 0;
+    for(size_t i = 0; i < entries.count; i++) {
+        uint32_t owner = owners[entries.resources[i]];
+        if(owner != RESOURCE_MAP_NO_MATCH) {
+            keys[range_count] = entries.keys[i];
+            resources[range_count++] = owner;
+        }
+    }
+    resource_map_index_init(&index->bitmap_pixel_ranges, keys, resources, range_count);
+    resource_map_index_free(&entries);
+    free(owners);
+}
+
+// Every resource in sounds.map that is big enough to be a sound
+static uint64_t resource_index_sound_key(const struct resource_map *map, uint32_t resource) {
+    if(map->resources[resource].size < sizeof(struct sound)) {
+        return 0;
+    }
+    return resource_index_hash_path(resource_map_get_path(map, resource));
+}
+
+static void resource_index_build(struct resource_index *index) {
+    resource_map_index_build(&index->bitmap_contents, &index->bitmaps, bitmap_resource_key);
+    resource_index_build_paths(&index->bitmap_paths, &index->bitmaps, &index->bitmap_contents);
+    resource_index_build_bitmap_pixel_ranges(index);
+    resource_map_index_build(&index->sound_paths, &index->sounds, resource_index_sound_key);
+}
+
+bool resource_index_load(struct resource_index *index, const char *directory) {
+    assert(index && directory);
+    memset(index, 0, sizeof(struct resource_index));
+    if(!resource_index_load_map(directory, "bitmaps.map", RESOURCE_MAP_TYPE_BITMAPS, &index->bitmaps) ||
+        !resource_index_load_map(directory, "sounds.map", RESOURCE_MAP_TYPE_SOUNDS, &index->sounds)) {
+        resource_index_free(index);
+        return false;
+    }
+
+    struct resource_index_cache_map maps[NUMBER_OF_RESOURCE_INDEX_CACHE_MAPS] = {
+        [RESOURCE_INDEX_CACHE_MAP_BITMAPS] = resource_index_describe_map(&index->bitmaps),
+        [RESOURCE_INDEX_CACHE_MAP_SOUNDS] = resource_index_describe_map(&index->sounds)
+    };
+
+    char *cache_path = resource_index_get_path(directory, RESOURCE_INDEX_CACHE_NAME);
+    if(!resource_index_read_cache(index, cache_path, maps)) {
+        for(size_t t = 0; t < NUMBER_OF_RESOURCE_INDEX_TABLES; t++) {
+            resource_map_index_free(resource_index_get_table(index, t));
+        }
+        resource_index_build(index);
+        resource_index_write_cache(index, cache_path, maps);
+    }
+    free(cache_path);
+    return true;
+}
+
+void resource_index_free(struct resource_index *index) {
+    assert(index);
+    for(size_t t = 0; t < NUMBER_OF_RESOURCE_INDEX_TABLES; t++) {
+        resource_map_index_free(resource_index_get_table(index, t));
+    }
+    resource_map_free(&index->bitmaps);
+    resource_map_free(&index->sounds);
+}
+
+static uint32_t resource_index_find_path(const struct resource_map_index *table, const struct resource_map *map, const char *tag_path) {
+    uint64_t key = resource_index_hash_path(tag_path);
+    for(size_t i = resource_map_index_find(table, key); i < table->count && table->keys[i] == key; i++) {
+        if(strcmp(resource_map_get_path(map, table->resources[i]), tag_path) == 0) {
+            return table->resources[i];
+        }
+    }
+    return RESOURCE_MAP_NO_MATCH;
+}
+
+uint32_t resource_index_find_bitmap(const struct resource_index *index, const char *tag_path) {
+    assert(index && tag_path);
+    return resource_index_find_path(&index->bitmap_paths, &index->bitmaps, tag_path);
+}
+
+// The tag whose pixels are in the same bitmaps.map entry as these, as long as these fit in it
+uint32_t resource_index_find_bitmap_pixels(const struct resource_index *index, uint32_t pixels_offset, uint32_t pixels_size) {
+    assert(index);
+    const struct resource_map_index *ranges = &index->bitmap_pixel_ranges;
+    size_t i = resource_index_find_range(ranges, pixels_offset, pixels_size);
+    return i < ranges->count ? ranges->resources[i] : RESOURCE_MAP_NO_MATCH;
+}
+
+uint32_t resource_index_find_sound(const struct resource_index *index, const char *tag_path) {
+    assert(index && tag_path);
+    return resource_index_find_path(&index->sound_paths, &index->sounds, tag_path);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "resource_map.h"
+
+// Lookup tables over the bitmaps.map and sounds.map actually in use, instead of the stock lists in resources.h.
+// Building them reads every bitmap in bitmaps.map, so they are saved to a cache file next to the resource maps and
+// read back while the resource maps have the same size, modification time and resource list.
+struct resource_index {
+    struct resource_map bitmaps;
+    struct resource_map sounds;
+    struct resource_map_index bitmap_paths; // bitmaps.map tags by the hash of their path
+    struct resource_map_index bitmap_pixel_ranges; // bitmaps.map entries holding pixels by where they are, to their tag
+    struct resource_map_index bitmap_contents; // bitmaps.map tags by the hash of all of their pixels
+    struct resource_map_index sound_paths; // sounds.map tags by the hash of their path
+};
+
+#define RESOURCE_INDEX_CACHE_NAME "tool-squisher-resources.cache"
+
+bool resource_index_load(struct resource_index *index, const char *directory);
+void resource_index_free(struct resource_index *index);
+
+// These return RESOURCE_MAP_NO_MATCH if there is no such tag
+uint32_t resource_index_find_bitmap(const struct resource_index *index, const char *tag_path);
+uint32_t resource_index_find_bitmap_pixels(const struct resource_index *index, uint32_t pixels_offset, uint32_t pixels_size);
+uint32_t resource_index_find_sound(const struct resource_index *index, const char *tag_path);
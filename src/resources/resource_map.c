@@ -0,0 +1,193 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "resource_map.h"
+
+#include "../data_types.h"
+#include "../file/file.h"
+#include "../thread/thread_output.h"
+
+bool resource_map_load(const char *path, uint32_t type, struct resource_map *map) {
+    assert(path && map);
+    memset(map, 0, sizeof(struct resource_map));
+    if(!file_map_read_only(path, &map->file)) {
+        thread_output_error("%s: Failed to open\n", path);
+        return false;
+    }
+    map->data = map->file.data;
+    map->size = map->file.size;
+
+    if(map->size < sizeof(struct resource_map_header) || map->header->type != type) {
+        thread_output_error("%s: Not a valid resource map of the right type\n", path);
+        goto cleanup;
+    }
+
+    uint64_t end_of_resources = map->header->resources_offset + (uint64_t)map->header->resource_count * sizeof(struct resource_map_resource);
+    if(end_of_resources > map->size || map->header->paths_offset > map->size) {
+        thread_output_error("%s: Resource list is out of bounds\n", path);
+        goto cleanup;
+    }
+
+    map->resources = (const struct resource_map_resource *)(map->data + map->header->resources_offset);
+    map->resource_count = map->header->resource_count;
+    for(uint32_t r = 0; r < map->resource_count; r++) {
+        const struct resource_map_resource *resource = &map->resources[r];
+        if((uint64_t)resource->data_offset + resource->size > map->size || !resource_map_get_path(map, r)) {
+            thread_output_error("%s: Resource %u is out of bounds\n", path, r);
+            goto cleanup;
+        }
+    }
+
+    return true;
+
+    cleanup:
+    resource_map_free(map);
+    return false;
+}
+
+void resource_map_free(struct resource_map *map) {
+    assert(map);
+    file_unmap(&map->file);
+    memset(map, 0, sizeof(struct resource_map));
+}
+
+// nullptr if the path is not terminated inside the map
+const char *resource_map_get_path(const struct resource_map *map, uint32_t resource) {
+    assert(map && resource < map->resource_count);
+    uint64_t offset = (uint64_t)map->header->paths_offset + map->resources[resource].path_offset;
+    if(offset >= map->size || !memchr(map->data + offset, '\0', map->size - offset)) {
+        return nullptr;
+    }
+    return (const char *)(map->data + offset);
+}
+
+// Offset is from the start of the resource. nullptr if out of bounds of the resource.
+const void *resource_map_get_data(const struct resource_map *map, uint32_t resource, uint32_t offset, size_t size) {
+    assert(map && resource < map->resource_count);
+    const struct resource_map_resource *entry = &map->resources[resource];
+    if(offset > entry->size || size > entry->size - offset) {
+        return nullptr;
+    }
+    return map->data + entry->data_offset + offset;
+}
+
+const void *resource_map_get_file_data(const struct resource_map *map, uint32_t offset, size_t size) {
+    assert(map);
+    if(offset > map->size || size > map->size - offset) {
+        return nullptr;
+    }
+    return map->data + offset;
+}
+
+uint64_t resource_map_hash(uint64_t hash, const void *data, size_t size) {
+    assert(data || size == 0);
+    const uint8_t *bytes = data;
+    for(size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3;
+    }
+    return hash;
+}
+
+static thread_local const uint64_t *resource_map_index_sort_keys;
+
+static int resource_map_index_compare(const void *a, const void *b) {
+    uint64_t key_a = resource_map_index_sort_keys[*(const uint32_t *)a];
+    uint64_t key_b = resource_map_index_sort_keys[*(const uint32_t *)b];
+    if(key_a != key_b) {
+        return key_a > key_b ? 1 : -1;
+    }
+    return (*(const uint32_t *)a > *(const uint32_t *)b) - (*(const uint32_t *)a < *(const uint32_t *)b);
+}
+
+void resource_map_index_init(struct resource_map_index *index, uint64_t *keys, uint32_t *resources, size_t count) {
+    assert(index && ((keys && resources) || count == 0));
+    uint32_t *order = calloc(MAX(count, 1), sizeof(uint32_t));
+    index->keys = calloc(MAX(count, 1), sizeof(uint64_t));
+    index->resources = calloc(MAX(count, 1), sizeof(uint32_t));
+    if(!order || !index->keys || !index->resources) {
+        abort();
+    }
+    index->count = count;
+
+    // qsort has no context argument. Ties keep their order so the first match is the first one given.
+    for(size_t i = 0; i < count; i++) {
+        order[i] = i;
+    }
+    resource_map_index_sort_keys = keys;
+    qsort(order, count, sizeof(uint32_t), resource_map_index_compare);
+    resource_map_index_sort_keys = nullptr;
+
+    for(size_t i = 0; i < count; i++) {
+        index->keys[i] = keys[order[i]];
+        index->resources[i] = resources[order[i]];
+    }
+    free(order);
+    free(keys);
+    free(resources);
+}
+
+void resource_map_index_build(struct resource_map_index *index, const struct resource_map *map, uint64_t (*key)(const struct resource_map *map, uint32_t resource)) {
+    assert(index && map && key);
+    uint64_t *keys = calloc(MAX(map->resource_count, 1), sizeof(uint64_t));
+    uint32_t *resources = calloc(MAX(map->resource_count, 1), sizeof(uint32_t));
+    if(!keys || !resources) {
+        abort();
+    }
+
+    size_t count = 0;
+    for(uint32_t r = 0; r < map->resource_count; r++) {
+        uint64_t resource_key = key(map, r);
+        if(resource_key != 0) {
+            keys[count] = resource_key;
+            resources[count++] = r;
+        }
+    }
+    resource_map_index_init(index, keys, resources, count);
+}
+
+// First position in the index with this key, or index->count if there is none
+size_t resource_map_index_find(const struct resource_map_index *index, uint64_t key) {
+    assert(index);
+    size_t low = 0;
+    size_t high = index->count;
+    while(low < high) {
+        size_t middle = low + (high - low) / 2;
+        if(index->keys[middle] < key) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+
+    return low < index->count && index->keys[low] == key ? low : index->count;
+}
+
+// Last position in the index with a key no greater than this one, or index->count if there is none
+size_t resource_map_index_find_last(const struct resource_map_index *index, uint64_t key) {
+    assert(index);
+    size_t low = 0;
+    size_t high = index->count;
+    while(low < high) {
+        size_t middle = low + (high - low) / 2;
+        if(index->keys[middle] <= key) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+
+    return low > 0 ? low - 1 : index->count;
+}
+
+void resource_map_index_free(struct resource_map_index *index) {
+    assert(index);
+    free(index->keys);
+    free(index->resources);
+    memset(index, 0, sizeof(struct resource_map_index));
+}
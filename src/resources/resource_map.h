@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "../file/file.h"
+
+#define RESOURCE_MAP_HASH_NEW 0xCBF29CE484222325
+
+enum {
+    RESOURCE_MAP_TYPE_BITMAPS = 1,
+    RESOURCE_MAP_TYPE_SOUNDS,
+    RESOURCE_MAP_TYPE_LOC
+};
+
+#pragma pack(push, 1)
+
+struct resource_map_header {
+    uint32_t type;
+    uint32_t paths_offset;
+    uint32_t resources_offset;
+    uint32_t resource_count;
+};
+static_assert(sizeof(struct resource_map_header) == 16);
+
+struct resource_map_resource {
+    uint32_t path_offset; // From paths_offset
+    uint32_t size;
+    uint32_t data_offset; // File offset
+};
+static_assert(sizeof(struct resource_map_resource) == 12);
+
+#pragma pack(pop)
+
+// A Custom Edition bitmaps.map or sounds.map, mapped into memory. Tag data in these has its pointers relative to the
+// start of its own resource, and raw data (pixels, samples) is referenced by file offset.
+struct resource_map {
+    struct file_mapping file;
+    union {
+        const uint8_t *data;
+        const struct resource_map_header *header;
+    };
+    size_t size;
+    const struct resource_map_resource *resources;
+    uint32_t resource_count;
+};
+
+// Resources sorted by a key the caller computes from their contents, so resources can be found by what is in them
+struct resource_map_index {
+    uint64_t *keys;
+    uint32_t *resources;
+    size_t count;
+};
+
+bool resource_map_load(const char *path, uint32_t type, struct resource_map *map);
+void resource_map_free(struct resource_map *map);
+const char *resource_map_get_path(const struct resource_map *map, uint32_t resource);
+const void *resource_map_get_data(const struct resource_map *map, uint32_t resource, uint32_t offset, size_t size);
+const void *resource_map_get_file_data(const struct resource_map *map, uint32_t offset, size_t size);
+
+// FNV-1a, which can be fed one piece at a time
+uint64_t resource_map_hash(uint64_t hash, const void *data, size_t size);
+
+// Takes the arrays, which must be allocated with malloc
+void resource_map_index_init(struct resource_map_index *index, uint64_t *keys, uint32_t *resources, size_t count);
+
+// key returns 0 for resources that should not be indexed
+void resource_map_index_build(struct resource_map_index *index, const struct resource_map *map, uint64_t (*key)(const struct resource_map *map, uint32_t resource));
+size_t resource_map_index_find(const struct resource_map_index *index, uint64_t key);
+size_t resource_map_index_find_last(const struct resource_map_index *index, uint64_t key);
+void resource_map_index_free(struct resource_map_index *index);
@@ -2,31 +2,18 @@
 #include <string.h>
 
 #include "resources.h"
+#include "resources_hash.h"
 
 uint32_t resources_get_bitmap_index(const char *tag_path) {
-    if(!tag_path) {
+    auto i = resources_hash_find(&resources_bitmaps_map_hash_table, tag_path);
+    if(i == RESOURCES_HASH_NO_MATCH || strcmp(tag_path, bitmaps_map_resource_list[i]) != 0) {
         return RESOURCE_MAP_NO_MATCH;
     }
 
-    for(uint32_t i = 0; i < NUMBER_OF_BITMAPS_MAP_RESOURCES; i++) {
-        if(strcmp(tag_path, bitmaps_map_resource_list[i]) == 0) {
-            return i + i + 1;
-        }
-    }
-
-    return RESOURCE_MAP_NO_MATCH;
+    return i + i + 1;
 }
 
 bool resources_sound_is_in_sounds_map(const char *tag_path) {
-    if(!tag_path) {
-        return false;
-    }
-
-    for(uint32_t i = 0; i < NUMBER_OF_SOUNDS_MAP_RESOURCES; i++) {
-        if(strcmp(tag_path, sounds_map_resource_list[i]) == 0) {
-            return true;
-        }
-    }
-
-    return false;
+    auto i = resources_hash_find(&resources_sounds_map_hash_table, tag_path);
+    return i != RESOURCES_HASH_NO_MATCH && strcmp(tag_path, sounds_map_resource_list[i]) == 0;
 }
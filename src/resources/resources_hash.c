@@ -0,0 +1,45 @@
+#include <stdint.h>
+#include <assert.h>
+
+#include "resources_hash.h"
+
+// FNV-1a with a splitmix64 finalizer so both halves of the result are usable
+uint64_t resources_hash_string(const char *string, uint32_t seed) {
+    assert(string);
+    uint64_t hash = 0xCBF29CE484222325 ^ seed;
+    for(const uint8_t *c = (const uint8_t *)string; *c != '\0'; c++) {
+        hash ^= *c;
+        hash *= 0x100000001B3;
+    }
+
+    hash ^= hash >> 30;
+    hash *= 0xBF58476D1CE4E5B9;
+    hash ^= hash >> 27;
+    hash *= 0x94D049BB133111EB;
+    hash ^= hash >> 31;
+    return hash;
+}
+
+uint32_t resources_hash_get_bucket(uint64_t hash, uint32_t bucket_count) {
+    return (uint32_t)(hash >> 32) % bucket_count;
+}
+
+uint32_t resources_hash_get_slot(uint64_t hash, uint32_t displacement, uint32_t key_count) {
+    uint64_t f1 = (uint32_t)hash % key_count;
+    uint64_t f2 = (uint32_t)((hash * 0x9E3779B97F4A7C15) >> 32) % key_count;
+    uint64_t d0 = displacement / key_count;
+    uint64_t d1 = displacement % key_count;
+    return (f1 + d0 * f2 + d1) % key_count;
+}
+
+// Returns the only list index the string can be at. The caller still has to compare the string against it.
+uint32_t resources_hash_find(const struct resources_hash_table *table, const char *string) {
+    assert(table);
+    if(!string) {
+        return RESOURCES_HASH_NO_MATCH;
+    }
+
+    uint64_t hash = resources_hash_string(string, table->seed);
+    uint32_t displacement = table->displacements[resources_hash_get_bucket(hash, table->bucket_count)];
+    return table->indices[resources_hash_get_slot(hash, displacement, table->key_count)];
+}
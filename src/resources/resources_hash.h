@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdint.h>
+
+#define RESOURCES_HASH_NO_MATCH UINT32_MAX
+
+// Minimal perfect hash table (hash and displace) over a fixed list of tag paths.
+// These are generated at build time by resources_hash_generator.c
+struct resources_hash_table {
+    uint32_t seed;
+    uint32_t key_count;
+    uint32_t bucket_count;
+    const uint32_t *displacements; // One per bucket, d0 * key_count + d1
+    const uint16_t *indices; // Slot to list index
+};
+
+extern const struct resources_hash_table resources_bitmaps_map_hash_table;
+extern const struct resources_hash_table resources_sounds_map_hash_table;
+extern const struct resources_hash_table decal_stock_bitmap_extent_hash_table;
+
+uint64_t resources_hash_string(const char *string, uint32_t seed);
+uint32_t resources_hash_get_bucket(uint64_t hash, uint32_t bucket_count);
+uint32_t resources_hash_get_slot(uint64_t hash, uint32_t displacement, uint32_t key_count);
+uint32_t resources_hash_find(const struct resources_hash_table *table, const char *string);
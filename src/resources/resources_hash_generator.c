@@ -0,0 +1,214 @@
+/**
+ * Tool Squisher
+ *
+ * This software is licensed under version 3 of the GNU General Public License
+ * as published by the Free Software Foundation in 2007. It is not licensed
+ * under any other license, even including later or earlier versions of the GPL.
+ */
+
+// Generator for the resource path hash tables in resources_hash_tables.c. It is not part of tool-squisher itself, so
+// the tables are checked in and only regenerated with the resources-hash-tables target when the lists change.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "resources.h"
+#include "resources_hash.h"
+#include "../tag_groups/decal.h"
+
+#define RESOURCES_HASH_KEYS_PER_BUCKET 4
+#define RESOURCES_HASH_MAXIMUM_SEEDS 256
+
+extern struct decal_bitmap_extent decal_stock_bitmap_extent_list[];
+
+struct resources_hash_bucket {
+    uint32_t bucket;
+    uint32_t key_count;
+    uint32_t keys[RESOURCES_HASH_KEYS_PER_BUCKET * 4];
+};
+
+static int resources_hash_bucket_compare(const void *a, const void *b) {
+    const struct resources_hash_bucket *bucket_a = a;
+    const struct resources_hash_bucket *bucket_b = b;
+    if(bucket_a->key_count != bucket_b->key_count) {
+        return bucket_a->key_count < bucket_b->key_count ? 1 : -1;
+    }
+    return bucket_a->bucket < bucket_b->bucket ? -1 : 1;
+}
+
+static bool resources_hash_try_seed(uint32_t seed, const char **keys, uint32_t key_count, uint32_t bucket_count, uint32_t *displacements, uint16_t *indices) {
+    uint64_t *hashes = calloc(key_count, sizeof(uint64_t));
+    struct resources_hash_bucket *buckets = calloc(bucket_count, sizeof(struct resources_hash_bucket));
+    bool *taken = calloc(key_count, sizeof(bool));
+    uint32_t *slots = calloc(key_count, sizeof(uint32_t));
+    if(!hashes || !buckets || !taken || !slots) {
+        abort();
+    }
+
+    bool success = false;
+    for(uint32_t b = 0; b < bucket_count; b++) {
+        buckets[b].bucket = b;
+    }
+
+    for(uint32_t k = 0; k < key_count; k++) {
+        hashes[k] = resources_hash_string(keys[k], seed);
+        struct resources_hash_bucket *bucket = &buckets[resources_hash_get_bucket(hashes[k], bucket_count)];
+        if(bucket->key_count == sizeof(bucket->keys) / sizeof(bucket->keys[0])) {
+            goto cleanup;
+        }
+        bucket->keys[bucket->key_count++] = k;
+    }
+
+    // Place the biggest buckets first while there is still room
+    qsort(buckets, bucket_count, sizeof(struct resources_hash_bucket), resources_hash_bucket_compare);
+    for(uint32_t b = 0; b < bucket_count; b++) {
+        struct resources_hash_bucket *bucket = &buckets[b];
+        if(bucket->key_count == 0) {
+            displacements[bucket->bucket] = 0;
+            continue;
+        }
+
+        bool placed = false;
+        for(uint64_t displacement = 0; displacement < (uint64_t)key_count * key_count && !placed; displacement++) {
+            placed = true;
+            for(uint32_t k = 0; k < bucket->key_count && placed; k++) {
+                slots[k] = resources_hash_get_slot(hashes[bucket->keys[k]], displacement, key_count);
+                placed = !taken[slots[k]];
+                for(uint32_t k2 = 0; k2 < k && placed; k2++) {
+                    placed = slots[k2] != slots[k];
+                }
+            }
+
+            if(placed) {
+                displacements[bucket->bucket] = displacement;
+                for(uint32_t k = 0; k < bucket->key_count; k++) {
+                    taken[slots[k]] = true;
+                    indices[slots[k]] = bucket->keys[k];
+                }
+            }
+        }
+
+        if(!placed) {
+            goto cleanup;
+        }
+    }
+
+    success = true;
+
+    cleanup:
+    free(hashes);
+    free(buckets);
+    free(taken);
+    free(slots);
+    return success;
+}
+
+static bool resources_hash_generate(FILE *output, const char *name, const char **keys, uint32_t key_count) {
+    assert(output && name && keys && key_count > 0 && key_count <= UINT16_MAX);
+
+    uint32_t bucket_count = (key_count + RESOURCES_HASH_KEYS_PER_BUCKET - 1) / RESOURCES_HASH_KEYS_PER_BUCKET;
+    uint32_t *displacements = calloc(bucket_count, sizeof(uint32_t));
+    uint16_t *indices = calloc(key_count, sizeof(uint16_t));
+    if(!displacements || !indices) {
+        abort();
+    }
+
+    bool found = false;
+    uint32_t seed = 0;
+    for(; seed < RESOURCES_HASH_MAXIMUM_SEEDS && !found; seed++) {
+        found = resources_hash_try_seed(seed, keys, key_count, bucket_count, displacements, indices);
+    }
+
+    if(!found) {
+        fprintf(stderr, "could not find a perfect hash for %s (duplicate paths?)\n", name);
+        free(displacements);
+        free(indices);
+        return false;
+    }
+
+    // Make sure every key can be found in its own slot
+    for(uint32_t k = 0; k < key_count; k++) {
+        uint64_t hash = resources_hash_string(keys[k], seed - 1);
+        uint32_t displacement = displacements[resources_hash_get_bucket(hash, bucket_count)];
+        if(indices[resources_hash_get_slot(hash, displacement, key_count)] != k) {
+            fprintf(stderr, "the perfect hash for %s does not find \"%s\"\n", name, keys[k]);
+            free(displacements);
+            free(indices);
+            return false;
+        }
+    }
+
+    fprintf(output, "\nstatic const uint32_t %s_displacements[] = {", name);
+    for(uint32_t b = 0; b < bucket_count; b++) {
+        fprintf(output, "%s%u,", b % 12 == 0 ? "\n    " : " ", displacements[b]);
+    }
+    fprintf(output, "\n};\n\nstatic const uint16_t %s_indices[] = {", name);
+    for(uint32_t k = 0; k < key_count; k++) {
+        fprintf(output, "%s%u,", k % 16 == 0 ? "\n    " : " ", indices[k]);
+    }
+    fprintf(output, "\n};\n\nconst struct resources_hash_table %s = {\n", name);
+    fprintf(output, "    .seed = %u,\n    .key_count = %u,\n    .bucket_count = %u,\n", seed - 1, key_count, bucket_count);
+    fprintf(output, "    .displacements = %s_displacements,\n    .indices = %s_indices\n};\n", name, name);
+
+    free(displacements);
+    free(indices);
+    return true;
+}
+
+int main(int argc, char **argv) {
+    if(argc != 2) {
+        fprintf(stderr, "Usage: %s <output.c>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const char *decal_keys[NUMBER_OF_STOCK_DECAL_BITMAPS];
+    for(size_t i = 0; i < NUMBER_OF_STOCK_DECAL_BITMAPS; i++) {
+        decal_keys[i] = decal_stock_bitmap_extent_list[i].name;
+    }
+
+    // The output is checked in, so it is only replaced once the whole thing was written
+    size_t path_length = strlen(argv[1]);
+    char *temporary_path = malloc(path_length + sizeof(".tmp"));
+    if(!temporary_path) {
+        abort();
+    }
+    memcpy(temporary_path, argv[1], path_length);
+    memcpy(temporary_path + path_length, ".tmp", sizeof(".tmp"));
+
+    FILE *output = fopen(temporary_path, "w");
+    if(!output) {
+        fprintf(stderr, "%s: Failed to open\n", temporary_path);
+        free(temporary_path);
+        return EXIT_FAILURE;
+    }
+
+    fprintf(output, "// Generated by resources_hash_generator.c. Do not edit.\n\n");
+    fprintf(output, "#include <stdint.h>\n\n#include \"resources_hash.h\"\n");
+
+    bool success = resources_hash_generate(output, "resources_bitmaps_map_hash_table", bitmaps_map_resource_list, NUMBER_OF_BITMAPS_MAP_RESOURCES) &&
+        resources_hash_generate(output, "resources_sounds_map_hash_table", sounds_map_resource_list, NUMBER_OF_SOUNDS_MAP_RESOURCES) &&
+        resources_hash_generate(output, "decal_stock_bitmap_extent_hash_table", decal_keys, NUMBER_OF_STOCK_DECAL_BITMAPS);
+
+    if(fclose(output) != 0 || !success) {
+        remove(temporary_path);
+        free(temporary_path);
+        return EXIT_FAILURE;
+    }
+
+#ifdef _WIN32
+    // rename() does not replace an existing file here
+    remove(argv[1]);
+#endif
+    if(rename(temporary_path, argv[1]) != 0) {
+        fprintf(stderr, "%s: Failed to replace with %s\n", argv[1], temporary_path);
+        remove(temporary_path);
+        free(temporary_path);
+        return EXIT_FAILURE;
+    }
+
+    free(temporary_path);
+    return EXIT_SUCCESS;
+}
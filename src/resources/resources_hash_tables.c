@@ -0,0 +1,159 @@
+// Generated by resources_hash_generator.c. Do not edit.
+
+#include <stdint.h>
+
+#include "resources_hash.h"
+
+static const uint32_t resources_bitmaps_map_hash_table_displacements[] = {
+    29, 8, 58, 34, 5, 133, 66, 2, 34, 4, 1, 297,
+    85, 2, 19, 0, 19, 42, 46, 3, 40, 917, 1, 78,
+    48, 1, 4, 39, 413, 105, 5, 10, 864, 14, 3, 19,
+    9, 65, 11, 20, 99, 3, 1, 473, 185, 28, 15, 0,
+    125, 16, 0, 337, 49, 9, 1, 0, 44, 133, 0, 5,
+    6, 0, 351, 16, 0, 181, 254, 34, 92, 0, 0, 0,
+    5, 136, 330, 61, 11, 14, 66, 11, 33, 51, 1, 7,
+    18, 229, 0, 787, 132, 145, 2, 32, 708, 143, 4, 217,
+    6, 9, 13, 4, 73, 118, 16, 10, 272, 621, 60, 398,
+    101, 4, 19, 80, 1, 556, 73, 36, 466, 3, 418, 26,
+    266, 373, 6, 44, 12, 2, 16, 366, 101, 25, 2, 53,
+    9, 1, 5, 57, 16, 119, 372, 8, 21, 180, 8, 3,
+    482, 18, 960, 50, 37, 175, 614, 1, 8, 112, 92, 1,
+    291, 11, 342, 28, 148, 110, 0, 317, 2, 5, 3, 1,
+    710, 1281, 220, 309, 96, 67, 90, 223, 672, 74, 346, 30,
+    716, 200, 199, 761, 40, 1, 102, 0, 2, 1, 1681, 2241,
+    0, 183, 96, 294, 0, 358, 101, 887, 0, 1927, 291, 3795,
+    20, 726, 0, 0, 277, 4, 128, 0, 676, 5,
+};
+
+static const uint16_t resources_bitmaps_map_hash_table_indices[] = {
+    752, 572, 11, 184, 462, 838, 678, 637, 292, 754, 306, 310, 561, 364, 501, 309,
+    106, 513, 262, 734, 679, 16, 508, 38, 185, 117, 616, 377, 182, 469, 397, 295,
+    340, 431, 722, 301, 136, 772, 589, 587, 291, 19, 433, 225, 830, 447, 515, 40,
+    646, 124, 161, 531, 683, 676, 210, 315, 120, 175, 151, 336, 354, 80, 432, 821,
+    25, 239, 129, 836, 78, 843, 355, 444, 405, 748, 540, 833, 420, 549, 842, 663,
+    347, 441, 559, 72, 808, 246, 325, 137, 77, 499, 775, 826, 338, 81, 698, 556,
+    22, 276, 215, 563, 588, 52, 573, 35, 390, 782, 648, 634, 417, 785, 332, 54,
+    485, 180, 718, 209, 598, 428, 649, 837, 604, 539, 133, 666, 631, 196, 147, 329,
+    851, 29, 87, 252, 26, 735, 768, 450, 789, 443, 350, 576, 439, 275, 50, 597,
+    387, 47, 495, 733, 496, 596, 527, 614, 326, 98, 171, 333, 109, 208, 760, 179,
+    160, 730, 480, 233, 122, 510, 455, 738, 773, 771, 42, 711, 625, 126, 76, 592,
+    84, 466, 799, 264, 45, 543, 158, 322, 8, 328, 560, 806, 577, 204, 189, 101,
+    205, 349, 57, 685, 555, 319, 360, 283, 610, 46, 263, 699, 402, 797, 65, 716,
+    664, 198, 695, 247, 399, 818, 382, 219, 436, 254, 488, 852, 33, 128, 694, 758,
+    502, 518, 627, 181, 670, 534, 571, 613, 800, 386, 381, 846, 67, 228, 446, 366,
+    591, 418, 659, 825, 305, 85, 370, 331, 795, 378, 335, 525, 807, 220, 824, 369,
+    434, 2, 211, 697, 802, 644, 15, 75, 638, 200, 713, 602, 493, 458, 623, 791,
+    298, 346, 7, 727, 751, 618, 300, 628, 114, 21, 4, 599, 778, 486, 693, 504,
+    27, 99, 102, 408, 617, 654, 593, 92, 524, 847, 575, 248, 261, 437, 811, 603,
+    484, 9, 522, 145, 23, 686, 194, 696, 651, 414, 36, 191, 471, 140, 144, 407,
+    172, 285, 311, 223, 193, 470, 71, 62, 564, 294, 605, 674, 365, 398, 115, 464,
+    18, 538, 121, 316, 173, 138, 580, 611, 105, 125, 689, 238, 814, 669, 786, 542,
+    744, 725, 229, 731, 372, 385, 61, 384, 362, 736, 822, 111, 127, 70, 463, 153,
+    150, 388, 318, 412, 269, 10, 815, 482, 467, 216, 774, 622, 511, 761, 632, 657,
+    237, 812, 415, 368, 684, 714, 507, 798, 374, 421, 375, 206, 419, 701, 266, 217,
+    558, 118, 404, 28, 226, 483, 214, 166, 330, 776, 31, 665, 747, 230, 162, 835,
+    187, 304, 413, 302, 612, 621, 687, 475, 290, 468, 438, 344, 595, 293, 91, 497,
+    188, 373, 271, 323, 429, 460, 841, 195, 299, 476, 51, 494, 586, 671, 135, 37,
+    123, 828, 492, 487, 201, 850, 243, 829, 550, 781, 170, 784, 401, 823, 750, 743,
+    557, 582, 721, 154, 516, 143, 274, 448, 82, 6, 34, 97, 545, 704, 395, 169,
+    514, 0, 723, 753, 570, 312, 1, 672, 537, 231, 190, 119, 762, 705, 633, 409,
+    473, 491, 528, 650, 257, 656, 630, 352, 606, 827, 234, 146, 532, 530, 578, 63,
+    535, 95, 235, 442, 282, 317, 652, 554, 139, 423, 268, 700, 668, 766, 400, 770,
+    343, 642, 303, 383, 681, 74, 251, 152, 297, 100, 620, 68, 703, 461, 411, 64,
+    719, 590, 58, 579, 520, 746, 635, 523, 763, 788, 810, 279, 241, 321, 60, 253,
+    805, 440, 132, 288, 245, 793, 607, 258, 804, 227, 178, 844, 94, 655, 849, 277,
+    478, 453, 660, 392, 481, 574, 224, 337, 174, 272, 376, 141, 745, 339, 357, 280,
+    351, 801, 809, 667, 424, 14, 526, 113, 465, 780, 267, 636, 848, 110, 403, 845,
+    359, 517, 59, 662, 265, 728, 724, 477, 500, 565, 445, 104, 435, 278, 242, 729,
+    779, 608, 287, 197, 44, 30, 281, 66, 199, 690, 764, 449, 345, 55, 709, 130,
+    107, 831, 5, 726, 108, 803, 93, 353, 708, 756, 327, 361, 737, 717, 89, 546,
+    203, 165, 720, 186, 454, 286, 389, 49, 380, 396, 17, 816, 103, 155, 142, 134,
+    348, 658, 505, 609, 183, 296, 755, 307, 406, 765, 452, 356, 544, 308, 250, 474,
+    832, 240, 692, 207, 682, 777, 498, 509, 601, 629, 552, 367, 619, 425, 236, 289,
+    472, 320, 536, 167, 673, 742, 249, 653, 567, 256, 90, 834, 732, 794, 341, 506,
+    56, 379, 459, 769, 691, 796, 624, 569, 521, 615, 273, 88, 393, 647, 12, 430,
+    202, 79, 675, 817, 819, 767, 600, 547, 324, 43, 73, 715, 342, 749, 626, 41,
+    489, 363, 96, 48, 426, 259, 661, 783, 581, 639, 260, 148, 255, 529, 416, 244,
+    20, 645, 284, 490, 24, 585, 741, 159, 840, 313, 270, 177, 192, 688, 707, 213,
+    422, 149, 553, 820, 394, 427, 680, 594, 710, 702, 583, 512, 519, 39, 131, 839,
+    533, 112, 643, 176, 568, 358, 83, 218, 641, 457, 451, 739, 677, 69, 221, 116,
+    32, 3, 759, 562, 86, 232, 168, 391, 163, 164, 813, 212, 156, 157, 792, 479,
+    371, 410, 13, 584, 790, 53, 222, 548, 640, 712, 541, 314, 566, 757, 503, 551,
+    334, 456, 787, 740, 706,
+};
+
+const struct resources_hash_table resources_bitmaps_map_hash_table = {
+    .seed = 0,
+    .key_count = 853,
+    .bucket_count = 214,
+    .displacements = resources_bitmaps_map_hash_table_displacements,
+    .indices = resources_bitmaps_map_hash_table_indices
+};
+
+static const uint32_t resources_sounds_map_hash_table_displacements[] = {
+    0, 1, 30, 55, 106, 23, 58, 0, 20, 22, 247, 8,
+    15, 1, 105, 15, 38, 0, 0, 51, 39, 68, 0, 0,
+    754, 0, 143, 19, 169, 94, 48, 8, 81, 4, 93, 4,
+    7, 21, 26, 211, 87, 38, 35, 7, 93, 75, 24, 371,
+    16, 35, 178, 0, 276, 9, 28, 27, 381, 0, 3, 205,
+    115, 78, 696, 417, 889, 159, 238, 42, 0, 9, 36, 894,
+    199, 31, 8, 69, 153, 8, 957, 1, 9, 1, 13, 5,
+    301, 88, 181, 0, 127, 651, 180, 13170, 9, 530,
+};
+
+static const uint16_t resources_sounds_map_hash_table_indices[] = {
+    53, 243, 277, 207, 248, 26, 163, 290, 134, 175, 337, 319, 8, 69, 93, 181,
+    136, 375, 10, 281, 296, 105, 204, 29, 73, 310, 43, 231, 348, 87, 14, 200,
+    46, 17, 45, 20, 208, 123, 182, 160, 261, 293, 151, 213, 40, 316, 347, 82,
+    0, 255, 302, 145, 318, 201, 61, 155, 325, 210, 327, 353, 177, 137, 83, 77,
+    49, 4, 37, 104, 86, 188, 331, 133, 51, 128, 199, 306, 113, 223, 279, 268,
+    209, 191, 193, 322, 176, 217, 167, 44, 274, 370, 244, 32, 112, 28, 172, 159,
+    119, 91, 303, 343, 121, 89, 174, 225, 183, 363, 335, 185, 352, 373, 57, 227,
+    202, 50, 292, 205, 168, 224, 229, 170, 287, 349, 309, 301, 329, 79, 365, 156,
+    283, 30, 334, 80, 211, 15, 95, 171, 139, 330, 328, 149, 27, 262, 127, 125,
+    232, 366, 265, 16, 250, 56, 122, 36, 162, 120, 246, 184, 206, 364, 251, 220,
+    62, 19, 253, 266, 85, 275, 238, 344, 34, 256, 38, 41, 312, 65, 355, 192,
+    333, 362, 66, 354, 35, 187, 18, 226, 196, 7, 131, 164, 239, 130, 340, 332,
+    173, 260, 374, 58, 39, 23, 12, 369, 214, 242, 54, 228, 6, 31, 98, 11,
+    169, 147, 143, 264, 13, 299, 345, 307, 78, 68, 361, 230, 254, 284, 74, 101,
+    341, 64, 252, 315, 99, 148, 9, 76, 245, 222, 72, 116, 195, 102, 24, 115,
+    178, 294, 271, 129, 166, 114, 126, 215, 359, 108, 97, 142, 272, 314, 42, 3,
+    249, 161, 157, 33, 263, 270, 351, 326, 71, 356, 288, 236, 111, 5, 154, 219,
+    324, 55, 158, 357, 278, 289, 25, 360, 96, 233, 317, 190, 276, 152, 247, 153,
+    297, 321, 291, 197, 311, 258, 132, 282, 320, 138, 257, 350, 47, 305, 124, 241,
+    240, 295, 118, 339, 146, 180, 52, 135, 94, 267, 103, 186, 59, 269, 285, 107,
+    165, 216, 237, 21, 308, 81, 1, 140, 60, 300, 203, 92, 75, 110, 212, 117,
+    63, 367, 304, 22, 90, 150, 368, 67, 189, 70, 141, 84, 221, 194, 273, 286,
+    100, 144, 280, 336, 198, 346, 372, 179, 338, 218, 109, 313, 2, 358, 298, 48,
+    259, 88, 235, 371, 342, 106, 323, 234,
+};
+
+const struct resources_hash_table resources_sounds_map_hash_table = {
+    .seed = 0,
+    .key_count = 376,
+    .bucket_count = 94,
+    .displacements = resources_sounds_map_hash_table_displacements,
+    .indices = resources_sounds_map_hash_table_indices
+};
+
+static const uint32_t decal_stock_bitmap_extent_hash_table_displacements[] = {
+    170, 0, 5, 751, 1118, 10, 36, 9, 9, 2063, 24, 716,
+    1, 31, 0, 38, 16, 12, 11, 383, 277, 4,
+};
+
+static const uint16_t decal_stock_bitmap_extent_hash_table_indices[] = {
+    30, 43, 4, 48, 52, 41, 40, 22, 44, 83, 80, 34, 71, 0, 29, 81,
+    11, 79, 60, 20, 62, 23, 26, 77, 75, 42, 10, 78, 84, 45, 16, 50,
+    9, 49, 47, 1, 5, 63, 35, 68, 17, 32, 53, 8, 67, 6, 14, 2,
+    73, 59, 27, 46, 12, 31, 74, 76, 15, 13, 28, 7, 25, 33, 37, 65,
+    19, 24, 70, 55, 56, 69, 36, 54, 61, 18, 39, 38, 72, 57, 58, 51,
+    82, 64, 66, 21, 3,
+};
+
+const struct resources_hash_table decal_stock_bitmap_extent_hash_table = {
+    .seed = 0,
+    .key_count = 85,
+    .bucket_count = 22,
+    .displacements = decal_stock_bitmap_extent_hash_table_displacements,
+    .indices = decal_stock_bitmap_extent_hash_table_indices
+};
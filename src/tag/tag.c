@@ -7,6 +7,8 @@
 
 #include "../data_types.h"
 #include "tag_fourcc.h"
+#include "tag_fix_plan.h"
+#include "../thread/thread_output.h"
 
 static const char *TAG_INVALID_PATH = "<invalid>";
 
@@ -55,8 +57,8 @@ void *tag_reflexive_get_element(struct tag_reflexive *reflexive, uint32_t index,
     return tag_resolve_pointer(reflexive->address + index * element_size, element_size, tag_data);
 }
 
-bool tag_reflexive_erase_element_data(struct tag_reflexive *reflexive, size_t element_size, struct tag_data_instance *tag_data) {
-    assert(reflexive && tag_data && tag_data->valid);
+bool tag_reflexive_erase_element_data(struct tag_reflexive *reflexive, size_t element_size, struct tag_data_instance *tag_data, struct tag_fix_plan *plan) {
+    assert(reflexive && tag_data && tag_data->valid && plan);
 
     // Halo checks/nulls the pointer, not the count
     if(reflexive->address == 0) {
@@ -69,9 +71,9 @@ bool tag_reflexive_erase_element_data(struct tag_reflexive *reflexive, size_t el
         return false;
     }
 
-    memset(data, 0, data_size);
+    tag_fix_plan_zero(plan, data, data_size, "stale reflexive data");
     //reflexive->count = 0;
-    reflexive->address = 0;
+    TAG_FIX_PLAN_SET(plan, reflexive->address, 0, "stale reflexive data");
     return true;
 }
 
@@ -83,17 +85,17 @@ void *tag_get(TagID tag_id, uint32_t tag_group, struct tag_data_instance *tag_da
 
     auto tag_count = tag_data->header->tag_count;
     if(tag_id.index >= tag_count) {
-        fprintf(stderr, "requested tag ID %#x is out of bounds for the number of tags in the map (%u >= %u)\n", tag_id.whole_id, tag_id.index, tag_count);
+        thread_output_error("requested tag ID %#x is out of bounds for the number of tags in the map (%u >= %u)\n", tag_id.whole_id, tag_id.index, tag_count);
         return nullptr;
     }
 
     // The base struct for sound tags is always in the map
     if(tag_data->tags[tag_id.index].external && tag_group != TAG_FOURCC_SOUND) {
-        fprintf(stderr, "requested tag ID %#x is external and not loaded in the map\n", tag_id.whole_id);
+        thread_output_error("requested tag ID %#x is external and not loaded in the map\n", tag_id.whole_id);
         return nullptr;
     }
     if(tag_data->tags[tag_id.index].tag_id.whole_id != tag_id.whole_id) {
-        fprintf(stderr, "requested tag ID %#x did not match tag array ID %#x\n", tag_id.whole_id, tag_data->tags[tag_id.index].tag_id.whole_id);
+        thread_output_error("requested tag ID %#x did not match tag array ID %#x\n", tag_id.whole_id, tag_data->tags[tag_id.index].tag_id.whole_id);
         return nullptr;
     }
 
@@ -106,7 +108,7 @@ void *tag_get(TagID tag_id, uint32_t tag_group, struct tag_data_instance *tag_da
         return tag_resolve_pointer(tag_data->tags[tag_id.index].base_address, needed_size, tag_data);
     }
 
-    fprintf(stderr, "requested tag group \"%s\" is not a valid match for tag array group \"%s\"\n", tag_fourcc_to_extension(tag_group), tag_fourcc_to_extension(primary_group));
+    thread_output_error("requested tag group \"%s\" is not a valid match for tag array group \"%s\"\n", tag_fourcc_to_extension(tag_group), tag_fourcc_to_extension(primary_group));
     return nullptr;
 }
 
@@ -118,11 +120,17 @@ const char *tag_path_get_maybe(TagID tag, struct tag_data_instance *tag_data) {
 
     auto tag_count = tag_data->header->tag_count;
     if(tag.index >= tag_count) {
-        fprintf(stderr, "requested tag ID %#x is out of bounds for the number of tags in the map (%u >= %u)\n", tag.whole_id, tag.index, tag_count);
+        thread_output_error("requested tag ID %#x is out of bounds for the number of tags in the map (%u >= %u)\n", tag.whole_id, tag.index, tag_count);
         return nullptr;
     }
 
-    const char *tag_path = tag_resolve_pointer(tag_data->tags[tag.index].name_address, 1, tag_data);
+    return tag_path_resolve(tag_data->tags[tag.index].name_address, tag_data);
+}
+
+// nullptr if the path is not terminated within MAX_TAG_PATH_LENGTH bytes in the tag data
+const char *tag_path_resolve(Pointer32 name, struct tag_data_instance *tag_data) {
+    assert(tag_data && tag_data->valid);
+    const char *tag_path = tag_resolve_pointer(name, 1, tag_data);
     if(!tag_path) {
         return nullptr;
     }
@@ -160,7 +168,7 @@ const char *tag_extension_get(TagID tag, struct tag_data_instance *tag_data) {
 
     auto tag_count = tag_data->header->tag_count;
     if(tag.index >= tag_count) {
-        fprintf(stderr, "requested tag ID %#x is out of bounds for the number of tags in the map (%u >= %u)\n", tag.whole_id, tag.index, tag_count);
+        thread_output_error("requested tag ID %#x is out of bounds for the number of tags in the map (%u >= %u)\n", tag.whole_id, tag.index, tag_count);
         return TAG_INVALID_PATH;
     }
 
@@ -4,6 +4,7 @@
 #include "../data_types.h"
 
 #define TAG_DATA_LOAD_ADDRESS 0x40440000
+#define TAG_DATA_LOAD_ADDRESS_XBOX 0x803A6000
 #define MAX_TAG_PATH_LENGTH 260
 
 enum {
@@ -27,6 +28,20 @@ struct tag_data_header {
 };
 static_assert(sizeof(struct tag_data_header) == 40);
 
+// Xbox maps keep their model data in the tag data, so this has pointers where the PC one has file offsets and sizes
+struct tag_data_header_xbox {
+	Pointer32 tag_instances;
+	TagID scenario_tag;
+	uint32_t tag_data_checksum;
+	uint32_t tag_count;
+	uint32_t vertex_buffer_count;
+	Pointer32 vertex_buffers;
+	uint32_t index_buffer_count;
+	Pointer32 index_buffers;
+	uint32_t signature;
+};
+static_assert(sizeof(struct tag_data_header_xbox) == 36);
+
 struct tag_instance {
     uint32_t primary_group;
     uint32_t secondary_group;
@@ -65,14 +80,22 @@ static_assert(sizeof(struct tag_reference) == 16);
 
 #pragma pack(pop)
 
+struct tag_fix_plan;
+struct decal_extent_cache;
+struct resource_index;
+
 struct tag_data_instance {
     union {
         uint8_t *data;
         struct tag_data_header *header;
+        struct tag_data_header_xbox *header_xbox;
     };
     size_t size;
+    size_t header_size; // The Xbox header is shorter
     struct tag_instance *tags;
     Pointer32 data_load_address;
+    struct decal_extent_cache *decal_extent_cache; // Optional, set while fixing tags
+    const struct resource_index *resource_index; // Optional, the resource maps in use if they were loaded
     bool indexed_external_tags;
     bool valid;
 };
@@ -81,9 +104,10 @@ bool tag_id_is_valid_tag(TagID tag, struct tag_data_instance *tag_data);
 bool tag_is_external(TagID tag, struct tag_data_instance *tag_data);
 void *tag_resolve_pointer(Pointer32 data_pointer, size_t needed_size, struct tag_data_instance *tag_data);
 void *tag_reflexive_get_element(struct tag_reflexive *reflexive, uint32_t index, size_t element_size, struct tag_data_instance *tag_data);
-bool tag_reflexive_erase_element_data(struct tag_reflexive *reflexive, size_t element_size, struct tag_data_instance *tag_data);
+bool tag_reflexive_erase_element_data(struct tag_reflexive *reflexive, size_t element_size, struct tag_data_instance *tag_data, struct tag_fix_plan *plan);
 void *tag_get(TagID tag_id, uint32_t tag_group, struct tag_data_instance *tag_data);
 const char *tag_path_get_maybe(TagID tag, struct tag_data_instance *tag_data);
 const char *tag_path_get(TagID tag, struct tag_data_instance *tag_data);
+const char *tag_path_resolve(Pointer32 name, struct tag_data_instance *tag_data);
 const char *tag_extension_get(TagID tag, struct tag_data_instance *tag_data);
 void tag_null_reference(struct tag_reference *reference, uint32_t tag_group);
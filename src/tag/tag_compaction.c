@@ -0,0 +1,427 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "tag_compaction.h"
+
+#include "../data_types.h"
+#include "../cache/cache.h"
+#include "tag.h"
+#include "tag_fix_plan.h"
+#include "tag_schema.h"
+
+#define TAG_COMPACTION_ALIGNMENT 4
+
+// A known block after fixing and the pointer to it
+struct tag_compaction_block {
+    uint32_t start;
+    uint32_t end;
+    Pointer32 *site;
+    TagID tag;
+    bool movable;
+};
+
+// A range of tag data that is in use, either known blocks (shared blocks are one item) or something the schema can
+// not see
+struct tag_compaction_item {
+    uint32_t start;
+    uint32_t end;
+    size_t first_block;
+    size_t block_count;
+    bool movable;
+};
+
+struct tag_compaction_move {
+    uint32_t start;
+    uint32_t end;
+    uint32_t new_start;
+    size_t item;
+};
+
+struct tag_compaction_walk {
+    struct tag_data_instance *tag_data;
+    struct tag_compaction *compaction;
+    struct tag_compaction_block *blocks;
+    size_t block_count;
+    size_t block_capacity;
+    struct tag_compaction_range *paths; // Tag paths are not blocks, but are known and can be freed too
+    size_t path_count;
+    size_t path_capacity;
+};
+
+static void *tag_compaction_grow(void *buffer, size_t *capacity, size_t needed, size_t element_size) {
+    if(needed <= *capacity) {
+        return buffer;
+    }
+
+    size_t new_capacity = MAX(*capacity * 2, MAX(needed, 1024));
+    buffer = realloc(buffer, new_capacity * element_size);
+    if(!buffer) {
+        abort();
+    }
+
+    *capacity = new_capacity;
+    return buffer;
+}
+
+static void tag_compaction_add_range(struct tag_compaction_range **ranges, size_t *count, size_t *capacity, uint32_t start, uint32_t end) {
+    *ranges = tag_compaction_grow(*ranges, capacity, *count + 1, sizeof(struct tag_compaction_range));
+    (*ranges)[(*count)++] = (struct tag_compaction_range){ start, end };
+}
+
+static bool tag_compaction_block_is_tag_data(const struct tag_schema_block *block, struct tag_data_instance *tag_data) {
+    return block->space->data == tag_data->data && block->data && block->size > 0;
+}
+
+static void tag_compaction_visit_block_before(const struct tag_schema_block *block, void *context) {
+    struct tag_compaction_walk *walk = context;
+    if(!tag_compaction_block_is_tag_data(block, walk->tag_data)) {
+        return;
+    }
+
+    struct tag_compaction *compaction = walk->compaction;
+    uint32_t start = block->data - walk->tag_data->data;
+    tag_compaction_add_range(&compaction->ranges, &compaction->range_count, &compaction->range_capacity, start, start + block->size);
+}
+
+static void tag_compaction_visit_block_after(const struct tag_schema_block *block, void *context) {
+    struct tag_compaction_walk *walk = context;
+    if(!tag_compaction_block_is_tag_data(block, walk->tag_data)) {
+        return;
+    }
+
+    Pointer32 *site;
+    switch(block->type) {
+        case TAG_SCHEMA_BLOCK_TYPE_BASE_STRUCT:
+            site = &walk->tag_data->tags[block->tag.index].base_address;
+            break;
+        case TAG_SCHEMA_BLOCK_TYPE_REFLEXIVE:
+            site = &((struct tag_reflexive *)block->pointer)->address;
+            break;
+        case TAG_SCHEMA_BLOCK_TYPE_DATA:
+            site = &((struct tag_data *)block->pointer)->address;
+            break;
+        default:
+            return;
+    }
+
+    walk->blocks = tag_compaction_grow(walk->blocks, &walk->block_capacity, walk->block_count + 1, sizeof(struct tag_compaction_block));
+    uint32_t start = block->data - walk->tag_data->data;
+    walk->blocks[walk->block_count++] = (struct tag_compaction_block){
+        .start = start,
+        .end = start + block->size,
+        .site = site,
+        .tag = block->tag,
+        .movable = tag_schema_block_is_known(block) // Anything unknown it points to would be left behind
+    };
+}
+
+static void tag_compaction_add_path(struct tag_compaction_walk *walk, Pointer32 name) {
+    const char *path = tag_path_resolve(name, walk->tag_data);
+    if(path) {
+        uint32_t start = (const uint8_t *)path - walk->tag_data->data;
+        tag_compaction_add_range(&walk->paths, &walk->path_count, &walk->path_capacity, start, start + strlen(path) + 1);
+    }
+}
+
+static void tag_compaction_visit_field(const struct tag_schema_block *block, const struct tag_schema_field *field, void *value, void *context) {
+    (void)block;
+    struct tag_compaction_walk *walk = context;
+    if(field->type == TAG_SCHEMA_FIELD_TYPE_REFERENCE && ((struct tag_reference *)value)->name != 0) {
+        tag_compaction_add_path(walk, ((struct tag_reference *)value)->name);
+    }
+}
+
+static int tag_compaction_compare_ranges(const void *a, const void *b) {
+    const struct tag_compaction_range *range_a = a;
+    const struct tag_compaction_range *range_b = b;
+    if(range_a->start != range_b->start) {
+        return range_a->start > range_b->start ? 1 : -1;
+    }
+    return (range_a->end > range_b->end) - (range_a->end < range_b->end);
+}
+
+static int tag_compaction_compare_blocks(const void *a, const void *b) {
+    const struct tag_compaction_block *block_a = a;
+    const struct tag_compaction_block *block_b = b;
+    if(block_a->start != block_b->start) {
+        return block_a->start > block_b->start ? 1 : -1;
+    }
+    return (block_a->end > block_b->end) - (block_a->end < block_b->end);
+}
+
+// Sorts and merges ranges that touch or overlap
+static void tag_compaction_merge_ranges(struct tag_compaction_range *ranges, size_t *count) {
+    if(*count == 0) {
+        return;
+    }
+
+    qsort(ranges, *count, sizeof(struct tag_compaction_range), tag_compaction_compare_ranges);
+    size_t merged = 0;
+    for(size_t r = 1; r < *count; r++) {
+        if(ranges[r].start <= ranges[merged].end) {
+            ranges[merged].end = MAX(ranges[merged].end, ranges[r].end);
+        }
+        else {
+            ranges[++merged] = ranges[r];
+        }
+    }
+    *count = merged + 1;
+}
+
+static void tag_compaction_walk_paths(struct tag_compaction_walk *walk) {
+    for(size_t t = 0; t < walk->tag_data->header->tag_count; t++) {
+        tag_compaction_add_path(walk, walk->tag_data->tags[t].name_address);
+    }
+    tag_compaction_merge_ranges(walk->paths, &walk->path_count);
+}
+
+void tag_compaction_begin(struct tag_compaction *compaction, struct cache_file_instance *cache_file) {
+    assert(compaction && cache_file && cache_file->valid);
+    memset(compaction, 0, sizeof(struct tag_compaction));
+
+    struct tag_compaction_walk walk = {
+        .tag_data = &cache_file->tag_data,
+        .compaction = compaction
+    };
+    struct tag_schema_visitor visitor = {
+        .block = tag_compaction_visit_block_before,
+        .field = tag_compaction_visit_field,
+        .context = &walk
+    };
+    tag_schema_walk(&visitor, cache_file);
+    tag_compaction_walk_paths(&walk);
+    for(size_t p = 0; p < walk.path_count; p++) {
+        tag_compaction_add_range(&compaction->ranges, &compaction->range_count, &compaction->range_capacity, walk.paths[p].start, walk.paths[p].end);
+    }
+    free(walk.paths);
+    tag_compaction_merge_ranges(compaction->ranges, &compaction->range_count);
+}
+
+// Index of the move that covers offset, or move_count if it is not being moved
+static size_t tag_compaction_find_move(const struct tag_compaction_move *moves, size_t move_count, uint32_t offset) {
+    size_t low = 0;
+    size_t high = move_count;
+    while(low < high) {
+        size_t middle = low + (high - low) / 2;
+        if(moves[middle].start <= offset) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+
+    if(low > 0 && offset < moves[low - 1].end) {
+        return low - 1;
+    }
+    return move_count;
+}
+
+size_t tag_compaction_plan(struct tag_compaction *compaction, struct cache_file_instance *cache_file, struct tag_fix_plan *plan) {
+    assert(compaction && cache_file && cache_file->valid && plan && plan->base == cache_file->data);
+    struct tag_data_instance *tag_data = &cache_file->tag_data;
+
+    struct tag_compaction_walk walk = {
+        .tag_data = tag_data
+    };
+    struct tag_schema_visitor visitor = {
+        .block = tag_compaction_visit_block_after,
+        .field = tag_compaction_visit_field,
+        .context = &walk
+    };
+    tag_schema_walk(&visitor, cache_file);
+    tag_compaction_walk_paths(&walk);
+
+    // Blocks that partly overlap are not something tool makes, so leave them alone. Blocks that match exactly are shared.
+    struct tag_compaction_block *blocks = walk.blocks;
+    size_t block_count = walk.block_count;
+    if(block_count > 0) {
+        qsort(blocks, block_count, sizeof(struct tag_compaction_block), tag_compaction_compare_blocks);
+    }
+    uint32_t furthest_end = 0;
+    size_t furthest_block = 0;
+    for(size_t b = 0; b < block_count; b++) {
+        bool same = b > 0 && blocks[b].start == blocks[b - 1].start && blocks[b].end == blocks[b - 1].end;
+        if(b > 0 && !same && blocks[b].start < furthest_end) {
+            blocks[b].movable = false;
+            blocks[furthest_block].movable = false;
+        }
+        if(blocks[b].end > furthest_end) {
+            furthest_end = blocks[b].end;
+            furthest_block = b;
+        }
+    }
+
+    // Freed space is what was known before fixing but is not used now
+    struct tag_compaction_range *used = nullptr;
+    size_t used_count = 0;
+    size_t used_capacity = 0;
+    for(size_t b = 0; b < block_count; b++) {
+        tag_compaction_add_range(&used, &used_count, &used_capacity, blocks[b].start, blocks[b].end);
+    }
+    for(size_t p = 0; p < walk.path_count; p++) {
+        tag_compaction_add_range(&used, &used_count, &used_capacity, walk.paths[p].start, walk.paths[p].end);
+    }
+    tag_compaction_merge_ranges(used, &used_count);
+
+    struct tag_compaction_range *holes = nullptr;
+    size_t hole_count = 0;
+    size_t hole_capacity = 0;
+    for(size_t r = 0, u = 0; r < compaction->range_count; r++) {
+        uint32_t start = compaction->ranges[r].start;
+        uint32_t end = compaction->ranges[r].end;
+        while(start < end) {
+            while(u < used_count && used[u].end <= start) {
+                u++;
+            }
+            if(u == used_count || used[u].start >= end) {
+                tag_compaction_add_range(&holes, &hole_count, &hole_capacity, start, end);
+                break;
+            }
+            if(used[u].start > start) {
+                tag_compaction_add_range(&holes, &hole_count, &hole_capacity, start, used[u].start);
+            }
+            start = used[u].end;
+        }
+    }
+
+    // Everything else is in use by something the schema can not see
+    struct tag_compaction_range *known = nullptr;
+    size_t known_count = 0;
+    size_t known_capacity = 0;
+    for(size_t u = 0; u < used_count; u++) {
+        tag_compaction_add_range(&known, &known_count, &known_capacity, used[u].start, used[u].end);
+    }
+    for(size_t h = 0; h < hole_count; h++) {
+        tag_compaction_add_range(&known, &known_count, &known_capacity, holes[h].start, holes[h].end);
+    }
+    tag_compaction_merge_ranges(known, &known_count);
+
+    struct tag_compaction_item *items = calloc(block_count + known_count + walk.path_count + 1, sizeof(struct tag_compaction_item));
+    if(!items) {
+        abort();
+    }
+    size_t item_count = 0;
+    uint32_t unknown_start = 0;
+    for(size_t k = 0; k <= known_count; k++) {
+        uint32_t unknown_end = k < known_count ? known[k].start : tag_data->size;
+        if(unknown_start < unknown_end) {
+            items[item_count++] = (struct tag_compaction_item){ .start = unknown_start, .end = unknown_end };
+        }
+        if(k < known_count) {
+            unknown_start = known[k].end;
+        }
+    }
+    for(size_t b = 0; b < block_count;) {
+        struct tag_compaction_item *item = &items[item_count++];
+        *item = (struct tag_compaction_item){ blocks[b].start, blocks[b].end, b, 0, true };
+        while(b < block_count && blocks[b].start == item->start && blocks[b].end == item->end) {
+            item->movable = item->movable && blocks[b].movable;
+            item->block_count++;
+            b++;
+        }
+    }
+
+    // Paths are never moved, since the schema can not see everything pointing to them
+    for(size_t p = 0; p < walk.path_count; p++) {
+        items[item_count++] = (struct tag_compaction_item){ .start = walk.paths[p].start, .end = walk.paths[p].end };
+    }
+    qsort(items, item_count, sizeof(struct tag_compaction_item), tag_compaction_compare_ranges);
+
+    // Move blocks from the end into the lowest hole they fit in until something is in the way
+    struct tag_compaction_move *moves = calloc(item_count + 1, sizeof(struct tag_compaction_move));
+    if(!moves) {
+        abort();
+    }
+    size_t move_count = 0;
+    size_t remaining = item_count;
+    while(remaining > 0 && items[remaining - 1].movable) {
+        struct tag_compaction_item *item = &items[remaining - 1];
+        uint32_t size = item->end - item->start;
+        bool moved = false;
+        for(size_t h = 0; h < hole_count && holes[h].end <= item->start; h++) {
+            uint32_t new_start = (holes[h].start + TAG_COMPACTION_ALIGNMENT - 1) & ~(uint32_t)(TAG_COMPACTION_ALIGNMENT - 1);
+            if(new_start < holes[h].end && holes[h].end - new_start >= size) {
+                moves[move_count++] = (struct tag_compaction_move){ item->start, item->end, new_start, remaining - 1 };
+                holes[h].start = new_start + size;
+                moved = true;
+                break;
+            }
+        }
+        if(!moved) {
+            break;
+        }
+        remaining--;
+    }
+
+    // A block can be moved into a hole that is past everything left behind
+    size_t new_size = tag_data->header_size;
+    for(size_t i = 0; i < remaining; i++) {
+        new_size = MAX(new_size, items[i].end);
+    }
+    for(size_t m = 0; m < move_count; m++) {
+        new_size = MAX(new_size, moves[m].new_start + (moves[m].end - moves[m].start));
+    }
+    new_size = MIN((new_size + TAG_COMPACTION_ALIGNMENT - 1) & ~(size_t)(TAG_COMPACTION_ALIGNMENT - 1), tag_data->size);
+
+    // Moves were found from the end backwards
+    for(size_t m = 0; m < move_count / 2; m++) {
+        struct tag_compaction_move swap = moves[m];
+        moves[m] = moves[move_count - 1 - m];
+        moves[move_count - 1 - m] = swap;
+    }
+
+    // Pointers in moved blocks are fixed in the copy, so each block is one write
+    uint8_t **copies = calloc(move_count + 1, sizeof(uint8_t *));
+    if(!copies) {
+        abort();
+    }
+    for(size_t m = 0; m < move_count; m++) {
+        copies[m] = malloc(moves[m].end - moves[m].start);
+        if(!copies[m]) {
+            abort();
+        }
+        memcpy(copies[m], tag_data->data + moves[m].start, moves[m].end - moves[m].start);
+    }
+
+    TagID plan_tag = plan->tag;
+    for(size_t m = 0; m < move_count; m++) {
+        const struct tag_compaction_item *item = &items[moves[m].item];
+        Pointer32 new_address = tag_data->data_load_address + moves[m].new_start;
+        for(size_t b = item->first_block; b < item->first_block + item->block_count; b++) {
+            uint32_t site_offset = (uint8_t *)blocks[b].site - tag_data->data;
+            size_t site_move = tag_compaction_find_move(moves, move_count, site_offset);
+            if(site_move < move_count) {
+                memcpy(copies[site_move] + (site_offset - moves[site_move].start), &new_address, sizeof(Pointer32));
+                continue;
+            }
+            plan->tag = blocks[b].tag;
+            TAG_FIX_PLAN_SET(plan, *blocks[b].site, new_address, "block was moved into freed tag data");
+        }
+    }
+    for(size_t m = 0; m < move_count; m++) {
+        plan->tag = blocks[items[moves[m].item].first_block].tag;
+        tag_fix_plan_write(plan, tag_data->data + moves[m].new_start, copies[m], moves[m].end - moves[m].start, "block was moved into freed tag data");
+        free(copies[m]);
+    }
+    plan->tag = plan_tag;
+
+    free(copies);
+    free(moves);
+    free(items);
+    free(known);
+    free(holes);
+    free(used);
+    free(blocks);
+    free(walk.paths);
+    return new_size;
+}
+
+void tag_compaction_free(struct tag_compaction *compaction) {
+    assert(compaction);
+    free(compaction->ranges);
+    memset(compaction, 0, sizeof(struct tag_compaction));
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "../cache/cache.h"
+#include "tag_fix_plan.h"
+
+// Tag data compaction moves known blocks from the end of the tag data into space that fixes freed up, such as the
+// blocks of bitmaps and sounds that were moved to the resource maps, so the tag data can be made shorter.
+//
+// Only blocks the tag schema knows the size of are moved, and only into blocks that were known before fixing but are
+// no longer pointed to by anything after. Everything else in the tag data may be something the schema can not see,
+// so it stays where it is.
+struct tag_compaction_range {
+    uint32_t start; // Offset from the start of the tag data
+    uint32_t end;
+};
+
+struct tag_compaction {
+    struct tag_compaction_range *ranges; // Known blocks before fixing
+    size_t range_count;
+    size_t range_capacity;
+};
+
+// Call before any fixes
+void tag_compaction_begin(struct tag_compaction *compaction, struct cache_file_instance *cache_file);
+
+// Call after all fixes are applied. Returns the new tag data size, which is the old size if nothing can be done.
+size_t tag_compaction_plan(struct tag_compaction *compaction, struct cache_file_instance *cache_file, struct tag_fix_plan *plan);
+
+void tag_compaction_free(struct tag_compaction *compaction);
@@ -0,0 +1,506 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "tag_data_builder.h"
+
+#include "../data_types.h"
+#include "../cache/cache.h"
+#include "tag.h"
+#include "tag_fourcc.h"
+#include "tag_schema.h"
+#include "../thread/thread_output.h"
+
+#define TAG_DATA_BUILDER_ALIGNMENT 4
+
+// Something in the tag data that is known to be used
+struct tag_data_builder_range {
+    uint32_t start;
+    uint32_t end;
+    bool pinned;
+};
+
+// A pointer found by the walk, before the items are known
+struct tag_data_builder_pointer {
+    uint32_t offset; // Of the pointer itself
+    Pointer32 address;
+};
+
+struct tag_data_builder_walk {
+    struct tag_data_instance *tag_data;
+    bool runtime_pointers_are_live;
+    struct tag_data_builder_range *ranges;
+    size_t range_count;
+    size_t range_capacity;
+    struct tag_data_builder_pointer *pointers;
+    size_t pointer_count;
+    size_t pointer_capacity;
+};
+
+static void *tag_data_builder_grow(void *buffer, size_t *capacity, size_t needed, size_t element_size) {
+    if(needed <= *capacity) {
+        return buffer;
+    }
+
+    size_t new_capacity = MAX(*capacity * 2, MAX(needed, 1024));
+    buffer = realloc(buffer, new_capacity * element_size);
+    if(!buffer) {
+        abort();
+    }
+
+    *capacity = new_capacity;
+    return buffer;
+}
+
+static uint64_t tag_data_builder_align(uint64_t offset) {
+    return (offset + TAG_DATA_BUILDER_ALIGNMENT - 1) & ~(uint64_t)(TAG_DATA_BUILDER_ALIGNMENT - 1);
+}
+
+static void tag_data_builder_add_range(struct tag_data_builder_walk *walk, uint32_t start, uint32_t end, bool pinned) {
+    walk->ranges = tag_data_builder_grow(walk->ranges, &walk->range_capacity, walk->range_count + 1, sizeof(struct tag_data_builder_range));
+    walk->ranges[walk->range_count++] = (struct tag_data_builder_range){ start, end, pinned };
+}
+
+static void tag_data_builder_add_pointer(struct tag_data_builder_walk *walk, const void *site, Pointer32 address) {
+    walk->pointers = tag_data_builder_grow(walk->pointers, &walk->pointer_capacity, walk->pointer_count + 1, sizeof(struct tag_data_builder_pointer));
+    walk->pointers[walk->pointer_count++] = (struct tag_data_builder_pointer){ (const uint8_t *)site - walk->tag_data->data, address };
+}
+
+// Paths are not moved, since the schema can not see everything pointing to them
+static void tag_data_builder_add_path(struct tag_data_builder_walk *walk, Pointer32 name) {
+    const char *path = tag_path_resolve(name, walk->tag_data);
+    if(path) {
+        uint32_t start = (const uint8_t *)path - walk->tag_data->data;
+        tag_data_builder_add_range(walk, start, start + strlen(path) + 1, true);
+    }
+}
+
+static void tag_data_builder_visit_block(const struct tag_schema_block *block, void *context) {
+    struct tag_data_builder_walk *walk = context;
+    struct tag_data_instance *tag_data = walk->tag_data;
+    if(block->space->data != tag_data->data || !block->data) {
+        return;
+    }
+
+    const Pointer32 *site;
+    switch(block->type) {
+        case TAG_SCHEMA_BLOCK_TYPE_BASE_STRUCT:
+            site = &tag_data->tags[block->tag.index].base_address;
+            break;
+        case TAG_SCHEMA_BLOCK_TYPE_REFLEXIVE:
+            site = &((struct tag_reflexive *)block->pointer)->address;
+            break;
+        case TAG_SCHEMA_BLOCK_TYPE_DATA:
+            site = &((struct tag_data *)block->pointer)->address;
+            break;
+        default:
+            return;
+    }
+
+    // Blocks the schema does not know the size of still have a known pointer to them. Blocks with pointers in them the
+    // schema does not know of stay where they are.
+    tag_data_builder_add_pointer(walk, site, block->address);
+    if(block->size > 0) {
+        uint32_t start = block->data - tag_data->data;
+        tag_data_builder_add_range(walk, start, start + block->size, !tag_schema_block_is_known(block));
+    }
+}
+
+static void tag_data_builder_visit_field(const struct tag_schema_block *block, const struct tag_schema_field *field, void *value, void *context) {
+    struct tag_data_builder_walk *walk = context;
+    if(field->type == TAG_SCHEMA_FIELD_TYPE_REFERENCE && ((struct tag_reference *)value)->name != 0) {
+        tag_data_builder_add_path(walk, ((struct tag_reference *)value)->name);
+    }
+
+    // On Xbox, the game uses these as they are, and they point into the tag data
+    if(field->type == TAG_SCHEMA_FIELD_TYPE_RUNTIME_POINTER && walk->runtime_pointers_are_live && block->space->data == walk->tag_data->data) {
+        tag_data_builder_add_pointer(walk, value, *(Pointer32 *)value);
+    }
+}
+
+static int tag_data_builder_compare_ranges(const void *a, const void *b) {
+    const struct tag_data_builder_range *range_a = a;
+    const struct tag_data_builder_range *range_b = b;
+    if(range_a->start != range_b->start) {
+        return range_a->start > range_b->start ? 1 : -1;
+    }
+    return (range_a->end > range_b->end) - (range_a->end < range_b->end);
+}
+
+static int tag_data_builder_compare_sites(const void *a, const void *b) {
+    const struct tag_data_builder_site *site_a = a;
+    const struct tag_data_builder_site *site_b = b;
+    if(site_a->item != site_b->item) {
+        return site_a->item > site_b->item ? 1 : -1;
+    }
+    return (site_a->offset > site_b->offset) - (site_a->offset < site_b->offset);
+}
+
+static size_t tag_data_builder_add_item(struct tag_data_builder *builder, struct tag_data_builder_item item) {
+    builder->items = tag_data_builder_grow(builder->items, &builder->item_capacity, builder->item_count + 1, sizeof(struct tag_data_builder_item));
+    builder->items[builder->item_count] = item;
+    return builder->item_count++;
+}
+
+static size_t tag_data_builder_find_offset(const struct tag_data_builder *builder, uint32_t offset, uint32_t *item_offset) {
+    size_t low = 0;
+    size_t high = builder->original_count;
+    while(low < high) {
+        size_t middle = low + (high - low) / 2;
+        if(builder->items[middle].start <= offset) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+
+    if(low == 0 || offset >= builder->items[low - 1].end) {
+        return TAG_DATA_BUILDER_NONE;
+    }
+    if(item_offset) {
+        *item_offset = offset - builder->items[low - 1].start;
+    }
+    return low - 1;
+}
+
+// Until something is found pointing into it, space between known blocks is marked removed
+static void tag_data_builder_pin(struct tag_data_builder_item *item) {
+    item->pinned = true;
+    item->removed = false;
+}
+
+void tag_data_builder_init(struct tag_data_builder *builder, struct cache_file_instance *cache_file) {
+    assert(builder && cache_file && cache_file->valid);
+    memset(builder, 0, sizeof(struct tag_data_builder));
+    builder->cache_file = cache_file;
+
+    struct tag_data_instance *tag_data = &cache_file->tag_data;
+    struct tag_data_builder_walk walk = {
+        .tag_data = tag_data,
+        .runtime_pointers_are_live = !cache_file_has_model_data(cache_file)
+    };
+
+    uint32_t tags_start = (uint8_t *)tag_data->tags - tag_data->data;
+    tag_data_builder_add_range(&walk, 0, tag_data->header_size, true);
+    tag_data_builder_add_range(&walk, tags_start, tags_start + tag_data->header->tag_count * sizeof(struct tag_instance), false);
+    tag_data_builder_add_pointer(&walk, &tag_data->header->tag_instances, tag_data->header->tag_instances);
+    if(!cache_file_has_model_data(cache_file)) {
+        struct tag_data_header_xbox *header = tag_data->header_xbox;
+        tag_data_builder_add_pointer(&walk, &header->vertex_buffers, header->vertex_buffers);
+        tag_data_builder_add_pointer(&walk, &header->index_buffers, header->index_buffers);
+    }
+
+    // Tags the walk skips still point to their base struct. BSPs are elsewhere.
+    for(size_t t = 0; t < tag_data->header->tag_count; t++) {
+        struct tag_instance *instance = &tag_data->tags[t];
+        tag_data_builder_add_path(&walk, instance->name_address);
+        if(instance->primary_group != TAG_FOURCC_SCENARIO_STRUCTURE_BSP) {
+            tag_data_builder_add_pointer(&walk, &instance->base_address, instance->base_address);
+        }
+    }
+
+    struct tag_schema_visitor visitor = {
+        .block = tag_data_builder_visit_block,
+        .field = tag_data_builder_visit_field,
+        .context = &walk
+    };
+    tag_schema_walk(&visitor, cache_file);
+
+    // Overlapping ranges are one item, and everything between them is an item too
+    if(walk.range_count > 0) {
+        qsort(walk.ranges, walk.range_count, sizeof(struct tag_data_builder_range), tag_data_builder_compare_ranges);
+    }
+    uint32_t cursor = 0;
+    for(size_t r = 0; r < walk.range_count;) {
+        struct tag_data_builder_range merged = walk.ranges[r++];
+        while(r < walk.range_count && walk.ranges[r].start < merged.end) {
+            merged.end = MAX(merged.end, walk.ranges[r].end);
+            merged.pinned = merged.pinned || walk.ranges[r].pinned;
+            r++;
+        }
+
+        merged.start = MAX(merged.start, cursor);
+        if(merged.start >= merged.end) {
+            continue;
+        }
+        if(cursor < merged.start) {
+            tag_data_builder_add_item(builder, (struct tag_data_builder_item){ .start = cursor, .end = merged.start, .size = merged.start - cursor, .removed = true });
+        }
+        tag_data_builder_add_item(builder, (struct tag_data_builder_item){ .start = merged.start, .end = merged.end, .size = merged.end - merged.start, .pinned = merged.pinned });
+        cursor = merged.end;
+    }
+    if(cursor < tag_data->size) {
+        tag_data_builder_add_item(builder, (struct tag_data_builder_item){ .start = cursor, .end = tag_data->size, .size = tag_data->size - cursor, .removed = true });
+    }
+    builder->original_count = builder->item_count;
+
+    for(size_t p = 0; p < walk.pointer_count; p++) {
+        const struct tag_data_builder_pointer *pointer = &walk.pointers[p];
+        if(pointer->address < tag_data->data_load_address || pointer->address - tag_data->data_load_address >= tag_data->size) {
+            continue;
+        }
+
+        struct tag_data_builder_site site;
+        site.item = tag_data_builder_find_offset(builder, pointer->offset, &site.offset);
+        site.target = tag_data_builder_find_offset(builder, pointer->address - tag_data->data_load_address, &site.target_offset);
+        assert(site.item != TAG_DATA_BUILDER_NONE && site.target != TAG_DATA_BUILDER_NONE);
+
+        // A pointer that is not all in one item can not be rewritten, so leave everything it touches where it is
+        if(site.offset + sizeof(Pointer32) > builder->items[site.item].size) {
+            for(size_t i = site.item; i < builder->original_count && builder->items[i].start < pointer->offset + sizeof(Pointer32); i++) {
+                tag_data_builder_pin(&builder->items[i]);
+            }
+            tag_data_builder_pin(&builder->items[site.target]);
+            continue;
+        }
+
+        if(builder->items[site.item].removed) {
+            tag_data_builder_pin(&builder->items[site.item]);
+        }
+        if(builder->items[site.target].removed) {
+            tag_data_builder_pin(&builder->items[site.target]);
+        }
+        builder->sites = tag_data_builder_grow(builder->sites, &builder->site_capacity, builder->site_count + 1, sizeof(struct tag_data_builder_site));
+        builder->sites[builder->site_count++] = site;
+    }
+
+    // Anything that is not zeroed may be used by something unknown
+    for(size_t i = 0; i < builder->original_count; i++) {
+        struct tag_data_builder_item *item = &builder->items[i];
+        if(!item->removed) {
+            continue;
+        }
+        for(uint32_t b = item->start; b < item->end; b++) {
+            if(tag_data->data[b] != 0) {
+                tag_data_builder_pin(item);
+                break;
+            }
+        }
+    }
+
+    // Shared blocks are walked more than once
+    if(builder->site_count > 0) {
+        qsort(builder->sites, builder->site_count, sizeof(struct tag_data_builder_site), tag_data_builder_compare_sites);
+        size_t unique = 0;
+        for(size_t s = 1; s < builder->site_count; s++) {
+            if(tag_data_builder_compare_sites(&builder->sites[s], &builder->sites[unique]) != 0) {
+                builder->sites[++unique] = builder->sites[s];
+            }
+        }
+        builder->site_count = unique + 1;
+    }
+    builder->sorted_site_count = builder->site_count;
+
+    free(walk.ranges);
+    free(walk.pointers);
+}
+
+size_t tag_data_builder_find(const struct tag_data_builder *builder, Pointer32 address, uint32_t *offset) {
+    assert(builder);
+    struct tag_data_instance *tag_data = &builder->cache_file->tag_data;
+    if(address < tag_data->data_load_address || address - tag_data->data_load_address >= tag_data->size) {
+        return TAG_DATA_BUILDER_NONE;
+    }
+    return tag_data_builder_find_offset(builder, address - tag_data->data_load_address, offset);
+}
+
+uint8_t *tag_data_builder_edit(struct tag_data_builder *builder, size_t item_index, uint32_t size) {
+    assert(builder && item_index < builder->item_count);
+    struct tag_data_builder_item *item = &builder->items[item_index];
+    assert(!item->pinned && !item->removed);
+
+    if(!item->data) {
+        item->data = calloc(MAX(size, 1), 1);
+        if(!item->data) {
+            abort();
+        }
+        memcpy(item->data, builder->cache_file->tag_data.data + item->start, MIN(size, item->size));
+    }
+    else if(size != item->size) {
+        item->data = realloc(item->data, MAX(size, 1));
+        if(!item->data) {
+            abort();
+        }
+        if(size > item->size) {
+            memset(item->data + item->size, 0, size - item->size);
+        }
+    }
+
+    item->size = size;
+    return item->data;
+}
+
+size_t tag_data_builder_append(struct tag_data_builder *builder, uint32_t size) {
+    assert(builder);
+    uint8_t *data = calloc(MAX(size, 1), 1);
+    if(!data) {
+        abort();
+    }
+    return tag_data_builder_add_item(builder, (struct tag_data_builder_item){ .data = data, .size = size });
+}
+
+void tag_data_builder_remove(struct tag_data_builder *builder, size_t item_index) {
+    assert(builder && item_index < builder->item_count);
+    struct tag_data_builder_item *item = &builder->items[item_index];
+    assert(!item->pinned);
+
+    free(item->data);
+    item->data = nullptr;
+    item->removed = true;
+}
+
+void tag_data_builder_point(struct tag_data_builder *builder, size_t item, uint32_t offset, size_t target, uint32_t target_offset) {
+    assert(builder && item < builder->item_count && (target == TAG_DATA_BUILDER_NONE || target < builder->item_count));
+    assert(!builder->items[item].removed && offset + sizeof(Pointer32) <= builder->items[item].size);
+
+    struct tag_data_builder_site site = { item, offset, target, target_offset };
+    struct tag_data_builder_site *found = nullptr;
+    if(builder->sorted_site_count > 0) {
+        found = bsearch(&site, builder->sites, builder->sorted_site_count, sizeof(struct tag_data_builder_site), tag_data_builder_compare_sites);
+    }
+    for(size_t s = builder->sorted_site_count; s < builder->site_count && !found; s++) {
+        if(tag_data_builder_compare_sites(&builder->sites[s], &site) == 0) {
+            found = &builder->sites[s];
+        }
+    }
+
+    if(found) {
+        *found = site;
+        return;
+    }
+    builder->sites = tag_data_builder_grow(builder->sites, &builder->site_capacity, builder->site_count + 1, sizeof(struct tag_data_builder_site));
+    builder->sites[builder->site_count++] = site;
+}
+
+static bool tag_data_builder_site_is_live(const struct tag_data_builder *builder, const struct tag_data_builder_site *site) {
+    const struct tag_data_builder_item *item = &builder->items[site->item];
+    return !item->removed && site->offset + sizeof(Pointer32) <= item->size;
+}
+
+bool tag_data_builder_emit(struct tag_data_builder *builder, uint8_t **data, size_t *size) {
+    assert(builder && data && size);
+    struct tag_data_instance *tag_data = &builder->cache_file->tag_data;
+
+    for(size_t s = 0; s < builder->site_count; s++) {
+        const struct tag_data_builder_site *site = &builder->sites[s];
+        if(!tag_data_builder_site_is_live(builder, site) || site->target == TAG_DATA_BUILDER_NONE) {
+            continue;
+        }
+
+        const struct tag_data_builder_item *target = &builder->items[site->target];
+        if(target->removed || site->target_offset > target->size) {
+            thread_output_error("%s: Tag data can not be rebuilt since something points to a block that was removed\n", builder->cache_file->header->name);
+            return false;
+        }
+    }
+
+    // Items that do not fit before the next pinned item go after everything
+    uint32_t *next_pinned = malloc((builder->original_count + 1) * sizeof(uint32_t));
+    size_t *deferred = malloc((builder->item_count + 1) * sizeof(size_t));
+    if(!next_pinned || !deferred) {
+        abort();
+    }
+    next_pinned[builder->original_count] = UINT32_MAX;
+    for(size_t i = builder->original_count; i > 0; i--) {
+        const struct tag_data_builder_item *item = &builder->items[i - 1];
+        next_pinned[i - 1] = item->pinned && !item->removed ? item->start : next_pinned[i];
+    }
+
+    uint64_t cursor = 0;
+    size_t deferred_count = 0;
+    for(size_t i = 0; i < builder->original_count; i++) {
+        struct tag_data_builder_item *item = &builder->items[i];
+        if(item->removed) {
+            continue;
+        }
+        if(item->pinned) {
+            assert(cursor <= item->start);
+            item->new_offset = item->start;
+            cursor = item->end;
+            continue;
+        }
+
+        uint64_t offset = tag_data_builder_align(cursor);
+        if(offset + item->size <= next_pinned[i]) {
+            item->new_offset = offset;
+            cursor = offset + item->size;
+        }
+        else {
+            deferred[deferred_count++] = i;
+        }
+    }
+    for(size_t i = builder->original_count; i < builder->item_count; i++) {
+        if(!builder->items[i].removed) {
+            deferred[deferred_count++] = i;
+        }
+    }
+    for(size_t d = 0; d < deferred_count; d++) {
+        struct tag_data_builder_item *item = &builder->items[deferred[d]];
+        uint64_t offset = tag_data_builder_align(cursor);
+        if(offset + item->size > CACHE_FILE_MAXIMUM_SIZE) {
+            thread_output_error("%s: Tag data is too big to be rebuilt\n", builder->cache_file->header->name);
+            free(deferred);
+            free(next_pinned);
+            return false;
+        }
+        item->new_offset = offset;
+        cursor = offset + item->size;
+    }
+    free(deferred);
+    free(next_pinned);
+
+    size_t new_size = tag_data_builder_align(cursor);
+    uint8_t *new_data = calloc(new_size, 1);
+    if(!new_data) {
+        abort();
+    }
+    for(size_t i = 0; i < builder->item_count; i++) {
+        const struct tag_data_builder_item *item = &builder->items[i];
+        if(!item->removed) {
+            memcpy(new_data + item->new_offset, item->data ? item->data : tag_data->data + item->start, item->size);
+        }
+    }
+
+    for(size_t s = 0; s < builder->site_count; s++) {
+        const struct tag_data_builder_site *site = &builder->sites[s];
+        if(!tag_data_builder_site_is_live(builder, site)) {
+            continue;
+        }
+
+        Pointer32 address = 0;
+        if(site->target != TAG_DATA_BUILDER_NONE) {
+            address = tag_data->data_load_address + builder->items[site->target].new_offset + site->target_offset;
+        }
+        memcpy(new_data + builder->items[site->item].new_offset + site->offset, &address, sizeof(Pointer32));
+    }
+
+    *data = new_data;
+    *size = new_size;
+    return true;
+}
+
+bool tag_data_builder_commit(struct tag_data_builder *builder) {
+    assert(builder);
+    uint8_t *data;
+    size_t size;
+    if(!tag_data_builder_emit(builder, &data, &size)) {
+        return false;
+    }
+
+    bool success = cache_file_replace_tag_data(builder->cache_file, data, size);
+    free(data);
+    return success;
+}
+
+void tag_data_builder_free(struct tag_data_builder *builder) {
+    assert(builder);
+    for(size_t i = 0; i < builder->item_count; i++) {
+        free(builder->items[i].data);
+    }
+    free(builder->items);
+    free(builder->sites);
+    memset(builder, 0, sizeof(struct tag_data_builder));
+}
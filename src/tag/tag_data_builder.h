@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "../data_types.h"
+#include "../cache/cache.h"
+
+#define TAG_DATA_BUILDER_NONE SIZE_MAX
+
+// A tag data builder splits the tag data into items and records every pointer the schema knows of as an item and an
+// offset in it, pointing to an item and an offset in that, so items can be moved, resized, appended and removed. The new
+// tag data is then laid out in one pass, with every pointer rewritten to where its target ended up.
+//
+// Items are the header, the tag array, known blocks (blocks that overlap are one item) and whatever is between them.
+// Zeroed space nothing points into is dropped. Tag paths and everything else between known blocks may be pointed to by
+// something the schema can not see, so they are pinned: they stay at the same offset and can not be changed, and other
+// items are laid out around them.
+struct tag_data_builder_item {
+    uint32_t start; // Offset in the original tag data. Appended items have no original bytes.
+    uint32_t end;
+    uint8_t *data; // New contents, or nullptr if unchanged
+    uint32_t size;
+    uint32_t new_offset; // Set when laid out
+    bool pinned;
+    bool removed;
+};
+
+struct tag_data_builder_site {
+    size_t item; // Where the pointer is
+    uint32_t offset; // From the start of the item
+    size_t target; // TAG_DATA_BUILDER_NONE for a null pointer
+    uint32_t target_offset;
+};
+
+struct tag_data_builder {
+    struct cache_file_instance *cache_file;
+    struct tag_data_builder_item *items; // Original items come first, sorted by offset
+    size_t original_count;
+    size_t item_count;
+    size_t item_capacity;
+    struct tag_data_builder_site *sites; // Sites found by init come first, sorted by item and offset
+    size_t sorted_site_count;
+    size_t site_count;
+    size_t site_capacity;
+};
+
+void tag_data_builder_init(struct tag_data_builder *builder, struct cache_file_instance *cache_file);
+
+// Original item containing the address, or TAG_DATA_BUILDER_NONE. offset is set to where in the item it is.
+size_t tag_data_builder_find(const struct tag_data_builder *builder, Pointer32 address, uint32_t *offset);
+
+// Resizes an item that is not pinned and returns its contents to change. New bytes are zeroed, and pointers past the new
+// size are dropped.
+uint8_t *tag_data_builder_edit(struct tag_data_builder *builder, size_t item, uint32_t size);
+
+// Adds a zeroed item after everything else
+size_t tag_data_builder_append(struct tag_data_builder *builder, uint32_t size);
+
+// Removes an item that is not pinned. Anything still pointing to it has to be pointed somewhere else first.
+void tag_data_builder_remove(struct tag_data_builder *builder, size_t item);
+
+// Sets the pointer at offset in item, replacing whatever was recorded there
+void tag_data_builder_point(struct tag_data_builder *builder, size_t item, uint32_t offset, size_t target, uint32_t target_offset);
+
+// Lays the items out and writes the new tag data, which is freed by the caller. Fails if something points to a removed
+// item or past the end of one.
+bool tag_data_builder_emit(struct tag_data_builder *builder, uint8_t **data, size_t *size);
+
+// Replaces the tag data in the cache file with what is emitted. The builder can only be freed after.
+bool tag_data_builder_commit(struct tag_data_builder *builder);
+
+void tag_data_builder_free(struct tag_data_builder *builder);
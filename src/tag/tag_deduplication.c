@@ -0,0 +1,475 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "tag_deduplication.h"
+
+#include "../data_types.h"
+#include "../cache/cache.h"
+#include "tag.h"
+#include "tag_fix_plan.h"
+#include "tag_schema.h"
+
+#define TAG_DEDUPLICATION_NONE SIZE_MAX
+
+// A tag_reflexive or tag_data pointing into the tag data
+struct tag_deduplication_site {
+    uint32_t offset; // Offset of the pointer from the start of the cache file
+    Pointer32 *pointer;
+    TagID tag;
+    size_t node;
+    size_t parent; // Node the pointer is in, TAG_DEDUPLICATION_NONE if it is in a base struct
+};
+
+// A block of tag data. A block reached through more than one site is still one node.
+struct tag_deduplication_node {
+    uint8_t type;
+    const struct tag_schema_struct *schema;
+    uint32_t start; // Offset from the start of the tag data
+    uint32_t size;
+    uint32_t count;
+    bool mergeable;
+    bool visiting;
+    size_t class_index; // TAG_DEDUPLICATION_NONE until classified
+};
+
+// Nodes with the same contents
+struct tag_deduplication_class {
+    size_t representative; // Member with the lowest offset, which everything is pointed at
+    uint64_t hash;
+    size_t canonical; // Offset of the contents in the canonical buffer, TAG_DEDUPLICATION_NONE if not mergeable
+    bool live;
+};
+
+// A pointer field of a node and the site it is
+struct tag_deduplication_slot {
+    uint32_t offset; // Offset from the start of the node
+    size_t site;
+};
+
+struct tag_deduplication {
+    struct tag_data_instance *tag_data;
+    uint32_t tag_data_offset; // Offset of the tag data from the start of the cache file
+    uint8_t *cache_data;
+
+    struct tag_deduplication_site *sites;
+    size_t site_count;
+    size_t site_capacity;
+    struct tag_deduplication_node *nodes;
+    size_t node_count;
+    struct tag_deduplication_class *classes;
+    size_t class_count;
+
+    size_t *table; // Open addressing over mergeable classes by hash
+    size_t table_mask;
+
+    struct tag_deduplication_slot *slots; // Used as a stack while classifying
+    size_t slot_count;
+    size_t slot_capacity;
+
+    uint8_t *canonical;
+    size_t canonical_size;
+    size_t canonical_capacity;
+};
+
+// A site as it is found while walking, before sites are merged into nodes
+struct tag_deduplication_visit {
+    struct tag_deduplication_site site;
+    struct tag_deduplication_node node;
+};
+
+struct tag_deduplication_walk {
+    struct tag_deduplication *deduplication;
+    struct tag_deduplication_visit *visits;
+    size_t visit_count;
+    size_t visit_capacity;
+};
+
+static void *tag_deduplication_grow(void *buffer, size_t *capacity, size_t needed, size_t element_size) {
+    if(needed <= *capacity) {
+        return buffer;
+    }
+
+    size_t new_capacity = MAX(*capacity * 2, MAX(needed, 1024));
+    buffer = realloc(buffer, new_capacity * element_size);
+    if(!buffer) {
+        abort();
+    }
+
+    *capacity = new_capacity;
+    return buffer;
+}
+
+// Eight bytes at a time, with a splitmix64 finalizer
+static uint64_t tag_deduplication_hash(const uint8_t *data, size_t size) {
+    uint64_t hash = 0xCBF29CE484222325 ^ size;
+    size_t i = 0;
+    for(; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * 0x9E3779B97F4A7C15;
+        hash ^= hash >> 29;
+    }
+    for(; i < size; i++) {
+        hash = (hash ^ data[i]) * 0x100000001B3;
+    }
+
+    hash ^= hash >> 30;
+    hash *= 0xBF58476D1CE4E5B9;
+    hash ^= hash >> 27;
+    hash *= 0x94D049BB133111EB;
+    hash ^= hash >> 31;
+    return hash;
+}
+
+static void tag_deduplication_visit_block(const struct tag_schema_block *block, void *context) {
+    struct tag_deduplication_walk *walk = context;
+    struct tag_deduplication *deduplication = walk->deduplication;
+    struct tag_data_instance *tag_data = deduplication->tag_data;
+    if(block->type == TAG_SCHEMA_BLOCK_TYPE_BASE_STRUCT || block->space->data != tag_data->data || !block->data) {
+        return;
+    }
+
+    Pointer32 *pointer;
+    bool mergeable;
+    if(block->type == TAG_SCHEMA_BLOCK_TYPE_REFLEXIVE) {
+        pointer = &((struct tag_reflexive *)block->pointer)->address;
+        mergeable = tag_schema_block_is_known(block) && !tag_schema_struct_is_written_at_runtime(block->schema);
+    }
+    else {
+        pointer = &((struct tag_data *)block->pointer)->address;
+        mergeable = !block->field->written_at_runtime;
+    }
+
+    walk->visits = tag_deduplication_grow(walk->visits, &walk->visit_capacity, walk->visit_count + 1, sizeof(struct tag_deduplication_visit));
+    walk->visits[walk->visit_count++] = (struct tag_deduplication_visit){
+        .site = {
+            .offset = (uint8_t *)pointer - deduplication->cache_data,
+            .pointer = pointer,
+            .tag = block->tag,
+            .parent = TAG_DEDUPLICATION_NONE
+        },
+        .node = {
+            .type = block->type,
+            .schema = block->schema,
+            .start = block->data - tag_data->data,
+            .size = block->size,
+            .count = block->count,
+            .mergeable = mergeable,
+            .class_index = TAG_DEDUPLICATION_NONE
+        }
+    };
+}
+
+static int tag_deduplication_compare_sites(const void *a, const void *b) {
+    const struct tag_deduplication_visit *visit_a = a;
+    const struct tag_deduplication_visit *visit_b = b;
+    return (visit_a->site.offset > visit_b->site.offset) - (visit_a->site.offset < visit_b->site.offset);
+}
+
+static int tag_deduplication_compare_nodes(const struct tag_deduplication_node *node_a, const struct tag_deduplication_node *node_b) {
+    if(node_a->start != node_b->start) {
+        return node_a->start > node_b->start ? 1 : -1;
+    }
+    if(node_a->size != node_b->size) {
+        return node_a->size > node_b->size ? 1 : -1;
+    }
+    if(node_a->count != node_b->count) {
+        return node_a->count > node_b->count ? 1 : -1;
+    }
+    if(node_a->type != node_b->type) {
+        return node_a->type > node_b->type ? 1 : -1;
+    }
+    return ((uintptr_t)node_a->schema > (uintptr_t)node_b->schema) - ((uintptr_t)node_a->schema < (uintptr_t)node_b->schema);
+}
+
+static thread_local const struct tag_deduplication_visit *tag_deduplication_sort_visits;
+
+static int tag_deduplication_compare_visit_nodes(const void *a, const void *b) {
+    const struct tag_deduplication_visit *visits = tag_deduplication_sort_visits;
+    return tag_deduplication_compare_nodes(&visits[*(const size_t *)a].node, &visits[*(const size_t *)b].node);
+}
+
+// Sites are visited again every time a shared block is walked into, so only the first visit of each is kept. Then
+// sites pointing to the same block get the same node.
+static void tag_deduplication_gather(struct tag_deduplication *deduplication, struct cache_file_instance *cache_file) {
+    struct tag_deduplication_walk walk = { .deduplication = deduplication };
+    struct tag_schema_visitor visitor = {
+        .block = tag_deduplication_visit_block,
+        .context = &walk
+    };
+    tag_schema_walk(&visitor, cache_file);
+
+    qsort(walk.visits, walk.visit_count, sizeof(struct tag_deduplication_visit), tag_deduplication_compare_sites);
+    size_t visit_count = 0;
+    for(size_t v = 0; v < walk.visit_count; v++) {
+        if(visit_count == 0 || walk.visits[v].site.offset != walk.visits[visit_count - 1].site.offset) {
+            walk.visits[visit_count++] = walk.visits[v];
+        }
+    }
+
+    size_t *order = calloc(MAX(visit_count, 1), sizeof(size_t));
+    deduplication->sites = calloc(MAX(visit_count, 1), sizeof(struct tag_deduplication_site));
+    deduplication->nodes = calloc(MAX(visit_count, 1), sizeof(struct tag_deduplication_node));
+    if(!order || !deduplication->sites || !deduplication->nodes) {
+        abort();
+    }
+
+    for(size_t v = 0; v < visit_count; v++) {
+        order[v] = v;
+        deduplication->sites[v] = walk.visits[v].site;
+    }
+    deduplication->site_count = visit_count;
+
+    // qsort has no context argument
+    tag_deduplication_sort_visits = walk.visits;
+    qsort(order, visit_count, sizeof(size_t), tag_deduplication_compare_visit_nodes);
+    tag_deduplication_sort_visits = nullptr;
+
+    for(size_t o = 0; o < visit_count; o++) {
+        const struct tag_deduplication_node *node = &walk.visits[order[o]].node;
+        struct tag_deduplication_node *last = deduplication->node_count > 0 ? &deduplication->nodes[deduplication->node_count - 1] : nullptr;
+        if(last && tag_deduplication_compare_nodes(last, node) == 0) {
+            // A data block is only mergeable if every field pointing to it says so
+            last->mergeable = last->mergeable && node->mergeable;
+        }
+        else {
+            deduplication->nodes[deduplication->node_count++] = *node;
+        }
+        deduplication->sites[order[o]].node = deduplication->node_count - 1;
+    }
+
+    free(order);
+    free(walk.visits);
+}
+
+static size_t tag_deduplication_find_site(const struct tag_deduplication *deduplication, uint32_t offset) {
+    size_t low = 0;
+    size_t high = deduplication->site_count;
+    while(low < high) {
+        size_t middle = low + (high - low) / 2;
+        if(deduplication->sites[middle].offset < offset) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+
+    if(low < deduplication->site_count && deduplication->sites[low].offset == offset) {
+        return low;
+    }
+    return TAG_DEDUPLICATION_NONE;
+}
+
+static void tag_deduplication_push_slot(struct tag_deduplication *deduplication, uint32_t offset, size_t site) {
+    deduplication->slots = tag_deduplication_grow(deduplication->slots, &deduplication->slot_capacity, deduplication->slot_count + 1, sizeof(struct tag_deduplication_slot));
+    deduplication->slots[deduplication->slot_count++] = (struct tag_deduplication_slot){ offset, site };
+}
+
+// Pushes a slot for every set pointer in an element. A pointer that is not a known site makes the node unmergeable,
+// since what it points to can not be compared.
+static void tag_deduplication_find_slots(struct tag_deduplication *deduplication, size_t n, const struct tag_schema_struct *schema, uint32_t offset) {
+    struct tag_deduplication_node *node = &deduplication->nodes[n];
+    uint8_t *element = deduplication->tag_data->data + node->start + offset;
+    for(size_t f = 0; f < schema->field_count; f++) {
+        const struct tag_schema_field *field = &schema->fields[f];
+        uint32_t pointer_offset;
+        switch(field->type) {
+            case TAG_SCHEMA_FIELD_TYPE_STRUCT:
+                tag_deduplication_find_slots(deduplication, n, field->schema, offset + field->offset);
+                continue;
+            case TAG_SCHEMA_FIELD_TYPE_REFLEXIVE:
+                pointer_offset = field->offset + offsetof(struct tag_reflexive, address);
+                break;
+            case TAG_SCHEMA_FIELD_TYPE_DATA:
+                pointer_offset = field->offset + offsetof(struct tag_data, address);
+                break;
+            default:
+                continue;
+        }
+
+        Pointer32 address;
+        memcpy(&address, element + pointer_offset, sizeof(address));
+        if(address == 0) {
+            continue;
+        }
+
+        size_t site = tag_deduplication_find_site(deduplication, deduplication->tag_data_offset + node->start + offset + pointer_offset);
+        if(site == TAG_DEDUPLICATION_NONE) {
+            node->mergeable = false;
+            continue;
+        }
+
+        if(deduplication->sites[site].parent == TAG_DEDUPLICATION_NONE) {
+            deduplication->sites[site].parent = n;
+        }
+        tag_deduplication_push_slot(deduplication, offset + pointer_offset, site);
+    }
+}
+
+static bool tag_deduplication_nodes_match(const struct tag_deduplication *deduplication, size_t a, size_t b) {
+    const struct tag_deduplication_node *node_a = &deduplication->nodes[a];
+    const struct tag_deduplication_node *node_b = &deduplication->nodes[b];
+    return node_a->type == node_b->type && node_a->schema == node_b->schema && node_a->count == node_b->count && node_a->size == node_b->size;
+}
+
+static size_t tag_deduplication_add_class(struct tag_deduplication *deduplication, size_t n, uint64_t hash, size_t canonical) {
+    size_t class_index = deduplication->class_count++;
+    deduplication->classes[class_index] = (struct tag_deduplication_class){
+        .representative = n,
+        .hash = hash,
+        .canonical = canonical
+    };
+    deduplication->nodes[n].class_index = class_index;
+    return class_index;
+}
+
+// Children are classified first, so a node's contents can refer to its children by class. Returns
+// TAG_DEDUPLICATION_NONE for a node that points back into itself, which tool never makes.
+static size_t tag_deduplication_classify(struct tag_deduplication *deduplication, size_t n) {
+    struct tag_deduplication_node *node = &deduplication->nodes[n];
+    if(node->class_index != TAG_DEDUPLICATION_NONE) {
+        return node->class_index;
+    }
+    if(node->visiting) {
+        node->mergeable = false;
+        return TAG_DEDUPLICATION_NONE;
+    }
+    node->visiting = true;
+
+    size_t first_slot = deduplication->slot_count;
+    if(node->type == TAG_SCHEMA_BLOCK_TYPE_REFLEXIVE && node->schema) {
+        for(uint32_t e = 0; e < node->count; e++) {
+            tag_deduplication_find_slots(deduplication, n, node->schema, e * node->schema->size);
+        }
+    }
+    size_t slot_count = deduplication->slot_count - first_slot;
+
+    // Keep the class of each child in its slot's site field from here on
+    for(size_t s = first_slot; s < first_slot + slot_count; s++) {
+        size_t child_class = tag_deduplication_classify(deduplication, deduplication->sites[deduplication->slots[s].site].node);
+        if(child_class == TAG_DEDUPLICATION_NONE) {
+            deduplication->nodes[n].mergeable = false;
+        }
+        deduplication->slots[s].site = child_class;
+    }
+
+    node = &deduplication->nodes[n];
+    node->visiting = false;
+    if(!node->mergeable) {
+        deduplication->slot_count = first_slot;
+        return tag_deduplication_add_class(deduplication, n, 0, TAG_DEDUPLICATION_NONE);
+    }
+
+    // Pointers are replaced with the class of what they point to. Class 0 is stored as 1 so it is not an empty pointer.
+    size_t canonical = deduplication->canonical_size;
+    deduplication->canonical = tag_deduplication_grow(deduplication->canonical, &deduplication->canonical_capacity, canonical + node->size, sizeof(uint8_t));
+    uint8_t *contents = deduplication->canonical + canonical;
+    memcpy(contents, deduplication->tag_data->data + node->start, node->size);
+    for(size_t s = first_slot; s < first_slot + slot_count; s++) {
+        uint32_t child_class = deduplication->slots[s].site + 1;
+        memcpy(contents + deduplication->slots[s].offset, &child_class, sizeof(child_class));
+    }
+    deduplication->slot_count = first_slot;
+
+    uint64_t hash = tag_deduplication_hash(contents, node->size);
+    size_t index = hash & deduplication->table_mask;
+    while(deduplication->table[index] != TAG_DEDUPLICATION_NONE) {
+        struct tag_deduplication_class *class = &deduplication->classes[deduplication->table[index]];
+        if(class->hash == hash &&
+            tag_deduplication_nodes_match(deduplication, class->representative, n) &&
+            memcmp(deduplication->canonical + class->canonical, contents, node->size) == 0) {
+
+            if(node->start < deduplication->nodes[class->representative].start) {
+                class->representative = n;
+            }
+            node->class_index = deduplication->table[index];
+            return node->class_index;
+        }
+        index = (index + 1) & deduplication->table_mask;
+    }
+
+    deduplication->canonical_size += node->size;
+    deduplication->table[index] = tag_deduplication_add_class(deduplication, n, hash, canonical);
+    return deduplication->table[index];
+}
+
+static bool tag_deduplication_site_is_live(const struct tag_deduplication *deduplication, const struct tag_deduplication_site *site) {
+    if(site->parent == TAG_DEDUPLICATION_NONE) {
+        return true;
+    }
+    const struct tag_deduplication_class *class = &deduplication->classes[deduplication->nodes[site->parent].class_index];
+    return class->live && class->representative == site->parent;
+}
+
+void tag_deduplication_plan(struct cache_file_instance *cache_file, struct tag_fix_plan *plan, struct tag_deduplication_result *result) {
+    assert(cache_file && cache_file->valid && plan && plan->base == cache_file->data && result);
+    struct tag_data_instance *tag_data = &cache_file->tag_data;
+    struct tag_deduplication deduplication = {
+        .tag_data = tag_data,
+        .tag_data_offset = tag_data->data - cache_file->data,
+        .cache_data = cache_file->data
+    };
+    memset(result, 0, sizeof(struct tag_deduplication_result));
+
+    tag_deduplication_gather(&deduplication, cache_file);
+
+    size_t table_size = 1;
+    while(table_size < deduplication.node_count * 2) {
+        table_size *= 2;
+    }
+    deduplication.table_mask = table_size - 1;
+    deduplication.table = malloc(table_size * sizeof(size_t));
+    deduplication.classes = calloc(MAX(deduplication.node_count, 1), sizeof(struct tag_deduplication_class));
+    if(!deduplication.table || !deduplication.classes) {
+        abort();
+    }
+    memset(deduplication.table, 0xFF, table_size * sizeof(size_t));
+
+    for(size_t n = 0; n < deduplication.node_count; n++) {
+        tag_deduplication_classify(&deduplication, n);
+    }
+
+    // A class is live if a live site points to any of it. Sites in base structs are always live, and the rest are
+    // live if the node they are in is the one its class is pointed at.
+    bool changed = true;
+    while(changed) {
+        changed = false;
+        for(size_t s = 0; s < deduplication.site_count; s++) {
+            const struct tag_deduplication_site *site = &deduplication.sites[s];
+            struct tag_deduplication_class *class = &deduplication.classes[deduplication.nodes[site->node].class_index];
+            if(!class->live && tag_deduplication_site_is_live(&deduplication, site)) {
+                class->live = true;
+                changed = true;
+            }
+        }
+    }
+
+    TagID plan_tag = plan->tag;
+    for(size_t s = 0; s < deduplication.site_count; s++) {
+        const struct tag_deduplication_site *site = &deduplication.sites[s];
+        size_t representative = deduplication.classes[deduplication.nodes[site->node].class_index].representative;
+        if(representative != site->node && tag_deduplication_site_is_live(&deduplication, site)) {
+            plan->tag = site->tag;
+            TAG_FIX_PLAN_SET(plan, *site->pointer, tag_data->data_load_address + deduplication.nodes[representative].start, "block is a duplicate of another block");
+        }
+    }
+    plan->tag = plan_tag;
+
+    for(size_t n = 0; n < deduplication.node_count; n++) {
+        const struct tag_deduplication_class *class = &deduplication.classes[deduplication.nodes[n].class_index];
+        if(!class->live || class->representative != n) {
+            result->block_count++;
+            result->byte_count += deduplication.nodes[n].size;
+        }
+    }
+
+    free(deduplication.sites);
+    free(deduplication.nodes);
+    free(deduplication.classes);
+    free(deduplication.table);
+    free(deduplication.slots);
+    free(deduplication.canonical);
+}
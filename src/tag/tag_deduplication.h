@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "../cache/cache.h"
+#include "tag_fix_plan.h"
+
+// Deduplication finds reflexives and data blocks in the tag data that have the same contents and points everything at
+// one copy of each. Two blocks are the same if their bytes are the same once every pointer in them is replaced with the
+// contents of what it points to, so whole trees of blocks are merged at once. The copies nothing points to anymore are
+// left where they are for compaction to reclaim.
+//
+// Blocks the game writes to are never merged, since then a write through one tag would show up in another. That is
+// any block with a runtime pointer, runtime value or tag ID in its layout, data blocks the schema marks as runtime
+// data, and anything the schema does not know the layout of.
+struct tag_deduplication_result {
+    size_t block_count; // Blocks nothing points to anymore
+    size_t byte_count;
+};
+
+void tag_deduplication_plan(struct cache_file_instance *cache_file, struct tag_fix_plan *plan, struct tag_deduplication_result *result);
@@ -0,0 +1,47 @@
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+#include "tag_externalization.h"
+
+#include "../data_types.h"
+#include "../resources/resources.h"
+#include "../tag_groups/tag_groups.h"
+#include "tag.h"
+#include "tag_fourcc.h"
+
+bool tag_externalization_plan(
+    const struct resource_index *index,
+    struct cache_file_instance *cache_file,
+    struct tag_fix_plan *plan,
+    struct tag_externalization_result *result) {
+
+    assert(index && cache_file && cache_file->valid && plan && result);
+    struct tag_data_instance *tag_data = &cache_file->tag_data;
+    assert(tag_data->indexed_external_tags);
+    memset(result, 0, sizeof(struct tag_externalization_result));
+
+    TagID plan_tag = plan->tag;
+    bool success = true;
+    for(size_t t = 0; t < tag_data->header->tag_count && success; t++) {
+        struct tag_instance *tag = &tag_data->tags[t];
+        plan->tag = tag->tag_id;
+
+        if(tag->primary_group == TAG_FOURCC_BITMAP) {
+            uint32_t resource = bitmap_find_in_resource_map(tag->tag_id, cache_file, &index->bitmaps, &index->bitmap_contents);
+            if(resource != RESOURCE_MAP_NO_MATCH) {
+                success = bitmap_make_external(tag->tag_id, resource, tag_data, plan);
+                result->bitmap_count++;
+            }
+        }
+        else if(tag->primary_group == TAG_FOURCC_SOUND) {
+            if(sound_matches_resource_map(tag->tag_id, cache_file, index)) {
+                success = sound_make_external(tag->tag_id, tag_data, plan);
+                result->sound_count++;
+            }
+        }
+    }
+
+    plan->tag = plan_tag;
+    return success;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "../cache/cache.h"
+#include "../resources/resource_index.h"
+#include "tag_fix_plan.h"
+
+// Externalization points bitmaps and sounds at the resource maps when the copy in the cache file is the same as the
+// one in the resource map, so the copy in the cache file is no longer needed. Custom Edition multiplayer maps look
+// bitmaps up by resource index and sounds by tag path, so only those can be externalized.
+struct tag_externalization_result {
+    size_t bitmap_count;
+    size_t sound_count;
+};
+
+bool tag_externalization_plan(
+    const struct resource_index *index,
+    struct cache_file_instance *cache_file,
+    struct tag_fix_plan *plan,
+    struct tag_externalization_result *result);
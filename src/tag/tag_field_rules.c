@@ -0,0 +1,273 @@
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "tag_field_rules.h"
+
+#include "../data_types.h"
+#include "tag.h"
+#include "tag_fix_plan.h"
+#include "tag_processing.h"
+
+// Elements are done in batches. Each rule is run over the whole batch at once, then fixes are planned element by
+// element in rule order so the plan comes out the same as fixing each element by hand.
+#define TAG_FIELD_RULE_BATCH 64
+
+static bool tag_field_rule_uses_lanes(const struct tag_field_rule *rule) {
+    switch(rule->type) {
+        case TAG_FIELD_RULE_TYPE_ENUM16_BIG_ENDIAN:
+        case TAG_FIELD_RULE_TYPE_ENUM16_RANGE:
+        case TAG_FIELD_RULE_TYPE_INT16_FLOOR:
+        case TAG_FIELD_RULE_TYPE_FLOAT_BIG_ENDIAN:
+        case TAG_FIELD_RULE_TYPE_CLEAR_FLAGS:
+            return true;
+        default:
+            return false;
+    }
+}
+
+[[maybe_unused]] static bool tag_field_rule_is_valid(const struct tag_field_rule *rule, size_t element_size) {
+    if(rule->offset + rule->size > element_size || !rule->reason) {
+        return false;
+    }
+
+    switch(rule->type) {
+        case TAG_FIELD_RULE_TYPE_ENUM16_BIG_ENDIAN:
+        case TAG_FIELD_RULE_TYPE_ENUM16_RANGE:
+        case TAG_FIELD_RULE_TYPE_INT16_FLOOR:
+            return rule->size == sizeof(uint16_t);
+        case TAG_FIELD_RULE_TYPE_FLOAT_BIG_ENDIAN:
+        case TAG_FIELD_RULE_TYPE_FLOAT_SET:
+            return rule->size == sizeof(float);
+        case TAG_FIELD_RULE_TYPE_CLEAR_FLAGS:
+            return rule->size == sizeof(uint16_t) || rule->size == sizeof(uint32_t);
+        case TAG_FIELD_RULE_TYPE_ZERO:
+            return rule->size > 0;
+        case TAG_FIELD_RULE_TYPE_NULL_REFERENCE:
+            return rule->size == sizeof(struct tag_reference);
+        default:
+            return false;
+    }
+}
+
+// Every lane based field is widened to 32 bits so all rules share one lane layout
+static void tag_field_rule_gather(const struct tag_field_rule *rule, const uint8_t *elements, size_t element_size, size_t count, uint32_t *lanes) {
+    for(size_t e = 0; e < count; e++) {
+        const uint8_t *field = elements + e * element_size + rule->offset;
+        if(rule->size == sizeof(uint16_t)) {
+            uint16_t value;
+            memcpy(&value, field, sizeof(value));
+            lanes[e] = rule->type == TAG_FIELD_RULE_TYPE_INT16_FLOOR ? (uint32_t)(int32_t)(int16_t)value : value;
+        }
+        else {
+            memcpy(&lanes[e], field, sizeof(uint32_t));
+        }
+    }
+}
+
+static void tag_field_rule_enum16(const struct tag_field_rule *rule, uint32_t *lanes, size_t count) {
+    bool big_endian = rule->type == TAG_FIELD_RULE_TYPE_ENUM16_BIG_ENDIAN;
+    size_t l = 0;
+
+    #ifdef __SSE2__
+    const __m128i low_byte = _mm_set1_epi32(0xFF);
+    const __m128i last_option = _mm_set1_epi32((int32_t)rule->enum16.count - 1);
+    const __m128i default_value = _mm_set1_epi32(rule->enum16.default_value);
+    for(; l + 4 <= count; l += 4) {
+        __m128i value = _mm_loadu_si128((const __m128i *)(lanes + l));
+        if(big_endian) {
+            value = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(value, low_byte), 8), _mm_srli_epi32(value, 8));
+        }
+        __m128i out_of_range = _mm_cmpgt_epi32(value, last_option);
+        value = _mm_or_si128(_mm_andnot_si128(out_of_range, value), _mm_and_si128(out_of_range, default_value));
+        _mm_storeu_si128((__m128i *)(lanes + l), value);
+    }
+    #endif
+
+    for(; l < count; l++) {
+        uint16_t value = lanes[l];
+        if(big_endian) {
+            value = tag_process_enum16(value, rule->enum16.count, rule->enum16.default_value);
+        }
+        else if(value >= rule->enum16.count) {
+            value = rule->enum16.default_value;
+        }
+        lanes[l] = value;
+    }
+}
+
+static void tag_field_rule_int16_floor(const struct tag_field_rule *rule, uint32_t *lanes, size_t count) {
+    size_t l = 0;
+
+    #ifdef __SSE2__
+    const __m128i floor = _mm_set1_epi32(rule->floor);
+    for(; l + 4 <= count; l += 4) {
+        __m128i value = _mm_loadu_si128((const __m128i *)(lanes + l));
+        __m128i below = _mm_cmplt_epi32(value, floor);
+        value = _mm_or_si128(_mm_andnot_si128(below, value), _mm_and_si128(below, floor));
+        _mm_storeu_si128((__m128i *)(lanes + l), value);
+    }
+    #endif
+
+    for(; l < count; l++) {
+        lanes[l] = (uint32_t)FLOOR((int32_t)lanes[l], (int32_t)rule->floor);
+    }
+}
+
+static void tag_field_rule_float_big_endian(const struct tag_field_rule *rule, uint32_t *lanes, size_t count) {
+    size_t l = 0;
+
+    #ifdef __SSE2__
+    const __m128i byte_mask = _mm_set1_epi32(0xFF00);
+    const __m128i exponent_mask = _mm_set1_epi32(0x7F800000);
+    const __m128 floor = _mm_set1_ps(rule->range.floor);
+    const __m128 ceiling = _mm_set1_ps(rule->range.ceiling);
+    for(; l + 4 <= count; l += 4) {
+        __m128i bits = _mm_loadu_si128((const __m128i *)(lanes + l));
+        bits = _mm_or_si128(
+            _mm_or_si128(_mm_slli_epi32(bits, 24), _mm_srli_epi32(bits, 24)),
+            _mm_or_si128(_mm_slli_epi32(_mm_and_si128(bits, byte_mask), 8), _mm_and_si128(_mm_srli_epi32(bits, 8), byte_mask))
+        );
+
+        // Infinity and NaN have every exponent bit set
+        __m128i not_finite = _mm_cmpeq_epi32(_mm_and_si128(bits, exponent_mask), exponent_mask);
+        __m128 value = _mm_castsi128_ps(_mm_andnot_si128(not_finite, bits));
+
+        // Same as PIN(), which keeps -0.0 where min/max would not
+        __m128 below = _mm_cmplt_ps(value, floor);
+        __m128 above = _mm_cmpgt_ps(value, ceiling);
+        value = _mm_or_ps(_mm_andnot_ps(_mm_or_ps(below, above), value), _mm_or_ps(_mm_and_ps(below, floor), _mm_and_ps(above, ceiling)));
+        _mm_storeu_si128((__m128i *)(lanes + l), _mm_castps_si128(value));
+    }
+    #endif
+
+    for(; l < count; l++) {
+        float value;
+        memcpy(&value, &lanes[l], sizeof(value));
+        value = tag_process_float(value);
+        value = PIN(value, rule->range.floor, rule->range.ceiling);
+        memcpy(&lanes[l], &value, sizeof(value));
+    }
+}
+
+static void tag_field_rule_clear_flags(const struct tag_field_rule *rule, uint32_t *lanes, size_t count) {
+    size_t l = 0;
+
+    #ifdef __SSE2__
+    const __m128i flags = _mm_set1_epi32(rule->flags);
+    for(; l + 4 <= count; l += 4) {
+        __m128i value = _mm_loadu_si128((const __m128i *)(lanes + l));
+        _mm_storeu_si128((__m128i *)(lanes + l), _mm_andnot_si128(flags, value));
+    }
+    #endif
+
+    for(; l < count; l++) {
+        lanes[l] &= ~rule->flags;
+    }
+}
+
+static void tag_field_rule_run(const struct tag_field_rule *rule, uint32_t *lanes, size_t count) {
+    switch(rule->type) {
+        case TAG_FIELD_RULE_TYPE_ENUM16_BIG_ENDIAN:
+        case TAG_FIELD_RULE_TYPE_ENUM16_RANGE:
+            tag_field_rule_enum16(rule, lanes, count);
+            break;
+        case TAG_FIELD_RULE_TYPE_INT16_FLOOR:
+            tag_field_rule_int16_floor(rule, lanes, count);
+            break;
+        case TAG_FIELD_RULE_TYPE_FLOAT_BIG_ENDIAN:
+            tag_field_rule_float_big_endian(rule, lanes, count);
+            break;
+        case TAG_FIELD_RULE_TYPE_CLEAR_FLAGS:
+            tag_field_rule_clear_flags(rule, lanes, count);
+            break;
+        default:
+            assert(false);
+    }
+}
+
+static void tag_field_rule_plan(const struct tag_field_rule *rule, uint8_t *field, uint32_t lane, struct tag_fix_plan *plan) {
+    switch(rule->type) {
+        case TAG_FIELD_RULE_TYPE_FLOAT_SET:
+            tag_fix_plan_write(plan, field, &rule->value, sizeof(rule->value), rule->reason);
+            break;
+        case TAG_FIELD_RULE_TYPE_ZERO:
+            tag_fix_plan_zero(plan, field, rule->size, rule->reason);
+            break;
+        case TAG_FIELD_RULE_TYPE_NULL_REFERENCE: {
+            struct tag_reference reference;
+            memcpy(&reference, field, sizeof(reference));
+            tag_null_reference(&reference, rule->tag_group);
+            tag_fix_plan_write(plan, field, &reference, sizeof(reference), rule->reason);
+            break;
+        }
+        default:
+            if(rule->size == sizeof(uint16_t)) {
+                uint16_t value = lane;
+                tag_fix_plan_write(plan, field, &value, sizeof(value), rule->reason);
+            }
+            else {
+                tag_fix_plan_write(plan, field, &lane, sizeof(lane), rule->reason);
+            }
+            break;
+    }
+}
+
+void tag_field_rules_apply(const struct tag_field_rule_table *table, void *elements, size_t element_count, struct tag_fix_plan *plan) {
+    assert(table && plan && (elements || element_count == 0));
+    assert(table->rule_count <= TAG_FIELD_RULE_MAXIMUM_RULES);
+
+    uint32_t lanes[TAG_FIELD_RULE_MAXIMUM_RULES][TAG_FIELD_RULE_BATCH];
+    for(size_t first = 0; first < element_count; first += TAG_FIELD_RULE_BATCH) {
+        uint8_t *batch = (uint8_t *)elements + first * table->element_size;
+        size_t batch_count = MIN(element_count - first, TAG_FIELD_RULE_BATCH);
+
+        for(size_t r = 0; r < table->rule_count; r++) {
+            const struct tag_field_rule *rule = &table->rules[r];
+            assert(tag_field_rule_is_valid(rule, table->element_size));
+            if(tag_field_rule_uses_lanes(rule)) {
+                tag_field_rule_gather(rule, batch, table->element_size, batch_count, lanes[r]);
+                tag_field_rule_run(rule, lanes[r], batch_count);
+            }
+        }
+
+        for(size_t e = 0; e < batch_count; e++) {
+            uint8_t *element = batch + e * table->element_size;
+            for(size_t r = 0; r < table->rule_count; r++) {
+                const struct tag_field_rule *rule = &table->rules[r];
+                uint32_t lane = tag_field_rule_uses_lanes(rule) ? lanes[r][e] : 0;
+                tag_field_rule_plan(rule, element + rule->offset, lane, plan);
+            }
+        }
+    }
+}
+
+// On failure, invalid_index is the first element that is out of bounds
+bool tag_field_rules_apply_reflexive(
+    const struct tag_field_rule_table *table,
+    struct tag_reflexive *reflexive,
+    size_t *invalid_index,
+    struct tag_data_instance *tag_data,
+    struct tag_fix_plan *plan) {
+
+    assert(table && reflexive && invalid_index && tag_data && tag_data->valid && plan);
+    if(reflexive->count == 0) {
+        return true;
+    }
+
+    void *elements = tag_resolve_pointer(reflexive->address, (size_t)reflexive->count * table->element_size, tag_data);
+    if(!elements) {
+        size_t index = 0;
+        while(index + 1 < reflexive->count && tag_reflexive_get_element(reflexive, index, table->element_size, tag_data)) {
+            index++;
+        }
+        *invalid_index = index;
+        return false;
+    }
+
+    tag_field_rules_apply(table, elements, reflexive->count, plan);
+    return true;
+}
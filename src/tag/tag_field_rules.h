@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "tag.h"
+#include "tag_fix_plan.h"
+
+// Field rules describe the usual per-field fixes (big-endian enums and floats, range checks, runtime flags and
+// references) as table entries so they can be applied over whole reflexive arrays at once.
+enum tag_field_rule_type {
+    TAG_FIELD_RULE_TYPE_ENUM16_BIG_ENDIAN, // Byteswap, then reset to the default if out of range
+    TAG_FIELD_RULE_TYPE_ENUM16_RANGE, // Reset to the default if out of range
+    TAG_FIELD_RULE_TYPE_INT16_FLOOR, // Raise to a minimum
+    TAG_FIELD_RULE_TYPE_FLOAT_BIG_ENDIAN, // Byteswap, zero if not finite, then pin to a range
+    TAG_FIELD_RULE_TYPE_FLOAT_SET, // Always set to a value
+    TAG_FIELD_RULE_TYPE_CLEAR_FLAGS, // Clear flag bits of a 16-bit or 32-bit field
+    TAG_FIELD_RULE_TYPE_ZERO, // Zero a runtime field
+    TAG_FIELD_RULE_TYPE_NULL_REFERENCE, // Null a reference of the given group
+    NUMBER_OF_TAG_FIELD_RULE_TYPES
+};
+
+struct tag_field_rule {
+    uint8_t type;
+    uint32_t offset; // From the start of the element
+    uint32_t size;
+    union {
+        struct {
+            uint16_t count;
+            uint16_t default_value;
+        } enum16;
+        struct {
+            float floor;
+            float ceiling;
+        } range;
+        int16_t floor;
+        float value;
+        uint32_t flags;
+        uint32_t tag_group;
+    };
+    const char *reason;
+};
+
+struct tag_field_rule_table {
+    size_t element_size;
+    const struct tag_field_rule *rules;
+    size_t rule_count;
+};
+
+#define TAG_FIELD_RULE_MAXIMUM_RULES 16
+
+#define TAG_FIELD_RULE(rule_type, struct_type, field, ...) \
+    { .type = rule_type, .offset = offsetof(struct_type, field), .size = sizeof(((struct_type *)nullptr)->field), __VA_ARGS__ }
+#define TAG_FIELD_RULE_ENUM16_BIG_ENDIAN(struct_type, field, option_count, option_default, why) \
+    TAG_FIELD_RULE(TAG_FIELD_RULE_TYPE_ENUM16_BIG_ENDIAN, struct_type, field, .enum16 = { option_count, option_default }, .reason = why)
+#define TAG_FIELD_RULE_ENUM16_RANGE(struct_type, field, option_count, option_default, why) \
+    TAG_FIELD_RULE(TAG_FIELD_RULE_TYPE_ENUM16_RANGE, struct_type, field, .enum16 = { option_count, option_default }, .reason = why)
+#define TAG_FIELD_RULE_INT16_FLOOR(struct_type, field, minimum, why) \
+    TAG_FIELD_RULE(TAG_FIELD_RULE_TYPE_INT16_FLOOR, struct_type, field, .floor = minimum, .reason = why)
+#define TAG_FIELD_RULE_FLOAT_BIG_ENDIAN(struct_type, field, minimum, maximum, why) \
+    TAG_FIELD_RULE(TAG_FIELD_RULE_TYPE_FLOAT_BIG_ENDIAN, struct_type, field, .range = { minimum, maximum }, .reason = why)
+#define TAG_FIELD_RULE_FLOAT_SET(struct_type, field, float_value, why) \
+    TAG_FIELD_RULE(TAG_FIELD_RULE_TYPE_FLOAT_SET, struct_type, field, .value = float_value, .reason = why)
+#define TAG_FIELD_RULE_CLEAR_FLAGS(struct_type, field, flag_mask, why) \
+    TAG_FIELD_RULE(TAG_FIELD_RULE_TYPE_CLEAR_FLAGS, struct_type, field, .flags = flag_mask, .reason = why)
+#define TAG_FIELD_RULE_ZERO(struct_type, field, why) \
+    TAG_FIELD_RULE(TAG_FIELD_RULE_TYPE_ZERO, struct_type, field, .reason = why)
+#define TAG_FIELD_RULE_NULL_REFERENCE(struct_type, field, group, why) \
+    TAG_FIELD_RULE(TAG_FIELD_RULE_TYPE_NULL_REFERENCE, struct_type, field, .tag_group = group, .reason = why)
+
+#define TAG_FIELD_RULE_TABLE(struct_type, rule_list) \
+    { .element_size = sizeof(struct_type), .rules = rule_list, .rule_count = sizeof(rule_list) / sizeof((rule_list)[0]) }
+
+void tag_field_rules_apply(const struct tag_field_rule_table *table, void *elements, size_t element_count, struct tag_fix_plan *plan);
+bool tag_field_rules_apply_reflexive(
+    const struct tag_field_rule_table *table,
+    struct tag_reflexive *reflexive,
+    size_t *invalid_index,
+    struct tag_data_instance *tag_data,
+    struct tag_fix_plan *plan);
@@ -0,0 +1,142 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "tag_fix_plan.h"
+
+#include "../data_types.h"
+#include "tag.h"
+#include "../thread/thread_output.h"
+
+#define TAG_FIX_PLAN_PRINT_BYTES 16
+
+static void *tag_fix_plan_grow(void *buffer, size_t *capacity, size_t needed, size_t element_size) {
+    if(needed <= *capacity) {
+        return buffer;
+    }
+
+    size_t new_capacity = MAX(*capacity * 2, MAX(needed, 16));
+    buffer = realloc(buffer, new_capacity * element_size);
+    if(!buffer) {
+        abort();
+    }
+
+    *capacity = new_capacity;
+    return buffer;
+}
+
+static struct tag_fix *tag_fix_plan_add(struct tag_fix_plan *plan, void *destination, size_t size, const char *reason) {
+    assert(plan && plan->base && destination && reason);
+    assert((uint8_t *)destination >= plan->base && (size_t)((uint8_t *)destination - plan->base) <= UINT32_MAX);
+    assert(size <= UINT32_MAX);
+
+    plan->fixes = tag_fix_plan_grow(plan->fixes, &plan->fix_capacity, plan->fix_count + 1, sizeof(struct tag_fix));
+    plan->bytes = tag_fix_plan_grow(plan->bytes, &plan->byte_capacity, plan->byte_count + size * 2, sizeof(uint8_t));
+
+    struct tag_fix *fix = &plan->fixes[plan->fix_count++];
+    fix->offset = (uint8_t *)destination - plan->base;
+    fix->size = size;
+    fix->bytes_offset = plan->byte_count;
+    fix->tag = plan->tag;
+    fix->reason = reason;
+
+    memcpy(plan->bytes + fix->bytes_offset, destination, size);
+    plan->byte_count += size * 2;
+    return fix;
+}
+
+void tag_fix_plan_init(struct tag_fix_plan *plan, uint8_t *base, TagID tag) {
+    assert(plan && base);
+    memset(plan, 0, sizeof(struct tag_fix_plan));
+    plan->base = base;
+    plan->tag = tag;
+}
+
+void tag_fix_plan_write(struct tag_fix_plan *plan, void *destination, const void *source, size_t size, const char *reason) {
+    assert(source);
+
+    // Nothing would change
+    if(memcmp(destination, source, size) == 0) {
+        return;
+    }
+
+    struct tag_fix *fix = tag_fix_plan_add(plan, destination, size, reason);
+    memcpy(plan->bytes + fix->bytes_offset + size, source, size);
+}
+
+void tag_fix_plan_zero(struct tag_fix_plan *plan, void *destination, size_t size, const char *reason) {
+    assert(destination);
+
+    // Skip data that is already zeroed
+    const uint8_t *bytes = destination;
+    size_t first = 0;
+    while(first < size && bytes[first] == 0) {
+        first++;
+    }
+    if(first == size) {
+        return;
+    }
+
+    struct tag_fix *fix = tag_fix_plan_add(plan, destination, size, reason);
+    memset(plan->bytes + fix->bytes_offset + size, 0, size);
+}
+
+void tag_fix_plan_merge(struct tag_fix_plan *plan, const struct tag_fix_plan *other) {
+    assert(plan && other && plan->base == other->base);
+
+    plan->fixes = tag_fix_plan_grow(plan->fixes, &plan->fix_capacity, plan->fix_count + other->fix_count, sizeof(struct tag_fix));
+    plan->bytes = tag_fix_plan_grow(plan->bytes, &plan->byte_capacity, plan->byte_count + other->byte_count, sizeof(uint8_t));
+
+    for(size_t f = 0; f < other->fix_count; f++) {
+        struct tag_fix *fix = &plan->fixes[plan->fix_count++];
+        *fix = other->fixes[f];
+        fix->bytes_offset += plan->byte_count;
+    }
+
+    if(other->byte_count > 0) {
+        memcpy(plan->bytes + plan->byte_count, other->bytes, other->byte_count);
+    }
+    plan->byte_count += other->byte_count;
+}
+
+void tag_fix_plan_apply(const struct tag_fix_plan *plan) {
+    assert(plan);
+
+    // Fixes are applied in the order they were planned, so a later fix wins where two overlap
+    for(size_t f = 0; f < plan->fix_count; f++) {
+        const struct tag_fix *fix = &plan->fixes[f];
+        memcpy(plan->base + fix->offset, plan->bytes + fix->bytes_offset + fix->size, fix->size);
+    }
+}
+
+static void tag_fix_plan_print_bytes(const char *label, const uint8_t *bytes, size_t size) {
+    thread_output_print("    %s", label);
+    for(size_t b = 0; b < size && b < TAG_FIX_PLAN_PRINT_BYTES; b++) {
+        thread_output_print(" %02X", bytes[b]);
+    }
+    if(size > TAG_FIX_PLAN_PRINT_BYTES) {
+        thread_output_print(" ... (%zu bytes)", size);
+    }
+    thread_output_print("\n");
+}
+
+void tag_fix_plan_print(const struct tag_fix_plan *plan, struct tag_data_instance *tag_data) {
+    assert(plan && tag_data && tag_data->valid);
+
+    for(size_t f = 0; f < plan->fix_count; f++) {
+        const struct tag_fix *fix = &plan->fixes[f];
+        thread_output_print("0x%08X \"%s.%s\": %s\n",
+            fix->offset, tag_path_get(fix->tag, tag_data), tag_extension_get(fix->tag, tag_data), fix->reason);
+        tag_fix_plan_print_bytes("old:", plan->bytes + fix->bytes_offset, fix->size);
+        tag_fix_plan_print_bytes("new:", plan->bytes + fix->bytes_offset + fix->size, fix->size);
+    }
+}
+
+void tag_fix_plan_free(struct tag_fix_plan *plan) {
+    assert(plan);
+    free(plan->fixes);
+    free(plan->bytes);
+    memset(plan, 0, sizeof(struct tag_fix_plan));
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "../data_types.h"
+#include "tag.h"
+
+// A fix plan is a list of byte patches against a cache file buffer. Fixers only read the cache file and record
+// what they want to change here, so nothing is modified until the plan is applied.
+struct tag_fix {
+    uint32_t offset; // Offset from the plan base (the start of the cache file)
+    uint32_t size;
+    size_t bytes_offset; // Old bytes are at bytes[bytes_offset], new bytes follow right after
+    TagID tag;
+    const char *reason;
+};
+
+struct tag_fix_plan {
+    uint8_t *base;
+    TagID tag; // Tag that new fixes are attributed to
+    struct tag_fix *fixes;
+    size_t fix_count;
+    size_t fix_capacity;
+    uint8_t *bytes;
+    size_t byte_count;
+    size_t byte_capacity;
+};
+
+void tag_fix_plan_init(struct tag_fix_plan *plan, uint8_t *base, TagID tag);
+void tag_fix_plan_write(struct tag_fix_plan *plan, void *destination, const void *source, size_t size, const char *reason);
+void tag_fix_plan_zero(struct tag_fix_plan *plan, void *destination, size_t size, const char *reason);
+void tag_fix_plan_merge(struct tag_fix_plan *plan, const struct tag_fix_plan *other);
+void tag_fix_plan_apply(const struct tag_fix_plan *plan);
+void tag_fix_plan_print(const struct tag_fix_plan *plan, struct tag_data_instance *tag_data);
+void tag_fix_plan_free(struct tag_fix_plan *plan);
+
+// Plan to set a scalar field to a value of the field's own type
+#define TAG_FIX_PLAN_SET(plan, field, value, reason) \
+    tag_fix_plan_write(plan, &(field), &(typeof(field)){ (value) }, sizeof(field), reason)
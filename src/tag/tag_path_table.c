@@ -0,0 +1,416 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "tag_path_table.h"
+
+#include "../data_types.h"
+#include "../cache/cache.h"
+#include "../tag_groups/scenario.h"
+#include "tag.h"
+#include "tag_fix_plan.h"
+#include "tag_fourcc.h"
+#include "tag_schema.h"
+#include "../thread/thread_output.h"
+
+// Something pointing to a path
+struct tag_path_table_site {
+    uint32_t offset; // Cache file offset of the pointer
+    Pointer32 name;
+    TagID tag; // What the fix is attributed to
+};
+
+// A distinct path pointer. Paths that end another one are stored inside it, in its host.
+struct tag_path_table_path {
+    Pointer32 name;
+    const char *path;
+    size_t length; // Not counting the terminator
+    size_t host;
+    size_t host_offset; // Where it starts in its host
+    uint32_t new_offset; // From the start of the table
+};
+
+struct tag_path_table_walk {
+    struct cache_file_instance *cache_file;
+    struct tag_path_table_site *sites;
+    size_t site_count;
+    size_t site_capacity;
+    struct cache_file_range *blocks; // Tag data offsets
+    size_t block_count;
+    size_t block_capacity;
+    Pointer32 *names; // The start of every string in the table, pointed to or not
+    size_t name_count;
+    size_t name_capacity;
+};
+
+static void *tag_path_table_grow(void *buffer, size_t *capacity, size_t needed, size_t element_size) {
+    if(needed <= *capacity) {
+        return buffer;
+    }
+
+    size_t new_capacity = MAX(*capacity * 2, MAX(needed, 1024));
+    buffer = realloc(buffer, new_capacity * element_size);
+    if(!buffer) {
+        abort();
+    }
+
+    *capacity = new_capacity;
+    return buffer;
+}
+
+static void tag_path_table_add_name(struct tag_path_table_walk *walk, Pointer32 name) {
+    walk->names = tag_path_table_grow(walk->names, &walk->name_capacity, walk->name_count + 1, sizeof(Pointer32));
+    walk->names[walk->name_count++] = name;
+}
+
+static void tag_path_table_add_site(struct tag_path_table_walk *walk, const Pointer32 *site, TagID tag) {
+    walk->sites = tag_path_table_grow(walk->sites, &walk->site_capacity, walk->site_count + 1, sizeof(struct tag_path_table_site));
+    walk->sites[walk->site_count++] = (struct tag_path_table_site){ (const uint8_t *)site - walk->cache_file->data, *site, tag };
+}
+
+static void tag_path_table_visit_block(const struct tag_schema_block *block, void *context) {
+    struct tag_path_table_walk *walk = context;
+    struct tag_data_instance *tag_data = &walk->cache_file->tag_data;
+    if(block->space->data != tag_data->data || !block->data || block->size == 0) {
+        return;
+    }
+
+    walk->blocks = tag_path_table_grow(walk->blocks, &walk->block_capacity, walk->block_count + 1, sizeof(struct cache_file_range));
+    uint32_t start = block->data - tag_data->data;
+    walk->blocks[walk->block_count++] = (struct cache_file_range){ start, start + block->size };
+}
+
+static void tag_path_table_visit_field(const struct tag_schema_block *block, const struct tag_schema_field *field, void *value, void *context) {
+    struct tag_path_table_walk *walk = context;
+    struct tag_reference *reference = value;
+    if(field->type == TAG_SCHEMA_FIELD_TYPE_REFERENCE && reference->name != 0 && tag_path_resolve(reference->name, &walk->cache_file->tag_data)) {
+        tag_path_table_add_site(walk, &reference->name, block->tag);
+    }
+}
+
+static int tag_path_table_compare_sites(const void *a, const void *b) {
+    const struct tag_path_table_site *site_a = a;
+    const struct tag_path_table_site *site_b = b;
+    if(site_a->name != site_b->name) {
+        return site_a->name > site_b->name ? 1 : -1;
+    }
+    return (site_a->offset > site_b->offset) - (site_a->offset < site_b->offset);
+}
+
+static int tag_path_table_compare_offsets(const void *a, const void *b) {
+    uint32_t offset_a = *(const uint32_t *)a;
+    uint32_t offset_b = *(const uint32_t *)b;
+    return (offset_a > offset_b) - (offset_a < offset_b);
+}
+
+static int tag_path_table_compare_indices(const void *a, const void *b) {
+    size_t index_a = *(const size_t *)a;
+    size_t index_b = *(const size_t *)b;
+    return (index_a > index_b) - (index_a < index_b);
+}
+
+static int tag_path_table_compare_names(const void *a, const void *b) {
+    Pointer32 name_a = *(const Pointer32 *)a;
+    Pointer32 name_b = ((const struct tag_path_table_path *)b)->name;
+    return (name_a > name_b) - (name_a < name_b);
+}
+
+// Compares paths from their last character, so a path comes right before the ones it is the end of
+static thread_local const struct tag_path_table_path *tag_path_table_sort_paths;
+
+static int tag_path_table_compare_reversed(const void *a, const void *b) {
+    const struct tag_path_table_path *path_a = &tag_path_table_sort_paths[*(const size_t *)a];
+    const struct tag_path_table_path *path_b = &tag_path_table_sort_paths[*(const size_t *)b];
+    size_t length_a = path_a->length;
+    size_t length_b = path_b->length;
+    while(length_a > 0 && length_b > 0) {
+        uint8_t character_a = path_a->path[--length_a];
+        uint8_t character_b = path_b->path[--length_b];
+        if(character_a != character_b) {
+            return character_a > character_b ? 1 : -1;
+        }
+    }
+    if(length_a != length_b) {
+        return length_a > length_b ? 1 : -1;
+    }
+    return (path_a->name > path_b->name) - (path_a->name < path_b->name);
+}
+
+static bool tag_path_table_ends_with(const struct tag_path_table_path *path, const struct tag_path_table_path *end) {
+    return end->length <= path->length && memcmp(path->path + path->length - end->length, end->path, end->length) == 0;
+}
+
+// A tag_reference the schema does not know about has the path pointer of the tag its ID is for, and one of its groups
+static bool tag_path_table_is_reference(const uint8_t *name_data, Pointer32 name, struct tag_data_instance *tag_data) {
+    struct tag_reference reference;
+    memcpy(&reference, name_data - offsetof(struct tag_reference, name), sizeof(reference));
+    if(!tag_id_is_valid_tag(reference.index, tag_data)) {
+        return false;
+    }
+
+    struct tag_instance *tag = &tag_data->tags[reference.index.index];
+    bool group_matches = reference.tag_group == tag->primary_group ||
+        reference.tag_group == tag->secondary_group ||
+        reference.tag_group == tag->tertiary_group;
+    return group_matches && tag->name_address == name;
+}
+
+// What is left of a tag_reference to a tag that is no longer in the map, like the ones in the data of pruned tags. It
+// still has a group and the length of the path, but its ID is not one of a tag anymore.
+static bool tag_path_table_is_stale_reference(const uint8_t *name_data, Pointer32 name, struct tag_data_instance *tag_data) {
+    struct tag_reference reference;
+    memcpy(&reference, name_data - offsetof(struct tag_reference, name), sizeof(reference));
+    const char *path = tag_path_resolve(name, tag_data);
+    return reference.index.whole_id != NULL_ID &&
+        !tag_id_is_valid_tag(reference.index, tag_data) &&
+        tag_fourcc_is_valid_tag(reference.tag_group) &&
+        path && reference.name_length == strlen(path);
+}
+
+// Looks at every offset in the range for a pointer to the start of a string in the table. Ones to a path that are not
+// known are added as sites if they are in a tag_reference, and ones to a string nothing else points to are left alone if
+// they are in a stale one. Returns false if anything else points to one.
+static bool tag_path_table_scan(
+    struct tag_path_table_walk *walk,
+    const uint32_t *known_sites,
+    size_t known_site_count,
+    const struct tag_path_table_path *paths,
+    size_t path_count,
+    uint32_t start,
+    uint32_t end) {
+
+    struct cache_file_instance *cache_file = walk->cache_file;
+    struct tag_data_instance *tag_data = &cache_file->tag_data;
+    Pointer32 lowest = walk->names[0];
+    Pointer32 highest = walk->names[walk->name_count - 1];
+    uint32_t reference_start = start + offsetof(struct tag_reference, name);
+    for(uint32_t offset = start; offset + sizeof(Pointer32) <= end; offset++) {
+        Pointer32 name;
+        memcpy(&name, cache_file->data + offset, sizeof(name));
+        if(name < lowest || name > highest || !bsearch(&name, walk->names, walk->name_count, sizeof(Pointer32), tag_path_table_compare_offsets)) {
+            continue;
+        }
+        if(bsearch(&offset, known_sites, known_site_count, sizeof(uint32_t), tag_path_table_compare_offsets)) {
+            continue;
+        }
+
+        const uint8_t *name_data = cache_file->data + offset;
+        bool fits = offset >= reference_start && offset - offsetof(struct tag_reference, name) + sizeof(struct tag_reference) <= end;
+        bool is_path = bsearch(&name, paths, path_count, sizeof(struct tag_path_table_path), tag_path_table_compare_names) != nullptr;
+        if(fits && !is_path && tag_path_table_is_stale_reference(name_data, name, tag_data)) {
+            continue;
+        }
+        if(!fits || !is_path || !tag_path_table_is_reference(name_data, name, tag_data)) {
+            return false;
+        }
+        TagID id;
+        memcpy(&id, name_data - offsetof(struct tag_reference, name) + offsetof(struct tag_reference, index), sizeof(id));
+        walk->sites = tag_path_table_grow(walk->sites, &walk->site_capacity, walk->site_count + 1, sizeof(struct tag_path_table_site));
+        walk->sites[walk->site_count++] = (struct tag_path_table_site){ offset, name, id };
+    }
+
+    return true;
+}
+
+// Everything else pointing to a path, in the tag data outside of the table and in the BSPs
+static bool tag_path_table_find_other_sites(struct tag_path_table_walk *walk, const struct tag_path_table_path *paths, size_t path_count, uint32_t table_start, uint32_t table_end) {
+    struct cache_file_instance *cache_file = walk->cache_file;
+    struct tag_data_instance *tag_data = &cache_file->tag_data;
+    uint32_t *known_sites = calloc(MAX(walk->site_count, 1), sizeof(uint32_t));
+    if(!known_sites) {
+        abort();
+    }
+    size_t known_site_count = walk->site_count;
+    for(size_t s = 0; s < known_site_count; s++) {
+        known_sites[s] = walk->sites[s].offset;
+    }
+    qsort(known_sites, known_site_count, sizeof(uint32_t), tag_path_table_compare_offsets);
+
+    uint32_t tags_offset = cache_file->header->tags_offset;
+    bool success = tag_path_table_scan(walk, known_sites, known_site_count, paths, path_count, tags_offset, tags_offset + table_start) &&
+        tag_path_table_scan(walk, known_sites, known_site_count, paths, path_count, tags_offset + table_end, tags_offset + tag_data->size);
+
+    struct scenario *scenario = tag_get(tag_data->header->scenario_tag, TAG_FOURCC_SCENARIO, tag_data);
+    for(size_t i = 0; success && scenario && i < scenario->structure_bsp_references.count; i++) {
+        struct scenario_structure_bsp_reference *bsp_reference = scenario_get_bsp_reference(scenario, i, tag_data);
+        if(!bsp_reference || bsp_reference->offset > cache_file->size || bsp_reference->size > cache_file->size - bsp_reference->offset) {
+            success = false;
+            break;
+        }
+        success = tag_path_table_scan(walk, known_sites, known_site_count, paths, path_count, bsp_reference->offset, bsp_reference->offset + bsp_reference->size);
+    }
+
+    free(known_sites);
+    return success && scenario;
+}
+
+// The table has to be nothing but strings and zeroes, with no known block in it. Strings nothing points to, like the
+// paths of pruned tags, are fine as long as nothing else turns out to point to them either, so their starts are added
+// to the names along with the paths.
+static bool tag_path_table_is_alone(struct tag_path_table_walk *walk, const struct tag_path_table_path *paths, size_t path_count, uint32_t table_start, uint32_t table_end) {
+    struct tag_data_instance *instance = &walk->cache_file->tag_data;
+    const uint8_t *tag_data = instance->data;
+    for(size_t b = 0; b < walk->block_count; b++) {
+        if(walk->blocks[b].start < table_end && walk->blocks[b].end > table_start) {
+            return false;
+        }
+    }
+
+    // Paths are sorted by address
+    uint32_t position = table_start;
+    for(size_t p = 0; p < path_count; p++) {
+        uint32_t start = (const uint8_t *)paths[p].path - tag_data;
+        for(; position < start; position++) {
+            uint8_t character = tag_data[position];
+            if(character == 0) {
+                continue;
+            }
+            if(character < 0x20 || character == 0x7F) {
+                return false;
+            }
+            if(tag_data[position - 1] == 0) {
+                tag_path_table_add_name(walk, instance->data_load_address + position);
+            }
+        }
+        position = MAX(position, start + paths[p].length + 1);
+        tag_path_table_add_name(walk, paths[p].name);
+    }
+    return true;
+}
+
+void tag_path_table_plan(struct cache_file_instance *cache_file, struct tag_fix_plan *plan, struct tag_path_table_result *result) {
+    assert(cache_file && cache_file->valid && plan && plan->base == cache_file->data && result);
+    struct tag_data_instance *tag_data = &cache_file->tag_data;
+    memset(result, 0, sizeof(struct tag_path_table_result));
+
+    struct tag_path_table_walk walk = {
+        .cache_file = cache_file
+    };
+    for(size_t t = 0; t < tag_data->header->tag_count; t++) {
+        struct tag_instance *tag = &tag_data->tags[t];
+        if(tag_path_resolve(tag->name_address, tag_data)) {
+            tag_path_table_add_site(&walk, &tag->name_address, tag->tag_id);
+        }
+    }
+    struct tag_schema_visitor visitor = {
+        .block = tag_path_table_visit_block,
+        .field = tag_path_table_visit_field,
+        .context = &walk
+    };
+    tag_schema_walk(&visitor, cache_file);
+
+    // Distinct pointers, sorted by address
+    qsort(walk.sites, walk.site_count, sizeof(struct tag_path_table_site), tag_path_table_compare_sites);
+    struct tag_path_table_path *paths = calloc(MAX(walk.site_count, 1), sizeof(struct tag_path_table_path));
+    if(!paths) {
+        abort();
+    }
+    size_t path_count = 0;
+    uint32_t table_start = UINT32_MAX;
+    uint32_t table_end = 0;
+    for(size_t s = 0; s < walk.site_count; s++) {
+        if(path_count > 0 && paths[path_count - 1].name == walk.sites[s].name) {
+            continue;
+        }
+        const char *path = tag_path_resolve(walk.sites[s].name, tag_data);
+        struct tag_path_table_path *entry = &paths[path_count++];
+        *entry = (struct tag_path_table_path){ .name = walk.sites[s].name, .path = path, .length = strlen(path) };
+        uint32_t start = (const uint8_t *)path - tag_data->data;
+        table_start = MIN(table_start, start);
+        table_end = MAX(table_end, start + entry->length + 1);
+    }
+
+    size_t *order = calloc(MAX(path_count, 1), sizeof(size_t));
+    size_t *hosts = calloc(MAX(path_count, 1), sizeof(size_t));
+    uint8_t *table = nullptr;
+    if(!order || !hosts) {
+        abort();
+    }
+    if(path_count == 0) {
+        goto cleanup;
+    }
+    if(!tag_path_table_is_alone(&walk, paths, path_count, table_start, table_end)) {
+        thread_output_print("tag paths are not in one table, so they were not packed\n");
+        goto cleanup;
+    }
+    qsort(walk.names, walk.name_count, sizeof(Pointer32), tag_path_table_compare_offsets);
+    if(!tag_path_table_find_other_sites(&walk, paths, path_count, table_start, table_end)) {
+        thread_output_print("something unknown points to a tag path, so they were not packed\n");
+        goto cleanup;
+    }
+
+    // Going backwards, a path is the end of the one after it if it is the end of anything
+    for(size_t p = 0; p < path_count; p++) {
+        order[p] = p;
+    }
+    tag_path_table_sort_paths = paths;
+    qsort(order, path_count, sizeof(size_t), tag_path_table_compare_reversed);
+    tag_path_table_sort_paths = nullptr;
+    size_t host_count = 0;
+    for(size_t o = path_count; o-- > 0;) {
+        struct tag_path_table_path *path = &paths[order[o]];
+        const struct tag_path_table_path *next = o + 1 < path_count ? &paths[order[o + 1]] : nullptr;
+        if(next && tag_path_table_ends_with(next, path)) {
+            path->host = next->host;
+            path->host_offset = next->host_offset + next->length - path->length;
+        }
+        else {
+            path->host = order[o];
+            path->host_offset = 0;
+            hosts[host_count++] = order[o];
+        }
+    }
+
+    // Hosts keep the order they were in, since paths are sorted by address
+    qsort(hosts, host_count, sizeof(size_t), tag_path_table_compare_indices);
+    uint32_t old_size = table_end - table_start;
+    table = calloc(old_size, 1);
+    if(!table) {
+        abort();
+    }
+    uint32_t new_size = 0;
+    for(size_t h = 0; h < host_count; h++) {
+        struct tag_path_table_path *host = &paths[hosts[h]];
+        memcpy(table + new_size, host->path, host->length + 1);
+        host->new_offset = new_size;
+        new_size += host->length + 1;
+    }
+    for(size_t p = 0; p < path_count; p++) {
+        paths[p].new_offset = paths[paths[p].host].new_offset + paths[p].host_offset;
+    }
+
+    result->pointer_count = walk.site_count;
+    result->path_count = path_count;
+    result->packed_count = host_count;
+    result->old_size = old_size;
+    result->new_size = old_size;
+    if(new_size >= old_size) {
+        goto cleanup;
+    }
+    result->new_size = new_size;
+
+    TagID plan_tag = plan->tag;
+    tag_fix_plan_write(plan, tag_data->data + table_start, table, old_size, "tag paths were packed");
+    for(size_t s = 0; s < walk.site_count; s++) {
+        const struct tag_path_table_site *site = &walk.sites[s];
+        const struct tag_path_table_path *path = bsearch(&site->name, paths, path_count, sizeof(struct tag_path_table_path), tag_path_table_compare_names);
+        assert(path);
+        Pointer32 new_name = tag_data->data_load_address + table_start + path->new_offset;
+        if(new_name != site->name) {
+            plan->tag = site->tag;
+            tag_fix_plan_write(plan, cache_file->data + site->offset, &new_name, sizeof(Pointer32), "tag path was moved into the packed table");
+        }
+    }
+    plan->tag = plan_tag;
+
+    cleanup:
+    free(table);
+    free(hosts);
+    free(order);
+    free(paths);
+    free(walk.sites);
+    free(walk.blocks);
+    free(walk.names);
+}
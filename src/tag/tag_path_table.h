@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "../cache/cache.h"
+#include "tag_fix_plan.h"
+
+// Tag paths are NUL terminated strings in the tag data, pointed to by the name_address of every tag and the name of
+// every tag_reference. tool.exe writes them one after another, but tags of different groups can have the same path and
+// a path can be the end of a longer one, so they can share bytes.
+//
+// Packing rewrites the table in place with each distinct path stored once, and paths that end another one pointing into
+// it, then points everything at the new table. The rest of the old table is zeroed and left for compaction to reclaim.
+// Pointers to paths in tag_references the schema does not know about are found the same way the reference graph finds
+// their IDs. Strings between the paths that no tag uses, like the paths of pruned tags, are zeroed along with the rest of
+// the old table, as long as only stale tag_references to tags that are gone point at them. If anything else points at a
+// string in the table, or the paths are not all together, they are left alone.
+struct tag_path_table_result {
+    size_t pointer_count;
+    size_t path_count; // Paths stored in the table before
+    size_t packed_count; // And after
+    uint32_t old_size;
+    uint32_t new_size;
+};
+
+void tag_path_table_plan(struct cache_file_instance *cache_file, struct tag_fix_plan *plan, struct tag_path_table_result *result);
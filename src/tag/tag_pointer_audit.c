@@ -0,0 +1,250 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <assert.h>
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define TAG_POINTER_AUDIT_SIMD
+#include <immintrin.h>
+#endif
+
+#include "tag_pointer_audit.h"
+
+#include "../data_types.h"
+#include "../cache/cache.h"
+#include "tag.h"
+#include "tag_fix_plan.h"
+#include "tag_fourcc.h"
+#include "tag_schema.h"
+#include "../thread/thread_output.h"
+
+// Pointers are gathered into flat arrays so the bounds check runs over the whole map at once. Each pointer has its
+// own bounds since BSPs are loaded somewhere else than the tag data. Runtime pointers have empty bounds.
+struct tag_pointer_audit_entry {
+    void *value; // The tag_reference, tag_data, tag_reflexive or Pointer32
+    Pointer32 *pointer;
+    const struct tag_schema_field *field;
+    TagID tag;
+};
+
+struct tag_pointer_audit {
+    struct tag_data_instance *tag_data;
+    bool runtime_pointers_are_stale; // Xbox vertex buffers are in the map and the game uses these as they are
+    struct tag_pointer_audit_entry *entries;
+    uint32_t *addresses;
+    uint32_t *bases;
+    uint32_t *sizes;
+    size_t count;
+    size_t capacity;
+};
+
+static void tag_pointer_audit_add(struct tag_pointer_audit *audit, const struct tag_pointer_audit_entry *entry, uint32_t base, uint32_t size) {
+    if(audit->count == audit->capacity) {
+        audit->capacity = MAX(audit->capacity * 2, 1024);
+        audit->entries = realloc(audit->entries, audit->capacity * sizeof(struct tag_pointer_audit_entry));
+        audit->addresses = realloc(audit->addresses, audit->capacity * sizeof(uint32_t));
+        audit->bases = realloc(audit->bases, audit->capacity * sizeof(uint32_t));
+        audit->sizes = realloc(audit->sizes, audit->capacity * sizeof(uint32_t));
+        if(!audit->entries || !audit->addresses || !audit->bases || !audit->sizes) {
+            abort();
+        }
+    }
+
+    audit->entries[audit->count] = *entry;
+    audit->addresses[audit->count] = *entry->pointer;
+    audit->bases[audit->count] = base;
+    audit->sizes[audit->count] = size;
+    audit->count++;
+}
+
+static void tag_pointer_audit_field(const struct tag_schema_block *block, const struct tag_schema_field *field, void *value, void *context) {
+    struct tag_pointer_audit *audit = context;
+    struct tag_data_instance *tag_data = audit->tag_data;
+
+    // Indexed sounds only have their base struct in the map. What it points to is in sounds.map.
+    if(block->type == TAG_SCHEMA_BLOCK_TYPE_BASE_STRUCT && block->tag_group == TAG_FOURCC_SOUND && tag_is_external(block->tag, tag_data)) {
+        return;
+    }
+
+    struct tag_pointer_audit_entry entry = {
+        .value = value,
+        .field = field,
+        .tag = block->tag
+    };
+    uint32_t base = block->space->load_address;
+    uint32_t size = block->space->size;
+    switch(field->type) {
+        case TAG_SCHEMA_FIELD_TYPE_REFERENCE:
+            // Tag paths are always in the tag data, even for references in a BSP
+            entry.pointer = &((struct tag_reference *)value)->name;
+            base = tag_data->data_load_address;
+            size = tag_data->size;
+            break;
+        case TAG_SCHEMA_FIELD_TYPE_DATA:
+            entry.pointer = &((struct tag_data *)value)->address;
+            break;
+        case TAG_SCHEMA_FIELD_TYPE_REFLEXIVE:
+            entry.pointer = &((struct tag_reflexive *)value)->address;
+            break;
+        case TAG_SCHEMA_FIELD_TYPE_RUNTIME_POINTER:
+            if(!audit->runtime_pointers_are_stale) {
+                return;
+            }
+            entry.pointer = value;
+            base = 0;
+            size = 0;
+            break;
+        default:
+            return;
+    }
+
+    tag_pointer_audit_add(audit, &entry, base, size);
+}
+
+// A pointer is bad if it is set and address - base >= size
+static size_t tag_pointer_audit_scan_scalar(const struct tag_pointer_audit *audit, size_t first, uint32_t *bad) {
+    size_t bad_count = 0;
+    for(size_t p = first; p < audit->count; p++) {
+        if(audit->addresses[p] != 0 && audit->addresses[p] - audit->bases[p] >= audit->sizes[p]) {
+            bad[bad_count++] = p;
+        }
+    }
+    return bad_count;
+}
+
+#ifdef TAG_POINTER_AUDIT_SIMD
+// There is no unsigned compare, so flip the sign bits and compare signed
+__attribute__((target("sse2")))
+static size_t tag_pointer_audit_scan_sse2(const struct tag_pointer_audit *audit, uint32_t *bad) {
+    const __m128i sign = _mm_set1_epi32(INT32_MIN);
+    const __m128i zero = _mm_setzero_si128();
+    size_t bad_count = 0;
+    size_t p = 0;
+    for(; p + 4 <= audit->count; p += 4) {
+        __m128i address = _mm_loadu_si128((const __m128i *)(audit->addresses + p));
+        __m128i offset = _mm_sub_epi32(address, _mm_loadu_si128((const __m128i *)(audit->bases + p)));
+        __m128i size = _mm_loadu_si128((const __m128i *)(audit->sizes + p));
+        __m128i in_bounds = _mm_cmplt_epi32(_mm_xor_si128(offset, sign), _mm_xor_si128(size, sign));
+        __m128i good = _mm_or_si128(in_bounds, _mm_cmpeq_epi32(address, zero));
+        unsigned mask = ~_mm_movemask_ps(_mm_castsi128_ps(good)) & 0xF;
+        while(mask) {
+            bad[bad_count++] = p + __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+    }
+
+    return bad_count + tag_pointer_audit_scan_scalar(audit, p, bad + bad_count);
+}
+
+__attribute__((target("avx2")))
+static size_t tag_pointer_audit_scan_avx2(const struct tag_pointer_audit *audit, uint32_t *bad) {
+    const __m256i sign = _mm256_set1_epi32(INT32_MIN);
+    const __m256i zero = _mm256_setzero_si256();
+    size_t bad_count = 0;
+    size_t p = 0;
+    for(; p + 8 <= audit->count; p += 8) {
+        __m256i address = _mm256_loadu_si256((const __m256i *)(audit->addresses + p));
+        __m256i offset = _mm256_sub_epi32(address, _mm256_loadu_si256((const __m256i *)(audit->bases + p)));
+        __m256i size = _mm256_loadu_si256((const __m256i *)(audit->sizes + p));
+        __m256i in_bounds = _mm256_cmpgt_epi32(_mm256_xor_si256(size, sign), _mm256_xor_si256(offset, sign));
+        __m256i good = _mm256_or_si256(in_bounds, _mm256_cmpeq_epi32(address, zero));
+        unsigned mask = ~_mm256_movemask_ps(_mm256_castsi256_ps(good)) & 0xFF;
+        while(mask) {
+            bad[bad_count++] = p + __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+    }
+
+    return bad_count + tag_pointer_audit_scan_scalar(audit, p, bad + bad_count);
+}
+#endif
+
+static size_t tag_pointer_audit_scan(const struct tag_pointer_audit *audit, uint32_t *bad) {
+    #ifdef TAG_POINTER_AUDIT_SIMD
+    if(__builtin_cpu_supports("avx2")) {
+        return tag_pointer_audit_scan_avx2(audit, bad);
+    }
+    if(__builtin_cpu_supports("sse2")) {
+        return tag_pointer_audit_scan_sse2(audit, bad);
+    }
+    #endif
+
+    return tag_pointer_audit_scan_scalar(audit, 0, bad);
+}
+
+// Returns true if the pointer is stale
+static bool tag_pointer_audit_check(const struct tag_pointer_audit_entry *entry, struct tag_data_instance *tag_data, struct tag_fix_plan *plan) {
+    const char *reason = nullptr;
+    switch(entry->field->type) {
+        case TAG_SCHEMA_FIELD_TYPE_DATA:
+            if(((struct tag_data *)entry->value)->size == 0) {
+                reason = "stale data pointer";
+            }
+            break;
+        case TAG_SCHEMA_FIELD_TYPE_REFLEXIVE:
+            if(((struct tag_reflexive *)entry->value)->count == 0) {
+                reason = "stale reflexive pointer";
+            }
+            break;
+        case TAG_SCHEMA_FIELD_TYPE_RUNTIME_POINTER:
+            reason = "stale runtime pointer";
+            break;
+        default:
+            break;
+    }
+
+    if(!reason) {
+        thread_output_error("%s in \"%s.%s\" points out of bounds (%#x)\n",
+            entry->field->name, tag_path_get(entry->tag, tag_data), tag_extension_get(entry->tag, tag_data), *entry->pointer);
+        return false;
+    }
+
+    if(plan) {
+        plan->tag = entry->tag;
+        tag_fix_plan_zero(plan, entry->pointer, sizeof(Pointer32), reason);
+    }
+    return true;
+}
+
+bool tag_pointer_audit(struct cache_file_instance *cache_file, struct tag_fix_plan *plan) {
+    assert(cache_file && cache_file->valid);
+    struct tag_pointer_audit audit = {
+        .tag_data = &cache_file->tag_data,
+        .runtime_pointers_are_stale = cache_file_has_model_data(cache_file)
+    };
+    struct tag_schema_visitor visitor = {
+        .field = tag_pointer_audit_field,
+        .context = &audit
+    };
+
+    // Keeps going past blocks that can not be walked into so everything else is still checked
+    bool success = tag_schema_walk(&visitor, cache_file);
+    if(!success) {
+        thread_output_error("some tag data could not be walked to check its pointers\n");
+    }
+
+    uint32_t *bad = calloc(MAX(audit.count, 1), sizeof(uint32_t));
+    if(!bad) {
+        abort();
+    }
+
+    size_t bad_count = tag_pointer_audit_scan(&audit, bad);
+    size_t stale_count = 0;
+    TagID plan_tag = plan ? plan->tag : (TagID){ .whole_id = NULL_ID };
+    for(size_t b = 0; b < bad_count; b++) {
+        stale_count += tag_pointer_audit_check(&audit.entries[bad[b]], &cache_file->tag_data, plan);
+    }
+    if(plan) {
+        plan->tag = plan_tag;
+    }
+    else if(stale_count > 0) {
+        thread_output_print("%zu stale pointer%s not zeroed\n", stale_count, stale_count == 1 ? "" : "s");
+    }
+
+    free(bad);
+    free(audit.entries);
+    free(audit.addresses);
+    free(audit.bases);
+    free(audit.sizes);
+    return success;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include "../cache/cache.h"
+#include "tag_fix_plan.h"
+
+// Checks every pointer the tag schema knows about against the data it has to point into. Pointers to nothing (empty
+// reflexives and data) and runtime pointers left from a previous load are stale. These are planned to be zeroed if a
+// plan is given, or else counted. Runtime pointers are left alone on Xbox, where the game uses them as they are.
+// Anything else out of bounds is reported. Fails if any tag data could not be walked.
+bool tag_pointer_audit(struct cache_file_instance *cache_file, struct tag_fix_plan *plan);
@@ -1,31 +1,26 @@
 #include <stdint.h>
+#include <string.h>
 #include <math.h>
-#include <assert.h>
 
 #include "../data_types.h"
 
-static inline void byteswap16(void *value) {
-    assert(value);
-    *(uint16_t *)value = __builtin_bswap16(*(uint16_t *)value);
-}
-
-static inline void byteswap32(void *value) {
-    assert(value);
-    *(uint32_t *)value = __builtin_bswap32(*(uint32_t *)value);
-}
+// These return the fixed value rather than fixing the field in place so the result can go into a fix plan
 
-void tag_process_enum16(uint16_t *field, uint16_t option_count, uint16_t option_default) {
-    assert(field);
-    byteswap16(field);
-    if(*field >= option_count) {
-        *field = option_default;
+uint16_t tag_process_enum16(uint16_t value, uint16_t option_count, uint16_t option_default) {
+    value = __builtin_bswap16(value);
+    if(value >= option_count) {
+        value = option_default;
     }
+    return value;
 }
 
-void tag_process_float(float *field) {
-    assert(field);
-    byteswap32(field);
-    if(!isfinite(*field)) {
-        *field = 0.0f;
+float tag_process_float(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    bits = __builtin_bswap32(bits);
+    memcpy(&value, &bits, sizeof(value));
+    if(!isfinite(value)) {
+        value = 0.0f;
     }
+    return value;
 }
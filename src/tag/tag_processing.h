@@ -2,5 +2,5 @@
 
 #include <stdint.h>
 
-void tag_process_enum16(uint16_t *field, uint16_t option_count, uint16_t option_default);
-void tag_process_float(float *field);
+uint16_t tag_process_enum16(uint16_t value, uint16_t option_count, uint16_t option_default);
+float tag_process_float(float value);
@@ -0,0 +1,432 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "tag_reference_graph.h"
+
+#include "../data_types.h"
+#include "../cache/cache.h"
+#include "../tag_groups/scenario.h"
+#include "tag.h"
+#include "tag_fix_plan.h"
+#include "tag_fourcc.h"
+#include "tag_schema.h"
+#include "../thread/thread_output.h"
+
+struct tag_reference_graph_edge {
+    uint32_t from;
+    uint16_t to;
+};
+
+// Where a known block is in the cache file and which tag it belongs to
+struct tag_reference_graph_block {
+    uint32_t start;
+    uint32_t end;
+    uint32_t owner;
+};
+
+struct tag_reference_graph_builder {
+    struct cache_file_instance *cache_file;
+    size_t tag_count;
+    struct tag_reference_graph_edge *edges;
+    size_t edge_count;
+    size_t edge_capacity;
+    struct tag_reference_graph_block *blocks;
+    size_t block_count;
+    size_t block_capacity;
+    uint32_t *sites;
+    size_t site_count;
+    size_t site_capacity;
+    size_t sorted_site_count;
+    bool *pinned;
+};
+
+static void *tag_reference_graph_grow(void *buffer, size_t *capacity, size_t needed, size_t element_size) {
+    if(needed <= *capacity) {
+        return buffer;
+    }
+
+    size_t new_capacity = MAX(*capacity * 2, MAX(needed, 1024));
+    buffer = realloc(buffer, new_capacity * element_size);
+    if(!buffer) {
+        abort();
+    }
+
+    *capacity = new_capacity;
+    return buffer;
+}
+
+static void tag_reference_graph_add_edge(struct tag_reference_graph_builder *builder, uint32_t from, uint16_t to) {
+    builder->edges = tag_reference_graph_grow(builder->edges, &builder->edge_capacity, builder->edge_count + 1, sizeof(struct tag_reference_graph_edge));
+    builder->edges[builder->edge_count++] = (struct tag_reference_graph_edge){ from, to };
+}
+
+static void tag_reference_graph_add_site(struct tag_reference_graph_builder *builder, const void *site) {
+    builder->sites = tag_reference_graph_grow(builder->sites, &builder->site_capacity, builder->site_count + 1, sizeof(uint32_t));
+    builder->sites[builder->site_count++] = (const uint8_t *)site - builder->cache_file->data;
+}
+
+static bool tag_reference_graph_is_tag(TagID id, struct tag_data_instance *tag_data) {
+    return id.index < tag_data->header->tag_count && tag_data->tags[id.index].tag_id.whole_id == id.whole_id;
+}
+
+static void tag_reference_graph_visit_block(const struct tag_schema_block *block, void *context) {
+    struct tag_reference_graph_builder *builder = context;
+    if(!block->data || block->size == 0) {
+        return;
+    }
+
+    builder->blocks = tag_reference_graph_grow(builder->blocks, &builder->block_capacity, builder->block_count + 1, sizeof(struct tag_reference_graph_block));
+    uint32_t start = block->data - builder->cache_file->data;
+    builder->blocks[builder->block_count++] = (struct tag_reference_graph_block){ start, start + block->size, block->tag.index };
+}
+
+static void tag_reference_graph_visit_field(const struct tag_schema_block *block, const struct tag_schema_field *field, void *value, void *context) {
+    struct tag_reference_graph_builder *builder = context;
+    TagID *id;
+    switch(field->type) {
+        case TAG_SCHEMA_FIELD_TYPE_REFERENCE:
+            id = &((struct tag_reference *)value)->index;
+            break;
+        case TAG_SCHEMA_FIELD_TYPE_TAG_ID:
+            id = value;
+            break;
+        default:
+            return;
+    }
+
+    if(tag_reference_graph_is_tag(*id, &builder->cache_file->tag_data)) {
+        tag_reference_graph_add_site(builder, id);
+        tag_reference_graph_add_edge(builder, block->tag.index, id->index);
+    }
+}
+
+static int tag_reference_graph_compare_sites(const void *a, const void *b) {
+    uint32_t site_a = *(const uint32_t *)a;
+    uint32_t site_b = *(const uint32_t *)b;
+    return (site_a > site_b) - (site_a < site_b);
+}
+
+static int tag_reference_graph_compare_blocks(const void *a, const void *b) {
+    const struct tag_reference_graph_block *block_a = a;
+    const struct tag_reference_graph_block *block_b = b;
+    return (block_a->start > block_b->start) - (block_a->start < block_b->start);
+}
+
+// The last block starting at or before offset, if it covers offset..offset+4
+static uint32_t tag_reference_graph_owner(const struct tag_reference_graph_builder *builder, size_t offset, uint32_t default_owner) {
+    size_t low = 0;
+    size_t high = builder->block_count;
+    while(low < high) {
+        size_t middle = low + (high - low) / 2;
+        if(builder->blocks[middle].start <= offset) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+
+    if(low == 0 || offset + sizeof(TagID) > builder->blocks[low - 1].end) {
+        return default_owner;
+    }
+    return builder->blocks[low - 1].owner;
+}
+
+// A tag_reference to the tag has the tag's own path pointer and one of its groups right before the ID
+static bool tag_reference_graph_is_reference(const uint8_t *id_data, struct tag_instance *tag) {
+    struct tag_reference reference;
+    memcpy(&reference, id_data - offsetof(struct tag_reference, index), sizeof(reference));
+    bool group_matches = reference.tag_group == tag->primary_group ||
+        reference.tag_group == tag->secondary_group ||
+        reference.tag_group == tag->tertiary_group;
+    return group_matches && reference.name == tag->name_address;
+}
+
+// Look at every offset for anything that could be a tag ID. Known reference fields were already counted.
+static void tag_reference_graph_scan(struct tag_reference_graph_builder *builder, size_t start, size_t end, uint32_t default_owner) {
+    struct tag_data_instance *tag_data = &builder->cache_file->tag_data;
+    const uint8_t *data = builder->cache_file->data;
+    for(size_t offset = start; offset + sizeof(TagID) <= end; offset++) {
+        TagID id;
+        memcpy(&id, data + offset, sizeof(id));
+        if(!tag_reference_graph_is_tag(id, tag_data)) {
+            continue;
+        }
+
+        uint32_t site = offset;
+        if(bsearch(&site, builder->sites, builder->sorted_site_count, sizeof(uint32_t), tag_reference_graph_compare_sites)) {
+            continue;
+        }
+
+        tag_reference_graph_add_edge(builder, tag_reference_graph_owner(builder, offset, default_owner), id.index);
+        if(offset >= start + offsetof(struct tag_reference, index) &&
+            tag_reference_graph_is_reference(data + offset, &tag_data->tags[id.index])) {
+            tag_reference_graph_add_site(builder, data + offset);
+        }
+        else {
+            builder->pinned[id.index] = true;
+        }
+    }
+}
+
+static bool tag_reference_graph_scan_structure_bsps(struct tag_reference_graph_builder *builder) {
+    struct cache_file_instance *cache_file = builder->cache_file;
+    struct tag_data_instance *tag_data = &cache_file->tag_data;
+    auto scenario_id = tag_data->header->scenario_tag;
+    struct scenario *scenario = tag_get(scenario_id, TAG_FOURCC_SCENARIO, tag_data);
+    if(!scenario) {
+        thread_output_error("scenario tag is missing or invalid\n");
+        return false;
+    }
+
+    for(size_t i = 0; i < scenario->structure_bsp_references.count; i++) {
+        struct scenario_structure_bsp_reference *bsp_reference = scenario_get_bsp_reference(scenario, i, tag_data);
+        if(!bsp_reference) {
+            thread_output_error("BSP reference %zu in \"%s.%s\" is out of bounds\n",
+                i, tag_path_get(scenario_id, tag_data), tag_fourcc_to_extension(TAG_FOURCC_SCENARIO));
+            return false;
+        }
+
+        auto bsp_id = bsp_reference->structure_bsp.index;
+        if(bsp_reference->offset > cache_file->size || bsp_reference->size > cache_file->size - bsp_reference->offset) {
+            thread_output_error("cache data for \"%s.%s\" is out of bounds\n",
+                tag_path_get(bsp_id, tag_data), tag_fourcc_to_extension(TAG_FOURCC_SCENARIO_STRUCTURE_BSP));
+            return false;
+        }
+
+        // Anything in a BSP's data that is not in a known block is still the BSP's
+        uint32_t owner = tag_reference_graph_is_tag(bsp_id, tag_data) ? bsp_id.index : builder->tag_count;
+        tag_reference_graph_scan(builder, bsp_reference->offset, bsp_reference->offset + bsp_reference->size, owner);
+    }
+
+    return true;
+}
+
+static void tag_reference_graph_mark_reachable(struct tag_reference_graph *graph, uint16_t *stack, size_t node) {
+    if(node < graph->tag_count && graph->reachable[node]) {
+        return;
+    }
+
+    size_t stack_count = 0;
+    for(size_t e = graph->edge_offsets[node]; e < graph->edge_offsets[node + 1]; e++) {
+        stack[stack_count++] = graph->edges[e];
+    }
+    if(node < graph->tag_count) {
+        graph->reachable[node] = true;
+    }
+
+    while(stack_count > 0) {
+        uint16_t tag = stack[--stack_count];
+        if(graph->reachable[tag]) {
+            continue;
+        }
+        graph->reachable[tag] = true;
+        for(size_t e = graph->edge_offsets[tag]; e < graph->edge_offsets[tag + 1]; e++) {
+            if(!graph->reachable[graph->edges[e]]) {
+                stack[stack_count++] = graph->edges[e];
+            }
+        }
+    }
+}
+
+bool tag_reference_graph_build(struct tag_reference_graph *graph, struct cache_file_instance *cache_file) {
+    assert(graph && cache_file && cache_file->valid);
+    memset(graph, 0, sizeof(struct tag_reference_graph));
+    struct tag_data_instance *tag_data = &cache_file->tag_data;
+    size_t tag_count = tag_data->header->tag_count;
+
+    // Tags are moved by index, so the array has to be in order
+    for(size_t t = 0; t < tag_count; t++) {
+        if(tag_data->tags[t].tag_id.index != t) {
+            thread_output_error("tag %zu in the tag array has the ID %#x of another index\n", t, tag_data->tags[t].tag_id.whole_id);
+            return false;
+        }
+    }
+
+    struct tag_reference_graph_builder builder = {
+        .cache_file = cache_file,
+        .tag_count = tag_count,
+        .pinned = calloc(tag_count + 1, sizeof(bool))
+    };
+    if(!builder.pinned) {
+        abort();
+    }
+
+    // Blocks that can not be walked are still scanned below
+    struct tag_schema_visitor visitor = {
+        .block = tag_reference_graph_visit_block,
+        .field = tag_reference_graph_visit_field,
+        .context = &builder
+    };
+    tag_schema_walk(&visitor, cache_file);
+    tag_reference_graph_add_site(&builder, &tag_data->header->scenario_tag);
+
+    // Blocks shared by more than one tag belong to the map, since any of them could be the one referencing something
+    qsort(builder.blocks, builder.block_count, sizeof(struct tag_reference_graph_block), tag_reference_graph_compare_blocks);
+    for(size_t b = 1; b < builder.block_count; b++) {
+        if(builder.blocks[b].start < builder.blocks[b - 1].end && builder.blocks[b].owner != builder.blocks[b - 1].owner) {
+            builder.blocks[b].owner = tag_count;
+            builder.blocks[b - 1].owner = tag_count;
+        }
+    }
+    qsort(builder.sites, builder.site_count, sizeof(uint32_t), tag_reference_graph_compare_sites);
+    builder.sorted_site_count = builder.site_count;
+
+    // Scan the tag data around the header and tag array, then the BSPs
+    size_t tag_data_start = tag_data->data - cache_file->data;
+    size_t header_end = tag_data_start + tag_data->header_size;
+    size_t tag_array_start = (uint8_t *)tag_data->tags - cache_file->data;
+    size_t tag_array_end = tag_array_start + tag_count * sizeof(struct tag_instance);
+    tag_reference_graph_scan(&builder, header_end, MAX(tag_array_start, header_end), tag_count);
+    tag_reference_graph_scan(&builder, MAX(tag_array_end, header_end), tag_data_start + tag_data->size, tag_count);
+    bool success = tag_reference_graph_scan_structure_bsps(&builder);
+
+    if(success) {
+        qsort(builder.sites, builder.site_count, sizeof(uint32_t), tag_reference_graph_compare_sites);
+
+        // Group the edges by the node they come from
+        graph->tag_count = tag_count;
+        graph->edge_offsets = calloc(tag_count + 2, sizeof(uint32_t));
+        graph->edges = calloc(MAX(builder.edge_count, 1), sizeof(uint16_t));
+        graph->reachable = calloc(tag_count + 1, sizeof(bool));
+        uint16_t *stack = calloc(MAX(builder.edge_count, 1), sizeof(uint16_t));
+        if(!graph->edge_offsets || !graph->edges || !graph->reachable || !stack) {
+            abort();
+        }
+        for(size_t e = 0; e < builder.edge_count; e++) {
+            graph->edge_offsets[builder.edges[e].from + 1]++;
+        }
+        for(size_t n = 0; n <= tag_count; n++) {
+            graph->edge_offsets[n + 1] += graph->edge_offsets[n];
+        }
+        for(size_t e = 0; e < builder.edge_count; e++) {
+            graph->edges[graph->edge_offsets[builder.edges[e].from]++] = builder.edges[e].to;
+        }
+        for(size_t n = tag_count + 1; n > 0; n--) {
+            graph->edge_offsets[n] = graph->edge_offsets[n - 1];
+        }
+        graph->edge_offsets[0] = 0;
+
+        graph->sites = builder.sites;
+        graph->site_count = builder.site_count;
+        graph->pinned = builder.pinned;
+        builder.sites = nullptr;
+        builder.pinned = nullptr;
+
+        // The game loads the scenario and globals directly, and the UI tags by path through their collections
+        tag_reference_graph_mark_reachable(graph, stack, tag_count);
+        tag_reference_graph_mark_reachable(graph, stack, tag_data->header->scenario_tag.index);
+        for(size_t t = 0; t < tag_count; t++) {
+            switch(tag_data->tags[t].primary_group) {
+                case TAG_FOURCC_GLOBALS:
+                case TAG_FOURCC_TAG_COLLECTION:
+                case TAG_FOURCC_UI_WIDGET_COLLECTION:
+                    tag_reference_graph_mark_reachable(graph, stack, t);
+                    break;
+                default:
+                    break;
+            }
+        }
+        free(stack);
+    }
+
+    free(builder.edges);
+    free(builder.blocks);
+    free(builder.sites);
+    free(builder.pinned);
+    return success;
+}
+
+void tag_reference_graph_free(struct tag_reference_graph *graph) {
+    assert(graph);
+    free(graph->edge_offsets);
+    free(graph->edges);
+    free(graph->sites);
+    free(graph->pinned);
+    free(graph->reachable);
+    memset(graph, 0, sizeof(struct tag_reference_graph));
+}
+
+size_t tag_reference_graph_print_orphans(const struct tag_reference_graph *graph, struct tag_data_instance *tag_data) {
+    assert(graph && tag_data && tag_data->valid);
+    size_t orphan_count = 0;
+    for(size_t t = 0; t < graph->tag_count; t++) {
+        if(!graph->reachable[t]) {
+            auto tag_id = tag_data->tags[t].tag_id;
+            thread_output_print("\"%s.%s\" is not referenced by anything\n", tag_path_get(tag_id, tag_data), tag_extension_get(tag_id, tag_data));
+            orphan_count++;
+        }
+    }
+    return orphan_count;
+}
+
+size_t tag_reference_graph_plan_prune(const struct tag_reference_graph *graph, struct cache_file_instance *cache_file, struct tag_fix_plan *plan) {
+    assert(graph && cache_file && cache_file->valid && plan && plan->base == cache_file->data);
+    struct tag_data_instance *tag_data = &cache_file->tag_data;
+    size_t tag_count = graph->tag_count;
+    assert(tag_count == tag_data->header->tag_count);
+
+    // The array can not end before a pinned tag, since that tag can not be moved into a free slot
+    size_t orphan_count = 0;
+    for(size_t t = 0; t < tag_count; t++) {
+        orphan_count += graph->reachable[t] ? 0 : 1;
+    }
+    size_t new_tag_count = tag_count - orphan_count;
+    for(size_t t = new_tag_count; t < tag_count; t++) {
+        if(graph->reachable[t] && graph->pinned[t]) {
+            new_tag_count = t + 1;
+        }
+    }
+    if(new_tag_count == tag_count) {
+        return 0;
+    }
+
+    // Move the tags past the new end into the free slots before it. The salt stays, only the index changes.
+    TagID *new_ids = calloc(tag_count, sizeof(TagID));
+    if(!new_ids) {
+        abort();
+    }
+    for(size_t t = 0; t < tag_count; t++) {
+        new_ids[t] = tag_data->tags[t].tag_id;
+    }
+    size_t free_slot = 0;
+    for(size_t t = new_tag_count; t < tag_count; t++) {
+        if(!graph->reachable[t]) {
+            continue;
+        }
+        while(graph->reachable[free_slot]) {
+            free_slot++;
+        }
+        assert(free_slot < new_tag_count);
+        new_ids[t].index = free_slot++;
+    }
+
+    TagID plan_tag = plan->tag;
+    for(size_t s = 0; s < graph->site_count; s++) {
+        uint8_t *site = cache_file->data + graph->sites[s];
+        TagID id;
+        memcpy(&id, site, sizeof(id));
+        if(tag_reference_graph_is_tag(id, tag_data) && graph->reachable[id.index]) {
+            plan->tag = id;
+            tag_fix_plan_write(plan, site, &new_ids[id.index], sizeof(TagID), "referenced tag was moved");
+        }
+    }
+    for(size_t t = new_tag_count; t < tag_count; t++) {
+        plan->tag = tag_data->tags[t].tag_id;
+        if(graph->reachable[t]) {
+            struct tag_instance moved = tag_data->tags[t];
+            moved.tag_id = new_ids[t];
+            tag_fix_plan_write(plan, &tag_data->tags[new_ids[t].index], &moved, sizeof(moved), "tag was moved into the slot of an unreferenced tag");
+        }
+        tag_fix_plan_zero(plan, &tag_data->tags[t], sizeof(struct tag_instance), "tag array was shortened");
+    }
+    plan->tag = tag_data->header->scenario_tag;
+    TAG_FIX_PLAN_SET(plan, tag_data->header->tag_count, new_tag_count, "unreferenced tags were removed");
+    plan->tag = plan_tag;
+
+    free(new_ids);
+    return tag_count - new_tag_count;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "../data_types.h"
+#include "../cache/cache.h"
+#include "tag_fix_plan.h"
+
+// Which tags reference which. Edges come from the schema's references and tag IDs, and from every other place a tag ID
+// shows up in the tag data or BSP data, since the schema does not cover everything. An ID found outside of anything the
+// schema knows is counted as referenced by the map itself, and a tag whose ID shows up somewhere that is not clearly a
+// reference is pinned so its ID is never changed.
+struct tag_reference_graph {
+    size_t tag_count;
+    uint32_t *edge_offsets; // Edges of node n are edges[edge_offsets[n]] to edges[edge_offsets[n + 1]]
+    uint16_t *edges; // Node tag_count is the map itself
+    uint32_t *sites; // Cache file offsets of IDs known to be references, sorted
+    size_t site_count;
+    bool *pinned;
+    bool *reachable;
+};
+
+bool tag_reference_graph_build(struct tag_reference_graph *graph, struct cache_file_instance *cache_file);
+void tag_reference_graph_free(struct tag_reference_graph *graph);
+size_t tag_reference_graph_print_orphans(const struct tag_reference_graph *graph, struct tag_data_instance *tag_data);
+
+// Plans to remove unreachable tags from the tag array. Tags from the end of the array are moved into the freed slots and
+// everything referencing them is rewritten. Pinned tags are never moved, so some unreachable tags may have to stay.
+// Returns how many tags are removed.
+size_t tag_reference_graph_plan_prune(const struct tag_reference_graph *graph, struct cache_file_instance *cache_file, struct tag_fix_plan *plan);
@@ -0,0 +1,123 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "tag_scheduler.h"
+
+#include "../data_types.h"
+#include "tag.h"
+#include "tag_fourcc.h"
+#include "../tag_groups/tag_groups.h"
+#include "../thread/thread_output.h"
+
+// Fixers that read another tag's data. The reading tag and the read tag are kept in the same order they
+// would be in a serial run over the tag array, so the result does not depend on how jobs get scheduled.
+//
+// Only reads of something another fixer can change need to be listed. Every fixer only plans writes to its
+// own tag's data and its own tag array entry, so the other cross-tag reads are safe in any order:
+// - The shader base and group fixers both run in the same job, on the same tag
+// - scenario_postprocess looks at the tag IDs and paths of ai conversation dialogue tags, which no fixer writes
+// - BSPs are fixed from the scenario before the tag pass starts
+struct tag_dependency {
+    uint32_t tag_group;
+    uint32_t dependency_group;
+    size_t reference_offset;
+};
+
+static const struct tag_dependency tag_dependencies[] = {
+    // decal_postprocess reads the sprites of a bitmap that bitmap_postprocess may externalize
+    { TAG_FOURCC_DECAL, TAG_FOURCC_BITMAP, offsetof(struct decal, shader.decal.map) }
+};
+
+static bool tag_schedule_resolve_dependency(uint16_t *dependency_index, const struct tag_dependency *dependency, struct tag_instance *tag, struct tag_data_instance *tag_data) {
+    if(tag->primary_group != dependency->tag_group || tag->external) {
+        return false;
+    }
+
+    // The fixer will complain about this later if it's bad
+    struct tag_reference *reference = tag_resolve_pointer(tag->base_address + dependency->reference_offset, sizeof(struct tag_reference), tag_data);
+    if(!reference || !tag_id_is_valid_tag(reference->index, tag_data)) {
+        return false;
+    }
+
+    if(tag_data->tags[reference->index.index].primary_group != dependency->dependency_group) {
+        return false;
+    }
+
+    *dependency_index = reference->index.index;
+    return true;
+}
+
+bool tag_schedule_build(struct tag_schedule *schedule, struct tag_data_instance *tag_data) {
+    assert(schedule && tag_data && tag_data->valid);
+    memset(schedule, 0, sizeof(struct tag_schedule));
+
+    size_t tag_count = tag_data->header->tag_count;
+    size_t *waves = calloc(tag_count + 1, sizeof(size_t));
+    size_t *minimum_waves = calloc(tag_count + 1, sizeof(size_t));
+    schedule->tag_indices = calloc(tag_count + 1, sizeof(uint16_t));
+    schedule->wave_offsets = calloc(tag_count + 2, sizeof(size_t));
+    if(!waves || !minimum_waves || !schedule->tag_indices || !schedule->wave_offsets) {
+        thread_output_error("failed to allocate memory for the tag schedule\n");
+        free(waves);
+        free(minimum_waves);
+        tag_schedule_free(schedule);
+        return false;
+    }
+
+    // Every constraint on a tag comes from a tag before it in the array, so one pass is enough
+    size_t wave_count = 0;
+    for(size_t t = 0; t < tag_count; t++) {
+        size_t wave = minimum_waves[t];
+        for(size_t d = 0; d < sizeof(tag_dependencies) / sizeof(tag_dependencies[0]); d++) {
+            uint16_t dependency_index;
+            if(!tag_schedule_resolve_dependency(&dependency_index, &tag_dependencies[d], &tag_data->tags[t], tag_data)) {
+                continue;
+            }
+
+            // The dependency was processed first in a serial run, so it has to be done before us
+            if(dependency_index < t) {
+                wave = MAX(wave, waves[dependency_index] + 1);
+            }
+        }
+
+        waves[t] = wave;
+        wave_count = MAX(wave_count, wave + 1);
+
+        // A dependency further down the array has to wait for us to read it first
+        for(size_t d = 0; d < sizeof(tag_dependencies) / sizeof(tag_dependencies[0]); d++) {
+            uint16_t dependency_index;
+            if(tag_schedule_resolve_dependency(&dependency_index, &tag_dependencies[d], &tag_data->tags[t], tag_data) && dependency_index > t) {
+                minimum_waves[dependency_index] = MAX(minimum_waves[dependency_index], wave + 1);
+            }
+        }
+    }
+
+    // Bucket the tags by wave, keeping them in tag array order
+    for(size_t t = 0; t < tag_count; t++) {
+        schedule->wave_offsets[waves[t] + 1]++;
+    }
+    for(size_t w = 0; w < wave_count; w++) {
+        schedule->wave_offsets[w + 1] += schedule->wave_offsets[w];
+    }
+
+    size_t *fill = minimum_waves;
+    memcpy(fill, schedule->wave_offsets, sizeof(size_t) * wave_count);
+    for(size_t t = 0; t < tag_count; t++) {
+        schedule->tag_indices[fill[waves[t]]++] = t;
+    }
+
+    schedule->wave_count = wave_count;
+    free(waves);
+    free(minimum_waves);
+    return true;
+}
+
+void tag_schedule_free(struct tag_schedule *schedule) {
+    assert(schedule);
+    free(schedule->tag_indices);
+    free(schedule->wave_offsets);
+    memset(schedule, 0, sizeof(struct tag_schedule));
+}
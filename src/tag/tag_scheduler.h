@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "tag.h"
+
+struct tag_schedule {
+    uint16_t *tag_indices; // Tag indices ordered by wave, then by tag index
+    size_t *wave_offsets; // Wave w is tag_indices[wave_offsets[w]] to tag_indices[wave_offsets[w + 1]]
+    size_t wave_count;
+};
+
+bool tag_schedule_build(struct tag_schedule *schedule, struct tag_data_instance *tag_data);
+void tag_schedule_free(struct tag_schedule *schedule);
@@ -0,0 +1,404 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <assert.h>
+
+#include "tag_schema.h"
+
+#include "../data_types.h"
+#include "../cache/cache.h"
+#include "../tag_groups/tag_groups.h"
+#include "tag.h"
+#include "tag_fourcc.h"
+#include "../thread/thread_output.h"
+
+// Layout names, used to index tag_schema_structs
+enum {
+    #define TAG_SCHEMA_BEGIN(layout, struct_type) TAG_SCHEMA_STRUCT_##layout,
+    #include "tag_schema_definitions.h"
+    NUMBER_OF_TAG_SCHEMA_STRUCTS
+};
+
+enum {
+    #define TAG_SCHEMA_GROUP(group, layout) TAG_SCHEMA_GROUP_INDEX_##group,
+    #define TAG_SCHEMA_GROUP_OPAQUE(group) TAG_SCHEMA_GROUP_INDEX_##group,
+    #include "tag_schema_definitions.h"
+    NUMBER_OF_TAG_SCHEMA_GROUPS
+};
+
+// Check that every field is what the definitions say it is
+#define TAG_SCHEMA_BEGIN(layout, struct_type) typedef struct_type tag_schema_type_##layout;
+#include "tag_schema_definitions.h"
+
+#define TAG_SCHEMA_FIELD_IS(struct_type, member, field_type) _Generic(((struct_type *)nullptr)->member, field_type: true, default: false)
+#define TAG_SCHEMA_REFERENCE(struct_type, member) static_assert(TAG_SCHEMA_FIELD_IS(struct_type, member, struct tag_reference));
+#define TAG_SCHEMA_DATA(struct_type, member) static_assert(TAG_SCHEMA_FIELD_IS(struct_type, member, struct tag_data));
+#define TAG_SCHEMA_RUNTIME_DATA(struct_type, member) static_assert(TAG_SCHEMA_FIELD_IS(struct_type, member, struct tag_data));
+#define TAG_SCHEMA_REFLEXIVE(struct_type, member, element) static_assert(TAG_SCHEMA_FIELD_IS(struct_type, member, struct tag_reflexive));
+#define TAG_SCHEMA_REFLEXIVE_OPAQUE(struct_type, member) static_assert(TAG_SCHEMA_FIELD_IS(struct_type, member, struct tag_reflexive));
+#define TAG_SCHEMA_STRUCT(struct_type, member, layout) static_assert(TAG_SCHEMA_FIELD_IS(struct_type, member, tag_schema_type_##layout));
+#define TAG_SCHEMA_RUNTIME_POINTER(struct_type, member) static_assert(TAG_SCHEMA_FIELD_IS(struct_type, member, Pointer32));
+#define TAG_SCHEMA_TAG_ID(struct_type, member) static_assert(TAG_SCHEMA_FIELD_IS(struct_type, member, TagID));
+#define TAG_SCHEMA_RUNTIME_VALUE(struct_type, member) static_assert(offsetof(struct_type, member) < sizeof(struct_type));
+#include "tag_schema_definitions.h"
+
+static const struct tag_schema_struct tag_schema_structs[NUMBER_OF_TAG_SCHEMA_STRUCTS];
+
+// Field lists end with an unused entry so structs with no pointer fields still have one
+#define TAG_SCHEMA_FIELD(field_type, struct_type, member, layout, runtime) \
+    { .type = field_type, .offset = offsetof(struct_type, member), .schema = layout, .name = #member, .written_at_runtime = runtime },
+#define TAG_SCHEMA_BEGIN(layout, struct_type) static const struct tag_schema_field tag_schema_##layout##_fields[] = {
+#define TAG_SCHEMA_END(layout) {} };
+#define TAG_SCHEMA_REFERENCE(struct_type, member) TAG_SCHEMA_FIELD(TAG_SCHEMA_FIELD_TYPE_REFERENCE, struct_type, member, nullptr, false)
+#define TAG_SCHEMA_DATA(struct_type, member) TAG_SCHEMA_FIELD(TAG_SCHEMA_FIELD_TYPE_DATA, struct_type, member, nullptr, false)
+#define TAG_SCHEMA_RUNTIME_DATA(struct_type, member) TAG_SCHEMA_FIELD(TAG_SCHEMA_FIELD_TYPE_DATA, struct_type, member, nullptr, true)
+#define TAG_SCHEMA_REFLEXIVE(struct_type, member, element) \
+    TAG_SCHEMA_FIELD(TAG_SCHEMA_FIELD_TYPE_REFLEXIVE, struct_type, member, &tag_schema_structs[TAG_SCHEMA_STRUCT_##element], false)
+#define TAG_SCHEMA_REFLEXIVE_OPAQUE(struct_type, member) TAG_SCHEMA_FIELD(TAG_SCHEMA_FIELD_TYPE_REFLEXIVE, struct_type, member, nullptr, false)
+#define TAG_SCHEMA_STRUCT(struct_type, member, layout) \
+    TAG_SCHEMA_FIELD(TAG_SCHEMA_FIELD_TYPE_STRUCT, struct_type, member, &tag_schema_structs[TAG_SCHEMA_STRUCT_##layout], false)
+#define TAG_SCHEMA_RUNTIME_POINTER(struct_type, member) \
+    TAG_SCHEMA_FIELD(TAG_SCHEMA_FIELD_TYPE_RUNTIME_POINTER, struct_type, member, nullptr, true)
+#define TAG_SCHEMA_TAG_ID(struct_type, member) TAG_SCHEMA_FIELD(TAG_SCHEMA_FIELD_TYPE_TAG_ID, struct_type, member, nullptr, false)
+#define TAG_SCHEMA_RUNTIME_VALUE(struct_type, member) \
+    TAG_SCHEMA_FIELD(TAG_SCHEMA_FIELD_TYPE_RUNTIME_VALUE, struct_type, member, nullptr, true)
+#include "tag_schema_definitions.h"
+#undef TAG_SCHEMA_FIELD
+
+static const struct tag_schema_struct tag_schema_structs[NUMBER_OF_TAG_SCHEMA_STRUCTS] = {
+    #define TAG_SCHEMA_BEGIN(layout, struct_type) [TAG_SCHEMA_STRUCT_##layout] = { \
+        .name = #layout, \
+        .size = sizeof(struct_type), \
+        .fields = tag_schema_##layout##_fields, \
+        .field_count = sizeof(tag_schema_##layout##_fields) / sizeof(tag_schema_##layout##_fields[0]) - 1 \
+    },
+    #include "tag_schema_definitions.h"
+};
+
+static const struct tag_schema_group tag_schema_groups[NUMBER_OF_TAG_SCHEMA_GROUPS] = {
+    #define TAG_SCHEMA_GROUP(group, layout) [TAG_SCHEMA_GROUP_INDEX_##group] = { group, &tag_schema_structs[TAG_SCHEMA_STRUCT_##layout] },
+    #define TAG_SCHEMA_GROUP_OPAQUE(group) [TAG_SCHEMA_GROUP_INDEX_##group] = { group, nullptr },
+    #include "tag_schema_definitions.h"
+};
+
+const struct tag_schema_group *tag_schema_get_group(uint32_t tag_group) {
+    switch(tag_group) {
+        #define TAG_SCHEMA_GROUP(group, layout) case group: return &tag_schema_groups[TAG_SCHEMA_GROUP_INDEX_##group];
+        #define TAG_SCHEMA_GROUP_OPAQUE(group) case group: return &tag_schema_groups[TAG_SCHEMA_GROUP_INDEX_##group];
+        #include "tag_schema_definitions.h"
+        default:
+            return nullptr;
+    }
+}
+
+bool tag_schema_struct_is_complete(const struct tag_schema_struct *schema) {
+    assert(schema);
+    for(size_t f = 0; f < schema->field_count; f++) {
+        const struct tag_schema_field *field = &schema->fields[f];
+        if(field->type != TAG_SCHEMA_FIELD_TYPE_REFLEXIVE && field->type != TAG_SCHEMA_FIELD_TYPE_STRUCT) {
+            continue;
+        }
+        if(!field->schema || !tag_schema_struct_is_complete(field->schema)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Tag IDs outside of references are the ID of the tag they are in, which the game may set when the map is loaded
+bool tag_schema_struct_is_written_at_runtime(const struct tag_schema_struct *schema) {
+    assert(schema);
+    for(size_t f = 0; f < schema->field_count; f++) {
+        const struct tag_schema_field *field = &schema->fields[f];
+        if(field->written_at_runtime || field->type == TAG_SCHEMA_FIELD_TYPE_TAG_ID) {
+            return true;
+        }
+        if(field->type == TAG_SCHEMA_FIELD_TYPE_STRUCT && tag_schema_struct_is_written_at_runtime(field->schema)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Complete if every pointer in a tag of this group is known
+bool tag_schema_group_is_complete(const struct tag_schema_group *group) {
+    assert(group);
+    if(!group->schema || group->schema->size != tag_fourcc_get_base_struct_size(group->tag_group)) {
+        return false;
+    }
+    return tag_schema_struct_is_complete(group->schema);
+}
+
+// Data blocks have no pointers. Base structs of groups and elements of reflexives need all of their layout.
+bool tag_schema_block_is_known(const struct tag_schema_block *block) {
+    assert(block);
+    switch(block->type) {
+        case TAG_SCHEMA_BLOCK_TYPE_DATA:
+            return true;
+        case TAG_SCHEMA_BLOCK_TYPE_BASE_STRUCT: {
+            const struct tag_schema_group *group = tag_schema_get_group(block->tag_group);
+            return group && tag_schema_group_is_complete(group);
+        }
+        case TAG_SCHEMA_BLOCK_TYPE_REFLEXIVE:
+            return block->schema && tag_schema_struct_is_complete(block->schema);
+        default:
+            return false;
+    }
+}
+
+struct tag_schema_walk {
+    const struct tag_schema_visitor *visitor;
+    const struct tag_schema_address_space *space;
+    TagID tag;
+    uint32_t tag_group;
+    bool follow; // false if the blocks are not in this map (indexed sounds)
+    bool success;
+};
+
+static uint8_t *tag_schema_resolve(const struct tag_schema_address_space *space, Pointer32 address, size_t size) {
+    if(address < space->load_address) {
+        return nullptr;
+    }
+
+    // A block of unknown size must at least start in bounds
+    size_t offset = address - space->load_address;
+    if(offset >= space->size || size > space->size - offset) {
+        return nullptr;
+    }
+    return space->data + offset;
+}
+
+static void tag_schema_walk_block(struct tag_schema_walk *walk, const struct tag_schema_block *block);
+
+static void tag_schema_report_fields(struct tag_schema_walk *walk, const struct tag_schema_block *block, const struct tag_schema_struct *schema, uint8_t *element) {
+    for(size_t f = 0; f < schema->field_count; f++) {
+        const struct tag_schema_field *field = &schema->fields[f];
+        if(field->type == TAG_SCHEMA_FIELD_TYPE_STRUCT) {
+            tag_schema_report_fields(walk, block, field->schema, element + field->offset);
+        }
+        else if(walk->visitor->field) {
+            walk->visitor->field(block, field, element + field->offset, walk->visitor->context);
+        }
+    }
+}
+
+static void tag_schema_follow_fields(struct tag_schema_walk *walk, const struct tag_schema_struct *schema, uint8_t *element) {
+    for(size_t f = 0; f < schema->field_count; f++) {
+        const struct tag_schema_field *field = &schema->fields[f];
+        void *value = element + field->offset;
+        struct tag_schema_block block = {
+            .tag = walk->tag,
+            .tag_group = walk->tag_group,
+            .schema = field->schema,
+            .field = field,
+            .pointer = value,
+            .space = walk->space
+        };
+
+        switch(field->type) {
+            case TAG_SCHEMA_FIELD_TYPE_STRUCT:
+                tag_schema_follow_fields(walk, field->schema, value);
+                continue;
+            case TAG_SCHEMA_FIELD_TYPE_REFLEXIVE: {
+                struct tag_reflexive *reflexive = value;
+                if(reflexive->count == 0) {
+                    continue;
+                }
+                block.type = TAG_SCHEMA_BLOCK_TYPE_REFLEXIVE;
+                block.address = reflexive->address;
+                block.count = reflexive->count;
+                block.size = field->schema ? (size_t)reflexive->count * field->schema->size : 0;
+                break;
+            }
+            case TAG_SCHEMA_FIELD_TYPE_DATA: {
+                // Raw data in a resource map or by file offset (bitmap pixels, sound samples) is not in here
+                struct tag_data *data = value;
+                if(data->size == 0 || data->address == 0 || TEST_FLAG(data->flags, TAG_DATA_FLAGS_EXTERNAL_BIT)) {
+                    continue;
+                }
+                block.type = TAG_SCHEMA_BLOCK_TYPE_DATA;
+                block.address = data->address;
+                block.count = 1;
+                block.size = data->size;
+                break;
+            }
+            default:
+                continue;
+        }
+
+        block.data = tag_schema_resolve(walk->space, block.address, block.size);
+        tag_schema_walk_block(walk, &block);
+    }
+}
+
+// Tool lays an array out before the blocks of its elements, so the fields of every element are reported before any
+// of their blocks are walked. That keeps the walk going forward through the map.
+static void tag_schema_walk_block(struct tag_schema_walk *walk, const struct tag_schema_block *block) {
+    if(walk->visitor->block) {
+        walk->visitor->block(block, walk->visitor->context);
+    }
+
+    if(!block->data) {
+        walk->success = false;
+        return;
+    }
+    if(!block->schema) {
+        return;
+    }
+
+    size_t element_size = block->type == TAG_SCHEMA_BLOCK_TYPE_BASE_STRUCT ? block->size : block->schema->size;
+    for(size_t e = 0; e < block->count; e++) {
+        tag_schema_report_fields(walk, block, block->schema, block->data + e * element_size);
+    }
+
+    if(!walk->follow) {
+        return;
+    }
+    for(size_t e = 0; e < block->count; e++) {
+        tag_schema_follow_fields(walk, block->schema, block->data + e * element_size);
+    }
+}
+
+static bool tag_schema_walk_base_struct(struct tag_schema_walk *walk, Pointer32 address, struct tag_data_instance *tag_data) {
+    const struct tag_schema_group *group = tag_schema_get_group(walk->tag_group);
+    size_t base_struct_size = tag_fourcc_get_base_struct_size(walk->tag_group);
+    if(!group || base_struct_size == UINT32_MAX) {
+        thread_output_error("tag \"%s\" has an unknown tag group %#x\n", tag_path_get(walk->tag, tag_data), walk->tag_group);
+        return false;
+    }
+    assert(!group->schema || group->schema->size <= base_struct_size);
+
+    struct tag_schema_block block = {
+        .type = TAG_SCHEMA_BLOCK_TYPE_BASE_STRUCT,
+        .tag = walk->tag,
+        .tag_group = walk->tag_group,
+        .schema = group->schema,
+        .address = address,
+        .count = 1,
+        .size = base_struct_size,
+        .data = tag_schema_resolve(walk->space, address, base_struct_size),
+        .space = walk->space
+    };
+
+    walk->success = true;
+    tag_schema_walk_block(walk, &block);
+    return walk->success;
+}
+
+static bool tag_schema_walk_structure_bsp(
+    struct scenario_structure_bsp_reference *bsp_reference,
+    const struct tag_schema_visitor *visitor,
+    struct cache_file_instance *cache_file) {
+
+    auto bsp_id = bsp_reference->structure_bsp.index;
+    struct tag_data_instance *tag_data = &cache_file->tag_data;
+    if(bsp_reference->size < sizeof(struct cache_file_structure_bsp_header) ||
+        bsp_reference->offset > cache_file->size ||
+        bsp_reference->size > cache_file->size - bsp_reference->offset) {
+        thread_output_error("cache data for \"%s.%s\" is out of bounds\n",
+            tag_path_get(bsp_id, tag_data), tag_fourcc_to_extension(TAG_FOURCC_SCENARIO_STRUCTURE_BSP));
+        return false;
+    }
+
+    struct cache_file_structure_bsp_header *bsp_header = (struct cache_file_structure_bsp_header *)(cache_file->data + bsp_reference->offset);
+    if(bsp_header->signature != TAG_FOURCC_SCENARIO_STRUCTURE_BSP) {
+        thread_output_error("BSP header for \"%s.%s\" is invalid\n",
+            tag_path_get(bsp_id, tag_data), tag_fourcc_to_extension(TAG_FOURCC_SCENARIO_STRUCTURE_BSP));
+        return false;
+    }
+
+    // BSP pointers are relative to where the BSP is loaded, not the tag data
+    struct tag_schema_address_space space = {
+        .data = cache_file->data + bsp_reference->offset,
+        .size = bsp_reference->size,
+        .load_address = bsp_reference->address
+    };
+    struct tag_schema_walk walk = {
+        .visitor = visitor,
+        .space = &space,
+        .tag = bsp_id,
+        .tag_group = TAG_FOURCC_SCENARIO_STRUCTURE_BSP,
+        .follow = true
+    };
+    return tag_schema_walk_base_struct(&walk, bsp_header->structure_bsp, tag_data);
+}
+
+static bool tag_schema_walk_scenario_bsps(TagID bsp_id, const struct tag_schema_visitor *visitor, struct cache_file_instance *cache_file) {
+    struct tag_data_instance *tag_data = &cache_file->tag_data;
+    auto scenario_id = tag_data->header->scenario_tag;
+    struct scenario *scenario = tag_get(scenario_id, TAG_FOURCC_SCENARIO, tag_data);
+    if(!scenario) {
+        thread_output_error("scenario tag is missing or invalid\n");
+        return false;
+    }
+
+    bool success = true;
+    for(size_t i = 0; i < scenario->structure_bsp_references.count; i++) {
+        struct scenario_structure_bsp_reference *bsp_reference = scenario_get_bsp_reference(scenario, i, tag_data);
+        if(!bsp_reference) {
+            thread_output_error("BSP reference %zu in \"%s.%s\" is out of bounds\n",
+                i, tag_path_get(scenario_id, tag_data), tag_fourcc_to_extension(TAG_FOURCC_SCENARIO));
+            return false;
+        }
+
+        if(bsp_id.whole_id == NULL_ID || bsp_reference->structure_bsp.index.whole_id == bsp_id.whole_id) {
+            success = tag_schema_walk_structure_bsp(bsp_reference, visitor, cache_file) && success;
+        }
+    }
+    return success;
+}
+
+// BSPs are walked from the scenario's BSP references, since that is where their data is
+bool tag_schema_walk_tag(TagID tag, const struct tag_schema_visitor *visitor, struct cache_file_instance *cache_file) {
+    assert(visitor && cache_file && cache_file->valid);
+    struct tag_data_instance *tag_data = &cache_file->tag_data;
+    if(!tag_id_is_valid_tag(tag, tag_data)) {
+        thread_output_error("tag ID %#x is not a valid tag\n", tag.whole_id);
+        return false;
+    }
+
+    struct tag_instance *instance = &tag_data->tags[tag.index];
+    if(instance->primary_group == TAG_FOURCC_SCENARIO_STRUCTURE_BSP) {
+        return tag_schema_walk_scenario_bsps(tag, visitor, cache_file);
+    }
+
+    // The base struct for sound tags is always in the map, but not what it points to
+    if(instance->external && instance->primary_group != TAG_FOURCC_SOUND) {
+        return true;
+    }
+
+    struct tag_schema_address_space space = {
+        .data = tag_data->data,
+        .size = tag_data->size,
+        .load_address = tag_data->data_load_address
+    };
+    struct tag_schema_walk walk = {
+        .visitor = visitor,
+        .space = &space,
+        .tag = tag,
+        .tag_group = instance->primary_group,
+        .follow = !instance->external
+    };
+    return tag_schema_walk_base_struct(&walk, instance->base_address, tag_data);
+}
+
+bool tag_schema_walk_structure_bsps(const struct tag_schema_visitor *visitor, struct cache_file_instance *cache_file) {
+    assert(visitor && cache_file && cache_file->valid);
+    return tag_schema_walk_scenario_bsps((TagID){ .whole_id = NULL_ID }, visitor, cache_file);
+}
+
+// Walks every tag in tag order, then every BSP. Keeps going past tags that fail so visitors see as much as possible.
+bool tag_schema_walk(const struct tag_schema_visitor *visitor, struct cache_file_instance *cache_file) {
+    assert(visitor && cache_file && cache_file->valid);
+    struct tag_data_instance *tag_data = &cache_file->tag_data;
+
+    bool success = true;
+    for(size_t i = 0; i < tag_data->header->tag_count; i++) {
+        struct tag_instance *instance = &tag_data->tags[i];
+        if(instance->primary_group == TAG_FOURCC_SCENARIO_STRUCTURE_BSP || instance->tag_id.index != i) {
+            continue;
+        }
+        success = tag_schema_walk_tag(instance->tag_id, visitor, cache_file) && success;
+    }
+
+    return tag_schema_walk_structure_bsps(visitor, cache_file) && success;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "../data_types.h"
+#include "../cache/cache.h"
+#include "tag.h"
+
+// The tag schema describes where the pointers are in each tag group: references, data blocks, reflexives and the
+// layout of their elements. Layouts are listed in tag_schema_definitions.h. Anything not defined in this tree is
+// opaque and is reported without being walked into.
+enum tag_schema_field_type {
+    TAG_SCHEMA_FIELD_TYPE_REFERENCE,
+    TAG_SCHEMA_FIELD_TYPE_DATA,
+    TAG_SCHEMA_FIELD_TYPE_REFLEXIVE,
+    TAG_SCHEMA_FIELD_TYPE_STRUCT, // Embedded in place, never reported to visitors
+    TAG_SCHEMA_FIELD_TYPE_RUNTIME_POINTER, // Set by the game when loaded
+    TAG_SCHEMA_FIELD_TYPE_TAG_ID, // Not part of a tag_reference
+    TAG_SCHEMA_FIELD_TYPE_RUNTIME_VALUE, // Anything else the game writes to while running
+    NUMBER_OF_TAG_SCHEMA_FIELD_TYPES
+};
+
+struct tag_schema_struct;
+
+struct tag_schema_field {
+    uint8_t type;
+    uint32_t offset;
+    const struct tag_schema_struct *schema; // Element or embedded layout, nullptr for an opaque reflexive
+    const char *name;
+    bool written_at_runtime; // The field, or the data block it points to, is written to by the game
+};
+
+struct tag_schema_struct {
+    const char *name;
+    size_t size;
+    const struct tag_schema_field *fields;
+    size_t field_count;
+};
+
+struct tag_schema_group {
+    uint32_t tag_group;
+    const struct tag_schema_struct *schema; // nullptr if only the base struct size is known
+};
+
+// Where a tag's blocks live. Tag data for most tags, the BSP's own data for scenario_structure_bsp.
+struct tag_schema_address_space {
+    uint8_t *data;
+    size_t size;
+    Pointer32 load_address;
+};
+
+enum tag_schema_block_type {
+    TAG_SCHEMA_BLOCK_TYPE_BASE_STRUCT,
+    TAG_SCHEMA_BLOCK_TYPE_REFLEXIVE,
+    TAG_SCHEMA_BLOCK_TYPE_DATA,
+    NUMBER_OF_TAG_SCHEMA_BLOCK_TYPES
+};
+
+struct tag_schema_block {
+    uint8_t type;
+    TagID tag;
+    uint32_t tag_group;
+    const struct tag_schema_struct *schema; // Element layout, nullptr for data and anything opaque
+    const struct tag_schema_field *field; // Field pointing here, nullptr for a base struct
+    void *pointer; // The tag_reflexive or tag_data pointing here, nullptr for a base struct
+    Pointer32 address;
+    uint32_t count; // Elements of a reflexive, 1 otherwise
+    size_t size; // 0 if the element size is not known
+    uint8_t *data; // nullptr if out of bounds. If size is 0, only the start was checked.
+    const struct tag_schema_address_space *space;
+};
+
+// Visitors may be nullptr. block is called once per pointer to a block before its fields, then field is called for every
+// reference, data, reflexive, runtime pointer, tag ID and runtime value field in it, including empty ones. value is the
+// tag_reference, tag_data, tag_reflexive, Pointer32, TagID or runtime value itself.
+//
+// A block shared by more than one parent is walked once for each of them, so every tag sees the references in the blocks
+// it uses. Visitors that record blocks or sites keep the first of each.
+struct tag_schema_visitor {
+    void (*block)(const struct tag_schema_block *block, void *context);
+    void (*field)(const struct tag_schema_block *block, const struct tag_schema_field *field, void *value, void *context);
+    void *context;
+};
+
+const struct tag_schema_group *tag_schema_get_group(uint32_t tag_group);
+bool tag_schema_struct_is_complete(const struct tag_schema_struct *schema);
+bool tag_schema_group_is_complete(const struct tag_schema_group *group);
+
+// Until every layout is defined, a block may have pointers in it the schema does not know of. Those blocks have to be
+// left where they are and as they are, and anything they point to is unknown.
+bool tag_schema_block_is_known(const struct tag_schema_block *block);
+bool tag_schema_struct_is_written_at_runtime(const struct tag_schema_struct *schema);
+bool tag_schema_walk_tag(TagID tag, const struct tag_schema_visitor *visitor, struct cache_file_instance *cache_file);
+bool tag_schema_walk_structure_bsps(const struct tag_schema_visitor *visitor, struct cache_file_instance *cache_file);
+bool tag_schema_walk(const struct tag_schema_visitor *visitor, struct cache_file_instance *cache_file);
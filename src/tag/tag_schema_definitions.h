@@ -0,0 +1,669 @@
+// Tag layouts for tag_schema.c. This file is included once per table, so it has no include guard.
+//
+// TAG_SCHEMA_BEGIN(layout, struct_type) ... TAG_SCHEMA_END(layout) lists the pointer fields of a struct, and anything in it
+// the game writes to, in order:
+//   TAG_SCHEMA_REFERENCE(struct_type, member)           a tag_reference
+//   TAG_SCHEMA_DATA(struct_type, member)                a tag_data block
+//   TAG_SCHEMA_RUNTIME_DATA(struct_type, member)        a tag_data block the game writes to while running
+//   TAG_SCHEMA_REFLEXIVE(struct_type, member, element)  a tag_reflexive of element structs
+//   TAG_SCHEMA_REFLEXIVE_OPAQUE(struct_type, member)    a tag_reflexive whose element layout is not defined in this tree
+//   TAG_SCHEMA_STRUCT(struct_type, member, layout)      a struct embedded in place
+//   TAG_SCHEMA_RUNTIME_POINTER(struct_type, member)     a Pointer32 the game sets when loading, so anything there is stale
+//   TAG_SCHEMA_TAG_ID(struct_type, member)              a TagID outside of a tag_reference
+//   TAG_SCHEMA_RUNTIME_VALUE(struct_type, member)       any other value the game writes to while running
+// TAG_SCHEMA_LEAF(layout, struct_type) is a struct with no pointer fields.
+//
+// TAG_SCHEMA_GROUP(group, layout) gives the base struct of a tag group. If the struct is smaller than the group's base
+// struct, it only describes the start of it. TAG_SCHEMA_GROUP_OPAQUE(group) is a group that has no layout at all.
+
+#ifndef TAG_SCHEMA_BEGIN
+#define TAG_SCHEMA_BEGIN(layout, struct_type)
+#endif
+#ifndef TAG_SCHEMA_END
+#define TAG_SCHEMA_END(layout)
+#endif
+#ifndef TAG_SCHEMA_LEAF
+#define TAG_SCHEMA_LEAF(layout, struct_type) TAG_SCHEMA_BEGIN(layout, struct_type) TAG_SCHEMA_END(layout)
+#endif
+#ifndef TAG_SCHEMA_REFERENCE
+#define TAG_SCHEMA_REFERENCE(struct_type, member)
+#endif
+#ifndef TAG_SCHEMA_DATA
+#define TAG_SCHEMA_DATA(struct_type, member)
+#endif
+#ifndef TAG_SCHEMA_RUNTIME_DATA
+#define TAG_SCHEMA_RUNTIME_DATA(struct_type, member) TAG_SCHEMA_DATA(struct_type, member)
+#endif
+#ifndef TAG_SCHEMA_REFLEXIVE
+#define TAG_SCHEMA_REFLEXIVE(struct_type, member, element)
+#endif
+#ifndef TAG_SCHEMA_REFLEXIVE_OPAQUE
+#define TAG_SCHEMA_REFLEXIVE_OPAQUE(struct_type, member)
+#endif
+#ifndef TAG_SCHEMA_STRUCT
+#define TAG_SCHEMA_STRUCT(struct_type, member, layout)
+#endif
+#ifndef TAG_SCHEMA_RUNTIME_POINTER
+#define TAG_SCHEMA_RUNTIME_POINTER(struct_type, member)
+#endif
+#ifndef TAG_SCHEMA_TAG_ID
+#define TAG_SCHEMA_TAG_ID(struct_type, member)
+#endif
+#ifndef TAG_SCHEMA_RUNTIME_VALUE
+#define TAG_SCHEMA_RUNTIME_VALUE(struct_type, member)
+#endif
+#ifndef TAG_SCHEMA_GROUP
+#define TAG_SCHEMA_GROUP(group, layout)
+#endif
+#ifndef TAG_SCHEMA_GROUP_OPAQUE
+#define TAG_SCHEMA_GROUP_OPAQUE(group)
+#endif
+
+// actor_variant
+TAG_SCHEMA_LEAF(actor_variant_change_colors, struct actor_variant_change_colors)
+TAG_SCHEMA_BEGIN(actor_variant, struct actor_variant)
+    TAG_SCHEMA_REFERENCE(struct actor_variant, actor_reference)
+    TAG_SCHEMA_REFERENCE(struct actor_variant, unit_reference)
+    TAG_SCHEMA_REFERENCE(struct actor_variant, major_upgrade_reference)
+    TAG_SCHEMA_REFERENCE(struct actor_variant, ranged_combat.weapon_reference)
+    TAG_SCHEMA_REFERENCE(struct actor_variant, items.equipment_reference)
+    TAG_SCHEMA_REFLEXIVE(struct actor_variant, change_colors, actor_variant_change_colors)
+TAG_SCHEMA_END(actor_variant)
+
+// bitmap
+TAG_SCHEMA_LEAF(bitmap_sprite, struct bitmap_sprite)
+TAG_SCHEMA_BEGIN(bitmap_sequence, struct bitmap_sequence)
+    TAG_SCHEMA_REFLEXIVE(struct bitmap_sequence, sprites, bitmap_sprite)
+TAG_SCHEMA_END(bitmap_sequence)
+TAG_SCHEMA_BEGIN(bitmap_data, struct bitmap_data)
+    TAG_SCHEMA_TAG_ID(struct bitmap_data, tag_index)
+TAG_SCHEMA_END(bitmap_data)
+TAG_SCHEMA_BEGIN(bitmap, struct bitmap)
+    TAG_SCHEMA_DATA(struct bitmap, import_bitmap)
+    TAG_SCHEMA_DATA(struct bitmap, pixel_data)
+    TAG_SCHEMA_REFLEXIVE(struct bitmap, sequences, bitmap_sequence)
+    TAG_SCHEMA_REFLEXIVE(struct bitmap, bitmaps, bitmap_data)
+TAG_SCHEMA_END(bitmap)
+
+// shader
+TAG_SCHEMA_LEAF(shader, struct shader)
+TAG_SCHEMA_BEGIN(shader_decal, struct shader_decal)
+    TAG_SCHEMA_REFERENCE(struct shader_decal, decal.map)
+TAG_SCHEMA_END(shader_decal)
+TAG_SCHEMA_BEGIN(shader_model, struct shader_model)
+    TAG_SCHEMA_REFERENCE(struct shader_model, model.base_map)
+    TAG_SCHEMA_REFERENCE(struct shader_model, model.multipurpose_map)
+    TAG_SCHEMA_REFERENCE(struct shader_model, model.detail_map)
+    TAG_SCHEMA_REFERENCE(struct shader_model, model.reflection_map)
+    TAG_SCHEMA_REFERENCE(struct shader_model, model.reflection_bump_map)
+TAG_SCHEMA_END(shader_model)
+
+// decal
+TAG_SCHEMA_BEGIN(decal, struct decal)
+    TAG_SCHEMA_REFERENCE(struct decal, next_decal_in_chain)
+    TAG_SCHEMA_STRUCT(struct decal, shader, shader_decal)
+TAG_SCHEMA_END(decal)
+
+// HUD elements shared by the HUD groups
+TAG_SCHEMA_LEAF(hud_multitexture_overlay_element_effector, struct hud_multitexture_overlay_element_effector)
+TAG_SCHEMA_BEGIN(hud_multitexture_overlay_element, struct hud_multitexture_overlay_element)
+    TAG_SCHEMA_REFERENCE(struct hud_multitexture_overlay_element, map[0])
+    TAG_SCHEMA_REFERENCE(struct hud_multitexture_overlay_element, map[1])
+    TAG_SCHEMA_REFERENCE(struct hud_multitexture_overlay_element, map[2])
+    TAG_SCHEMA_REFLEXIVE(struct hud_multitexture_overlay_element, effectors, hud_multitexture_overlay_element_effector)
+TAG_SCHEMA_END(hud_multitexture_overlay_element)
+TAG_SCHEMA_BEGIN(hud_static_element, struct hud_static_element)
+    TAG_SCHEMA_REFERENCE(struct hud_static_element, interface_bitmap)
+    TAG_SCHEMA_REFLEXIVE(struct hud_static_element, multitexture_overlays, hud_multitexture_overlay_element)
+TAG_SCHEMA_END(hud_static_element)
+TAG_SCHEMA_BEGIN(hud_meter_element, struct hud_meter_element)
+    TAG_SCHEMA_REFERENCE(struct hud_meter_element, meter_bitmap)
+TAG_SCHEMA_END(hud_meter_element)
+TAG_SCHEMA_BEGIN(hud_screen_effect, struct hud_screen_effect)
+    TAG_SCHEMA_REFERENCE(struct hud_screen_effect, mask_fullscreen)
+    TAG_SCHEMA_REFERENCE(struct hud_screen_effect, mask_splitscreen)
+TAG_SCHEMA_END(hud_screen_effect)
+TAG_SCHEMA_BEGIN(hud_sound_element, struct hud_sound_element)
+    TAG_SCHEMA_REFERENCE(struct hud_sound_element, sound)
+TAG_SCHEMA_END(hud_sound_element)
+TAG_SCHEMA_BEGIN(hud_messaging_parameters, struct hud_messaging_parameters)
+    TAG_SCHEMA_REFERENCE(struct hud_messaging_parameters, single_player_font)
+    TAG_SCHEMA_REFERENCE(struct hud_messaging_parameters, multi_player_font)
+    TAG_SCHEMA_REFERENCE(struct hud_messaging_parameters, hud_item_messages)
+    TAG_SCHEMA_REFERENCE(struct hud_messaging_parameters, messaging_icons)
+    TAG_SCHEMA_REFERENCE(struct hud_messaging_parameters, alternate_icon_text)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct hud_messaging_parameters, button_icons)
+    TAG_SCHEMA_REFERENCE(struct hud_messaging_parameters, hud_messages)
+TAG_SCHEMA_END(hud_messaging_parameters)
+
+// weapon_hud_interface
+TAG_SCHEMA_LEAF(weapon_hud_overlay_item, struct weapon_hud_overlay_item)
+TAG_SCHEMA_BEGIN(weapon_hud_overlay, struct weapon_hud_overlay)
+    TAG_SCHEMA_REFERENCE(struct weapon_hud_overlay, bitmap)
+    TAG_SCHEMA_REFLEXIVE(struct weapon_hud_overlay, items, weapon_hud_overlay_item)
+TAG_SCHEMA_END(weapon_hud_overlay)
+TAG_SCHEMA_BEGIN(weapon_hud_static_element, struct weapon_hud_static_element)
+    TAG_SCHEMA_STRUCT(struct weapon_hud_static_element, static_element, hud_static_element)
+TAG_SCHEMA_END(weapon_hud_static_element)
+TAG_SCHEMA_BEGIN(weapon_hud_meter_element, struct weapon_hud_meter_element)
+    TAG_SCHEMA_STRUCT(struct weapon_hud_meter_element, meter_element, hud_meter_element)
+TAG_SCHEMA_END(weapon_hud_meter_element)
+TAG_SCHEMA_LEAF(weapon_hud_number_element, struct weapon_hud_number_element)
+TAG_SCHEMA_BEGIN(weapon_hud_overlays_element, struct weapon_hud_overlays_element)
+    TAG_SCHEMA_STRUCT(struct weapon_hud_overlays_element, overlays, weapon_hud_overlay)
+TAG_SCHEMA_END(weapon_hud_overlays_element)
+TAG_SCHEMA_LEAF(weapon_hud_crosshair_item, struct weapon_hud_crosshair_item)
+TAG_SCHEMA_BEGIN(weapon_hud_crosshair, struct weapon_hud_crosshair)
+    TAG_SCHEMA_REFERENCE(struct weapon_hud_crosshair, bitmap)
+    TAG_SCHEMA_REFLEXIVE(struct weapon_hud_crosshair, items, weapon_hud_crosshair_item)
+TAG_SCHEMA_END(weapon_hud_crosshair)
+TAG_SCHEMA_BEGIN(weapon_hud_crosshairs_element, struct weapon_hud_crosshairs_element)
+    TAG_SCHEMA_STRUCT(struct weapon_hud_crosshairs_element, crosshairs, weapon_hud_crosshair)
+TAG_SCHEMA_END(weapon_hud_crosshairs_element)
+TAG_SCHEMA_BEGIN(weapon_hud_interface, struct weapon_hud_interface)
+    TAG_SCHEMA_REFERENCE(struct weapon_hud_interface, parent_hud)
+    TAG_SCHEMA_REFLEXIVE(struct weapon_hud_interface, statics, weapon_hud_static_element)
+    TAG_SCHEMA_REFLEXIVE(struct weapon_hud_interface, meters, weapon_hud_meter_element)
+    TAG_SCHEMA_REFLEXIVE(struct weapon_hud_interface, numbers, weapon_hud_number_element)
+    TAG_SCHEMA_REFLEXIVE(struct weapon_hud_interface, crosshairs, weapon_hud_crosshairs_element)
+    TAG_SCHEMA_REFLEXIVE(struct weapon_hud_interface, overlays, weapon_hud_overlays_element)
+    TAG_SCHEMA_REFLEXIVE(struct weapon_hud_interface, warning_sounds, hud_sound_element)
+    TAG_SCHEMA_REFLEXIVE(struct weapon_hud_interface, screen_effects, hud_screen_effect)
+TAG_SCHEMA_END(weapon_hud_interface)
+
+// grenade_hud_interface
+TAG_SCHEMA_BEGIN(grenade_count_panel, struct grenade_count_panel)
+    TAG_SCHEMA_STRUCT(struct grenade_count_panel, background, hud_static_element)
+TAG_SCHEMA_END(grenade_count_panel)
+TAG_SCHEMA_BEGIN(grenade_hud_interface, struct grenade_hud_interface)
+    TAG_SCHEMA_STRUCT(struct grenade_hud_interface, background, hud_static_element)
+    TAG_SCHEMA_STRUCT(struct grenade_hud_interface, grenade_count_panel, grenade_count_panel)
+    TAG_SCHEMA_STRUCT(struct grenade_hud_interface, overlays, weapon_hud_overlay)
+    TAG_SCHEMA_REFLEXIVE(struct grenade_hud_interface, warning_sounds, hud_sound_element)
+    TAG_SCHEMA_REFERENCE(struct grenade_hud_interface, messaging_icon_bitmap)
+TAG_SCHEMA_END(grenade_hud_interface)
+
+// unit_hud_interface
+TAG_SCHEMA_BEGIN(uint_hud_shield_panel, struct uint_hud_shield_panel)
+    TAG_SCHEMA_STRUCT(struct uint_hud_shield_panel, background, hud_static_element)
+    TAG_SCHEMA_STRUCT(struct uint_hud_shield_panel, meter, hud_meter_element)
+TAG_SCHEMA_END(uint_hud_shield_panel)
+TAG_SCHEMA_BEGIN(uint_hud_health_panel, struct uint_hud_health_panel)
+    TAG_SCHEMA_STRUCT(struct uint_hud_health_panel, background, hud_static_element)
+    TAG_SCHEMA_STRUCT(struct uint_hud_health_panel, meter, hud_meter_element)
+TAG_SCHEMA_END(uint_hud_health_panel)
+TAG_SCHEMA_BEGIN(uint_hud_auxiliary_meter_panel, struct uint_hud_auxiliary_meter_panel)
+    TAG_SCHEMA_STRUCT(struct uint_hud_auxiliary_meter_panel, background, hud_static_element)
+    TAG_SCHEMA_STRUCT(struct uint_hud_auxiliary_meter_panel, meter, hud_meter_element)
+TAG_SCHEMA_END(uint_hud_auxiliary_meter_panel)
+TAG_SCHEMA_BEGIN(uint_hud_motion_sensor_panel, struct uint_hud_motion_sensor_panel)
+    TAG_SCHEMA_STRUCT(struct uint_hud_motion_sensor_panel, background, hud_static_element)
+    TAG_SCHEMA_STRUCT(struct uint_hud_motion_sensor_panel, foreground, hud_static_element)
+TAG_SCHEMA_END(uint_hud_motion_sensor_panel)
+TAG_SCHEMA_BEGIN(uint_hud_auxiliary_overlay_element, struct uint_hud_auxiliary_overlay_element)
+    TAG_SCHEMA_STRUCT(struct uint_hud_auxiliary_overlay_element, static_element, hud_static_element)
+TAG_SCHEMA_END(uint_hud_auxiliary_overlay_element)
+TAG_SCHEMA_BEGIN(uint_hud_auxiliary_meter_element, struct uint_hud_auxiliary_meter_element)
+    TAG_SCHEMA_STRUCT(struct uint_hud_auxiliary_meter_element, panel, uint_hud_auxiliary_meter_panel)
+TAG_SCHEMA_END(uint_hud_auxiliary_meter_element)
+TAG_SCHEMA_BEGIN(unit_hud_interface, struct unit_hud_interface)
+    TAG_SCHEMA_STRUCT(struct unit_hud_interface, background, hud_static_element)
+    TAG_SCHEMA_STRUCT(struct unit_hud_interface, shield_meter, uint_hud_shield_panel)
+    TAG_SCHEMA_STRUCT(struct unit_hud_interface, health_meter, uint_hud_health_panel)
+    TAG_SCHEMA_STRUCT(struct unit_hud_interface, motion_sensor, uint_hud_motion_sensor_panel)
+    TAG_SCHEMA_REFLEXIVE(struct unit_hud_interface, auxiliary_panel.auxiliary_overlays, uint_hud_auxiliary_overlay_element)
+    TAG_SCHEMA_REFLEXIVE(struct unit_hud_interface, warning_sounds, hud_sound_element)
+    TAG_SCHEMA_REFLEXIVE(struct unit_hud_interface, auxiliary_meters, uint_hud_auxiliary_meter_element)
+TAG_SCHEMA_END(unit_hud_interface)
+
+// hud_globals
+TAG_SCHEMA_LEAF(hud_waypoint_arrow, struct hud_waypoint_arrow)
+TAG_SCHEMA_BEGIN(hud_globals, struct hud_globals)
+    TAG_SCHEMA_STRUCT(struct hud_globals, messaging, hud_messaging_parameters)
+    TAG_SCHEMA_REFERENCE(struct hud_globals, waypoint.arrow_bitmap)
+    TAG_SCHEMA_REFLEXIVE(struct hud_globals, waypoint.arrows, hud_waypoint_arrow)
+    TAG_SCHEMA_REFERENCE(struct hud_globals, defaults.default_weapon_hud)
+    TAG_SCHEMA_REFERENCE(struct hud_globals, damage_indicators.indicator_bitmap)
+    TAG_SCHEMA_REFERENCE(struct hud_globals, carnage_report_bitmap)
+    TAG_SCHEMA_REFERENCE(struct hud_globals, checkpoint_sound)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct hud_globals, bitmap_remaps)
+TAG_SCHEMA_END(hud_globals)
+
+// hud_number
+TAG_SCHEMA_BEGIN(hud_number, struct hud_number)
+    TAG_SCHEMA_REFERENCE(struct hud_number, number_bitmap)
+TAG_SCHEMA_END(hud_number)
+
+// lens_flare
+TAG_SCHEMA_LEAF(lens_flare_reflection, struct lens_flare_reflection)
+TAG_SCHEMA_BEGIN(lens_flare, struct lens_flare)
+    TAG_SCHEMA_REFERENCE(struct lens_flare, primary_map)
+    TAG_SCHEMA_REFLEXIVE(struct lens_flare, reflections, lens_flare_reflection)
+TAG_SCHEMA_END(lens_flare)
+
+// meter
+TAG_SCHEMA_BEGIN(meter, struct meter)
+    TAG_SCHEMA_REFERENCE(struct meter, stencil_bitmaps)
+    TAG_SCHEMA_REFERENCE(struct meter, source_bitmap)
+    TAG_SCHEMA_DATA(struct meter, encoded_stencil)
+TAG_SCHEMA_END(meter)
+
+// model and gbxmodel only differ in the geometry part struct
+TAG_SCHEMA_LEAF(model_marker_instance, struct model_marker_instance)
+TAG_SCHEMA_BEGIN(model_marker, struct model_marker)
+    TAG_SCHEMA_REFLEXIVE(struct model_marker, instances, model_marker_instance)
+TAG_SCHEMA_END(model_marker)
+TAG_SCHEMA_LEAF(model_node, struct model_node)
+TAG_SCHEMA_LEAF(model_region_permutation_marker, struct model_region_permutation_marker)
+TAG_SCHEMA_BEGIN(model_region_permutation, struct model_region_permutation)
+    TAG_SCHEMA_REFLEXIVE(struct model_region_permutation, markers, model_region_permutation_marker)
+TAG_SCHEMA_END(model_region_permutation)
+TAG_SCHEMA_BEGIN(model_region, struct model_region)
+    TAG_SCHEMA_REFLEXIVE(struct model_region, permutations, model_region_permutation)
+TAG_SCHEMA_END(model_region)
+TAG_SCHEMA_BEGIN(model_geometry_part, struct model_geometry_part)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct model_geometry_part, uncompressed_vertices)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct model_geometry_part, compressed_vertices)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct model_geometry_part, triangles)
+    TAG_SCHEMA_RUNTIME_POINTER(struct model_geometry_part, vertex_buffer.base_address)
+TAG_SCHEMA_END(model_geometry_part)
+TAG_SCHEMA_BEGIN(gbxmodel_geometry_part, struct gbxmodel_geometry_part)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct gbxmodel_geometry_part, uncompressed_vertices)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct gbxmodel_geometry_part, compressed_vertices)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct gbxmodel_geometry_part, triangles)
+    TAG_SCHEMA_RUNTIME_POINTER(struct gbxmodel_geometry_part, vertex_buffer.base_address)
+TAG_SCHEMA_END(gbxmodel_geometry_part)
+TAG_SCHEMA_BEGIN(model_geometry, struct model_geometry)
+    TAG_SCHEMA_REFLEXIVE(struct model_geometry, parts, model_geometry_part)
+TAG_SCHEMA_END(model_geometry)
+TAG_SCHEMA_BEGIN(gbxmodel_geometry, struct model_geometry)
+    TAG_SCHEMA_REFLEXIVE(struct model_geometry, parts, gbxmodel_geometry_part)
+TAG_SCHEMA_END(gbxmodel_geometry)
+TAG_SCHEMA_BEGIN(model_shader_reference, struct model_shader_reference)
+    TAG_SCHEMA_REFERENCE(struct model_shader_reference, shader)
+TAG_SCHEMA_END(model_shader_reference)
+TAG_SCHEMA_BEGIN(model, struct model)
+    TAG_SCHEMA_REFLEXIVE(struct model, runtime_markers, model_marker)
+    TAG_SCHEMA_REFLEXIVE(struct model, nodes, model_node)
+    TAG_SCHEMA_REFLEXIVE(struct model, regions, model_region)
+    TAG_SCHEMA_REFLEXIVE(struct model, geometries, model_geometry)
+    TAG_SCHEMA_REFLEXIVE(struct model, shaders, model_shader_reference)
+TAG_SCHEMA_END(model)
+TAG_SCHEMA_BEGIN(gbxmodel, struct model)
+    TAG_SCHEMA_REFLEXIVE(struct model, runtime_markers, model_marker)
+    TAG_SCHEMA_REFLEXIVE(struct model, nodes, model_node)
+    TAG_SCHEMA_REFLEXIVE(struct model, regions, model_region)
+    TAG_SCHEMA_REFLEXIVE(struct model, geometries, gbxmodel_geometry)
+    TAG_SCHEMA_REFLEXIVE(struct model, shaders, model_shader_reference)
+TAG_SCHEMA_END(gbxmodel)
+
+// object, and unit for the groups that derive from it
+TAG_SCHEMA_BEGIN(object_attachment, struct object_attachment)
+    TAG_SCHEMA_REFERENCE(struct object_attachment, type)
+TAG_SCHEMA_END(object_attachment)
+TAG_SCHEMA_BEGIN(object_widget, struct object_widget)
+    TAG_SCHEMA_REFERENCE(struct object_widget, type)
+TAG_SCHEMA_END(object_widget)
+TAG_SCHEMA_LEAF(object_function, struct object_function)
+TAG_SCHEMA_LEAF(object_change_colors_permutation, struct object_change_colors_permutation)
+TAG_SCHEMA_BEGIN(object_change_colors, struct object_change_colors)
+    TAG_SCHEMA_REFLEXIVE(struct object_change_colors, permutations, object_change_colors_permutation)
+TAG_SCHEMA_END(object_change_colors)
+TAG_SCHEMA_BEGIN(_object, struct _object)
+    TAG_SCHEMA_REFERENCE(struct _object, model)
+    TAG_SCHEMA_REFERENCE(struct _object, animation_graph)
+    TAG_SCHEMA_REFERENCE(struct _object, collision_model)
+    TAG_SCHEMA_REFERENCE(struct _object, physics)
+    TAG_SCHEMA_REFERENCE(struct _object, modifier_shader)
+    TAG_SCHEMA_REFERENCE(struct _object, creation_effect)
+    TAG_SCHEMA_REFLEXIVE(struct _object, attachments, object_attachment)
+    TAG_SCHEMA_REFLEXIVE(struct _object, widgets, object_widget)
+    TAG_SCHEMA_REFLEXIVE(struct _object, functions, object_function)
+    TAG_SCHEMA_REFLEXIVE(struct _object, change_colors, object_change_colors)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct _object, predicted_resources)
+TAG_SCHEMA_END(_object)
+TAG_SCHEMA_BEGIN(object, struct object)
+    TAG_SCHEMA_STRUCT(struct object, object, _object)
+TAG_SCHEMA_END(object)
+TAG_SCHEMA_BEGIN(unit_camera_track, struct unit_camera_track)
+    TAG_SCHEMA_REFERENCE(struct unit_camera_track, track)
+TAG_SCHEMA_END(unit_camera_track)
+TAG_SCHEMA_BEGIN(unit_camera, struct unit_camera)
+    TAG_SCHEMA_REFLEXIVE(struct unit_camera, unit_camera_tracks, unit_camera_track)
+TAG_SCHEMA_END(unit_camera)
+TAG_SCHEMA_BEGIN(unit_hud_reference, struct unit_hud_reference)
+    TAG_SCHEMA_REFERENCE(struct unit_hud_reference, hud)
+TAG_SCHEMA_END(unit_hud_reference)
+TAG_SCHEMA_BEGIN(unit_dialogue_variant, struct unit_dialogue_variant)
+    TAG_SCHEMA_REFERENCE(struct unit_dialogue_variant, dialogue_variant)
+TAG_SCHEMA_END(unit_dialogue_variant)
+TAG_SCHEMA_LEAF(unit_powered_seat, struct unit_powered_seat)
+TAG_SCHEMA_BEGIN(unit_initial_weapon, struct unit_initial_weapon)
+    TAG_SCHEMA_REFERENCE(struct unit_initial_weapon, reference)
+TAG_SCHEMA_END(unit_initial_weapon)
+TAG_SCHEMA_BEGIN(unit_seat, struct unit_seat)
+    TAG_SCHEMA_STRUCT(struct unit_seat, camera, unit_camera)
+    TAG_SCHEMA_REFLEXIVE(struct unit_seat, seat_huds, unit_hud_reference)
+    TAG_SCHEMA_REFERENCE(struct unit_seat, built_in_actor_reference)
+TAG_SCHEMA_END(unit_seat)
+TAG_SCHEMA_BEGIN(_unit, struct _unit)
+    TAG_SCHEMA_REFERENCE(struct _unit, integrated_light_toggle_effect)
+    TAG_SCHEMA_STRUCT(struct _unit, camera, unit_camera)
+    TAG_SCHEMA_REFERENCE(struct _unit, spawned_actor_variant)
+    TAG_SCHEMA_REFERENCE(struct _unit, melee_damage)
+    TAG_SCHEMA_REFLEXIVE(struct _unit, huds, unit_hud_reference)
+    TAG_SCHEMA_REFLEXIVE(struct _unit, dialogue_variants, unit_dialogue_variant)
+    TAG_SCHEMA_REFLEXIVE(struct _unit, powered_seats, unit_powered_seat)
+    TAG_SCHEMA_REFLEXIVE(struct _unit, initial_weapons, unit_initial_weapon)
+    TAG_SCHEMA_REFLEXIVE(struct _unit, seats, unit_seat)
+TAG_SCHEMA_END(_unit)
+TAG_SCHEMA_BEGIN(unit, struct unit)
+    TAG_SCHEMA_STRUCT(struct unit, object, _object)
+    TAG_SCHEMA_STRUCT(struct unit, unit, _unit)
+TAG_SCHEMA_END(unit)
+
+// scenario
+TAG_SCHEMA_BEGIN(scenario_structure_bsp_reference, struct scenario_structure_bsp_reference)
+    TAG_SCHEMA_REFERENCE(struct scenario_structure_bsp_reference, structure_bsp)
+TAG_SCHEMA_END(scenario_structure_bsp_reference)
+TAG_SCHEMA_BEGIN(scenario, struct scenario)
+    TAG_SCHEMA_REFERENCE(struct scenario, unused_structure_bsp)
+    TAG_SCHEMA_REFERENCE(struct scenario, unused_globals)
+    TAG_SCHEMA_REFERENCE(struct scenario, unused_sky)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, sky_references)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, scenario_references)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, predicted_ui_resources)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, functions)
+    TAG_SCHEMA_DATA(struct scenario, editor_scenario_data)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, comments)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, scavenger_hunt_objects)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, object_names)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, scenery)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, scenery_palette)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, bipeds)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, biped_palette)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, vehicles)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, vehicle_palette)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, equipment)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, equipment_palette)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, weapons)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, weapon_palette)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, device_groups)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, machines)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, machine_palette)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, controls)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, control_palette)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, light_fixtures)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, light_fixtures_palette)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, sound_scenery)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, sound_scenery_palette)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, unused_blocks[0])
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, unused_blocks[1])
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, unused_blocks[2])
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, unused_blocks[3])
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, unused_blocks[4])
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, unused_blocks[5])
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, unused_blocks[6])
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, starting_profiles)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, players)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, trigger_volumes)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, recorded_animations)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, netgame_flags)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, netgame_equipment)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, scenario_starting_equipment)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, bsp_switch_trigger_volumes)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, decals)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, decal_palette)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, detail_object_collection_palette)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, ai_actor_palette)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, ai_encounters)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, ai_command_lists)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, ai_animation_references)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, ai_script_references)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, ai_recording_references)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, ai_conversations)
+    TAG_SCHEMA_RUNTIME_DATA(struct scenario, hs_syntax_data)
+    TAG_SCHEMA_DATA(struct scenario, hs_string_constants)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, hs_scripts)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, hs_globals)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, hs_references)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, hs_source_files)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, cutscene_flags)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, cutscene_camera_points)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct scenario, cutscene_chapter_titles)
+    TAG_SCHEMA_REFERENCE(struct scenario, custom_object_names)
+    TAG_SCHEMA_REFERENCE(struct scenario, ingame_help_text)
+    TAG_SCHEMA_REFERENCE(struct scenario, hud_messages)
+    TAG_SCHEMA_REFLEXIVE(struct scenario, structure_bsp_references, scenario_structure_bsp_reference)
+TAG_SCHEMA_END(scenario)
+
+// scenario_structure_bsp, which is walked in its own BSP data rather than the tag data
+TAG_SCHEMA_BEGIN(structure_collision_material, struct structure_collision_material)
+    TAG_SCHEMA_REFERENCE(struct structure_collision_material, shader)
+TAG_SCHEMA_END(structure_collision_material)
+TAG_SCHEMA_LEAF(structure_node, struct structure_node)
+TAG_SCHEMA_LEAF(structure_leaf, struct structure_leaf)
+TAG_SCHEMA_LEAF(structure_surface_reference, struct structure_surface_reference)
+TAG_SCHEMA_LEAF(structure_surface, struct structure_surface)
+TAG_SCHEMA_BEGIN(structure_material, struct structure_material)
+    TAG_SCHEMA_REFERENCE(struct structure_material, shader)
+    TAG_SCHEMA_RUNTIME_POINTER(struct structure_material, vertices.base_address)
+    TAG_SCHEMA_RUNTIME_POINTER(struct structure_material, vertices.hardware_format)
+    TAG_SCHEMA_RUNTIME_POINTER(struct structure_material, lightmap_vertices.base_address)
+    TAG_SCHEMA_RUNTIME_POINTER(struct structure_material, lightmap_vertices.hardware_format)
+    TAG_SCHEMA_DATA(struct structure_material, uncompressed_vertex_data)
+    TAG_SCHEMA_DATA(struct structure_material, compressed_vertex_data)
+TAG_SCHEMA_END(structure_material)
+TAG_SCHEMA_BEGIN(structure_lightmap, struct structure_lightmap)
+    TAG_SCHEMA_REFLEXIVE(struct structure_lightmap, materials, structure_material)
+TAG_SCHEMA_END(structure_lightmap)
+TAG_SCHEMA_BEGIN(structure_lens_flare, struct structure_lens_flare)
+    TAG_SCHEMA_REFERENCE(struct structure_lens_flare, lens_flare)
+TAG_SCHEMA_END(structure_lens_flare)
+TAG_SCHEMA_LEAF(structure_lens_flare_marker, struct structure_lens_flare_marker)
+TAG_SCHEMA_BEGIN(structure_subcluster, struct structure_subcluster)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct structure_subcluster, surface_indices)
+TAG_SCHEMA_END(structure_subcluster)
+TAG_SCHEMA_BEGIN(structure_mirror, struct structure_mirror)
+    TAG_SCHEMA_REFERENCE(struct structure_mirror, shader)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct structure_mirror, points)
+TAG_SCHEMA_END(structure_mirror)
+TAG_SCHEMA_BEGIN(structure_cluster, struct structure_cluster)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct structure_cluster, predicted_resources)
+    TAG_SCHEMA_REFLEXIVE(struct structure_cluster, subclusters, structure_subcluster)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct structure_cluster, surface_indices)
+    TAG_SCHEMA_REFLEXIVE(struct structure_cluster, mirrors, structure_mirror)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct structure_cluster, portal_indices)
+TAG_SCHEMA_END(structure_cluster)
+TAG_SCHEMA_BEGIN(cluster_portal, struct cluster_portal)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct cluster_portal, vertices)
+TAG_SCHEMA_END(cluster_portal)
+TAG_SCHEMA_LEAF(structure_breakable_surface, struct structure_breakable_surface)
+TAG_SCHEMA_BEGIN(structure_fog_plane, struct structure_fog_plane)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct structure_fog_plane, vertices)
+TAG_SCHEMA_END(structure_fog_plane)
+TAG_SCHEMA_LEAF(structure_fog_region, struct structure_fog_region)
+TAG_SCHEMA_BEGIN(structure_fog_palette_entry, struct structure_fog_palette_entry)
+    TAG_SCHEMA_REFERENCE(struct structure_fog_palette_entry, fog)
+TAG_SCHEMA_END(structure_fog_palette_entry)
+TAG_SCHEMA_BEGIN(structure_weather_palette_entry, struct structure_weather_palette_entry)
+    TAG_SCHEMA_REFERENCE(struct structure_weather_palette_entry, particle_system)
+    TAG_SCHEMA_REFERENCE(struct structure_weather_palette_entry, wind)
+TAG_SCHEMA_END(structure_weather_palette_entry)
+TAG_SCHEMA_BEGIN(structure_weather_polyhedron, struct structure_weather_polyhedron)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct structure_weather_polyhedron, planes)
+TAG_SCHEMA_END(structure_weather_polyhedron)
+TAG_SCHEMA_BEGIN(structure_background_sound_palette_entry, struct structure_background_sound_palette_entry)
+    TAG_SCHEMA_REFERENCE(struct structure_background_sound_palette_entry, background_sound)
+TAG_SCHEMA_END(structure_background_sound_palette_entry)
+TAG_SCHEMA_BEGIN(structure_sound_environment_palette_entry, struct structure_sound_environment_palette_entry)
+    TAG_SCHEMA_REFERENCE(struct structure_sound_environment_palette_entry, sound_environment)
+TAG_SCHEMA_END(structure_sound_environment_palette_entry)
+TAG_SCHEMA_LEAF(structure_marker, struct structure_marker)
+TAG_SCHEMA_BEGIN(structure_detail_object_data, struct structure_detail_object_data)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct structure_detail_object_data, cells)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct structure_detail_object_data, detail_objects)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct structure_detail_object_data, detail_objects_counts)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct structure_detail_object_data, detail_object_z_reference_vectors)
+TAG_SCHEMA_END(structure_detail_object_data)
+TAG_SCHEMA_LEAF(structure_runtime_decal, struct structure_runtime_decal)
+TAG_SCHEMA_BEGIN(map_leaf_face, struct map_leaf_face)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct map_leaf_face, vertices)
+TAG_SCHEMA_END(map_leaf_face)
+TAG_SCHEMA_BEGIN(map_leaf, struct map_leaf)
+    TAG_SCHEMA_REFLEXIVE(struct map_leaf, faces, map_leaf_face)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct map_leaf, portal_designators)
+TAG_SCHEMA_END(map_leaf)
+TAG_SCHEMA_BEGIN(leaf_portal, struct leaf_portal)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct leaf_portal, vertices)
+TAG_SCHEMA_END(leaf_portal)
+TAG_SCHEMA_BEGIN(structure_bsp, struct structure_bsp)
+    TAG_SCHEMA_REFERENCE(struct structure_bsp, lightmap_group)
+    TAG_SCHEMA_REFLEXIVE(struct structure_bsp, collision_materials, structure_collision_material)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct structure_bsp, collision_bsp)
+    TAG_SCHEMA_REFLEXIVE(struct structure_bsp, nodes, structure_node)
+    TAG_SCHEMA_REFLEXIVE(struct structure_bsp, leaves, structure_leaf)
+    TAG_SCHEMA_REFLEXIVE(struct structure_bsp, surface_references, structure_surface_reference)
+    TAG_SCHEMA_REFLEXIVE(struct structure_bsp, surfaces, structure_surface)
+    TAG_SCHEMA_REFLEXIVE(struct structure_bsp, lightmaps, structure_lightmap)
+    TAG_SCHEMA_REFLEXIVE(struct structure_bsp, lens_flares, structure_lens_flare)
+    TAG_SCHEMA_REFLEXIVE(struct structure_bsp, lens_flare_markers, structure_lens_flare_marker)
+    TAG_SCHEMA_REFLEXIVE(struct structure_bsp, clusters, structure_cluster)
+    TAG_SCHEMA_DATA(struct structure_bsp, cluster_data)
+    TAG_SCHEMA_REFLEXIVE(struct structure_bsp, cluster_portals, cluster_portal)
+    TAG_SCHEMA_REFLEXIVE(struct structure_bsp, breakable_surfaces, structure_breakable_surface)
+    TAG_SCHEMA_REFLEXIVE(struct structure_bsp, fog_planes, structure_fog_plane)
+    TAG_SCHEMA_REFLEXIVE(struct structure_bsp, fog_regions, structure_fog_region)
+    TAG_SCHEMA_REFLEXIVE(struct structure_bsp, fog_palette, structure_fog_palette_entry)
+    TAG_SCHEMA_REFLEXIVE(struct structure_bsp, weather_palette, structure_weather_palette_entry)
+    TAG_SCHEMA_REFLEXIVE(struct structure_bsp, weather_polyhedra, structure_weather_polyhedron)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct structure_bsp, pathfinding_surfaces)
+    TAG_SCHEMA_REFLEXIVE_OPAQUE(struct structure_bsp, pathfinding_edges)
+    TAG_SCHEMA_REFLEXIVE(struct structure_bsp, background_sound_palette, structure_background_sound_palette_entry)
+    TAG_SCHEMA_REFLEXIVE(struct structure_bsp, sound_environment_palette, structure_sound_environment_palette_entry)
+    TAG_SCHEMA_DATA(struct structure_bsp, sound_cluster_data)
+    TAG_SCHEMA_REFLEXIVE(struct structure_bsp, markers, structure_marker)
+    TAG_SCHEMA_REFLEXIVE(struct structure_bsp, detail_object_data, structure_detail_object_data)
+    TAG_SCHEMA_REFLEXIVE(struct structure_bsp, runtime_decals, structure_runtime_decal)
+    TAG_SCHEMA_REFLEXIVE(struct structure_bsp, leaf_map.leaves, map_leaf)
+    TAG_SCHEMA_REFLEXIVE(struct structure_bsp, leaf_map.portals, leaf_portal)
+TAG_SCHEMA_END(structure_bsp)
+
+// sound
+TAG_SCHEMA_BEGIN(sound_permutation, struct sound_permutation)
+    TAG_SCHEMA_TAG_ID(struct sound_permutation, cache_tag_index)
+    TAG_SCHEMA_TAG_ID(struct sound_permutation, runtime_tag_index)
+    TAG_SCHEMA_DATA(struct sound_permutation, samples)
+    TAG_SCHEMA_DATA(struct sound_permutation, mouth_data)
+    TAG_SCHEMA_DATA(struct sound_permutation, subtitle_data)
+TAG_SCHEMA_END(sound_permutation)
+TAG_SCHEMA_BEGIN(sound_pitch_range, struct sound_pitch_range)
+    TAG_SCHEMA_RUNTIME_VALUE(struct sound_pitch_range, runtime_permutation_flags)
+    TAG_SCHEMA_RUNTIME_VALUE(struct sound_pitch_range, runtime_last_permutation_index)
+    TAG_SCHEMA_RUNTIME_VALUE(struct sound_pitch_range, runtime_discarded_permutation_index)
+    TAG_SCHEMA_REFLEXIVE(struct sound_pitch_range, permutations, sound_permutation)
+TAG_SCHEMA_END(sound_pitch_range)
+TAG_SCHEMA_BEGIN(sound, struct sound)
+    TAG_SCHEMA_REFERENCE(struct sound, promotion_sound)
+    TAG_SCHEMA_REFLEXIVE(struct sound, pitch_ranges, sound_pitch_range)
+TAG_SCHEMA_END(sound)
+
+// Every group in tag_fourcc.h
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_ACTOR)
+TAG_SCHEMA_GROUP(TAG_FOURCC_ACTOR_VARIANT, actor_variant)
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_ANTENNA)
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_MODEL_ANIMATIONS)
+TAG_SCHEMA_GROUP(TAG_FOURCC_BIPED, unit)
+TAG_SCHEMA_GROUP(TAG_FOURCC_BITMAP, bitmap)
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_SPHEROID)
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_CONTINUOUS_DAMAGE_EFFECT)
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_MODEL_COLLISION_GEOMETRY)
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_COLOR_TABLE)
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_CONTRAIL)
+TAG_SCHEMA_GROUP(TAG_FOURCC_DEVICE_CONTROL, object)
+TAG_SCHEMA_GROUP(TAG_FOURCC_DECAL, decal)
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_UI_WIDGET_DEFINITION)
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_INPUT_DEVICE_DEFAULTS)
+TAG_SCHEMA_GROUP(TAG_FOURCC_DEVICE, object)
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_DETAIL_OBJECT_COLLECTION)
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_EFFECT)
+TAG_SCHEMA_GROUP(TAG_FOURCC_EQUIPMENT, object)
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_FLAG)
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_FOG)
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_FONT)
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_MATERIAL_EFFECTS)
+TAG_SCHEMA_GROUP(TAG_FOURCC_GARBAGE, object)
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_GLOW)
+TAG_SCHEMA_GROUP(TAG_FOURCC_GRENADE_HUD_INTERFACE, grenade_hud_interface)
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_HUD_MESSAGE_TEXT)
+TAG_SCHEMA_GROUP(TAG_FOURCC_HUD_NUMBER, hud_number)
+TAG_SCHEMA_GROUP(TAG_FOURCC_HUD_GLOBALS, hud_globals)
+TAG_SCHEMA_GROUP(TAG_FOURCC_ITEM, object)
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_ITEM_COLLECTION)
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_DAMAGE_EFFECT)
+TAG_SCHEMA_GROUP(TAG_FOURCC_LENS_FLARE, lens_flare)
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_LIGHTNING)
+TAG_SCHEMA_GROUP(TAG_FOURCC_DEVICE_LIGHT_FIXTURE, object)
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_LIGHT)
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_SOUND_LOOPING)
+TAG_SCHEMA_GROUP(TAG_FOURCC_DEVICE_MACHINE, object)
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_GLOBALS)
+TAG_SCHEMA_GROUP(TAG_FOURCC_METER, meter)
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_LIGHT_VOLUME)
+TAG_SCHEMA_GROUP(TAG_FOURCC_GBXMODEL, gbxmodel)
+TAG_SCHEMA_GROUP(TAG_FOURCC_MODEL, model)
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_MULTIPLAYER_SCENARIO_DESCRIPTION)
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_PREFERENCES_NETWORK_GAME)
+TAG_SCHEMA_GROUP(TAG_FOURCC_OBJECT, object)
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_PARTICLE)
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_PARTICLE_SYSTEM)
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_PHYSICS)
+TAG_SCHEMA_GROUP(TAG_FOURCC_PLACEHOLDER, object)
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_POINT_PHYSICS)
+TAG_SCHEMA_GROUP(TAG_FOURCC_PROJECTILE, object)
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_WEATHER_PARTICLE_SYSTEM)
+TAG_SCHEMA_GROUP(TAG_FOURCC_SCENARIO_STRUCTURE_BSP, structure_bsp)
+TAG_SCHEMA_GROUP(TAG_FOURCC_SCENERY, object)
+TAG_SCHEMA_GROUP(TAG_FOURCC_SHADER_TRANSPARENT_CHICAGO_EXTENDED, shader)
+TAG_SCHEMA_GROUP(TAG_FOURCC_SHADER_TRANSPARENT_CHICAGO, shader)
+TAG_SCHEMA_GROUP(TAG_FOURCC_SCENARIO, scenario)
+TAG_SCHEMA_GROUP(TAG_FOURCC_SHADER_ENVIRONMENT, shader)
+TAG_SCHEMA_GROUP(TAG_FOURCC_SHADER_TRANSPARENT_GLASS, shader)
+TAG_SCHEMA_GROUP(TAG_FOURCC_SHADER, shader)
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_SKY)
+TAG_SCHEMA_GROUP(TAG_FOURCC_SHADER_TRANSPARENT_METER, shader)
+TAG_SCHEMA_GROUP(TAG_FOURCC_SOUND, sound)
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_SOUND_ENVIRONMENT)
+TAG_SCHEMA_GROUP(TAG_FOURCC_SHADER_MODEL, shader_model)
+TAG_SCHEMA_GROUP(TAG_FOURCC_SHADER_TRANSPARENT_GENERIC, shader)
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_UI_WIDGET_COLLECTION)
+TAG_SCHEMA_GROUP(TAG_FOURCC_SHADER_TRANSPARENT_PLASMA, shader)
+TAG_SCHEMA_GROUP(TAG_FOURCC_SOUND_SCENERY, object)
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_STRING_LIST)
+TAG_SCHEMA_GROUP(TAG_FOURCC_SHADER_TRANSPARENT_WATER, shader)
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_TAG_COLLECTION)
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_CAMERA_TRACK)
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_DIALOGUE)
+TAG_SCHEMA_GROUP(TAG_FOURCC_UNIT_HUD_INTERFACE, unit_hud_interface)
+TAG_SCHEMA_GROUP(TAG_FOURCC_UNIT, unit)
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_UNICODE_STRING_LIST)
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_VIRTUAL_KEYBOARD)
+TAG_SCHEMA_GROUP(TAG_FOURCC_VEHICLE, unit)
+TAG_SCHEMA_GROUP(TAG_FOURCC_WEAPON, object)
+TAG_SCHEMA_GROUP_OPAQUE(TAG_FOURCC_WIND)
+TAG_SCHEMA_GROUP(TAG_FOURCC_WEAPON_HUD_INTERFACE, weapon_hud_interface)
+
+#undef TAG_SCHEMA_BEGIN
+#undef TAG_SCHEMA_END
+#undef TAG_SCHEMA_LEAF
+#undef TAG_SCHEMA_REFERENCE
+#undef TAG_SCHEMA_DATA
+#undef TAG_SCHEMA_RUNTIME_DATA
+#undef TAG_SCHEMA_REFLEXIVE
+#undef TAG_SCHEMA_REFLEXIVE_OPAQUE
+#undef TAG_SCHEMA_STRUCT
+#undef TAG_SCHEMA_RUNTIME_POINTER
+#undef TAG_SCHEMA_TAG_ID
+#undef TAG_SCHEMA_RUNTIME_VALUE
+#undef TAG_SCHEMA_GROUP
+#undef TAG_SCHEMA_GROUP_OPAQUE
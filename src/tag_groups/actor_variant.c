@@ -7,29 +7,32 @@
 
 #include "actor_variant.h"
 #include "unit.h"
+#include "../thread/thread_output.h"
 
-bool actor_variant_postprocess(TagID tag, struct tag_data_instance *tag_data) {
+// These can be invalid due to Bungie changing the struct after some stock tags were made, and tool.exe will not check them.
+static const struct tag_field_rule actor_variant_rule_list[] = {
+    TAG_FIELD_RULE_ENUM16_RANGE(struct actor_variant, grenade_combat.grenade_type,
+        NUMBER_OF_UNIT_GRENADE_TYPES, UNIT_GRENADE_TYPE_HUMAN_FRAGMENTATION, "grenade type is out of range"),
+    TAG_FIELD_RULE_ENUM16_RANGE(struct actor_variant, grenade_combat.trajectory_type,
+        NUMBER_OF_ACTOR_VARIANT_GRENADE_TRAJECTORIES, ACTOR_VARIANT_GRENADE_TRAJECTORY_TOSS, "grenade trajectory is out of range"),
+    TAG_FIELD_RULE_ENUM16_RANGE(struct actor_variant, grenade_combat.stimulus_type,
+        NUMBER_OF_ACTOR_VARIANT_GRENADE_STIMULI, ACTOR_VARIANT_GRENADE_STIMULUS_NONE, "grenade stimulus is out of range"),
+    TAG_FIELD_RULE_INT16_FLOOR(struct actor_variant, grenade_combat.minimum_enemy_count, 0, "minimum enemy count is negative"),
+
+    // Added in MCC CEA
+    UNIT_METAGAME_PROPERTIES_RULES(struct actor_variant, metagame_properties)
+};
+static const struct tag_field_rule_table actor_variant_rules = TAG_FIELD_RULE_TABLE(struct actor_variant, actor_variant_rule_list);
+
+bool actor_variant_postprocess(TagID tag, struct tag_data_instance *tag_data, struct tag_fix_plan *plan) {
     struct actor_variant *actor_variant = tag_get(tag, TAG_FOURCC_ACTOR_VARIANT, tag_data);
     if(!actor_variant) {
-        fprintf(stderr, "tag data for \"%s.%s\" is invalid\n",
+        thread_output_error("tag data for \"%s.%s\" is invalid\n",
             tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_ACTOR_VARIANT));
         return false;
     }
 
-    // These can be invalid due to Bungie changing the struct after some stock tags were made, and tool.exe will not check them.
-    if(actor_variant->grenade_combat.grenade_type >= NUMBER_OF_UNIT_GRENADE_TYPES) {
-        actor_variant->grenade_combat.grenade_type = UNIT_GRENADE_TYPE_HUMAN_FRAGMENTATION;
-    }
-    if(actor_variant->grenade_combat.trajectory_type >= NUMBER_OF_ACTOR_VARIANT_GRENADE_TRAJECTORIES) {
-        actor_variant->grenade_combat.trajectory_type = ACTOR_VARIANT_GRENADE_TRAJECTORY_TOSS;
-    }
-    if(actor_variant->grenade_combat.stimulus_type >= NUMBER_OF_ACTOR_VARIANT_GRENADE_STIMULI) {
-        actor_variant->grenade_combat.stimulus_type = ACTOR_VARIANT_GRENADE_STIMULUS_NONE;
-    }
-    actor_variant->grenade_combat.minimum_enemy_count = FLOOR(actor_variant->grenade_combat.minimum_enemy_count, 0);
-
-    // Added in MCC CEA
-    unit_process_metagame_properties(&actor_variant->metagame_properties);
+    tag_field_rules_apply(&actor_variant_rules, actor_variant, 1, plan);
 
     return true;
 }
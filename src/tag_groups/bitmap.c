@@ -6,11 +6,77 @@
 #include "../data_types.h"
 #include "../tag/tag.h"
 #include "../tag/tag_fourcc.h"
+#include "../cache/cache.h"
 #include "../resources/resources.h"
+#include "../resources/resource_index.h"
+#include "../resources/resource_map.h"
 
 #include "bitmap.h"
+#include "../thread/thread_output.h"
 
-bool bitmap_postprocess(TagID tag, struct tag_data_instance *tag_data) {
+// Points the tag at a bitmaps.map resource. Everything the tag had in the map is zeroed.
+bool bitmap_make_external(TagID tag, uint32_t resource_index, struct tag_data_instance *tag_data, struct tag_fix_plan *plan) {
+    struct bitmap *bitmap_group = tag_get(tag, TAG_FOURCC_BITMAP, tag_data);
+    const char *tag_path = tag_path_get(tag, tag_data);
+    if(!bitmap_group) {
+        thread_output_error("tag data for \"%s.%s\" is invalid\n", tag_path, tag_fourcc_to_extension(TAG_FOURCC_BITMAP));
+        return false;
+    }
+
+    // Zero stale reflexive data
+    for(size_t i = 0; i < bitmap_group->sequences.count; i++) {
+        struct bitmap_sequence *sequence = bitmap_get_sequence(bitmap_group, i, tag_data);
+        if(!sequence) {
+            thread_output_error("bitmap sequence %zu in \"%s.%s\" is out of bounds\n",
+                i, tag_path, tag_fourcc_to_extension(TAG_FOURCC_BITMAP));
+            return false;
+        }
+
+        if(!tag_reflexive_erase_element_data(&sequence->sprites, sizeof(struct bitmap_sprite), tag_data, plan)) {
+            thread_output_error("sprite data for bitmap sequence %zu in \"%s.%s\" is out of bounds\n",
+                i, tag_path, tag_fourcc_to_extension(TAG_FOURCC_BITMAP));
+            return false;
+        }
+    }
+
+    if(!tag_reflexive_erase_element_data(&bitmap_group->sequences, sizeof(struct bitmap_sequence), tag_data, plan)) {
+        thread_output_error("bitmap sequence data for \"%s.%s\" is out of bounds\n",
+            tag_path, tag_fourcc_to_extension(TAG_FOURCC_BITMAP));
+        return false;
+    }
+
+    if(!tag_reflexive_erase_element_data(&bitmap_group->bitmaps, sizeof(struct bitmap_data), tag_data, plan)) {
+        thread_output_error("bitmap data for \"%s.%s\" is out of bounds\n",
+            tag_path, tag_fourcc_to_extension(TAG_FOURCC_BITMAP));
+        return false;
+    }
+
+    struct tag_instance *tag_instance = &tag_data->tags[tag.index];
+    tag_fix_plan_zero(plan, bitmap_group, sizeof(struct bitmap), "bitmap is in bitmaps.map");
+    TAG_FIX_PLAN_SET(plan, tag_instance->external, 1, "bitmap is in bitmaps.map");
+    TAG_FIX_PLAN_SET(plan, tag_instance->base_address, resource_index, "bitmap is in bitmaps.map");
+    return true;
+}
+
+// The bitmaps.map tag whose entries have all of the external pixels of this bitmap in them
+static uint32_t bitmap_find_external_pixels(struct bitmap *bitmap_group, const struct resource_index *index, struct tag_data_instance *tag_data) {
+    uint32_t resource_index = RESOURCE_MAP_NO_MATCH;
+    for(size_t i = 0; i < bitmap_group->bitmaps.count; i++) {
+        struct bitmap_data *bitmap = bitmap_get_data(bitmap_group, i, tag_data);
+        if(!TEST_FLAG(bitmap->flags, BITMAP_DATA_FLAGS_EXTERNAL_BIT)) {
+            continue;
+        }
+
+        uint32_t owner = resource_index_find_bitmap_pixels(index, bitmap->pixels_offset, bitmap->pixels_size);
+        if(owner == RESOURCE_MAP_NO_MATCH || (resource_index != RESOURCE_MAP_NO_MATCH && owner != resource_index)) {
+            return RESOURCE_MAP_NO_MATCH;
+        }
+        resource_index = owner;
+    }
+    return resource_index;
+}
+
+bool bitmap_postprocess(TagID tag, struct tag_data_instance *tag_data, struct tag_fix_plan *plan) {
     // Nothing to process?
     if(!tag_data->indexed_external_tags || tag_is_external(tag, tag_data)) {
         return true;
@@ -21,66 +87,211 @@ bool bitmap_postprocess(TagID tag, struct tag_data_instance *tag_data) {
     struct bitmap *bitmap_group = tag_get(tag, TAG_FOURCC_BITMAP, tag_data);
     const char *tag_path = tag_path_get(tag, tag_data);
     if(!bitmap_group) {
-        fprintf(stderr, "tag data for \"%s.%s\" is invalid\n", tag_path, tag_fourcc_to_extension(TAG_FOURCC_BITMAP));
+        thread_output_error("tag data for \"%s.%s\" is invalid\n", tag_path, tag_fourcc_to_extension(TAG_FOURCC_BITMAP));
         return false;
     }
 
-    bool make_external = false;
+    bool has_external_pixels = false;
     for(size_t i = 0; i < bitmap_group->bitmaps.count; i++) {
         struct bitmap_data *bitmap = bitmap_get_data(bitmap_group, i, tag_data);
         if(!bitmap) {
-            fprintf(stderr, "bitmap data %zu in \"%s.%s\" is out of bounds\n", i, tag_path, tag_fourcc_to_extension(TAG_FOURCC_BITMAP));
+            thread_output_error("bitmap data %zu in \"%s.%s\" is out of bounds\n", i, tag_path, tag_fourcc_to_extension(TAG_FOURCC_BITMAP));
             return false;
         }
 
         if(TEST_FLAG(bitmap->flags, BITMAP_DATA_FLAGS_EXTERNAL_BIT)) {
-            make_external = true;
-            break;
+            has_external_pixels = true;
         }
     }
 
-    // Set an index based on tag path
-    if(make_external) {
-        auto resource_index = resources_get_bitmap_index(tag_path);
+    // Set an index based on tag path. With the real bitmaps.map, the pixels can also say which tag it is.
+    if(has_external_pixels) {
+        uint32_t resource_index;
+        if(tag_data->resource_index) {
+            resource_index = resource_index_find_bitmap(tag_data->resource_index, tag_path);
+            if(resource_index == RESOURCE_MAP_NO_MATCH) {
+                resource_index = bitmap_find_external_pixels(bitmap_group, tag_data->resource_index, tag_data);
+            }
+        }
+        else {
+            resource_index = resources_get_bitmap_index(tag_path);
+        }
         if(resource_index == RESOURCE_MAP_NO_MATCH) {
-            fprintf(stderr, "bitmap \"%s\" has external pixels but does not map to the stock bitmaps.map by path index\nThe map should be rebuilt\n", tag_path);
+            thread_output_error("bitmap \"%s\" has external pixels but does not map to %s bitmaps.map by path index\nThe map should be rebuilt\n",
+                tag_path, tag_data->resource_index ? "the given" : "the stock");
             return false;
         }
 
-        // Zero stale reflexive data
-        for(size_t i = 0; i < bitmap_group->sequences.count; i++) {
-            struct bitmap_sequence *sequence = bitmap_get_sequence(bitmap_group, i, tag_data);
-            if(!sequence) {
-                fprintf(stderr, "bitmap sequence %zu in \"%s.%s\" is out of bounds\n",
-                    i, tag_path, tag_fourcc_to_extension(TAG_FOURCC_BITMAP));
-                return false;
-            }
+        if(!bitmap_make_external(tag, resource_index, tag_data, plan)) {
+            return false;
+        }
+        thread_output_error("bitmap \"%s\" had external pixels and was remapped to use bitmaps.map resource index %u\n", tag_path, resource_index);
+    }
 
-            if(!tag_reflexive_erase_element_data(&sequence->sprites, sizeof(struct bitmap_sprite), tag_data)) {
-                fprintf(stderr, "sprite data for bitmap sequence %zu in \"%s.%s\" is out of bounds\n",
-                    i, tag_path, tag_fourcc_to_extension(TAG_FOURCC_BITMAP));
-                return false;
-            }
+    return true;
+}
+
+// A bitmap either in the cache file or in bitmaps.map. Pixel offsets are file offsets in either one.
+struct bitmap_source {
+    struct tag_data_instance *tag_data; // nullptr for a resource
+    const struct resource_map *map;
+    uint32_t resource;
+    const uint8_t *file;
+    size_t file_size;
+};
+
+static const void *bitmap_source_resolve(const struct bitmap_source *source, Pointer32 address, size_t size) {
+    if(source->tag_data) {
+        return tag_resolve_pointer(address, size, source->tag_data);
+    }
+    return resource_map_get_data(source->map, source->resource, address, size);
+}
+
+static const uint8_t *bitmap_source_get_pixels(const struct bitmap_source *source, const struct bitmap_data *bitmap) {
+    if(source->tag_data && TEST_FLAG(bitmap->flags, BITMAP_DATA_FLAGS_EXTERNAL_BIT)) {
+        return nullptr;
+    }
+    if(bitmap->pixels_offset > source->file_size || bitmap->pixels_size > source->file_size - bitmap->pixels_offset) {
+        return nullptr;
+    }
+    return source->file + bitmap->pixels_offset;
+}
+
+// Hash of all of the pixels, or 0 if any are missing
+static uint64_t bitmap_source_key(const struct bitmap_source *source, const struct bitmap *bitmap_group) {
+    const struct bitmap_data *bitmaps = bitmap_source_resolve(source, bitmap_group->bitmaps.address, bitmap_group->bitmaps.count * sizeof(struct bitmap_data));
+    if(!bitmaps || bitmap_group->bitmaps.count == 0) {
+        return 0;
+    }
+
+    uint64_t hash = RESOURCE_MAP_HASH_NEW;
+    for(size_t i = 0; i < bitmap_group->bitmaps.count; i++) {
+        const uint8_t *pixels = bitmap_source_get_pixels(source, &bitmaps[i]);
+        if(!pixels) {
+            return 0;
         }
+        hash = resource_map_hash(hash, pixels, bitmaps[i].pixels_size);
+    }
+    return hash != 0 ? hash : 1;
+}
+
+// Clears pointers, offsets and what the game sets when loading so the rest can be compared
+static struct bitmap bitmap_masked(const struct bitmap *bitmap_group) {
+    struct bitmap masked = *bitmap_group;
+    memset(&masked.import_bitmap, 0, sizeof(masked.import_bitmap));
+    memset(&masked.pixel_data, 0, sizeof(masked.pixel_data));
+    masked.sequences.address = masked.sequences.definition = 0;
+    masked.bitmaps.address = masked.bitmaps.definition = 0;
+    return masked;
+}
+
+static struct bitmap_data bitmap_data_masked(const struct bitmap_data *bitmap) {
+    struct bitmap_data masked = *bitmap;
+    SET_FLAG(masked.flags, BITMAP_DATA_FLAGS_EXTERNAL_BIT, false);
+    masked.pixels_offset = 0;
+    masked.tag_index.whole_id = 0;
+    masked.cache_block_index = 0;
+    masked.hardware_format = 0;
+    masked.base_address = 0;
+    return masked;
+}
 
-        if(!tag_reflexive_erase_element_data(&bitmap_group->sequences, sizeof(struct bitmap_sequence), tag_data)) {
-            fprintf(stderr, "bitmap sequence data for \"%s.%s\" is out of bounds\n",
-                tag_path, tag_fourcc_to_extension(TAG_FOURCC_BITMAP));
+static bool bitmap_sources_match(const struct bitmap_source *a, const struct bitmap *group_a, const struct bitmap_source *b, const struct bitmap *group_b) {
+    struct bitmap base_a = bitmap_masked(group_a);
+    struct bitmap base_b = bitmap_masked(group_b);
+    if(memcmp(&base_a, &base_b, sizeof(struct bitmap)) != 0) {
+        return false;
+    }
+
+    size_t sequence_count = group_a->sequences.count;
+    const struct bitmap_sequence *sequences_a = bitmap_source_resolve(a, group_a->sequences.address, sequence_count * sizeof(struct bitmap_sequence));
+    const struct bitmap_sequence *sequences_b = bitmap_source_resolve(b, group_b->sequences.address, sequence_count * sizeof(struct bitmap_sequence));
+    if(sequence_count > 0 && (!sequences_a || !sequences_b)) {
+        return false;
+    }
+    for(size_t i = 0; i < sequence_count; i++) {
+        struct bitmap_sequence sequence_a = sequences_a[i];
+        struct bitmap_sequence sequence_b = sequences_b[i];
+        sequence_a.sprites.address = sequence_a.sprites.definition = 0;
+        sequence_b.sprites.address = sequence_b.sprites.definition = 0;
+        if(memcmp(&sequence_a, &sequence_b, sizeof(struct bitmap_sequence)) != 0) {
             return false;
         }
 
-        if(!tag_reflexive_erase_element_data(&bitmap_group->bitmaps, sizeof(struct bitmap_data), tag_data)) {
-            fprintf(stderr, "bitmap data for \"%s.%s\" is out of bounds\n",
-                tag_path, tag_fourcc_to_extension(TAG_FOURCC_BITMAP));
+        size_t sprites_size = sequence_a.sprites.count * sizeof(struct bitmap_sprite);
+        const void *sprites_a = bitmap_source_resolve(a, sequences_a[i].sprites.address, sprites_size);
+        const void *sprites_b = bitmap_source_resolve(b, sequences_b[i].sprites.address, sprites_size);
+        if(sprites_size > 0 && (!sprites_a || !sprites_b || memcmp(sprites_a, sprites_b, sprites_size) != 0)) {
+            return false;
+        }
+    }
+
+    size_t bitmap_count = group_a->bitmaps.count;
+    const struct bitmap_data *bitmaps_a = bitmap_source_resolve(a, group_a->bitmaps.address, bitmap_count * sizeof(struct bitmap_data));
+    const struct bitmap_data *bitmaps_b = bitmap_source_resolve(b, group_b->bitmaps.address, bitmap_count * sizeof(struct bitmap_data));
+    if(!bitmaps_a || !bitmaps_b) {
+        return false;
+    }
+    for(size_t i = 0; i < bitmap_count; i++) {
+        struct bitmap_data bitmap_a = bitmap_data_masked(&bitmaps_a[i]);
+        struct bitmap_data bitmap_b = bitmap_data_masked(&bitmaps_b[i]);
+        if(memcmp(&bitmap_a, &bitmap_b, sizeof(struct bitmap_data)) != 0) {
             return false;
         }
 
-        memset(bitmap_group, 0, sizeof(struct bitmap));
-        bitmap_group = nullptr;
-        tag_data->tags[tag.index].external = 1;
-        tag_data->tags[tag.index].base_address = resource_index;
-        fprintf(stderr, "bitmap \"%s\" had external pixels and was remapped to use bitmaps.map resource index %u\n", tag_path, resource_index);
+        const uint8_t *pixels_a = bitmap_source_get_pixels(a, &bitmaps_a[i]);
+        const uint8_t *pixels_b = bitmap_source_get_pixels(b, &bitmaps_b[i]);
+        if(!pixels_a || !pixels_b || memcmp(pixels_a, pixels_b, bitmap_a.pixels_size) != 0) {
+            return false;
+        }
     }
 
     return true;
 }
+
+static const struct bitmap *bitmap_resource_get(const struct resource_map *map, uint32_t resource, struct bitmap_source *source) {
+    *source = (struct bitmap_source){
+        .map = map,
+        .resource = resource,
+        .file = map->data,
+        .file_size = map->size
+    };
+    return resource_map_get_data(map, resource, 0, sizeof(struct bitmap));
+}
+
+// For resource_map_index_build. Only resources that are bitmap tags get a key.
+uint64_t bitmap_resource_key(const struct resource_map *map, uint32_t resource) {
+    struct bitmap_source source;
+    const struct bitmap *bitmap_group = bitmap_resource_get(map, resource, &source);
+    return bitmap_group ? bitmap_source_key(&source, bitmap_group) : 0;
+}
+
+// The bitmaps.map resource that is the same bitmap with the same pixels, if any. Only bitmaps with all of their pixels
+// in the cache file are looked at.
+uint32_t bitmap_find_in_resource_map(TagID tag, struct cache_file_instance *cache_file, const struct resource_map *map, const struct resource_map_index *index) {
+    assert(cache_file && cache_file->valid && map && index);
+    struct tag_data_instance *tag_data = &cache_file->tag_data;
+    const struct bitmap *bitmap_group = tag_get(tag, TAG_FOURCC_BITMAP, tag_data);
+    if(!bitmap_group || tag_is_external(tag, tag_data)) {
+        return RESOURCE_MAP_NO_MATCH;
+    }
+
+    struct bitmap_source source = {
+        .tag_data = tag_data,
+        .file = cache_file->data,
+        .file_size = cache_file->header->tags_offset
+    };
+    uint64_t key = bitmap_source_key(&source, bitmap_group);
+    if(key == 0) {
+        return RESOURCE_MAP_NO_MATCH;
+    }
+
+    for(size_t i = resource_map_index_find(index, key); i < index->count && index->keys[i] == key; i++) {
+        struct bitmap_source resource_source;
+        const struct bitmap *resource_group = bitmap_resource_get(map, index->resources[i], &resource_source);
+        if(bitmap_sources_match(&source, bitmap_group, &resource_source, resource_group)) {
+            return index->resources[i];
+        }
+    }
+    return RESOURCE_MAP_NO_MATCH;
+}
@@ -4,6 +4,9 @@
 
 #include "../data_types.h"
 #include "../tag/tag.h"
+#include "../tag/tag_fix_plan.h"
+#include "../cache/cache.h"
+#include "../resources/resource_map.h"
 
 enum {
     BITMAP_FLAGS_DIFFUSION_DITHER_BIT,
@@ -184,4 +187,7 @@ static_assert(sizeof(struct bitmap) == 108);
 #define bitmap_get_sprite(sequence, index, data) tag_reflexive_get_element(&(sequence)->sprites, index, sizeof(struct bitmap_sprite), data)
 #define bitmap_get_data(bitmap, index, data) tag_reflexive_get_element(&(bitmap)->bitmaps, index, sizeof(struct bitmap_data), data)
 
-bool bitmap_postprocess(TagID tag, struct tag_data_instance *tag_data);
+bool bitmap_postprocess(TagID tag, struct tag_data_instance *tag_data, struct tag_fix_plan *plan);
+bool bitmap_make_external(TagID tag, uint32_t resource_index, struct tag_data_instance *tag_data, struct tag_fix_plan *plan);
+uint64_t bitmap_resource_key(const struct resource_map *map, uint32_t resource);
+uint32_t bitmap_find_in_resource_map(TagID tag, struct cache_file_instance *cache_file, const struct resource_map *map, const struct resource_map_index *index);
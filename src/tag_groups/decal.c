@@ -1,20 +1,159 @@
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <assert.h>
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
 
 #include "../data_types.h"
 #include "../tag/tag.h"
 #include "../tag/tag_fourcc.h"
+#include "../resources/resources_hash.h"
 
 #include "decal.h"
 #include "bitmap.h"
+#include "../thread/thread_output.h"
 
 extern struct decal_bitmap_extent decal_stock_bitmap_extent_list[];
 
-bool decal_postprocess(TagID tag, struct tag_data_instance *tag_data) {
+#ifdef __SSE__
+// MAX() keeps the later value when two compare equal and lets NaN through, which is order dependent. The SIMD walk
+// takes lanes out of order, so its result is only used when it is positive and not NaN; that value is unique.
+static inline bool decal_sprite_extent_is_exact(float extent) {
+    return extent > 0.0f;
+}
+
+#define DECAL_SPRITE_LANES 4
+
+// Sprites waiting to be walked, one per lane
+struct decal_sprite_lanes {
+    struct bitmap_sprite *sprites[DECAL_SPRITE_LANES];
+    struct bitmap_data *bitmaps[DECAL_SPRITE_LANES];
+    size_t count;
+};
+
+// Takes four sprites at a time. Unused lanes are zero, which does not change the maximum since it starts at zero.
+static inline __m128 decal_sprite_extent_max(__m128 max_extent, __m128 *nan_lanes, struct decal_sprite_lanes *lanes) {
+    float registration_x[DECAL_SPRITE_LANES] = {};
+    float registration_y[DECAL_SPRITE_LANES] = {};
+    float width[DECAL_SPRITE_LANES] = {};
+    float height[DECAL_SPRITE_LANES] = {};
+    float scale_x[DECAL_SPRITE_LANES] = {};
+    float scale_y[DECAL_SPRITE_LANES] = {};
+    for(size_t i = 0; i < lanes->count; i++) {
+        struct bitmap_sprite *sprite = lanes->sprites[i];
+        registration_x[i] = sprite->registration_point.x;
+        registration_y[i] = sprite->registration_point.y;
+        width[i] = sprite->bounds.x1 - sprite->bounds.x0;
+        height[i] = sprite->bounds.y1 - sprite->bounds.y0;
+        scale_x[i] = (float)lanes->bitmaps[i]->width;
+        scale_y[i] = (float)lanes->bitmaps[i]->height;
+    }
+    lanes->count = 0;
+
+    // The registration point x and y and the distance from it to the right and bottom edge
+    __m128 x = _mm_loadu_ps(registration_x);
+    __m128 y = _mm_loadu_ps(registration_y);
+    __m128 sx = _mm_loadu_ps(scale_x);
+    __m128 sy = _mm_loadu_ps(scale_y);
+    __m128 extents[] = {
+        _mm_mul_ps(x, sx),
+        _mm_mul_ps(y, sy),
+        _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(width), x), sx),
+        _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(height), y), sy)
+    };
+    for(size_t e = 0; e < sizeof(extents) / sizeof(extents[0]); e++) {
+        *nan_lanes = _mm_or_ps(*nan_lanes, _mm_cmpunord_ps(extents[e], extents[e]));
+        max_extent = _mm_max_ps(max_extent, extents[e]);
+    }
+    return max_extent;
+}
+#else
+static inline bool decal_sprite_extent_is_exact(float) {
+    return true;
+}
+#endif
+
+static bool decal_get_maximum_sprite_extent(float *max_sprite_extent, TagID map, struct tag_data_instance *tag_data, bool vectorize) {
+    struct bitmap *bitmap_group = tag_get(map, TAG_FOURCC_BITMAP, tag_data);
+    if(!bitmap_group) {
+        thread_output_error("tag data for \"%s.%s\" is invalid\n",
+            tag_path_get(map, tag_data), tag_fourcc_to_extension(TAG_FOURCC_BITMAP));
+        return false;
+    }
+
+    #ifdef __SSE__
+    __m128 max_extent = _mm_setzero_ps();
+    __m128 nan_lanes = _mm_setzero_ps();
+    struct decal_sprite_lanes lanes = {};
+    #else
+    vectorize = false;
+    #endif
+
+    *max_sprite_extent = 0.0f;
+    if(bitmap_group->type == BITMAP_TYPE_SPRITES) {
+        for(size_t sequence_index = 0; sequence_index < bitmap_group->sequences.count; sequence_index++) {
+            struct bitmap_sequence *sequence = bitmap_get_sequence(bitmap_group, sequence_index, tag_data);
+            if(!sequence) {
+                thread_output_error("bitmap sequence %zu in \"%s.%s\" is out of bounds\n",
+                    sequence_index, tag_path_get(map, tag_data), tag_fourcc_to_extension(TAG_FOURCC_BITMAP));
+                return false;
+            }
+
+            for(size_t sprite_index = 0; sprite_index < sequence->sprites.count; sprite_index++) {
+                struct bitmap_sprite *sprite = bitmap_get_sprite(sequence, sprite_index, tag_data);
+                if(!sprite) {
+                    thread_output_error("bitmap sprite %zu of sequence %zu in \"%s.%s\" is out of bounds\n",
+                        sprite_index, sequence_index, tag_path_get(map, tag_data), tag_fourcc_to_extension(TAG_FOURCC_BITMAP));
+                    return false;
+                }
+
+                struct bitmap_data *bitmap = bitmap_get_data(bitmap_group, sprite->bitmap_index, tag_data);
+                if(!bitmap) {
+                    thread_output_error("bitmap data %u in \"%s.%s\" is out of bounds\n",
+                        sprite->bitmap_index, tag_path_get(map, tag_data), tag_fourcc_to_extension(TAG_FOURCC_BITMAP));
+                    return false;
+                }
+
+                #ifdef __SSE__
+                if(vectorize) {
+                    lanes.sprites[lanes.count] = sprite;
+                    lanes.bitmaps[lanes.count] = bitmap;
+                    if(++lanes.count == DECAL_SPRITE_LANES) {
+                        max_extent = decal_sprite_extent_max(max_extent, &nan_lanes, &lanes);
+                    }
+                    continue;
+                }
+                #endif
+
+                *max_sprite_extent = MAX(*max_sprite_extent, (sprite->registration_point.x) * (float)bitmap->width);
+                *max_sprite_extent = MAX(*max_sprite_extent, (sprite->registration_point.y) * (float)bitmap->height);
+                *max_sprite_extent = MAX(*max_sprite_extent, (sprite->bounds.x1 - sprite->bounds.x0 - sprite->registration_point.x) * (float)bitmap->width);
+                *max_sprite_extent = MAX(*max_sprite_extent, (sprite->bounds.y1 - sprite->bounds.y0 - sprite->registration_point.y) * (float)bitmap->height);
+            }
+        }
+    }
+
+    #ifdef __SSE__
+    if(vectorize) {
+        max_extent = decal_sprite_extent_max(max_extent, &nan_lanes, &lanes);
+        max_extent = _mm_max_ps(max_extent, _mm_movehl_ps(max_extent, max_extent));
+        max_extent = _mm_max_ps(max_extent, _mm_shuffle_ps(max_extent, max_extent, _MM_SHUFFLE(1, 1, 1, 1)));
+        *max_sprite_extent = _mm_movemask_ps(nan_lanes) ? NAN : _mm_cvtss_f32(max_extent);
+    }
+    #endif
+
+    return true;
+}
+
+bool decal_postprocess(TagID tag, struct tag_data_instance *tag_data, struct tag_fix_plan *plan) {
     struct decal *decal = tag_get(tag, TAG_FOURCC_DECAL, tag_data);
     if(!decal) {
-        fprintf(stderr, "tag data for \"%s.%s\" is invalid\n",
+        thread_output_error("tag data for \"%s.%s\" is invalid\n",
             tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_DECAL));
         return false;
     }
@@ -23,13 +162,13 @@ bool decal_postprocess(TagID tag, struct tag_data_instance *tag_data) {
     // considered to have no bitmap when the code is run so it always defaults to 16.0f
     auto map = decal->shader.decal.map.index;
     if(!TEST_FLAG(decal->flags, DECAL_FLAGS_SPRITE_SCALE_BUG_FIX_BIT) || map.whole_id == NULL_ID) {
-        decal->runtime_maximum_sprite_extent = 16.0f;
+        TAG_FIX_PLAN_SET(plan, decal->runtime_maximum_sprite_extent, 16.0f, "maximum sprite extent is not calculated");
         return true;
     }
 
     // Calculate runtime_maximum_sprite_extent based on the bitmap
     if(!tag_id_is_valid_tag(map, tag_data)) {
-        fprintf(stderr, "decal \"%s.%s\" references an invalid bitmap\n",
+        thread_output_error("decal \"%s.%s\" references an invalid bitmap\n",
             tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_DECAL));
         return false;
     }
@@ -38,59 +177,66 @@ bool decal_postprocess(TagID tag, struct tag_data_instance *tag_data) {
     // This will not work if the target bitmaps.map had custom decal bitmaps in it, but we do not support those anyway
     // Ideally the game would re-calculate this on map load when loading external bitmap tags
     if(tag_is_external(map, tag_data)) {
-        for(size_t i = 0; i < NUMBER_OF_STOCK_DECAL_BITMAPS; i++) {
-            if(strcmp(tag_path_get(map, tag_data), decal_stock_bitmap_extent_list[i].name) == 0) {
-                decal->runtime_maximum_sprite_extent = decal_stock_bitmap_extent_list[i].extent;
-                return true;
-            }
+        const char *map_path = tag_path_get(map, tag_data);
+        auto i = resources_hash_find(&decal_stock_bitmap_extent_hash_table, map_path);
+        if(i != RESOURCES_HASH_NO_MATCH && strcmp(map_path, decal_stock_bitmap_extent_list[i].name) == 0) {
+            TAG_FIX_PLAN_SET(plan, decal->runtime_maximum_sprite_extent, decal_stock_bitmap_extent_list[i].extent,
+                "maximum sprite extent is not calculated");
+            return true;
         }
 
-        fprintf(stderr, "decal \"%s.%s\" references external bitmap \"%s.%s\" that does not match a known decal bitmap and cannot be processed by this tool\n",
+        thread_output_error("decal \"%s.%s\" references external bitmap \"%s.%s\" that does not match a known decal bitmap and cannot be processed by this tool\n",
             tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_DECAL),
             tag_path_get(map, tag_data), tag_fourcc_to_extension(TAG_FOURCC_BITMAP));
         return false;
     }
 
-    struct bitmap *bitmap_group = tag_get(map, TAG_FOURCC_BITMAP, tag_data);
-    if(!bitmap_group) {
-        fprintf(stderr, "tag data for \"%s.%s\" is invalid\n",
+    // Many decals share one sprite bitmap, so only walk each one once per map
+    float max_sprite_extent;
+    struct decal_extent_cache *cache = tag_data->decal_extent_cache;
+    struct decal_extent_cache_entry *entry = cache && map.index < cache->count ? &cache->entries[map.index] : nullptr;
+    unsigned state = DECAL_EXTENT_CACHE_STATE_EMPTY;
+    bool claimed = entry && atomic_compare_exchange_strong_explicit(&entry->state, &state, DECAL_EXTENT_CACHE_STATE_PENDING, memory_order_acquire, memory_order_acquire);
+    if(state == DECAL_EXTENT_CACHE_STATE_INVALID) {
+        thread_output_error("decal \"%s.%s\" references bitmap \"%s.%s\" which has invalid sprite data\n",
+            tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_DECAL),
             tag_path_get(map, tag_data), tag_fourcc_to_extension(TAG_FOURCC_BITMAP));
         return false;
     }
+    else if(state == DECAL_EXTENT_CACHE_STATE_VALID) {
+        max_sprite_extent = entry->extent;
+    }
+    else {
+        // If another decal is still walking this bitmap, walk it too instead of waiting, but leave the entry to them
+        bool valid = decal_get_maximum_sprite_extent(&max_sprite_extent, map, tag_data, true);
+        if(valid && !decal_sprite_extent_is_exact(max_sprite_extent)) {
+            valid = decal_get_maximum_sprite_extent(&max_sprite_extent, map, tag_data, false);
+        }
 
-    float max_sprite_extent = 0.0f;
-    if(bitmap_group->type == BITMAP_TYPE_SPRITES) {
-        for(size_t sequence_index = 0; sequence_index < bitmap_group->sequences.count; sequence_index++) {
-            struct bitmap_sequence *sequence = bitmap_get_sequence(bitmap_group, sequence_index, tag_data);
-            if(!sequence) {
-                fprintf(stderr, "bitmap sequence %zu in \"%s.%s\" is out of bounds\n",
-                    sequence_index, tag_path_get(map, tag_data), tag_fourcc_to_extension(TAG_FOURCC_BITMAP));
-                return false;
-            }
-
-            for(size_t sprite_index = 0; sprite_index < sequence->sprites.count; sprite_index++) {
-                struct bitmap_sprite *sprite = bitmap_get_sprite(sequence, sprite_index, tag_data);
-                if(!sprite) {
-                    fprintf(stderr, "bitmap sprite %zu of sequence %zu in \"%s.%s\" is out of bounds\n",
-                        sprite_index, sequence_index, tag_path_get(map, tag_data), tag_fourcc_to_extension(TAG_FOURCC_BITMAP));
-                    return false;
-                }
-
-                struct bitmap_data *bitmap = bitmap_get_data(bitmap_group, sprite->bitmap_index, tag_data);
-                if(!bitmap) {
-                    fprintf(stderr, "bitmap data %u in \"%s.%s\" is out of bounds\n",
-                        sprite->bitmap_index, tag_path_get(map, tag_data), tag_fourcc_to_extension(TAG_FOURCC_BITMAP));
-                    return false;
-                }
+        if(claimed) {
+            entry->extent = max_sprite_extent;
+            atomic_store_explicit(&entry->state, valid ? DECAL_EXTENT_CACHE_STATE_VALID : DECAL_EXTENT_CACHE_STATE_INVALID, memory_order_release);
+        }
 
-                max_sprite_extent = MAX(max_sprite_extent, (sprite->registration_point.x) * (float)bitmap->width);
-                max_sprite_extent = MAX(max_sprite_extent, (sprite->registration_point.y) * (float)bitmap->height);
-                max_sprite_extent = MAX(max_sprite_extent, (sprite->bounds.x1 - sprite->bounds.x0 - sprite->registration_point.x) * (float)bitmap->width);
-                max_sprite_extent = MAX(max_sprite_extent, (sprite->bounds.y1 - sprite->bounds.y0 - sprite->registration_point.y) * (float)bitmap->height);
-            }
+        if(!valid) {
+            return false;
         }
     }
 
-    decal->runtime_maximum_sprite_extent = max_sprite_extent;
+    TAG_FIX_PLAN_SET(plan, decal->runtime_maximum_sprite_extent, max_sprite_extent, "maximum sprite extent is not calculated");
     return true;
 }
+
+bool decal_extent_cache_init(struct decal_extent_cache *cache, size_t tag_count) {
+    assert(cache);
+    cache->entries = calloc(tag_count + 1, sizeof(struct decal_extent_cache_entry));
+    cache->count = cache->entries ? tag_count : 0;
+    return cache->entries != nullptr;
+}
+
+void decal_extent_cache_free(struct decal_extent_cache *cache) {
+    assert(cache);
+    free(cache->entries);
+    cache->entries = nullptr;
+    cache->count = 0;
+}
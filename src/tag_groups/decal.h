@@ -1,9 +1,11 @@
 #pragma once
 
 #include <stdint.h>
+#include <stdatomic.h>
 
 #include "../data_types.h"
 #include "../tag/tag.h"
+#include "../tag/tag_fix_plan.h"
 #include "shader.h"
 
 #define NUMBER_OF_STOCK_DECAL_BITMAPS 85
@@ -75,4 +77,25 @@ struct decal_bitmap_extent {
     const float extent;
 };
 
-bool decal_postprocess(TagID tag, struct tag_data_instance *tag_data);
+enum {
+    DECAL_EXTENT_CACHE_STATE_EMPTY,
+    DECAL_EXTENT_CACHE_STATE_PENDING,
+    DECAL_EXTENT_CACHE_STATE_VALID,
+    DECAL_EXTENT_CACHE_STATE_INVALID
+};
+
+// Maximum sprite extent of each bitmap by tag index, filled in as decals reference them. The first decal to get to an
+// entry claims it and is the only one that writes the extent.
+struct decal_extent_cache_entry {
+    atomic_uint state;
+    float extent;
+};
+
+struct decal_extent_cache {
+    struct decal_extent_cache_entry *entries;
+    size_t count;
+};
+
+bool decal_postprocess(TagID tag, struct tag_data_instance *tag_data, struct tag_fix_plan *plan);
+bool decal_extent_cache_init(struct decal_extent_cache *cache, size_t tag_count);
+void decal_extent_cache_free(struct decal_extent_cache *cache);
@@ -4,21 +4,26 @@
 #include "../data_types.h"
 #include "../tag/tag.h"
 #include "../tag/tag_fourcc.h"
-#include "../tag/tag_processing.h"
 
 #include "hud_types.h"
 #include "grenade_hud_interface.h"
+#include "../thread/thread_output.h"
 
-bool grenade_hud_interface_postprocess(TagID tag, struct tag_data_instance *tag_data) {
+static const struct tag_field_rule grenade_hud_interface_rule_list[] = {
+    HUD_ABSOLUTE_PLACEMENT_CANVAS_SIZE_RULE(struct grenade_hud_interface, absolute_placement.canvas_size)
+};
+static const struct tag_field_rule_table grenade_hud_interface_rules = TAG_FIELD_RULE_TABLE(struct grenade_hud_interface, grenade_hud_interface_rule_list);
+
+bool grenade_hud_interface_postprocess(TagID tag, struct tag_data_instance *tag_data, struct tag_fix_plan *plan) {
     struct grenade_hud_interface *grenade_hud = tag_get(tag, TAG_FOURCC_GRENADE_HUD_INTERFACE, tag_data);
     if(!grenade_hud) {
-        fprintf(stderr, "tag data for \"%s.%s\" is invalid\n",
+        thread_output_error("tag data for \"%s.%s\" is invalid\n",
             tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_GRENADE_HUD_INTERFACE));
         return false;
     }
 
     // Absolute placement
-    hud_process_absolute_placement(&grenade_hud->absolute_placement);
+    tag_field_rules_apply(&grenade_hud_interface_rules, grenade_hud, 1, plan);
 
     return true;
 }
@@ -4,6 +4,7 @@
 
 #include "../data_types.h"
 #include "../tag/tag.h"
+#include "../tag/tag_fix_plan.h"
 
 #include "hud_types.h"
 #include "weapon_hud_interface.h"
@@ -47,4 +48,4 @@ static_assert(sizeof(struct grenade_hud_interface) == 504);
 
 #pragma pack(pop)
 
-bool grenade_hud_interface_postprocess(TagID tag, struct tag_data_instance *tag_data);
+bool grenade_hud_interface_postprocess(TagID tag, struct tag_data_instance *tag_data, struct tag_fix_plan *plan);
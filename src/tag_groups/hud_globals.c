@@ -8,11 +8,17 @@
 
 #include "hud_types.h"
 #include "hud_globals.h"
+#include "../thread/thread_output.h"
 
-bool hud_globals_postprocess(TagID tag, struct tag_data_instance *tag_data) {
+static const struct tag_field_rule hud_globals_rule_list[] = {
+    HUD_ABSOLUTE_PLACEMENT_CANVAS_SIZE_RULE(struct hud_globals, messaging.absolute_placement.canvas_size)
+};
+static const struct tag_field_rule_table hud_globals_rules = TAG_FIELD_RULE_TABLE(struct hud_globals, hud_globals_rule_list);
+
+bool hud_globals_postprocess(TagID tag, struct tag_data_instance *tag_data, struct tag_fix_plan *plan) {
     struct hud_globals *hud_globals = tag_get(tag, TAG_FOURCC_HUD_GLOBALS, tag_data);
     if(!hud_globals) {
-        fprintf(stderr, "tag data for \"%s.%s\" is invalid\n",
+        thread_output_error("tag data for \"%s.%s\" is invalid\n",
             tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_HUD_GLOBALS));
         return false;
     }
@@ -21,13 +27,13 @@ bool hud_globals_postprocess(TagID tag, struct tag_data_instance *tag_data) {
     // If these have a count, then it was likely truncated in a way where the rest of the tag is fine
     // as these are the last thing defined in the tag. We zero it out here so it can be extracted.
     if(hud_globals->bitmap_remaps.count != 0) {
-        memset(&hud_globals->bitmap_remaps, 0, sizeof(struct tag_reflexive));
-        fprintf(stderr, "HUD globals tag \"%s.%s\" had MCC CEA bitmap remaps\nthis was likely corrupted by the older tool.exe so the reflexive was zeroed out\n",
+        tag_fix_plan_zero(plan, &hud_globals->bitmap_remaps, sizeof(struct tag_reflexive), "MCC CEA bitmap remaps are corrupt");
+        thread_output_error("HUD globals tag \"%s.%s\" had MCC CEA bitmap remaps\nthis was likely corrupted by the older tool.exe so the reflexive was zeroed out\n",
             tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_HUD_GLOBALS));
     }
 
     // Absolute placement
-    hud_process_absolute_placement(&hud_globals->messaging.absolute_placement);
+    tag_field_rules_apply(&hud_globals_rules, hud_globals, 1, plan);
 
     return true;
 }
@@ -4,6 +4,7 @@
 
 #include "../data_types.h"
 #include "../tag/tag.h"
+#include "../tag/tag_fix_plan.h"
 #include "hud_types.h"
 
 enum {
@@ -97,4 +98,4 @@ static_assert(sizeof(struct hud_globals) == 1104);
 
 #pragma pack(pop)
 
-bool hud_globals_postprocess(TagID tag, struct tag_data_instance *tag_data);
+bool hud_globals_postprocess(TagID tag, struct tag_data_instance *tag_data, struct tag_fix_plan *plan);
@@ -4,6 +4,7 @@
 
 #include "../data_types.h"
 #include "../tag/tag.h"
+#include "../tag/tag_field_rules.h"
 
 enum {
     HUD_FLASH_FLAGS_REVERSE_COLORS_BIT,
@@ -353,5 +354,9 @@ static_assert(sizeof(struct hud_sound_element) == 56);
 
 #pragma pack(pop)
 
-void hud_process_absolute_placement(struct hud_absolute_placement *absolute_placement);
-void hud_process_meter_element(struct hud_meter_element *meter);
+// Field rules shared by every HUD group. The field is the full path to the member from struct_type.
+// Nothing supports the canvas size extension as of this time but might as well handle it for now
+#define HUD_ABSOLUTE_PLACEMENT_CANVAS_SIZE_RULE(struct_type, field) \
+    TAG_FIELD_RULE_ENUM16_BIG_ENDIAN(struct_type, field, NUMBER_OF_HUD_CANVAS_SIZES, HUD_CANVAS_SIZE_480P, "canvas size is big-endian")
+#define HUD_METER_ELEMENT_MIN_ALPHA_RULE(struct_type, field) \
+    TAG_FIELD_RULE_FLOAT_BIG_ENDIAN(struct_type, field, 0.0f, 1.0f, "meter min alpha is big-endian")
@@ -4,6 +4,7 @@
 
 #include "../data_types.h"
 #include "../tag/tag.h"
+#include "../tag/tag_fix_plan.h"
 
 enum {
     LENS_FLARE_REFLECTION_FLAGS_ROTATE_FROM_CENTER_OF_SCREEN_BIT,
@@ -102,4 +103,4 @@ static_assert(sizeof(struct lens_flare) == 240);
 
 #pragma pack(pop)
 
-bool lens_flare_postprocess(TagID tag, struct tag_data_instance *tag_data);
+bool lens_flare_postprocess(TagID tag, struct tag_data_instance *tag_data, struct tag_fix_plan *plan);
@@ -1,16 +1,73 @@
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "../data_types.h"
 #include "../tag/tag.h"
 #include "../tag/tag_fourcc.h"
 
 #include "meter.h"
+#include "../thread/thread_output.h"
 
-bool meter_postprocess(TagID tag, struct tag_data_instance *tag_data) {
+// Check every row header, origin and pixel span before anything is touched. Returns false after reporting the first bad row.
+static bool meter_validate_encoded_rows(const uint8_t *stencil, size_t size, struct meter *meter, TagID tag, struct tag_data_instance *tag_data) {
+    size_t row_index = 0;
+    size_t offset = 0;
+    while(offset < size) {
+        if(offset + sizeof(struct meter_encoded_row) > size) {
+            thread_output_error("encoded stencil row data %zu in \"%s.%s\" is out of bounds\n",
+                row_index, tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_METER));
+            return false;
+        }
+
+        // Check origin (so we are more sure this is what we think it is)
+        const struct meter_encoded_row *row = (const struct meter_encoded_row *)(stencil + offset);
+        if(row->origin.x + row->pixel_count > meter->runtime_width || row->origin.y > meter->runtime_height) {
+            thread_output_error("encoded stencil row data %zu origin in \"%s.%s\" is out of bounds for meter dimensions\n",
+                row_index, tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_METER));
+            return false;
+        }
+
+        offset += sizeof(struct meter_encoded_row) + row->pixel_count * sizeof(struct meter_encoded_pixel);
+        if(offset > size) {
+            thread_output_error("encoded stencil pixel data for row %zu in \"%s.%s\" is out of bounds\n",
+                row_index, tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_METER));
+            return false;
+        }
+
+        row_index++;
+    }
+    return true;
+}
+
+// Pixels are 4 bytes, so the pad is cleared by masking the whole row with a 4-byte pattern
+static void meter_clear_encoded_pixel_pads(struct meter_encoded_pixel *pixels, size_t pixel_count) {
+    uint8_t *bytes = (uint8_t *)pixels;
+    size_t size = pixel_count * sizeof(struct meter_encoded_pixel);
+    size_t offset = 0;
+
+    #ifdef __SSE2__
+    const __m128i keep = _mm_setr_epi8(-1, 0, -1, -1, -1, 0, -1, -1, -1, 0, -1, -1, -1, 0, -1, -1);
+    for(; offset + sizeof(__m128i) <= size; offset += sizeof(__m128i)) {
+        __m128i *block = (__m128i *)(bytes + offset);
+        _mm_storeu_si128(block, _mm_and_si128(_mm_loadu_si128(block), keep));
+    }
+    #endif
+
+    for(; offset < size; offset += sizeof(struct meter_encoded_pixel)) {
+        bytes[offset + offsetof(struct meter_encoded_pixel, pad)] = 0;
+    }
+}
+
+bool meter_postprocess(TagID tag, struct tag_data_instance *tag_data, struct tag_fix_plan *plan) {
     struct meter *meter = tag_get(tag, TAG_FOURCC_METER, tag_data);
     if(!meter) {
-        fprintf(stderr, "tag data for \"%s.%s\" is invalid\n",
+        thread_output_error("tag data for \"%s.%s\" is invalid\n",
             tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_METER));
         return false;
     }
@@ -22,46 +79,33 @@ bool meter_postprocess(TagID tag, struct tag_data_instance *tag_data) {
 
     uint8_t *stencil = tag_resolve_pointer(meter->encoded_stencil.address, meter->encoded_stencil.size, tag_data);
     if(!stencil) {
-        fprintf(stderr, "encoded stencil data in \"%s.%s\" is out of bounds\n",
+        thread_output_error("encoded stencil data in \"%s.%s\" is out of bounds\n",
             tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_METER));
         return false;
     }
 
-    // Go through each encoded pixel and zero out the padding between the mask and meter level
-    // When maps are built by tool.exe this data will be uninitialized, breaking reproducible map builds
-    size_t row_index = 0;
-    uint8_t *end = stencil + meter->encoded_stencil.size;
-    struct meter_encoded_row *row = (struct meter_encoded_row *)stencil;
-    while((uint8_t *)row < end) {
-        if((uint8_t *)row + sizeof(struct meter_encoded_row) > end) {
-            fprintf(stderr, "encoded stencil row data %zu in \"%s.%s\" is out of bounds\n",
-                row_index, tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_METER));
-            return false;
-        }
-
-        // Check origin (so we are more sure this is what we think it is)
-        if(row->origin.x + row->pixel_count > meter->runtime_width || row->origin.y > meter->runtime_height) {
-            fprintf(stderr, "encoded stencil row data %zu origin in \"%s.%s\" is out of bounds for meter dimensions\n",
-                row_index, tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_METER));
-            return false;
-        }
-
-        struct meter_encoded_pixel *pixel = row->pixels;
-        struct meter_encoded_pixel *last_pixel = &row->pixels[row->pixel_count];
-        if((uint8_t *)last_pixel > end) {
-            fprintf(stderr, "encoded stencil pixel data for row %zu in \"%s.%s\" is out of bounds\n",
-                row_index, tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_METER));
-            return false;
-        }
+    size_t stencil_size = meter->encoded_stencil.size;
+    if(!meter_validate_encoded_rows(stencil, stencil_size, meter, tag, tag_data)) {
+        return false;
+    }
 
-        while(pixel < last_pixel) {
-            pixel->pad = 0;
-            pixel++;
-        }
+    // Go through each encoded row and zero out the padding between the mask and meter level
+    // When maps are built by tool.exe this data will be uninitialized, breaking reproducible map builds
+    // This is done on a copy so the whole stencil goes into the plan as one fix
+    uint8_t *fixed_stencil = malloc(stencil_size);
+    if(!fixed_stencil) {
+        abort();
+    }
+    memcpy(fixed_stencil, stencil, stencil_size);
 
-        row = (struct meter_encoded_row *)last_pixel;
-        row_index++;
+    size_t offset = 0;
+    while(offset < stencil_size) {
+        struct meter_encoded_row *row = (struct meter_encoded_row *)(fixed_stencil + offset);
+        meter_clear_encoded_pixel_pads(row->pixels, row->pixel_count);
+        offset += sizeof(struct meter_encoded_row) + row->pixel_count * sizeof(struct meter_encoded_pixel);
     }
 
+    tag_fix_plan_write(plan, stencil, fixed_stencil, stencil_size, "encoded stencil padding is uninitialized");
+    free(fixed_stencil);
     return true;
 }
@@ -4,6 +4,7 @@
 
 #include "../data_types.h"
 #include "../tag/tag.h"
+#include "../tag/tag_fix_plan.h"
 
 enum {
     METER_COLOR_ANCHOR_BOTH,
@@ -62,4 +63,4 @@ static_assert(sizeof(struct meter) == 172);
 
 #pragma pack(pop)
 
-bool meter_postprocess(TagID tag, struct tag_data_instance *tag_data);
+bool meter_postprocess(TagID tag, struct tag_data_instance *tag_data, struct tag_fix_plan *plan);
@@ -4,39 +4,47 @@
 #include "../data_types.h"
 #include "../tag/tag.h"
 #include "../tag/tag_fourcc.h"
+#include "../tag/tag_field_rules.h"
 
 #include "model.h"
+#include "../thread/thread_output.h"
 
-bool gbxmodel_postprocess(TagID tag, struct tag_data_instance *tag_data) {
+static const struct tag_field_rule gbxmodel_rule_list[] = {
+    // Unset this since it has been applied once already
+    TAG_FIELD_RULE_CLEAR_FLAGS(struct model, flags, FLAG(MODEL_FLAGS_BLEND_SHARED_NORMALS_BIT), "blend shared normals was already applied")
+};
+static const struct tag_field_rule_table gbxmodel_rules = TAG_FIELD_RULE_TABLE(struct model, gbxmodel_rule_list);
+
+static const struct tag_field_rule gbxmodel_geometry_part_rule_list[] = {
+    // This contains a stale pointer from when the map was built,
+    // so zeroing it allows model tag data between map builds to be reproducible
+    TAG_FIELD_RULE_ZERO(struct gbxmodel_geometry_part, vertex_buffer.base_address, "stale vertex buffer pointer")
+};
+static const struct tag_field_rule_table gbxmodel_geometry_part_rules = TAG_FIELD_RULE_TABLE(struct gbxmodel_geometry_part, gbxmodel_geometry_part_rule_list);
+
+bool gbxmodel_postprocess(TagID tag, struct tag_data_instance *tag_data, struct tag_fix_plan *plan) {
     struct model *gbxmodel = tag_get(tag, TAG_FOURCC_GBXMODEL, tag_data);
     if(!gbxmodel) {
-        fprintf(stderr, "tag data for \"%s.%s\" is invalid\n",
+        thread_output_error("tag data for \"%s.%s\" is invalid\n",
             tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_GBXMODEL));
         return false;
     }
 
-    // Unset this since it has been applied once already
-    SET_FLAG(gbxmodel->flags, MODEL_FLAGS_BLEND_SHARED_NORMALS_BIT, false);
+    tag_field_rules_apply(&gbxmodel_rules, gbxmodel, 1, plan);
 
     for(size_t g = 0; g < gbxmodel->geometries.count; g++) {
         struct model_geometry *geometry = model_get_geometry(gbxmodel, g, tag_data);
         if(!geometry) {
-            fprintf(stderr, "geometry %zu in \"%s.%s\" is out of bounds\n",
+            thread_output_error("geometry %zu in \"%s.%s\" is out of bounds\n",
                 g, tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_GBXMODEL));
             return false;
         }
 
-        for(size_t gp = 0; gp < geometry->parts.count; gp++) {
-            struct gbxmodel_geometry_part *part = gbxmodel_get_geometry_part(geometry, gp, tag_data);
-            if(!part) {
-                fprintf(stderr, "geometry part %zu of geometry %zu in \"%s.%s\" is out of bounds\n",
-                    gp, g, tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_GBXMODEL));
-                return false;
-            }
-
-            // This contains a stale pointer from when the map was built,
-            // so zeroing it allows model tag data between map builds to be reproducible
-            part->vertex_buffer.base_address = 0;
+        size_t invalid_index;
+        if(!tag_field_rules_apply_reflexive(&gbxmodel_geometry_part_rules, &geometry->parts, &invalid_index, tag_data, plan)) {
+            thread_output_error("geometry part %zu of geometry %zu in \"%s.%s\" is out of bounds\n",
+                invalid_index, g, tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_GBXMODEL));
+            return false;
         }
     }
 
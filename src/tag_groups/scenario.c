@@ -1,6 +1,9 @@
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <limits.h>
+#include <assert.h>
 
 #include "../data_types.h"
 #include "../tag/tag.h"
@@ -8,82 +11,209 @@
 
 #include "scenario.h"
 #include "scenario/ai.h"
+#include "../thread/thread_output.h"
 
-bool scenario_postprocess(TagID tag, struct tag_data_instance *tag_data) {
+#define AI_CONVERSATION_VARIANT_NUMBER_UNKNOWN INT16_MIN
+#define AI_CONVERSATION_VARIANT_MATCHER_MAXIMUM_STATES 64
+
+struct ai_conversation_variant_name {
+    const char *name;
+    int16_t variant_number;
+};
+
+// code is from invader
+// If a path contains more than one of these, the first one in this list wins (so "sarge2" has to come before "sarge")
+static const struct ai_conversation_variant_name ai_conversation_variant_names[] = {
+    { "bisenti", 2 },
+    { "fitzgerald", 4 },
+    { "jenkins", 4 },
+    { "aussie", 5 },
+    { "mendoza", 6 },
+    { "sarge2", 101 },
+    { "sarge", 100 },
+    { "johnson", 100 },
+    { "lehto", 101 }
+};
+#define NUMBER_OF_AI_CONVERSATION_VARIANT_NAMES (sizeof(ai_conversation_variant_names) / sizeof(ai_conversation_variant_names[0]))
+static_assert(NUMBER_OF_AI_CONVERSATION_VARIANT_NAMES <= sizeof(uint16_t) * CHAR_BIT);
+
+// Aho-Corasick automaton over the names above, flattened into a full transition table
+struct ai_conversation_variant_matcher {
+    uint8_t next[AI_CONVERSATION_VARIANT_MATCHER_MAXIMUM_STATES][UINT8_MAX + 1];
+    uint16_t matches[AI_CONVERSATION_VARIANT_MATCHER_MAXIMUM_STATES]; // Bit n is set if the name n ends at this state
+};
+
+static void ai_conversation_variant_matcher_build(struct ai_conversation_variant_matcher *matcher) {
+    assert(matcher);
+    memset(matcher, 0, sizeof(struct ai_conversation_variant_matcher));
+
+    // Build a trie. State 0 is the root, which no other state goes back to, so 0 also means no edge here
+    size_t state_count = 1;
+    for(size_t n = 0; n < NUMBER_OF_AI_CONVERSATION_VARIANT_NAMES; n++) {
+        size_t state = 0;
+        for(const uint8_t *c = (const uint8_t *)ai_conversation_variant_names[n].name; *c != '\0'; c++) {
+            if(matcher->next[state][*c] == 0) {
+                assert(state_count < AI_CONVERSATION_VARIANT_MATCHER_MAXIMUM_STATES);
+                matcher->next[state][*c] = state_count++;
+            }
+            state = matcher->next[state][*c];
+        }
+        matcher->matches[state] |= FLAG(n);
+    }
+
+    // Fill in the failure transitions breadth first so every state's fallback is already complete
+    uint8_t fail[AI_CONVERSATION_VARIANT_MATCHER_MAXIMUM_STATES] = {};
+    uint8_t queue[AI_CONVERSATION_VARIANT_MATCHER_MAXIMUM_STATES];
+    size_t queue_start = 0;
+    size_t queue_end = 0;
+    for(size_t c = 0; c <= UINT8_MAX; c++) {
+        if(matcher->next[0][c] != 0) {
+            queue[queue_end++] = matcher->next[0][c];
+        }
+    }
+
+    while(queue_start < queue_end) {
+        uint8_t state = queue[queue_start++];
+        matcher->matches[state] |= matcher->matches[fail[state]];
+        for(size_t c = 0; c <= UINT8_MAX; c++) {
+            uint8_t child = matcher->next[state][c];
+            if(child != 0) {
+                fail[child] = matcher->next[fail[state]][c];
+                queue[queue_end++] = child;
+            }
+            else {
+                matcher->next[state][c] = matcher->next[fail[state]][c];
+            }
+        }
+    }
+}
+
+static int16_t ai_conversation_variant_matcher_resolve(const struct ai_conversation_variant_matcher *matcher, const char *tag_path) {
+    assert(matcher && tag_path);
+    uint16_t matches = 0;
+    uint8_t state = 0;
+    for(const uint8_t *c = (const uint8_t *)tag_path; *c != '\0'; c++) {
+        state = matcher->next[state][*c];
+        matches |= matcher->matches[state];
+    }
+
+    if(matches == 0) {
+        return 0;
+    }
+
+    return ai_conversation_variant_names[__builtin_ctz(matches)].variant_number;
+}
+
+bool scenario_postprocess(TagID tag, struct tag_data_instance *tag_data, struct tag_fix_plan *plan) {
     struct scenario *scenario = tag_get(tag, TAG_FOURCC_SCENARIO, tag_data);
     if(!scenario) {
-        fprintf(stderr, "tag data for \"%s.%s\" is invalid\n",
+        thread_output_error("tag data for \"%s.%s\" is invalid\n",
             tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_SCENARIO));
         return false;
     }
 
     // Ensure this flag is unset so tag extractors don't assume it worked, as it would have been ignored by the older tool versions.
-    SET_FLAG(scenario->flags, SCENARIO_FLAGS_DO_NOT_APPLY_BUNGIE_CAMPAIGN_TAG_PATCHES_BIT, false);
+    auto flags = scenario->flags;
+    SET_FLAG(flags, SCENARIO_FLAGS_DO_NOT_APPLY_BUNGIE_CAMPAIGN_TAG_PATCHES_BIT, false);
+    TAG_FIX_PLAN_SET(plan, scenario->flags, flags, "bungie campaign tag patches flag is ignored by tool.exe");
 
     // These can never be valid if the map was compiled with the expected tool versions, so zero it.
     if(scenario->scavenger_hunt_objects.count != 0) {
-        memset(&scenario->scavenger_hunt_objects, 0, sizeof(struct tag_reflexive));
-        fprintf(stderr, "scenario tag \"%s.%s\" had scavenger hunt objects\nthis was likely corrupted by the older tool.exe so the reflexive was zeroed out\n",
+        tag_fix_plan_zero(plan, &scenario->scavenger_hunt_objects, sizeof(struct tag_reflexive), "scavenger hunt objects are corrupt");
+        thread_output_error("scenario tag \"%s.%s\" had scavenger hunt objects\nthis was likely corrupted by the older tool.exe so the reflexive was zeroed out\n",
             tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_SCENARIO));
     }
 
+    // Dialogue sounds are shared between a lot of lines, so each one is only matched once
+    size_t tag_count = tag_data->header->tag_count;
+    int16_t *variant_number_cache = malloc(sizeof(int16_t) * (tag_count + 1));
+    if(!variant_number_cache) {
+        abort();
+    }
+    for(size_t t = 0; t < tag_count; t++) {
+        variant_number_cache[t] = AI_CONVERSATION_VARIANT_NUMBER_UNKNOWN;
+    }
+
+    struct ai_conversation_variant_matcher matcher;
+    ai_conversation_variant_matcher_build(&matcher);
+
+    bool success = false;
+    int16_t (*variant_numbers)[AI_CONVERSATION_DIALOGUE_VARIANT_COUNT] = nullptr;
     for(size_t c = 0; c < scenario->ai_conversations.count; c++) {
         struct ai_conversation *conversation = scenario_get_ai_conversation(scenario, c, tag_data);
         if(!conversation) {
-            fprintf(stderr, "ai conversation %zu in \"%s.%s\" is out of bounds\n",
+            thread_output_error("ai conversation %zu in \"%s.%s\" is out of bounds\n",
                 c, tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_SCENARIO));
-            return false;
+            goto cleanup;
         }
 
-        for(size_t p = 0; p < conversation->participants.count; p++) {
-            struct ai_conversation_participant *participant = scenario_get_ai_conversation_participant(conversation, p, tag_data);
-            if(!participant) {
-                fprintf(stderr, "ai conversation participant %zu in \"%s.%s\" is out of bounds\n",
-                    p, tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_SCENARIO));
-                return false;
+        // Nothing would ever look at the lines
+        size_t participant_count = conversation->participants.count;
+        if(participant_count == 0) {
+            continue;
+        }
+
+        free(variant_numbers);
+        variant_numbers = malloc(sizeof(*variant_numbers) * participant_count);
+        if(!variant_numbers) {
+            abort();
+        }
+        for(size_t p = 0; p < participant_count; p++) {
+            for(size_t i = 0; i < AI_CONVERSATION_DIALOGUE_VARIANT_COUNT; i++) {
+                variant_numbers[p][i] = NONE;
             }
+        }
 
-            int16_t variant_numbers[AI_CONVERSATION_DIALOGUE_VARIANT_COUNT] = {[0 ... (AI_CONVERSATION_DIALOGUE_VARIANT_COUNT - 1)] = NONE};
-            for(size_t l = 0; l < conversation->lines.count; l++) {
-                struct ai_conversation_line *line = scenario_get_ai_conversation_line(conversation, l, tag_data);
-                if(!line) {
-                    fprintf(stderr, "ai conversation line %zu in \"%s.%s\" is out of bounds\n",
-                        l, tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_SCENARIO));
-                    return false;
+        // Go through the lines once, handing each one to its participant in order
+        // this can match multiple participants, which can lead to ambiguous variant numbers; we'll just do the last one
+        for(size_t l = 0; l < conversation->lines.count; l++) {
+            struct ai_conversation_line *line = scenario_get_ai_conversation_line(conversation, l, tag_data);
+            if(!line) {
+                thread_output_error("ai conversation line %zu in \"%s.%s\" is out of bounds\n",
+                    l, tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_SCENARIO));
+                goto cleanup;
+            }
+
+            // Not anyone's line
+            if(line->participant_index >= participant_count) {
+                continue;
+            }
+
+            for(size_t i = 0; i < AI_CONVERSATION_DIALOGUE_VARIANT_COUNT; i++) {
+                auto dialogue = line->dialogue[i].index;
+                if(dialogue.whole_id == NULL_ID) {
+                    continue;
                 }
 
-                // Not our line
-                if(line->participant_index != p) {
+                int16_t *variant_number = &variant_numbers[line->participant_index][i];
+                if(!tag_id_is_valid_tag(dialogue, tag_data)) {
+                    *variant_number = ai_conversation_variant_matcher_resolve(&matcher, tag_path_get(dialogue, tag_data));
                     continue;
                 }
 
-                // this can match multiple participants, which can lead to ambiguous variant numbers; we'll just do the last one
-                for(size_t i = 0; i < AI_CONVERSATION_DIALOGUE_VARIANT_COUNT; i++) {
-                    if(line->dialogue[i].index.whole_id != NULL_ID) {
-                        const char *tag_path = tag_path_get(line->dialogue[i].index, tag_data);
-                        #define IF_THING_IS_CONTAINED_IN_THE_THING(thing, number) \
-                            if(strstr(tag_path, thing) != nullptr) { variant_numbers[i] = number; } \
-
-                        // code is from invader
-                        IF_THING_IS_CONTAINED_IN_THE_THING("bisenti", 2)
-                        else IF_THING_IS_CONTAINED_IN_THE_THING("fitzgerald", 4)
-                        else IF_THING_IS_CONTAINED_IN_THE_THING("jenkins", 4)
-                        else IF_THING_IS_CONTAINED_IN_THE_THING("aussie", 5)
-                        else IF_THING_IS_CONTAINED_IN_THE_THING("mendoza", 6)
-                        else IF_THING_IS_CONTAINED_IN_THE_THING("sarge2", 101)
-                        else IF_THING_IS_CONTAINED_IN_THE_THING("sarge", 100)
-                        else IF_THING_IS_CONTAINED_IN_THE_THING("johnson", 100)
-                        else IF_THING_IS_CONTAINED_IN_THE_THING("lehto", 101)
-                        else {
-                            variant_numbers[i] = 0;
-                        }
-                    }
+                if(variant_number_cache[dialogue.index] == AI_CONVERSATION_VARIANT_NUMBER_UNKNOWN) {
+                    variant_number_cache[dialogue.index] = ai_conversation_variant_matcher_resolve(&matcher, tag_path_get(dialogue, tag_data));
                 }
+                *variant_number = variant_number_cache[dialogue.index];
             }
+        }
 
-            memcpy(participant->dialogue_variants, variant_numbers, sizeof(variant_numbers));
+        for(size_t p = 0; p < participant_count; p++) {
+            struct ai_conversation_participant *participant = scenario_get_ai_conversation_participant(conversation, p, tag_data);
+            if(!participant) {
+                thread_output_error("ai conversation participant %zu in \"%s.%s\" is out of bounds\n",
+                    p, tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_SCENARIO));
+                goto cleanup;
+            }
+
+            tag_fix_plan_write(plan, participant->dialogue_variants, variant_numbers[p], sizeof(variant_numbers[p]), "dialogue variant numbers are not set");
         }
     }
 
-    return true;
+    success = true;
+
+    cleanup:
+    free(variant_numbers);
+    free(variant_number_cache);
+    return success;
 }
@@ -1,14 +1,22 @@
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
 #include <assert.h>
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define STRUCTURE_NODE_BOUNDS_SIMD
+#include <immintrin.h>
+#endif
 
 #include "../data_types.h"
 #include "../cache/cache.h"
 #include "../tag/tag.h"
 #include "../tag/tag_fourcc.h"
+#include "../thread/thread_pool.h"
 
 #include "scenario.h"
 #include "scenario_structure_bsp.h"
+#include "../thread/thread_output.h"
 
 static void *structure_bsp_resolve_cached_pointer(
     Pointer32 data_pointer,
@@ -45,6 +53,19 @@ static void *structure_bsp_get_cached_reflexive_element(
     return structure_bsp_resolve_cached_pointer(reflexive->address + index * size, size, reference, cache_file);
 }
 
+struct structure_bsp_job {
+    struct tag_fix_plan plan;
+    char *report; // Anything that would have been printed, printed later in BSP order
+    size_t report_length;
+    bool success;
+};
+
+struct structure_bsp_job_context {
+    struct structure_bsp_job *jobs;
+    struct scenario *scenario;
+    struct cache_file_instance *cache_file;
+};
+
 #define structure_bsp_get_cached_node(bsp, index, reference, cache_file) \
     structure_bsp_get_cached_reflexive_element(&(bsp)->nodes, index, sizeof(struct structure_node), reference, cache_file)
 #define structure_bsp_get_cached_lightmap(bsp, index, reference, cache_file) \
@@ -52,122 +73,368 @@ static void *structure_bsp_get_cached_reflexive_element(
 #define structure_bsp_get_cached_material(lightmap, index, reference, cache_file) \
     structure_bsp_get_cached_reflexive_element(&(lightmap)->materials, index, sizeof(struct structure_material), reference, cache_file)
 
-bool scenario_structure_bsp_postprocess_all_in_cache(struct cache_file_instance *cache_file) {
-    assert(cache_file && cache_file->valid);
+static void structure_bsp_job_report(struct structure_bsp_job *job, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(nullptr, 0, format, args);
+    va_end(args);
+    if(length < 0) {
+        return;
+    }
 
-    struct tag_data_instance *tag_data = &cache_file->tag_data;
-    assert(tag_data->valid);
+    job->report = realloc(job->report, job->report_length + length + 1);
+    if(!job->report) {
+        abort();
+    }
 
-    auto scenario_id = tag_data->header->scenario_tag;
-    struct scenario *scenario = tag_get(scenario_id, TAG_FOURCC_SCENARIO, tag_data);
-    if(!scenario) {
-        fprintf(stderr, "tag data for \"%s.%s\" is invalid\n",
-            tag_path_get(scenario_id, tag_data), tag_fourcc_to_extension(TAG_FOURCC_SCENARIO));
+    va_start(args, format);
+    vsnprintf(job->report + job->report_length, length + 1, format, args);
+    va_end(args);
+    job->report_length += length;
+}
+
+// Node bounds are three min/max byte pairs. HEK+ swaps every pair of a node, so an inverted node is fixed by swapping
+// them all back. If any pair of an inverted node is properly ordered, swapping would invert it instead.
+struct structure_node_bounds_scan {
+    struct structure_node *nodes;
+    size_t count;
+    struct tag_fix_plan *plan;
+    size_t inverted_count;
+    size_t unrepairable; // First node that can not be fixed, or SIZE_MAX
+};
+
+static bool structure_node_bounds_commit(struct structure_node_bounds_scan *scan, size_t n, const uint8_rectangle3d *repaired, bool inverted, bool ordered) {
+    if(!inverted) {
+        return true;
+    }
+
+    if(ordered) {
+        scan->unrepairable = n;
         return false;
     }
 
-    for(size_t i = 0; i < scenario->structure_bsp_references.count; i++) {
-        struct scenario_structure_bsp_reference *bsp_reference = scenario_get_bsp_reference(scenario, i, tag_data);
-        if(!bsp_reference) {
-            fprintf(stderr, "BSP reference %zu in \"%s.%s\" is out of bounds\n",
-                i, tag_path_get(scenario_id, tag_data), tag_fourcc_to_extension(TAG_FOURCC_SCENARIO));
-            return false;
+    tag_fix_plan_write(scan->plan, &scan->nodes[n].bounds, repaired, sizeof(uint8_rectangle3d), "node bounds are inverted");
+    scan->inverted_count++;
+    return true;
+}
+
+static void structure_node_bounds_scan_scalar(struct structure_node_bounds_scan *scan, size_t first) {
+    for(size_t n = first; n < scan->count; n++) {
+        const uint8_t *bounds = (const uint8_t *)&scan->nodes[n].bounds;
+        uint8_rectangle3d repaired;
+        uint8_t *swapped = (uint8_t *)&repaired;
+        bool inverted = false;
+        bool ordered = false;
+        for(size_t a = 0; a < sizeof(uint8_rectangle3d); a += 2) {
+            inverted |= bounds[a] > bounds[a + 1];
+            ordered |= bounds[a] < bounds[a + 1];
+            swapped[a] = bounds[a + 1];
+            swapped[a + 1] = bounds[a];
         }
 
-        auto bsp_id = bsp_reference->structure_bsp.index;
-        if(bsp_reference->size < sizeof(struct cache_file_structure_bsp_header)) {
-            fprintf(stderr, "cache data for \"%s.%s\" is too small to be a BSP\n",
-                tag_path_get(bsp_id, tag_data), tag_fourcc_to_extension(TAG_FOURCC_SCENARIO_STRUCTURE_BSP));
-            return false;
+        if(!structure_node_bounds_commit(scan, n, &repaired, inverted, ordered)) {
+            return;
         }
+    }
+}
 
-        if(bsp_reference->offset + bsp_reference->size > cache_file->size) {
-            fprintf(stderr, "cache data for \"%s.%s\" is out of bounds\n",
-                tag_path_get(bsp_id, tag_data), tag_fourcc_to_extension(TAG_FOURCC_SCENARIO_STRUCTURE_BSP));
-            return false;
+#ifdef STRUCTURE_NODE_BOUNDS_SIMD
+// The vector kernels only get here for a block with an inverted pair in it, which is rare. They store the block's
+// repaired bounds and per-byte masks so the nodes can be committed in order.
+static bool structure_node_bounds_commit_block(
+    struct structure_node_bounds_scan *scan,
+    size_t first,
+    size_t node_count,
+    const uint8_t *repaired,
+    const uint8_t *inverted,
+    const uint8_t *ordered) {
+
+    for(size_t n = 0; n < node_count; n++) {
+        bool node_inverted = false;
+        bool node_ordered = false;
+        for(size_t b = n * sizeof(uint8_rectangle3d); b < (n + 1) * sizeof(uint8_rectangle3d); b++) {
+            node_inverted |= inverted[b] != 0;
+            node_ordered |= ordered[b] != 0;
         }
 
-        struct cache_file_structure_bsp_header *bsp_header = (struct cache_file_structure_bsp_header *)(cache_file->data + bsp_reference->offset);
-        if(bsp_header->signature != TAG_FOURCC_SCENARIO_STRUCTURE_BSP) {
-            fprintf(stderr, "BSP header for \"%s.%s\" is invalid\n",
-                tag_path_get(bsp_id, tag_data), tag_fourcc_to_extension(TAG_FOURCC_SCENARIO_STRUCTURE_BSP));
+        const uint8_rectangle3d *node_repaired = (const uint8_rectangle3d *)(repaired + n * sizeof(uint8_rectangle3d));
+        if(!structure_node_bounds_commit(scan, first + n, node_repaired, node_inverted, node_ordered)) {
             return false;
         }
+    }
+    return true;
+}
 
-        struct structure_bsp *bsp = structure_bsp_resolve_cached_pointer(bsp_header->structure_bsp, sizeof(struct structure_bsp), bsp_reference, cache_file);
-        if(!bsp) {
-            fprintf(stderr, "tag data for \"%s.%s\" is out of bounds\n",
-                tag_path_get(bsp_id, tag_data), tag_fourcc_to_extension(TAG_FOURCC_SCENARIO_STRUCTURE_BSP));
+// 8 nodes are 48 bytes, three registers. Pairs never straddle a register, so each 16-bit lane is one min/max pair.
+__attribute__((target("sse4.1")))
+static void structure_node_bounds_scan_sse41(struct structure_node_bounds_scan *scan) {
+    const __m128i low_bytes = _mm_set1_epi16(0x00FF);
+    size_t n = 0;
+    for(; n + 8 <= scan->count; n += 8) {
+        const uint8_t *block = (const uint8_t *)&scan->nodes[n];
+        __m128i bounds[3];
+        __m128i inverted[3];
+        __m128i ordered[3];
+        __m128i any_inverted = _mm_setzero_si128();
+        for(size_t r = 0; r < 3; r++) {
+            bounds[r] = _mm_loadu_si128((const __m128i *)(block + r * sizeof(__m128i)));
+            __m128i minimum = _mm_and_si128(bounds[r], low_bytes);
+            __m128i maximum = _mm_srli_epi16(bounds[r], 8);
+            inverted[r] = _mm_cmpgt_epi16(minimum, maximum);
+            ordered[r] = _mm_cmpgt_epi16(maximum, minimum);
+            any_inverted = _mm_or_si128(any_inverted, inverted[r]);
+        }
+
+        if(_mm_testz_si128(any_inverted, any_inverted)) {
+            continue;
+        }
+
+        uint8_t repaired[3 * sizeof(__m128i)];
+        uint8_t inverted_bytes[3 * sizeof(__m128i)];
+        uint8_t ordered_bytes[3 * sizeof(__m128i)];
+        for(size_t r = 0; r < 3; r++) {
+            __m128i swapped = _mm_or_si128(_mm_slli_epi16(bounds[r], 8), _mm_srli_epi16(bounds[r], 8));
+            _mm_storeu_si128((__m128i *)(repaired + r * sizeof(__m128i)), _mm_blendv_epi8(bounds[r], swapped, inverted[r]));
+            _mm_storeu_si128((__m128i *)(inverted_bytes + r * sizeof(__m128i)), inverted[r]);
+            _mm_storeu_si128((__m128i *)(ordered_bytes + r * sizeof(__m128i)), ordered[r]);
+        }
+
+        if(!structure_node_bounds_commit_block(scan, n, 8, repaired, inverted_bytes, ordered_bytes)) {
+            return;
+        }
+    }
+
+    structure_node_bounds_scan_scalar(scan, n);
+}
+
+// Same as above with 16 nodes, 96 bytes, at a time
+__attribute__((target("avx2")))
+static void structure_node_bounds_scan_avx2(struct structure_node_bounds_scan *scan) {
+    const __m256i low_bytes = _mm256_set1_epi16(0x00FF);
+    size_t n = 0;
+    for(; n + 16 <= scan->count; n += 16) {
+        const uint8_t *block = (const uint8_t *)&scan->nodes[n];
+        __m256i bounds[3];
+        __m256i inverted[3];
+        __m256i ordered[3];
+        __m256i any_inverted = _mm256_setzero_si256();
+        for(size_t r = 0; r < 3; r++) {
+            bounds[r] = _mm256_loadu_si256((const __m256i *)(block + r * sizeof(__m256i)));
+            __m256i minimum = _mm256_and_si256(bounds[r], low_bytes);
+            __m256i maximum = _mm256_srli_epi16(bounds[r], 8);
+            inverted[r] = _mm256_cmpgt_epi16(minimum, maximum);
+            ordered[r] = _mm256_cmpgt_epi16(maximum, minimum);
+            any_inverted = _mm256_or_si256(any_inverted, inverted[r]);
+        }
+
+        if(_mm256_testz_si256(any_inverted, any_inverted)) {
+            continue;
+        }
+
+        uint8_t repaired[3 * sizeof(__m256i)];
+        uint8_t inverted_bytes[3 * sizeof(__m256i)];
+        uint8_t ordered_bytes[3 * sizeof(__m256i)];
+        for(size_t r = 0; r < 3; r++) {
+            __m256i swapped = _mm256_or_si256(_mm256_slli_epi16(bounds[r], 8), _mm256_srli_epi16(bounds[r], 8));
+            _mm256_storeu_si256((__m256i *)(repaired + r * sizeof(__m256i)), _mm256_blendv_epi8(bounds[r], swapped, inverted[r]));
+            _mm256_storeu_si256((__m256i *)(inverted_bytes + r * sizeof(__m256i)), inverted[r]);
+            _mm256_storeu_si256((__m256i *)(ordered_bytes + r * sizeof(__m256i)), ordered[r]);
+        }
+
+        if(!structure_node_bounds_commit_block(scan, n, 16, repaired, inverted_bytes, ordered_bytes)) {
+            return;
+        }
+    }
+
+    structure_node_bounds_scan_scalar(scan, n);
+}
+#endif
+
+static void structure_node_bounds_scan(struct structure_node_bounds_scan *scan) {
+    #ifdef STRUCTURE_NODE_BOUNDS_SIMD
+    if(__builtin_cpu_supports("avx2")) {
+        structure_node_bounds_scan_avx2(scan);
+        return;
+    }
+    if(__builtin_cpu_supports("sse4.1")) {
+        structure_node_bounds_scan_sse41(scan);
+        return;
+    }
+    #endif
+
+    structure_node_bounds_scan_scalar(scan, 0);
+}
+
+static bool structure_bsp_postprocess(struct structure_bsp_job *job, size_t i, struct scenario *scenario, struct cache_file_instance *cache_file) {
+    struct tag_data_instance *tag_data = &cache_file->tag_data;
+    auto scenario_id = tag_data->header->scenario_tag;
+
+    struct scenario_structure_bsp_reference *bsp_reference = scenario_get_bsp_reference(scenario, i, tag_data);
+    if(!bsp_reference) {
+        structure_bsp_job_report(job, "BSP reference %zu in \"%s.%s\" is out of bounds\n",
+            i, tag_path_get(scenario_id, tag_data), tag_fourcc_to_extension(TAG_FOURCC_SCENARIO));
+        return false;
+    }
+
+    auto bsp_id = bsp_reference->structure_bsp.index;
+    job->plan.tag = bsp_id;
+    if(bsp_reference->size < sizeof(struct cache_file_structure_bsp_header)) {
+        structure_bsp_job_report(job, "cache data for \"%s.%s\" is too small to be a BSP\n",
+            tag_path_get(bsp_id, tag_data), tag_fourcc_to_extension(TAG_FOURCC_SCENARIO_STRUCTURE_BSP));
+        return false;
+    }
+
+    if(bsp_reference->offset + bsp_reference->size > cache_file->size) {
+        structure_bsp_job_report(job, "cache data for \"%s.%s\" is out of bounds\n",
+            tag_path_get(bsp_id, tag_data), tag_fourcc_to_extension(TAG_FOURCC_SCENARIO_STRUCTURE_BSP));
+        return false;
+    }
+
+    struct cache_file_structure_bsp_header *bsp_header = (struct cache_file_structure_bsp_header *)(cache_file->data + bsp_reference->offset);
+    if(bsp_header->signature != TAG_FOURCC_SCENARIO_STRUCTURE_BSP) {
+        structure_bsp_job_report(job, "BSP header for \"%s.%s\" is invalid\n",
+            tag_path_get(bsp_id, tag_data), tag_fourcc_to_extension(TAG_FOURCC_SCENARIO_STRUCTURE_BSP));
+        return false;
+    }
+
+    struct structure_bsp *bsp = structure_bsp_resolve_cached_pointer(bsp_header->structure_bsp, sizeof(struct structure_bsp), bsp_reference, cache_file);
+    if(!bsp) {
+        structure_bsp_job_report(job, "tag data for \"%s.%s\" is out of bounds\n",
+            tag_path_get(bsp_id, tag_data), tag_fourcc_to_extension(TAG_FOURCC_SCENARIO_STRUCTURE_BSP));
+        return false;
+    }
+
+    bool vertex_buffers_are_stale = cache_file_has_model_data(cache_file);
+    for(size_t l = 0; l < bsp->lightmaps.count; l++) {
+        struct structure_lightmap *lightmap = structure_bsp_get_cached_lightmap(bsp, l, bsp_reference, cache_file);
+        if(!lightmap) {
+            structure_bsp_job_report(job, "lightmap %zu in \"%s.%s\" is out of bounds\n",
+                l, tag_path_get(bsp_id, tag_data), tag_fourcc_to_extension(TAG_FOURCC_SCENARIO_STRUCTURE_BSP));
             return false;
         }
 
-        for(size_t l = 0; l < bsp->lightmaps.count; l++) {
-            struct structure_lightmap *lightmap = structure_bsp_get_cached_lightmap(bsp, l, bsp_reference, cache_file);
-            if(!lightmap) {
-                fprintf(stderr, "lightmap %zu in \"%s.%s\" is out of bounds\n",
-                    l, tag_path_get(bsp_id, tag_data), tag_fourcc_to_extension(TAG_FOURCC_SCENARIO_STRUCTURE_BSP));
+        for(size_t m = 0; m < lightmap->materials.count; m++) {
+            struct structure_material *material = structure_bsp_get_cached_material(lightmap, m, bsp_reference, cache_file);
+            if(!material) {
+                structure_bsp_job_report(job, "material %zu of lightmap %zu in \"%s.%s\" is out of bounds\n",
+                    m, l, tag_path_get(bsp_id, tag_data), tag_fourcc_to_extension(TAG_FOURCC_SCENARIO_STRUCTURE_BSP));
                 return false;
             }
 
-            for(size_t m = 0; m < lightmap->materials.count; m++) {
-                struct structure_material *material = structure_bsp_get_cached_material(lightmap, m, bsp_reference, cache_file);
-                if(!material) {
-                    fprintf(stderr, "material %zu of lightmap %zu in \"%s.%s\" is out of bounds\n",
-                        m, l, tag_path_get(bsp_id, tag_data), tag_fourcc_to_extension(TAG_FOURCC_SCENARIO_STRUCTURE_BSP));
-                    return false;
-                }
-
-                // Set the vertex buffer types to a consistent state.
-                // This will be set correctly by the game when the BSP is loaded, but here can be set
-                // to whatever was in the loose tag (different depending on what tool last touched it)
-                material->vertices.type = RASTERIZER_VERTEX_TYPE_ENVIRONMENT_UNCOMPRESSED;
-                if(material->lightmap_vertices.count > 0) {
-                    material->lightmap_vertices.type = RASTERIZER_VERTEX_TYPE_ENVIRONMENT_LIGHTMAP_UNCOMPRESSED;
-                }
-
-                // Zero stale pointers. These are set when loaded, so anything here will be from a previous load.
-                material->vertices.base_address = 0;
-                material->vertices.hardware_format = 0;
-                material->lightmap_vertices.base_address = 0;
-                material->lightmap_vertices.hardware_format = 0;
+            // Xbox BSPs have compressed vertices, and the game uses the vertex buffers in them as they are
+            if(!vertex_buffers_are_stale) {
+                continue;
             }
-        }
 
-        // Check for HEK+ damage in node bounds
-        // Node bounds are a set of relative floats compressed to an unsigned 8-bit integer
-        bool inverted_nodes = false;
-        for(size_t n = 0; n < bsp->nodes.count; n++) {
-            struct structure_node *node = structure_bsp_get_cached_node(bsp, n, bsp_reference, cache_file);
-            if(!node) {
-                fprintf(stderr, "node %zu in \"%s.%s\" is out of bounds\n",
-                    n, tag_path_get(bsp_id, tag_data), tag_fourcc_to_extension(TAG_FOURCC_SCENARIO_STRUCTURE_BSP));
-                return false;
+            // Set the vertex buffer types to a consistent state.
+            // This will be set correctly by the game when the BSP is loaded, but here can be set
+            // to whatever was in the loose tag (different depending on what tool last touched it)
+            TAG_FIX_PLAN_SET(&job->plan, material->vertices.type, RASTERIZER_VERTEX_TYPE_ENVIRONMENT_UNCOMPRESSED, "vertex buffer type is inconsistent");
+            if(material->lightmap_vertices.count > 0) {
+                TAG_FIX_PLAN_SET(&job->plan, material->lightmap_vertices.type, RASTERIZER_VERTEX_TYPE_ENVIRONMENT_LIGHTMAP_UNCOMPRESSED, "vertex buffer type is inconsistent");
             }
 
-            // This never happens on normal tags, so we can assume HEK+ did it and try to fix it
-            if(node->bounds.x0 > node->bounds.x1 || node->bounds.y0 > node->bounds.y1 || node->bounds.y0 > node->bounds.y1) {
-                uint8_rectangle3d temp = node->bounds;
-                node->bounds.x0 = temp.x1;
-                node->bounds.x1 = temp.x0;
-                node->bounds.y0 = temp.y1;
-                node->bounds.y1 = temp.y0;
-                node->bounds.z0 = temp.z1;
-                node->bounds.z1 = temp.z0;
-                if(node->bounds.x0 > node->bounds.x1 || node->bounds.y0 > node->bounds.y1 || node->bounds.y0 > node->bounds.y1) {
-                    fprintf(stderr, "node %zu in \"%s.%s\" has invalid bounds and can not be fixed\n",
-                        n, tag_path_get(bsp_id, tag_data), tag_fourcc_to_extension(TAG_FOURCC_SCENARIO_STRUCTURE_BSP));
-                    return false;
-                }
-
-                inverted_nodes = true;
-            }
+            // Zero stale pointers. These are set when loaded, so anything here will be from a previous load.
+            TAG_FIX_PLAN_SET(&job->plan, material->vertices.base_address, 0, "stale vertex buffer pointer");
+            TAG_FIX_PLAN_SET(&job->plan, material->vertices.hardware_format, 0, "stale vertex buffer pointer");
+            TAG_FIX_PLAN_SET(&job->plan, material->lightmap_vertices.base_address, 0, "stale vertex buffer pointer");
+            TAG_FIX_PLAN_SET(&job->plan, material->lightmap_vertices.hardware_format, 0, "stale vertex buffer pointer");
         }
+    }
 
-        if(inverted_nodes) {
-            fprintf(stderr, "fixed inverted node bounds in \"%s.%s\"\nthis was likely caused by HEK+, if you are sure this BSP was not touched by HEK+ then this might be a bug!\n",
-                tag_path_get(bsp_id, tag_data), tag_fourcc_to_extension(TAG_FOURCC_SCENARIO_STRUCTURE_BSP));
+    // Check for HEK+ damage in node bounds
+    // Node bounds are a set of relative floats compressed to an unsigned 8-bit integer
+    size_t node_count = bsp->nodes.count;
+    struct structure_node *nodes = structure_bsp_resolve_cached_pointer(bsp->nodes.address, node_count * sizeof(struct structure_node), bsp_reference, cache_file);
+    if(node_count > 0 && !nodes) {
+        size_t n = 0;
+        while(n + 1 < node_count && structure_bsp_get_cached_node(bsp, n, bsp_reference, cache_file)) {
+            n++;
         }
+        structure_bsp_job_report(job, "node %zu in \"%s.%s\" is out of bounds\n",
+            n, tag_path_get(bsp_id, tag_data), tag_fourcc_to_extension(TAG_FOURCC_SCENARIO_STRUCTURE_BSP));
+        return false;
+    }
+
+    // This never happens on normal tags, so we can assume HEK+ did it and try to fix it
+    struct structure_node_bounds_scan scan = {
+        .nodes = nodes,
+        .count = node_count,
+        .plan = &job->plan,
+        .unrepairable = SIZE_MAX
+    };
+    if(node_count > 0) {
+        structure_node_bounds_scan(&scan);
+    }
+
+    if(scan.unrepairable != SIZE_MAX) {
+        structure_bsp_job_report(job, "node %zu in \"%s.%s\" has invalid bounds and can not be fixed\n",
+            scan.unrepairable, tag_path_get(bsp_id, tag_data), tag_fourcc_to_extension(TAG_FOURCC_SCENARIO_STRUCTURE_BSP));
+        return false;
     }
 
+    if(scan.inverted_count > 0) {
+        structure_bsp_job_report(job, "fixed inverted node bounds in \"%s.%s\"\nthis was likely caused by HEK+, if you are sure this BSP was not touched by HEK+ then this might be a bug!\n",
+            tag_path_get(bsp_id, tag_data), tag_fourcc_to_extension(TAG_FOURCC_SCENARIO_STRUCTURE_BSP));
+    }
     return true;
 }
+
+static void structure_bsp_postprocess_job(size_t job_index, void *context) {
+    struct structure_bsp_job_context *jobs = context;
+    struct structure_bsp_job *job = &jobs->jobs[job_index];
+    job->success = structure_bsp_postprocess(job, job_index, jobs->scenario, jobs->cache_file);
+}
+
+bool scenario_structure_bsp_postprocess_all_in_cache(struct cache_file_instance *cache_file, struct tag_fix_plan *plan) {
+    assert(cache_file && cache_file->valid && plan);
+
+    struct tag_data_instance *tag_data = &cache_file->tag_data;
+    assert(tag_data->valid);
+
+    auto scenario_id = tag_data->header->scenario_tag;
+    struct scenario *scenario = tag_get(scenario_id, TAG_FOURCC_SCENARIO, tag_data);
+    if(!scenario) {
+        thread_output_error("tag data for \"%s.%s\" is invalid\n",
+            tag_path_get(scenario_id, tag_data), tag_fourcc_to_extension(TAG_FOURCC_SCENARIO));
+        return false;
+    }
+
+    // Every BSP is in its own part of the cache file, so they can all be done at once
+    size_t bsp_count = scenario->structure_bsp_references.count;
+    struct structure_bsp_job_context context = {
+        .jobs = calloc(bsp_count + 1, sizeof(struct structure_bsp_job)),
+        .scenario = scenario,
+        .cache_file = cache_file
+    };
+    if(!context.jobs) {
+        abort();
+    }
+
+    for(size_t i = 0; i < bsp_count; i++) {
+        tag_fix_plan_init(&context.jobs[i].plan, cache_file->data, scenario_id);
+    }
+
+    thread_pool_run(bsp_count, structure_bsp_postprocess_job, &context);
+
+    // Report in BSP order and stop at the first broken one like a serial run would
+    bool success = true;
+    for(size_t i = 0; i < bsp_count; i++) {
+        struct structure_bsp_job *job = &context.jobs[i];
+        if(success) {
+            if(job->report) {
+                thread_output_error("%s", job->report);
+            }
+            success = job->success;
+            if(success) {
+                tag_fix_plan_merge(plan, &job->plan);
+            }
+        }
+
+        tag_fix_plan_free(&job->plan);
+        free(job->report);
+    }
+
+    free(context.jobs);
+    return success;
+}
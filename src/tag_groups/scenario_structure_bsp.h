@@ -5,6 +5,7 @@
 #include "../data_types.h"
 #include "../cache/cache.h"
 #include "../tag/tag.h"
+#include "../tag/tag_fix_plan.h"
 #include "model_types.h"
 
 enum {
@@ -284,4 +285,4 @@ static_assert(sizeof(struct structure_bsp) == 648);
 
 #pragma pack(pop)
 
-bool scenario_structure_bsp_postprocess_all_in_cache(struct cache_file_instance *cache_file);
+bool scenario_structure_bsp_postprocess_all_in_cache(struct cache_file_instance *cache_file, struct tag_fix_plan *plan);
@@ -5,11 +5,12 @@
 #include "../tag/tag_fourcc.h"
 
 #include "shader.h"
+#include "../thread/thread_output.h"
 
-bool shader_postprocess(TagID tag, struct tag_data_instance *tag_data) {
+bool shader_postprocess(TagID tag, struct tag_data_instance *tag_data, struct tag_fix_plan *plan) {
     struct shader *shader = tag_get(tag, TAG_FOURCC_SHADER, tag_data);
     if(!shader) {
-        fprintf(stderr, "tag data for \"%s.%s\" is invalid\n",
+        thread_output_error("tag data for \"%s.%s\" is invalid\n",
             tag_path_get(tag, tag_data), tag_extension_get(tag, tag_data));
         return false;
     }
@@ -19,39 +20,41 @@ bool shader_postprocess(TagID tag, struct tag_data_instance *tag_data) {
     // Using a switch statment here allows us to also check for other funky stuff like using the base shader struct as a
     // stand-alone tag (could be done with kornman00.exe).
     // the tag index here should be valid since we resolved tag data.
+    uint16_t type;
     switch(tag_data->tags[tag.index].primary_group) {
         case TAG_FOURCC_SHADER_ENVIRONMENT:
-            shader->type = SHADER_TYPE_ENVIRONMENT;
+            type = SHADER_TYPE_ENVIRONMENT;
             break;
         case TAG_FOURCC_SHADER_MODEL:
-            shader->type = SHADER_TYPE_MODEL;
+            type = SHADER_TYPE_MODEL;
             break;
         case TAG_FOURCC_SHADER_TRANSPARENT_GENERIC:
-            shader->type = SHADER_TYPE_TRANSPARENT_GENERIC;
+            type = SHADER_TYPE_TRANSPARENT_GENERIC;
             break;
         case TAG_FOURCC_SHADER_TRANSPARENT_CHICAGO:
-            shader->type = SHADER_TYPE_TRANSPARENT_CHICAGO;
+            type = SHADER_TYPE_TRANSPARENT_CHICAGO;
             break;
         case TAG_FOURCC_SHADER_TRANSPARENT_CHICAGO_EXTENDED:
-            shader->type = SHADER_TYPE_TRANSPARENT_CHICAGO_EXTENDED;
+            type = SHADER_TYPE_TRANSPARENT_CHICAGO_EXTENDED;
             break;
         case TAG_FOURCC_SHADER_TRANSPARENT_WATER:
-            shader->type = SHADER_TYPE_TRANSPARENT_WATER;
+            type = SHADER_TYPE_TRANSPARENT_WATER;
             break;
         case TAG_FOURCC_SHADER_TRANSPARENT_GLASS:
-            shader->type = SHADER_TYPE_TRANSPARENT_GLASS;
+            type = SHADER_TYPE_TRANSPARENT_GLASS;
             break;
         case TAG_FOURCC_SHADER_TRANSPARENT_METER:
-            shader->type = SHADER_TYPE_TRANSPARENT_METER;
+            type = SHADER_TYPE_TRANSPARENT_METER;
             break;
         case TAG_FOURCC_SHADER_TRANSPARENT_PLASMA:
-            shader->type = SHADER_TYPE_TRANSPARENT_PLASMA;
+            type = SHADER_TYPE_TRANSPARENT_PLASMA;
             break;
         default:
-            fprintf(stderr, "tag \"%s.%s\" is not valid for a shader tag\n",
+            thread_output_error("tag \"%s.%s\" is not valid for a shader tag\n",
                 tag_path_get(tag, tag_data), tag_extension_get(tag, tag_data));
             return false;
     }
 
+    TAG_FIX_PLAN_SET(plan, shader->type, type, "shader type is invalid");
     return true;
 }
@@ -5,6 +5,7 @@
 
 #include "../data_types.h"
 #include "../tag/tag.h"
+#include "../tag/tag_fix_plan.h"
 
 enum {
     SHADER_RADIOSITY_FLAGS_SIMPLE_PARAMETERIZATION_BIT,
@@ -140,4 +141,4 @@ static_assert(sizeof(struct shader_decal) == 104);
 
 #pragma pack(pop)
 
-bool shader_postprocess(TagID tag, struct tag_data_instance *tag_data);
+bool shader_postprocess(TagID tag, struct tag_data_instance *tag_data, struct tag_fix_plan *plan);
@@ -1,25 +1,32 @@
 #include <stdint.h>
-#include <string.h>
+#include <stdio.h>
 
 #include "../data_types.h"
 #include "../tag/tag.h"
 #include "../tag/tag_fourcc.h"
+#include "../tag/tag_field_rules.h"
 
 #include "shader_model.h"
+#include "../thread/thread_output.h"
 
-bool shader_model_postprocess(TagID tag, struct tag_data_instance *tag_data) {
+static const struct tag_field_rule shader_model_rule_list[] = {
+    // Partially removed field. This will be defaulted to 1.0 if zero in the tag file, otherwise it's copied in big-endian.
+    TAG_FIELD_RULE_FLOAT_SET(struct shader_model, model.reflection_bump_map_scale, 1.0f, "reflection bump map scale is big-endian"),
+
+    // This is always copied in big-endian so reset it.
+    TAG_FIELD_RULE_NULL_REFERENCE(struct shader_model, model.reflection_bump_map, TAG_FOURCC_BITMAP, "reflection bump map is big-endian")
+};
+static const struct tag_field_rule_table shader_model_rules = TAG_FIELD_RULE_TABLE(struct shader_model, shader_model_rule_list);
+
+bool shader_model_postprocess(TagID tag, struct tag_data_instance *tag_data, struct tag_fix_plan *plan) {
     struct shader_model *shader = tag_get(tag, TAG_FOURCC_SHADER_MODEL, tag_data);
     if(!shader) {
-        fprintf(stderr, "tag data for \"%s.%s\" is invalid\n",
+        thread_output_error("tag data for \"%s.%s\" is invalid\n",
             tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_SHADER_MODEL));
         return false;
     }
 
-    // Partially removed field. This will be defaulted to 1.0 if zero in the tag file, otherwise it's copied in big-endian.
-    shader->model.reflection_bump_map_scale = 1.0f;
-
-    // This is always copied in big-endian so reset it.
-    tag_null_reference(&shader->model.reflection_bump_map, TAG_FOURCC_BITMAP);
+    tag_field_rules_apply(&shader_model_rules, shader, 1, plan);
 
     return true;
 }
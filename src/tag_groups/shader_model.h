@@ -5,6 +5,7 @@
 
 #include "../data_types.h"
 #include "../tag/tag.h"
+#include "../tag/tag_fix_plan.h"
 #include "shader.h"
 
 enum  {
@@ -94,4 +95,4 @@ static_assert(sizeof(struct shader_model) == 440);
 
 #pragma pack(pop)
 
-bool shader_model_postprocess(TagID tag, struct tag_data_instance *tag_data);
+bool shader_model_postprocess(TagID tag, struct tag_data_instance *tag_data, struct tag_fix_plan *plan);
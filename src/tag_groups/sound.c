@@ -1,12 +1,18 @@
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
+#include <assert.h>
 
 #include "../data_types.h"
 #include "../tag/tag.h"
 #include "../tag/tag_fourcc.h"
+#include "../cache/cache.h"
 #include "../resources/resources.h"
+#include "../resources/resource_index.h"
+#include "../resources/resource_map.h"
 
 #include "sound.h"
+#include "../thread/thread_output.h"
 
 static float_bounds sound_get_default_distance_values_for_class(uint16_t sound_class) {
     float_bounds defaults;
@@ -77,10 +83,44 @@ static float_bounds sound_get_default_distance_values_for_class(uint16_t sound_c
     return defaults;
 }
 
-bool sound_postprocess(TagID tag, struct tag_data_instance *tag_data) {
+// Makes the game load the sound's pitch ranges from sounds.map by tag path. The base struct stays in the map.
+bool sound_make_external(TagID tag, struct tag_data_instance *tag_data, struct tag_fix_plan *plan) {
+    struct sound *sound = tag_get(tag, TAG_FOURCC_SOUND, tag_data);
+    const char *tag_path = tag_path_get(tag, tag_data);
+    if(!sound) {
+        thread_output_error("tag data for \"%s.%s\" is invalid\n", tag_path, tag_fourcc_to_extension(TAG_FOURCC_SOUND));
+        return false;
+    }
+
+    TAG_FIX_PLAN_SET(plan, sound->sample_rate, SOUND_SAMPLE_RATE_22K, "sound is in sounds.map");
+    TAG_FIX_PLAN_SET(plan, sound->encoding, SOUND_ENCODING_MONO, "sound is in sounds.map");
+    TAG_FIX_PLAN_SET(plan, sound->compression, SOUND_COMPRESSION_TYPE_NONE, "sound is in sounds.map");
+    TAG_FIX_PLAN_SET(plan, sound->runtime_maximum_play_time, 0, "sound is in sounds.map");
+
+    // Zero stale reflexive data
+    for(size_t pr = 0; pr < sound->pitch_ranges.count; pr++) {
+        struct sound_pitch_range *pitch_range = sound_get_pitch_range(sound, pr, tag_data);
+        if(!pitch_range || !tag_reflexive_erase_element_data(&pitch_range->permutations, sizeof(struct sound_permutation), tag_data, plan)) {
+            thread_output_error("permutation data for pitch range %zu in \"%s.%s\" is out of bounds\n",
+                pr, tag_path, tag_fourcc_to_extension(TAG_FOURCC_SOUND));
+            return false;
+        }
+    }
+
+    if(!tag_reflexive_erase_element_data(&sound->pitch_ranges, sizeof(struct sound_pitch_range), tag_data, plan)) {
+        thread_output_error("pitch range data in \"%s.%s\" is out of bounds\n",
+            tag_path, tag_fourcc_to_extension(TAG_FOURCC_SOUND));
+        return false;
+    }
+
+    TAG_FIX_PLAN_SET(plan, tag_data->tags[tag.index].external, 1, "sound is in sounds.map");
+    return true;
+}
+
+bool sound_postprocess(TagID tag, struct tag_data_instance *tag_data, struct tag_fix_plan *plan) {
     struct sound *sound = tag_get(tag, TAG_FOURCC_SOUND, tag_data);
     if(!sound) {
-        fprintf(stderr, "tag data for \"%s.%s\" is invalid\n",
+        thread_output_error("tag data for \"%s.%s\" is invalid\n",
             tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_SOUND));
         return false;
     }
@@ -88,10 +128,10 @@ bool sound_postprocess(TagID tag, struct tag_data_instance *tag_data) {
     // Default these
     float_bounds defaults = sound_get_default_distance_values_for_class(sound->sound_class);
     if(sound->minimum_distance <= 0.0f) {
-        sound->minimum_distance = defaults.lower;
+        TAG_FIX_PLAN_SET(plan, sound->minimum_distance, defaults.lower, "minimum distance is not set");
     }
     if(sound->maximum_distance <= 0.0f) {
-        sound->maximum_distance = defaults.upper;
+        TAG_FIX_PLAN_SET(plan, sound->maximum_distance, defaults.upper, "maximum distance is not set");
     }
 
     // Nothing more to do?
@@ -104,7 +144,7 @@ bool sound_postprocess(TagID tag, struct tag_data_instance *tag_data) {
     for(size_t pr = 0; pr < sound->pitch_ranges.count; pr++) {
         struct sound_pitch_range *pitch_range = sound_get_pitch_range(sound, pr, tag_data);
         if(!pitch_range) {
-            fprintf(stderr, "sound pitch range %zu in \"%s.%s\" is out of bounds\n",
+            thread_output_error("sound pitch range %zu in \"%s.%s\" is out of bounds\n",
                 pr, tag_path, tag_fourcc_to_extension(TAG_FOURCC_SOUND));
             return false;
         }
@@ -112,7 +152,7 @@ bool sound_postprocess(TagID tag, struct tag_data_instance *tag_data) {
         for(size_t p = 0; p < pitch_range->permutations.count; p++) {
             struct sound_permutation *permutation = sound_get_permutation(pitch_range, p, tag_data);
             if(!permutation) {
-                fprintf(stderr, "sound permutation %zu of pitch range %zu in \"%s.%s\" is out of bounds\n",
+                thread_output_error("sound permutation %zu of pitch range %zu in \"%s.%s\" is out of bounds\n",
                     p, pr, tag_path, tag_fourcc_to_extension(TAG_FOURCC_SOUND));
                 return false;
             }
@@ -122,44 +162,175 @@ bool sound_postprocess(TagID tag, struct tag_data_instance *tag_data) {
             external = external || external_samples;
 
             // Clear possible bogus flags (leftover from HEK+/MEK extracted tags)
-            permutation->samples.flags = 0;
-            SET_FLAG(permutation->samples.flags, TAG_DATA_FLAGS_EXTERNAL_BIT, external_samples);
+            uint32_t flags = 0;
+            SET_FLAG(flags, TAG_DATA_FLAGS_EXTERNAL_BIT, external_samples);
+            TAG_FIX_PLAN_SET(plan, permutation->samples.flags, flags, "sample data has bogus flags");
         }
     }
 
     // Fix maps using direct sounds.map data offsets if they should be using external tags
     // This happens due to an oversight in tool.exe when checking if tags are the same as the ones in the resource maps or not
     if(external && tag_data->indexed_external_tags) {
-        if(!resources_sound_is_in_sounds_map(tag_path)) {
-            fprintf(stderr, "sound \"%s\" has external sound sample offsets but does not map to the stock sounds.map by tag path\nThe map should be rebuilt\n", tag_path);
+        bool in_sounds_map = tag_data->resource_index ?
+            resource_index_find_sound(tag_data->resource_index, tag_path) != RESOURCE_MAP_NO_MATCH :
+            resources_sound_is_in_sounds_map(tag_path);
+        if(!in_sounds_map) {
+            thread_output_error("sound \"%s\" has external sound sample offsets but does not map to %s sounds.map by tag path\nThe map should be rebuilt\n",
+                tag_path, tag_data->resource_index ? "the given" : "the stock");
             return false;
         }
 
-        sound->sample_rate = SOUND_SAMPLE_RATE_22K;
-        sound->encoding = SOUND_ENCODING_MONO;
-        sound->compression = SOUND_COMPRESSION_TYPE_NONE;
-        sound->runtime_maximum_play_time = 0;
-
-        // Zero stale reflexive data
-        for(size_t pr = 0; pr < sound->pitch_ranges.count; pr++) {
-            // We got this before
-            struct sound_pitch_range *pitch_range = sound_get_pitch_range(sound, pr, tag_data);
-            if(!tag_reflexive_erase_element_data(&pitch_range->permutations, sizeof(struct sound_permutation), tag_data)) {
-                fprintf(stderr, "permutation data for pitch range %zu in \"%s.%s\" is out of bounds\n",
-                    pr, tag_path, tag_fourcc_to_extension(TAG_FOURCC_SOUND));
-                return false;
-            }
+        if(!sound_make_external(tag, tag_data, plan)) {
+            return false;
+        }
+        thread_output_error("sound \"%s\" had external sound sample offsets and was changed to lookup tag data from sounds.map by tag path\n", tag_path);
+    }
+
+    return true;
+}
+
+// A sound either in the cache file or in sounds.map. Sample offsets are file offsets in either one.
+struct sound_source {
+    struct tag_data_instance *tag_data; // nullptr for a resource
+    const struct resource_map *map;
+    uint32_t resource;
+    const uint8_t *file;
+    size_t file_size;
+};
+
+static const void *sound_source_resolve(const struct sound_source *source, Pointer32 address, size_t size) {
+    if(source->tag_data) {
+        return tag_resolve_pointer(address, size, source->tag_data);
+    }
+    return resource_map_get_data(source->map, source->resource, address, size);
+}
+
+static const uint8_t *sound_source_get_samples(const struct sound_source *source, const struct tag_data *samples) {
+    if(source->tag_data && TEST_FLAG(samples->flags, TAG_DATA_FLAGS_EXTERNAL_BIT)) {
+        return nullptr;
+    }
+    if(samples->file_offset > source->file_size || samples->size > source->file_size - samples->file_offset) {
+        return nullptr;
+    }
+    return source->file + samples->file_offset;
+}
+
+static bool sound_source_data_match(const struct sound_source *a, const struct tag_data *data_a, const struct sound_source *b, const struct tag_data *data_b) {
+    if(data_a->size != data_b->size) {
+        return false;
+    }
+    if(data_a->size == 0) {
+        return true;
+    }
+
+    const void *bytes_a = sound_source_resolve(a, data_a->address, data_a->size);
+    const void *bytes_b = sound_source_resolve(b, data_b->address, data_b->size);
+    return bytes_a && bytes_b && memcmp(bytes_a, bytes_b, data_a->size) == 0;
+}
+
+// Clears pointers, offsets and what the game sets while running so the rest can be compared
+static struct sound_pitch_range sound_pitch_range_masked(const struct sound_pitch_range *pitch_range) {
+    struct sound_pitch_range masked = *pitch_range;
+    masked.pad = 0;
+    masked.runtime_oo_natural_pitch = 0.0f;
+    masked.runtime_permutation_flags = 0;
+    masked.runtime_last_permutation_index = 0;
+    masked.runtime_discarded_permutation_index = 0;
+    masked.permutations.address = masked.permutations.definition = 0;
+    return masked;
+}
+
+static struct sound_permutation sound_permutation_masked(const struct sound_permutation *permutation) {
+    struct sound_permutation masked = *permutation;
+    masked.cache_base_address = 0;
+    masked.padding = 0;
+    masked.cache_tag_index.whole_id = 0;
+    masked.runtime_tag_index.whole_id = 0;
+    memset(&masked.samples, 0, sizeof(masked.samples));
+    memset(&masked.mouth_data, 0, sizeof(masked.mouth_data));
+    memset(&masked.subtitle_data, 0, sizeof(masked.subtitle_data));
+    return masked;
+}
+
+// The pitch ranges are what the game loads from sounds.map, so those and the format they are in have to be the same
+static bool sound_sources_match(const struct sound_source *a, const struct sound *sound_a, const struct sound_source *b, const struct sound *sound_b) {
+    if(sound_a->sample_rate != sound_b->sample_rate || sound_a->encoding != sound_b->encoding ||
+        sound_a->compression != sound_b->compression || sound_a->pitch_ranges.count != sound_b->pitch_ranges.count) {
+        return false;
+    }
+
+    size_t pitch_range_count = sound_a->pitch_ranges.count;
+    const struct sound_pitch_range *pitch_ranges_a = sound_source_resolve(a, sound_a->pitch_ranges.address, pitch_range_count * sizeof(struct sound_pitch_range));
+    const struct sound_pitch_range *pitch_ranges_b = sound_source_resolve(b, sound_b->pitch_ranges.address, pitch_range_count * sizeof(struct sound_pitch_range));
+    if(pitch_range_count > 0 && (!pitch_ranges_a || !pitch_ranges_b)) {
+        return false;
+    }
+
+    for(size_t pr = 0; pr < pitch_range_count; pr++) {
+        struct sound_pitch_range pitch_range_a = sound_pitch_range_masked(&pitch_ranges_a[pr]);
+        struct sound_pitch_range pitch_range_b = sound_pitch_range_masked(&pitch_ranges_b[pr]);
+        if(memcmp(&pitch_range_a, &pitch_range_b, sizeof(struct sound_pitch_range)) != 0) {
+            return false;
         }
 
-        if(!tag_reflexive_erase_element_data(&sound->pitch_ranges, sizeof(struct sound_pitch_range), tag_data)) {
-            fprintf(stderr, "pitch range data in \"%s.%s\" is out of bounds\n",
-                tag_path, tag_fourcc_to_extension(TAG_FOURCC_SOUND));
+        size_t permutation_count = pitch_range_a.permutations.count;
+        const struct sound_permutation *permutations_a = sound_source_resolve(a, pitch_ranges_a[pr].permutations.address, permutation_count * sizeof(struct sound_permutation));
+        const struct sound_permutation *permutations_b = sound_source_resolve(b, pitch_ranges_b[pr].permutations.address, permutation_count * sizeof(struct sound_permutation));
+        if(permutation_count > 0 && (!permutations_a || !permutations_b)) {
             return false;
         }
 
-        tag_data->tags[tag.index].external = 1;
-        fprintf(stderr, "sound \"%s\" had external sound sample offsets and was changed to lookup tag data from sounds.map by tag path\n", tag_path);
+        for(size_t p = 0; p < permutation_count; p++) {
+            struct sound_permutation permutation_a = sound_permutation_masked(&permutations_a[p]);
+            struct sound_permutation permutation_b = sound_permutation_masked(&permutations_b[p]);
+            if(memcmp(&permutation_a, &permutation_b, sizeof(struct sound_permutation)) != 0) {
+                return false;
+            }
+
+            const struct tag_data *samples_a = &permutations_a[p].samples;
+            const struct tag_data *samples_b = &permutations_b[p].samples;
+            const uint8_t *sample_bytes_a = sound_source_get_samples(a, samples_a);
+            const uint8_t *sample_bytes_b = sound_source_get_samples(b, samples_b);
+            if(samples_a->size != samples_b->size || !sample_bytes_a || !sample_bytes_b || memcmp(sample_bytes_a, sample_bytes_b, samples_a->size) != 0) {
+                return false;
+            }
+
+            if(!sound_source_data_match(a, &permutations_a[p].mouth_data, b, &permutations_b[p].mouth_data) ||
+                !sound_source_data_match(a, &permutations_a[p].subtitle_data, b, &permutations_b[p].subtitle_data)) {
+                return false;
+            }
+        }
     }
 
     return true;
 }
+
+// Sounds are looked up in sounds.map by tag path, so only the resource with the same path can match. Only sounds with
+// all of their samples in the cache file are looked at.
+bool sound_matches_resource_map(TagID tag, struct cache_file_instance *cache_file, const struct resource_index *index) {
+    assert(cache_file && cache_file->valid && index);
+    struct tag_data_instance *tag_data = &cache_file->tag_data;
+    const struct sound *sound = tag_get(tag, TAG_FOURCC_SOUND, tag_data);
+    if(!sound || tag_is_external(tag, tag_data)) {
+        return false;
+    }
+
+    uint32_t resource = resource_index_find_sound(index, tag_path_get(tag, tag_data));
+    if(resource == RESOURCE_MAP_NO_MATCH) {
+        return false;
+    }
+
+    const struct resource_map *map = &index->sounds;
+    struct sound_source source = {
+        .tag_data = tag_data,
+        .file = cache_file->data,
+        .file_size = cache_file->header->tags_offset
+    };
+    struct sound_source resource_source = {
+        .map = map,
+        .resource = resource,
+        .file = map->data,
+        .file_size = map->size
+    };
+    return sound_sources_match(&source, sound, &resource_source, resource_map_get_data(map, resource, 0, sizeof(struct sound)));
+}
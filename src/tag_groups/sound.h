@@ -4,6 +4,9 @@
 
 #include "../data_types.h"
 #include "../tag/tag.h"
+#include "../tag/tag_fix_plan.h"
+#include "../cache/cache.h"
+#include "../resources/resource_index.h"
 
 enum {
     SOUND_FLAGS_FIT_TO_ADPCM_BLOCK_SIZE_BIT,
@@ -163,4 +166,6 @@ static_assert(sizeof(struct sound) == 164);
 #define sound_get_pitch_range(sound, index, data) tag_reflexive_get_element(&(sound)->pitch_ranges, index, sizeof(struct sound_pitch_range), data)
 #define sound_get_permutation(pitch_range, index, data) tag_reflexive_get_element(&(pitch_range)->permutations, index, sizeof(struct sound_permutation), data)
 
-bool sound_postprocess(TagID tag, struct tag_data_instance *tag_data);
+bool sound_postprocess(TagID tag, struct tag_data_instance *tag_data, struct tag_fix_plan *plan);
+bool sound_make_external(TagID tag, struct tag_data_instance *tag_data, struct tag_fix_plan *plan);
+bool sound_matches_resource_map(TagID tag, struct cache_file_instance *cache_file, const struct resource_index *index);
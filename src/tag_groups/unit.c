@@ -1,37 +1,32 @@
 #include <stdint.h>
 #include <stdio.h>
-#include <assert.h>
 
 #include "../data_types.h"
 #include "../tag/tag.h"
 #include "../tag/tag_fourcc.h"
-#include "../tag/tag_processing.h"
 
 #include "hud_types.h"
 #include "unit.h"
+#include "../thread/thread_output.h"
 
-void unit_process_metagame_properties(struct unit_metagame_properties *metagame_properties) {
-    assert(metagame_properties);
+static const struct tag_field_rule unit_rule_list[] = {
+    // This can be invalid due to Bungie changing the struct after some stock tags were made, and tool.exe will not check it.
+    TAG_FIELD_RULE_ENUM16_RANGE(struct unit, unit.blip_type, NUMBER_OF_HUD_BLIP_TYPES, HUD_BLIP_TYPE_MEDIUM, "blip type is out of range"),
 
-    tag_process_enum16(&metagame_properties->metagame_type, NUMBER_OF_UNIT_METAGAME_TYPES, UNIT_METAGAME_TYPE_BRUTE);
-    tag_process_enum16(&metagame_properties->metagame_class, NUMBER_OF_UNIT_METAGAME_CLASSES, UNIT_METAGAME_CLASS_INFANTRY);
-}
+    // Added in MCC CEA
+    UNIT_METAGAME_PROPERTIES_RULES(struct unit, unit.metagame_properties)
+};
+static const struct tag_field_rule_table unit_rules = TAG_FIELD_RULE_TABLE(struct unit, unit_rule_list);
 
-bool uint_postprocess(TagID tag, struct tag_data_instance *tag_data) {
+bool uint_postprocess(TagID tag, struct tag_data_instance *tag_data, struct tag_fix_plan *plan) {
     struct unit *unit = tag_get(tag, TAG_FOURCC_UNIT, tag_data);
     if(!unit) {
-        fprintf(stderr, "tag data for \"%s.%s\" is invalid\n",
+        thread_output_error("tag data for \"%s.%s\" is invalid\n",
             tag_path_get(tag, tag_data), tag_extension_get(tag, tag_data));
         return false;
     }
 
-    // This can be invalid due to Bungie changing the struct after some stock tags were made, and tool.exe will not check it.
-    if(unit->unit.blip_type >= NUMBER_OF_HUD_BLIP_TYPES) {
-        unit->unit.blip_type = HUD_BLIP_TYPE_MEDIUM;
-    }
-
-    // Added in MCC CEA
-    unit_process_metagame_properties(&unit->unit.metagame_properties);
+    tag_field_rules_apply(&unit_rules, unit, 1, plan);
 
     return true;
 }
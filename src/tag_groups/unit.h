@@ -4,6 +4,8 @@
 
 #include "../data_types.h"
 #include "../tag/tag.h"
+#include "../tag/tag_fix_plan.h"
+#include "../tag/tag_field_rules.h"
 #include "object.h"
 
 enum {
@@ -302,5 +304,8 @@ static_assert(sizeof(struct unit) == 752);
 
 #pragma pack(pop)
 
-void unit_process_metagame_properties(struct unit_metagame_properties *metagame_properties);
-bool uint_postprocess(TagID tag, struct tag_data_instance *tag_data);
+// Added in MCC CEA. The field is the full path to the metagame properties from struct_type.
+#define UNIT_METAGAME_PROPERTIES_RULES(struct_type, field) \
+    TAG_FIELD_RULE_ENUM16_BIG_ENDIAN(struct_type, field.metagame_type, NUMBER_OF_UNIT_METAGAME_TYPES, UNIT_METAGAME_TYPE_BRUTE, "metagame type is big-endian"), \
+    TAG_FIELD_RULE_ENUM16_BIG_ENDIAN(struct_type, field.metagame_class, NUMBER_OF_UNIT_METAGAME_CLASSES, UNIT_METAGAME_CLASS_INFANTRY, "metagame class is big-endian")
+bool uint_postprocess(TagID tag, struct tag_data_instance *tag_data, struct tag_fix_plan *plan);
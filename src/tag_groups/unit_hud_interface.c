@@ -7,30 +7,37 @@
 
 #include "hud_types.h"
 #include "unit_hud_interface.h"
+#include "../thread/thread_output.h"
 
-bool unit_hud_interface_postprocess(TagID tag, struct tag_data_instance *tag_data) {
+static const struct tag_field_rule unit_hud_interface_rule_list[] = {
+    HUD_ABSOLUTE_PLACEMENT_CANVAS_SIZE_RULE(struct unit_hud_interface, absolute_placement.canvas_size),
+    HUD_ABSOLUTE_PLACEMENT_CANVAS_SIZE_RULE(struct unit_hud_interface, auxiliary_panel.absolute_placement.canvas_size),
+    HUD_METER_ELEMENT_MIN_ALPHA_RULE(struct unit_hud_interface, shield_meter.meter.min_alpha),
+    HUD_METER_ELEMENT_MIN_ALPHA_RULE(struct unit_hud_interface, health_meter.meter.min_alpha)
+};
+static const struct tag_field_rule_table unit_hud_interface_rules = TAG_FIELD_RULE_TABLE(struct unit_hud_interface, unit_hud_interface_rule_list);
+
+static const struct tag_field_rule unit_hud_auxiliary_meter_rule_list[] = {
+    HUD_METER_ELEMENT_MIN_ALPHA_RULE(struct uint_hud_auxiliary_meter_element, panel.meter.min_alpha)
+};
+static const struct tag_field_rule_table unit_hud_auxiliary_meter_rules = TAG_FIELD_RULE_TABLE(struct uint_hud_auxiliary_meter_element, unit_hud_auxiliary_meter_rule_list);
+
+bool unit_hud_interface_postprocess(TagID tag, struct tag_data_instance *tag_data, struct tag_fix_plan *plan) {
     struct unit_hud_interface *unit_hud = tag_get(tag, TAG_FOURCC_UNIT_HUD_INTERFACE, tag_data);
     if(!unit_hud) {
-        fprintf(stderr, "tag data for \"%s.%s\" is invalid\n",
+        thread_output_error("tag data for \"%s.%s\" is invalid\n",
             tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_UNIT_HUD_INTERFACE));
         return false;
     }
 
-    hud_process_absolute_placement(&unit_hud->absolute_placement);
-    hud_process_absolute_placement(&unit_hud->auxiliary_panel.absolute_placement);
-    hud_process_meter_element(&unit_hud->shield_meter.meter);
-    hud_process_meter_element(&unit_hud->health_meter.meter);
+    tag_field_rules_apply(&unit_hud_interface_rules, unit_hud, 1, plan);
 
     // Auxiliary meter elements
-    for(size_t i = 0; i < unit_hud->auxiliary_meters.count; i++) {
-        struct uint_hud_auxiliary_meter_element *meter_element = unit_hud_get_auxiliary_meter_element(unit_hud, i, tag_data);
-        if(!meter_element) {
-            fprintf(stderr, "auxiliary meter element %zu in \"%s.%s\" is out of bounds\n",
-                i, tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_UNIT_HUD_INTERFACE));
-            return false;
-        }
-
-        hud_process_meter_element(&meter_element->panel.meter);
+    size_t invalid_index;
+    if(!tag_field_rules_apply_reflexive(&unit_hud_auxiliary_meter_rules, &unit_hud->auxiliary_meters, &invalid_index, tag_data, plan)) {
+        thread_output_error("auxiliary meter element %zu in \"%s.%s\" is out of bounds\n",
+            invalid_index, tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_UNIT_HUD_INTERFACE));
+        return false;
     }
 
     return true;
@@ -1,74 +1,73 @@
 #include <stdint.h>
 #include <stdio.h>
+#include <stddef.h>
 
 #include "../data_types.h"
 #include "../tag/tag.h"
 #include "../tag/tag_fourcc.h"
-#include "../tag/tag_processing.h"
 
 #include "hud_types.h"
 #include "weapon_hud_interface.h"
-
-#define PROCESS_CHILD_ANCHOR(anchor) tag_process_enum16(anchor, NUMBER_OF_HUD_CHILD_ANCHORS, HUD_CHILD_ANCHOR_FROM_PARENT)
-
-bool weapon_hud_interface_postprocess(TagID tag, struct tag_data_instance *tag_data) {
+#include "../thread/thread_output.h"
+
+#define CHILD_ANCHOR_RULE(struct_type) \
+    TAG_FIELD_RULE_ENUM16_BIG_ENDIAN(struct_type, header.child_anchor, NUMBER_OF_HUD_CHILD_ANCHORS, HUD_CHILD_ANCHOR_FROM_PARENT, "child anchor is big-endian")
+
+static const struct tag_field_rule weapon_hud_interface_rule_list[] = {
+    HUD_ABSOLUTE_PLACEMENT_CANVAS_SIZE_RULE(struct weapon_hud_interface, absolute_placement.canvas_size)
+};
+static const struct tag_field_rule weapon_hud_static_element_rule_list[] = {
+    CHILD_ANCHOR_RULE(struct weapon_hud_static_element)
+};
+static const struct tag_field_rule weapon_hud_meter_element_rule_list[] = {
+    CHILD_ANCHOR_RULE(struct weapon_hud_meter_element),
+    HUD_METER_ELEMENT_MIN_ALPHA_RULE(struct weapon_hud_meter_element, meter_element.min_alpha)
+};
+static const struct tag_field_rule weapon_hud_number_element_rule_list[] = {
+    CHILD_ANCHOR_RULE(struct weapon_hud_number_element)
+};
+static const struct tag_field_rule weapon_hud_overlays_element_rule_list[] = {
+    CHILD_ANCHOR_RULE(struct weapon_hud_overlays_element)
+};
+
+static const struct tag_field_rule_table weapon_hud_interface_rules = TAG_FIELD_RULE_TABLE(struct weapon_hud_interface, weapon_hud_interface_rule_list);
+static const struct tag_field_rule_table weapon_hud_static_element_rules = TAG_FIELD_RULE_TABLE(struct weapon_hud_static_element, weapon_hud_static_element_rule_list);
+static const struct tag_field_rule_table weapon_hud_meter_element_rules = TAG_FIELD_RULE_TABLE(struct weapon_hud_meter_element, weapon_hud_meter_element_rule_list);
+static const struct tag_field_rule_table weapon_hud_number_element_rules = TAG_FIELD_RULE_TABLE(struct weapon_hud_number_element, weapon_hud_number_element_rule_list);
+static const struct tag_field_rule_table weapon_hud_overlays_element_rules = TAG_FIELD_RULE_TABLE(struct weapon_hud_overlays_element, weapon_hud_overlays_element_rule_list);
+
+// Element arrays, in the order they are fixed
+static const struct {
+    const struct tag_field_rule_table *rules;
+    size_t reflexive_offset;
+    const char *name;
+} weapon_hud_element_arrays[] = {
+    { &weapon_hud_static_element_rules, offsetof(struct weapon_hud_interface, statics), "static" },
+    { &weapon_hud_meter_element_rules, offsetof(struct weapon_hud_interface, meters), "meter" },
+    { &weapon_hud_number_element_rules, offsetof(struct weapon_hud_interface, numbers), "number" },
+    { &weapon_hud_overlays_element_rules, offsetof(struct weapon_hud_interface, overlays), "overlays" }
+};
+
+bool weapon_hud_interface_postprocess(TagID tag, struct tag_data_instance *tag_data, struct tag_fix_plan *plan) {
     struct weapon_hud_interface *weapon_hud = tag_get(tag, TAG_FOURCC_WEAPON_HUD_INTERFACE, tag_data);
     if(!weapon_hud) {
-        fprintf(stderr, "tag data for \"%s.%s\" is invalid\n",
+        thread_output_error("tag data for \"%s.%s\" is invalid\n",
             tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_WEAPON_HUD_INTERFACE));
         return false;
     }
 
     // Absolute placement
-    hud_process_absolute_placement(&weapon_hud->absolute_placement);
-
-    // Static elements
-    for(size_t statics = 0; statics < weapon_hud->statics.count; statics++) {
-        struct weapon_hud_static_element *static_element = weapon_hud_get_static_element(weapon_hud, statics, tag_data);
-        if(!static_element) {
-            fprintf(stderr, "static element %zu in \"%s.%s\" is out of bounds\n",
-                statics, tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_WEAPON_HUD_INTERFACE));
-            return false;
-        }
-
-        PROCESS_CHILD_ANCHOR(&static_element->header.child_anchor);
-    }
-
-    // Meter elements
-    for(size_t meters = 0; meters < weapon_hud->meters.count; meters++) {
-        struct weapon_hud_meter_element *meter_element = weapon_hud_get_meter_element(weapon_hud, meters, tag_data);
-        if(!meter_element) {
-            fprintf(stderr, "meter element %zu in \"%s.%s\" is out of bounds\n",
-                meters, tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_WEAPON_HUD_INTERFACE));
+    tag_field_rules_apply(&weapon_hud_interface_rules, weapon_hud, 1, plan);
+
+    // Static, meter, number and overlays elements
+    for(size_t a = 0; a < sizeof(weapon_hud_element_arrays) / sizeof(weapon_hud_element_arrays[0]); a++) {
+        struct tag_reflexive *elements = (struct tag_reflexive *)((uint8_t *)weapon_hud + weapon_hud_element_arrays[a].reflexive_offset);
+        size_t invalid_index;
+        if(!tag_field_rules_apply_reflexive(weapon_hud_element_arrays[a].rules, elements, &invalid_index, tag_data, plan)) {
+            thread_output_error("%s element %zu in \"%s.%s\" is out of bounds\n",
+                weapon_hud_element_arrays[a].name, invalid_index, tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_WEAPON_HUD_INTERFACE));
             return false;
         }
-
-        PROCESS_CHILD_ANCHOR(&meter_element->header.child_anchor);
-        hud_process_meter_element(&meter_element->meter_element);
-    }
-
-    // Number elements
-    for(size_t numbers = 0; numbers < weapon_hud->numbers.count; numbers++) {
-        struct weapon_hud_number_element *number_element = weapon_hud_get_number_element(weapon_hud, numbers, tag_data);
-        if(!number_element) {
-            fprintf(stderr, "number element %zu in \"%s.%s\" is out of bounds\n",
-                numbers, tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_WEAPON_HUD_INTERFACE));
-            return false;
-        }
-
-        PROCESS_CHILD_ANCHOR(&number_element->header.child_anchor);
-    }
-
-    // Overlays elements
-    for(size_t overlays = 0; overlays < weapon_hud->overlays.count; overlays++) {
-        struct weapon_hud_overlays_element *overlays_element = weapon_hud_get_overlays_element(weapon_hud, overlays, tag_data);
-        if(!overlays_element) {
-            fprintf(stderr, "overlays element %zu in \"%s.%s\" is out of bounds\n",
-                overlays, tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_WEAPON_HUD_INTERFACE));
-            return false;
-        }
-
-        PROCESS_CHILD_ANCHOR(&overlays_element->header.child_anchor);
     }
 
     // Check for buggy zoom flag state
@@ -80,14 +79,14 @@ bool weapon_hud_interface_postprocess(TagID tag, struct tag_data_instance *tag_d
     for(size_t crosshairs = 0; crosshairs < weapon_hud->crosshairs.count; crosshairs++) {
         struct weapon_hud_crosshairs_element *crosshairs_element = weapon_hud_get_crosshairs_element(weapon_hud, crosshairs, tag_data);
         if(!crosshairs_element) {
-            fprintf(stderr, "crosshairs element %zu in \"%s.%s\" is out of bounds\n",
+            thread_output_error("crosshairs element %zu in \"%s.%s\" is out of bounds\n",
                 crosshairs, tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_WEAPON_HUD_INTERFACE));
             return false;
         }
         for(size_t overlay = 0; overlay < crosshairs_element->crosshairs.items.count; overlay++) {
             struct weapon_hud_crosshair_item *overlay_element = weapon_hud_get_crosshairs_item(crosshairs_element, overlay, tag_data);
             if(!overlay_element) {
-                fprintf(stderr, "crosshair overlay %zu of crosshairs element %zu in \"%s.%s\" is out of bounds\n",
+                thread_output_error("crosshair overlay %zu of crosshairs element %zu in \"%s.%s\" is out of bounds\n",
                     overlay, crosshairs, tag_path_get(tag, tag_data), tag_fourcc_to_extension(TAG_FOURCC_WEAPON_HUD_INTERFACE));
                 return false;
             }
@@ -104,7 +103,9 @@ bool weapon_hud_interface_postprocess(TagID tag, struct tag_data_instance *tag_d
                 // This leads to the game breaking in horrible horrible ways if you do not set it here in this condition.
                 // Bungie would never hit this, because every scoped weapon has a zoom level sprite causing tool.exe to always set the flag.
                 // With custom weapons however it is up to the author. This bug still happens on MCC CEA!
-                SET_FLAG(weapon_hud->valid_crosshair_types_flags, WEAPON_HUD_CROSSHAIR_STATE_ZOOM, true);
+                auto crosshair_types_flags = weapon_hud->valid_crosshair_types_flags;
+                SET_FLAG(crosshair_types_flags, WEAPON_HUD_CROSSHAIR_STATE_ZOOM, true);
+                TAG_FIX_PLAN_SET(plan, weapon_hud->valid_crosshair_types_flags, crosshair_types_flags, "zoom crosshair type flag is missing");
                 return true;
             }
         }
@@ -0,0 +1,95 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include "thread_admission.h"
+
+static thread_local const size_t *thread_admission_sort_costs;
+
+// Largest first, then in the order given
+static int thread_admission_compare_costs(const void *a, const void *b) {
+    size_t job_a = *(const size_t *)a;
+    size_t job_b = *(const size_t *)b;
+    size_t cost_a = thread_admission_sort_costs[job_a];
+    size_t cost_b = thread_admission_sort_costs[job_b];
+    if(cost_a != cost_b) {
+        return cost_a > cost_b ? -1 : 1;
+    }
+    return (job_a > job_b) - (job_a < job_b);
+}
+
+void thread_admission_init(struct thread_admission *admission, const size_t *costs, size_t job_count, size_t budget) {
+    assert(admission && (costs || job_count == 0));
+    *admission = (struct thread_admission){
+        .costs = costs,
+        .job_count = job_count,
+        .budget = budget
+    };
+
+    admission->order = calloc(job_count + 1, sizeof(size_t));
+    admission->admitted = calloc(job_count + 1, sizeof(bool));
+    if(!admission->order || !admission->admitted) {
+        abort();
+    }
+    for(size_t i = 0; i < job_count; i++) {
+        admission->order[i] = i;
+    }
+    thread_admission_sort_costs = costs;
+    qsort(admission->order, job_count, sizeof(size_t), thread_admission_compare_costs);
+    thread_admission_sort_costs = nullptr;
+
+    if(pthread_mutex_init(&admission->mutex, nullptr) != 0 || pthread_cond_init(&admission->released, nullptr) != 0) {
+        abort();
+    }
+}
+
+size_t thread_admission_acquire(struct thread_admission *admission) {
+    assert(admission);
+    pthread_mutex_lock(&admission->mutex);
+    while(true) {
+        while(admission->first_waiting < admission->job_count && admission->admitted[admission->first_waiting]) {
+            admission->first_waiting++;
+        }
+        if(admission->first_waiting == admission->job_count) {
+            pthread_mutex_unlock(&admission->mutex);
+            return THREAD_ADMISSION_DONE;
+        }
+
+        for(size_t i = admission->first_waiting; i < admission->job_count; i++) {
+            if(admission->admitted[i]) {
+                continue;
+            }
+            size_t cost = admission->costs[admission->order[i]];
+            bool fits = admission->budget == 0 || admission->running == 0 || admission->in_use + cost <= admission->budget;
+            if(fits) {
+                admission->admitted[i] = true;
+                admission->in_use += cost;
+                admission->running++;
+                pthread_mutex_unlock(&admission->mutex);
+                return admission->order[i];
+            }
+        }
+
+        pthread_cond_wait(&admission->released, &admission->mutex);
+    }
+}
+
+void thread_admission_release(struct thread_admission *admission, size_t job) {
+    assert(admission && job < admission->job_count);
+    pthread_mutex_lock(&admission->mutex);
+    assert(admission->running > 0 && admission->in_use >= admission->costs[job]);
+    admission->in_use -= admission->costs[job];
+    admission->running--;
+    pthread_cond_broadcast(&admission->released);
+    pthread_mutex_unlock(&admission->mutex);
+}
+
+void thread_admission_free(struct thread_admission *admission) {
+    assert(admission);
+    pthread_cond_destroy(&admission->released);
+    pthread_mutex_destroy(&admission->mutex);
+    free(admission->order);
+    free(admission->admitted);
+    *admission = (struct thread_admission){};
+}
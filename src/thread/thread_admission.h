@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#define THREAD_ADMISSION_DONE SIZE_MAX
+
+// A thread admission controller hands out jobs that each hold some amount of memory while they run, largest first,
+// keeping the jobs running at once within a budget. A job that does not fit waits until enough is released, unless
+// nothing is running, in which case it goes ahead alone so a job bigger than the whole budget still gets done. While
+// the largest job waits, smaller ones that fit are handed out instead.
+struct thread_admission {
+    pthread_mutex_t mutex;
+    pthread_cond_t released;
+    const size_t *costs;
+    size_t *order; // Job indices, largest cost first
+    bool *admitted; // Indexed by order
+    size_t job_count;
+    size_t first_waiting; // Everything in order before this was admitted
+    size_t budget; // 0 for no limit
+    size_t in_use;
+    size_t running;
+};
+
+void thread_admission_init(struct thread_admission *admission, const size_t *costs, size_t job_count, size_t budget);
+
+// Waits for the next job that fits and returns its index, or THREAD_ADMISSION_DONE once every job was handed out
+size_t thread_admission_acquire(struct thread_admission *admission);
+
+// Gives back what a finished job held
+void thread_admission_release(struct thread_admission *admission, size_t job);
+
+void thread_admission_free(struct thread_admission *admission);
@@ -0,0 +1,123 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <pthread.h>
+#include <assert.h>
+
+#include "thread_output.h"
+
+#include "../data_types.h"
+
+// Text printed to one stream in a row
+struct thread_output_chunk {
+    bool error;
+    char *text;
+    size_t length;
+};
+
+struct thread_output {
+    pthread_mutex_t mutex; // Jobs of the thread that started it print at the same time
+    struct thread_output_chunk *chunks;
+    size_t chunk_count;
+    size_t chunk_capacity;
+};
+
+// So buffers written out at the same time are not mixed together either
+static pthread_mutex_t thread_output_write_mutex = PTHREAD_MUTEX_INITIALIZER;
+static thread_local struct thread_output *thread_output_current = nullptr;
+
+static void thread_output_append(struct thread_output *output, bool error, const char *format, va_list args) {
+    va_list length_args;
+    va_copy(length_args, args);
+    int length = vsnprintf(nullptr, 0, format, length_args);
+    va_end(length_args);
+    if(length < 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&output->mutex);
+    struct thread_output_chunk *chunk = output->chunk_count > 0 ? &output->chunks[output->chunk_count - 1] : nullptr;
+    if(!chunk || chunk->error != error) {
+        if(output->chunk_count == output->chunk_capacity) {
+            output->chunk_capacity = MAX(output->chunk_capacity * 2, 16);
+            output->chunks = realloc(output->chunks, output->chunk_capacity * sizeof(struct thread_output_chunk));
+            if(!output->chunks) {
+                abort();
+            }
+        }
+        chunk = &output->chunks[output->chunk_count++];
+        *chunk = (struct thread_output_chunk){ .error = error };
+    }
+
+    chunk->text = realloc(chunk->text, chunk->length + length + 1);
+    if(!chunk->text) {
+        abort();
+    }
+    vsnprintf(chunk->text + chunk->length, length + 1, format, args);
+    chunk->length += length;
+    pthread_mutex_unlock(&output->mutex);
+}
+
+void thread_output_print(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    if(thread_output_current) {
+        thread_output_append(thread_output_current, false, format, args);
+    }
+    else {
+        vprintf(format, args);
+    }
+    va_end(args);
+}
+
+void thread_output_error(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    if(thread_output_current) {
+        thread_output_append(thread_output_current, true, format, args);
+    }
+    else {
+        vfprintf(stderr, format, args);
+    }
+    va_end(args);
+}
+
+void thread_output_begin(void) {
+    assert(!thread_output_current);
+    thread_output_current = calloc(1, sizeof(struct thread_output));
+    if(!thread_output_current) {
+        abort();
+    }
+    pthread_mutex_init(&thread_output_current->mutex, nullptr);
+}
+
+void thread_output_end(void) {
+    struct thread_output *output = thread_output_current;
+    assert(output);
+    thread_output_current = nullptr;
+
+    // Flushed as it goes so stdout and stderr stay in order on a terminal
+    pthread_mutex_lock(&thread_output_write_mutex);
+    for(size_t c = 0; c < output->chunk_count; c++) {
+        struct thread_output_chunk *chunk = &output->chunks[c];
+        FILE *stream = chunk->error ? stderr : stdout;
+        fwrite(chunk->text, 1, chunk->length, stream);
+        fflush(stream);
+        free(chunk->text);
+    }
+    pthread_mutex_unlock(&thread_output_write_mutex);
+
+    pthread_mutex_destroy(&output->mutex);
+    free(output->chunks);
+    free(output);
+}
+
+struct thread_output *thread_output_get(void) {
+    return thread_output_current;
+}
+
+void thread_output_set(struct thread_output *output) {
+    thread_output_current = output;
+}
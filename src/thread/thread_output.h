@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Maps processed at once print everything to a buffer of their own, which is written out in one go once the map is
+// done, so the lines of different maps are not mixed together. Jobs started from a thread that is buffering print to
+// its buffer too. Otherwise this prints straight to stdout and stderr.
+struct thread_output;
+
+// Prints to stdout
+void thread_output_print(const char *format, ...);
+
+// Prints to stderr
+void thread_output_error(const char *format, ...);
+
+// Buffers what the calling thread prints until thread_output_end(), which writes it all out in the order it was printed
+void thread_output_begin(void);
+void thread_output_end(void);
+
+// So thread pool jobs print where the thread that started the batch does
+struct thread_output *thread_output_get(void);
+void thread_output_set(struct thread_output *output);
@@ -0,0 +1,115 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <assert.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "thread_pool.h"
+#include "thread_output.h"
+
+#include "../data_types.h"
+
+struct thread_pool_batch {
+    thread_pool_job_proc job;
+    void *context;
+    struct thread_output *output;
+    size_t job_count;
+    atomic_size_t next_job;
+};
+
+static size_t thread_pool_thread_count = 0;
+static thread_local size_t thread_pool_local_thread_count = 0;
+
+static size_t thread_pool_get_processor_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO system_info;
+    GetSystemInfo(&system_info);
+    long processor_count = system_info.dwNumberOfProcessors;
+#else
+    long processor_count = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if(processor_count < 1) {
+        return 1;
+    }
+
+    return MIN((size_t)processor_count, THREAD_POOL_MAXIMUM_THREADS);
+}
+
+size_t thread_pool_get_thread_count(void) {
+    if(thread_pool_local_thread_count > 0) {
+        return thread_pool_local_thread_count;
+    }
+    if(thread_pool_thread_count == 0) {
+        thread_pool_thread_count = thread_pool_get_processor_count();
+    }
+
+    return thread_pool_thread_count;
+}
+
+void thread_pool_set_thread_count(size_t thread_count) {
+    thread_pool_thread_count = PIN(thread_count, 1, THREAD_POOL_MAXIMUM_THREADS);
+}
+
+void thread_pool_set_local_thread_count(size_t thread_count) {
+    thread_pool_local_thread_count = MIN(thread_count, THREAD_POOL_MAXIMUM_THREADS);
+}
+
+// Every thread (including the caller) grabs the next unclaimed job until the batch runs dry, so a few
+// expensive jobs do not hold up a whole chunk of cheap ones
+static void *thread_pool_worker(void *parameter) {
+    struct thread_pool_batch *batch = parameter;
+    thread_output_set(batch->output);
+    while(true) {
+        size_t job_index = atomic_fetch_add_explicit(&batch->next_job, 1, memory_order_relaxed);
+        if(job_index >= batch->job_count) {
+            break;
+        }
+        batch->job(job_index, batch->context);
+    }
+
+    return nullptr;
+}
+
+void thread_pool_run(size_t job_count, thread_pool_job_proc job, void *context) {
+    assert(job);
+    if(job_count == 0) {
+        return;
+    }
+
+    struct thread_pool_batch batch = {
+        .job = job,
+        .context = context,
+        .output = thread_output_get(),
+        .job_count = job_count
+    };
+    atomic_init(&batch.next_job, 0);
+
+    // Not worth spinning up threads for
+    size_t thread_count = MIN(thread_pool_get_thread_count(), job_count);
+    if(thread_count <= 1) {
+        thread_pool_worker(&batch);
+        return;
+    }
+
+    pthread_t threads[THREAD_POOL_MAXIMUM_THREADS];
+    size_t threads_started = 0;
+    for(size_t i = 1; i < thread_count; i++) {
+        if(pthread_create(&threads[threads_started], nullptr, thread_pool_worker, &batch) != 0) {
+            // We can still finish the batch with whatever we have
+            break;
+        }
+        threads_started++;
+    }
+
+    thread_pool_worker(&batch);
+    for(size_t i = 0; i < threads_started; i++) {
+        pthread_join(threads[i], nullptr);
+    }
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define THREAD_POOL_MAXIMUM_THREADS 64
+
+typedef void (*thread_pool_job_proc)(size_t job_index, void *context);
+
+// How many threads batches started from the calling thread use
+size_t thread_pool_get_thread_count(void);
+void thread_pool_set_thread_count(size_t thread_count);
+
+// Overrides the thread count for batches started from the calling thread, or goes back to the global count if 0. Jobs
+// that start their own batches use this so they do not each take every core.
+void thread_pool_set_local_thread_count(size_t thread_count);
+
+void thread_pool_run(size_t job_count, thread_pool_job_proc job, void *context);
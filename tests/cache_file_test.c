@@ -0,0 +1,131 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test_map.h"
+
+#include "../src/cache/cache.h"
+#include "../src/cache/cache_compression.h"
+#include "../src/tag/tag.h"
+#include "../src/tag/tag_fix_plan.h"
+#include "../src/tag/tag_fourcc.h"
+#include "../src/tag/tag_reference_graph.h"
+#include "../src/tag_groups/scenario.h"
+
+#define TEST_MAP_PATH "cache_file_test.map"
+
+// Nothing references the bitmap, so pruning removes it
+static const struct test_map_tag test_tags[] = {
+    { TAG_FOURCC_SCENARIO, "levels\\test\\test\\test", sizeof(struct scenario) },
+    { TAG_FOURCC_SKY, "test\\sky\\sky", 16 },
+    { TAG_FOURCC_BITMAP, "test\\orphans\\bitmap", 16 }
+};
+
+static void load_test_map(uint32_t version, struct cache_file_instance *cache_file) {
+    test_map_load(TEST_MAP_PATH, version, test_tags, sizeof(test_tags) / sizeof(test_tags[0]), cache_file);
+}
+
+// Points the scenario at the sky and prunes the bitmap, the way main does it
+static void process(struct cache_file_instance *cache_file) {
+    struct tag_data_instance *tag_data = &cache_file->tag_data;
+    struct scenario *scenario = tag_get(tag_data->header->scenario_tag, TAG_FOURCC_SCENARIO, tag_data);
+    CHECK(scenario);
+    const struct tag_instance *sky = &tag_data->tags[1];
+    struct tag_reference reference = { sky->primary_group, sky->name_address, strlen(test_tags[1].path), sky->tag_id };
+
+    struct tag_fix_plan plan;
+    tag_fix_plan_init(&plan, cache_file->data, tag_data->header->scenario_tag);
+    tag_fix_plan_write(&plan, &scenario->unused_sky, &reference, sizeof(reference), "test");
+    tag_fix_plan_apply(&plan);
+    tag_fix_plan_free(&plan);
+
+    struct tag_reference_graph graph;
+    CHECK(tag_reference_graph_build(&graph, cache_file));
+    tag_fix_plan_init(&plan, cache_file->data, tag_data->header->scenario_tag);
+    CHECK(tag_reference_graph_plan_prune(&graph, cache_file, &plan) == 1);
+    tag_fix_plan_apply(&plan);
+    tag_fix_plan_free(&plan);
+    tag_reference_graph_free(&graph);
+    CHECK(tag_data->header->tag_count == 2);
+
+    CHECK(cache_file_update_header(cache_file, true));
+}
+
+// Loads the map saved after processing and checks it is the same
+static void save_and_reload(struct cache_file_instance *cache_file, uint16_t build) {
+    CHECK(cache_file_save(TEST_MAP_PATH, cache_file));
+
+    struct cache_file_instance reloaded = {};
+    cache_file_load(TEST_MAP_PATH, &reloaded);
+    CHECK(reloaded.valid);
+    CHECK(reloaded.size == cache_file->size);
+    CHECK(memcmp(reloaded.data, cache_file->data, cache_file->size) == 0);
+    CHECK(cache_file_resolve_build(reloaded.header) == build);
+    CHECK(reloaded.tag_data.header->tag_count == 2);
+    CHECK(strcmp(tag_path_get(reloaded.tag_data.tags[1].tag_id, &reloaded.tag_data), test_tags[1].path) == 0);
+    cache_file_unload(&reloaded);
+}
+
+static void test_pc_round_trip(void) {
+    struct cache_file_instance cache_file;
+    load_test_map(CACHE_FILE_VERSION_CUSTOM_EDITION, &cache_file);
+    CHECK(cache_file_has_model_data(&cache_file));
+    CHECK(cache_file.tag_data.header_size == sizeof(struct tag_data_header));
+
+    process(&cache_file);
+    save_and_reload(&cache_file, CACHE_FILE_TRACKED_BUILD_TOOL_SQUISHER);
+    cache_file_unload(&cache_file);
+}
+
+// The build is tracked and kept, the shorter header is used for the tag array and pruning, and the map is compressed again
+static void test_xbox_round_trip(void) {
+    struct cache_file_instance cache_file;
+    load_test_map(CACHE_FILE_VERSION_XBOX, &cache_file);
+    CHECK(cache_file_resolve_build(cache_file.header) == CACHE_FILE_TRACKED_BUILD_XBOX);
+    CHECK(!cache_file_has_model_data(&cache_file));
+    CHECK(cache_file.tag_data.header_size == sizeof(struct tag_data_header_xbox));
+    CHECK(cache_file.tag_data.data_load_address == TAG_DATA_LOAD_ADDRESS_XBOX);
+    CHECK((uint8_t *)cache_file.tag_data.tags == cache_file.tag_data.data + sizeof(struct tag_data_header_xbox));
+    uint32_t checksum = cache_file.header->checksum;
+
+    process(&cache_file);
+    CHECK(cache_file.header->checksum == checksum);
+    save_and_reload(&cache_file, CACHE_FILE_TRACKED_BUILD_XBOX);
+    cache_file_unload(&cache_file);
+}
+
+// More than one block, so the blocks have to be put back together as one stream
+static void test_compression_round_trip(void) {
+    size_t size = CACHE_COMPRESSION_BLOCK_SIZE * 5 / 2;
+    uint8_t *data = malloc(size);
+    uint8_t *inflated = malloc(size);
+    CHECK(data && inflated);
+    uint32_t state = 1;
+    for(size_t i = 0; i < size; i++) {
+        state = state * 1103515245 + 12345;
+        data[i] = i % 3 == 0 ? (uint8_t)(state >> 24) : (uint8_t)(i >> 8);
+    }
+
+    FILE *file = tmpfile();
+    CHECK(file);
+    uint64_t compressed_size;
+    CHECK(cache_compression_deflate(file, data, size, &compressed_size));
+    CHECK(compressed_size > 0 && compressed_size < size);
+    CHECK(ftell(file) == (long)compressed_size);
+    rewind(file);
+    CHECK(cache_compression_inflate(file, inflated, size));
+    CHECK(memcmp(data, inflated, size) == 0);
+
+    fclose(file);
+    free(inflated);
+    free(data);
+}
+
+int main(void) {
+    test_pc_round_trip();
+    test_xbox_round_trip();
+    test_compression_round_trip();
+    remove(TEST_MAP_PATH);
+    return EXIT_SUCCESS;
+}
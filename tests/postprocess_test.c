@@ -0,0 +1,163 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test_map.h"
+
+// postprocess_tag_data() is static, so main.c is built in with its main() renamed
+#define main tool_squisher_main
+#include "../src/main.c"
+#undef main
+
+#define TEST_MAP_PATH "postprocess_test.map"
+#define TEST_BSP_ADDRESS_OFFSET 0x100000
+#define TEST_VERTEX_COUNT 4
+#define TEST_HARDWARE_FORMAT 0x12345678
+#define TEST_SOUND_CACHE_INDEX 7
+
+// The sky is opaque, so its base struct holds the blocks below without the schema looking inside. The BSP is given its
+// group once the scenario has a reference to it, since loading checks the two match.
+static const struct test_map_tag test_tags[] = {
+    { TAG_FOURCC_SCENARIO, "levels\\test\\test\\test", sizeof(struct scenario) },
+    { TAG_FOURCC_MODEL, "test\\model\\model", sizeof(struct model) },
+    { TAG_FOURCC_SOUND, "test\\sound\\sound", sizeof(struct sound) },
+    { TAG_FOURCC_NONE, "levels\\test\\test\\test", 4 },
+    { TAG_FOURCC_SKY, "test\\sky\\blocks", 1536 }
+};
+
+// Where everything is in the sky's base struct
+enum {
+    TEST_GEOMETRY_OFFSET = 0,
+    TEST_PART_OFFSET = TEST_GEOMETRY_OFFSET + sizeof(struct model_geometry),
+    TEST_VERTICES_OFFSET = TEST_PART_OFFSET + sizeof(struct model_geometry_part),
+    TEST_PITCH_RANGE_OFFSET = TEST_VERTICES_OFFSET + 64,
+    TEST_PERMUTATION_OFFSET = TEST_PITCH_RANGE_OFFSET + sizeof(struct sound_pitch_range),
+    TEST_BSP_REFERENCE_OFFSET = TEST_PERMUTATION_OFFSET + sizeof(struct sound_permutation),
+    TEST_BSP_OFFSET = TEST_BSP_REFERENCE_OFFSET + sizeof(struct scenario_structure_bsp_reference),
+    TEST_BSP_STRUCT_OFFSET = sizeof(struct cache_file_structure_bsp_header),
+    TEST_LIGHTMAP_OFFSET = TEST_BSP_STRUCT_OFFSET + sizeof(struct structure_bsp),
+    TEST_MATERIAL_OFFSET = TEST_LIGHTMAP_OFFSET + sizeof(struct structure_lightmap),
+    TEST_BSP_SIZE = TEST_MATERIAL_OFFSET + sizeof(struct structure_material)
+};
+static_assert(TEST_BSP_OFFSET + TEST_BSP_SIZE <= 1536);
+
+struct test_map {
+    struct cache_file_instance cache_file;
+    struct model_geometry_part *part;
+    struct sound_permutation *permutation;
+    struct structure_material *material;
+};
+
+static void *test_map_get_base_struct(struct test_map *map, size_t index) {
+    struct tag_data_instance *tag_data = &map->cache_file.tag_data;
+    return tag_data->data + (tag_data->tags[index].base_address - tag_data->data_load_address);
+}
+
+static struct tag_reflexive test_map_reflexive(Pointer32 address, uint32_t count) {
+    return (struct tag_reflexive){ .count = count, .address = address };
+}
+
+// A model part and a BSP material with their vertex buffers set up the way the game would load them, and a sound
+static void load_test_map(uint32_t version, struct test_map *map) {
+    test_map_load(TEST_MAP_PATH, version, test_tags, sizeof(test_tags) / sizeof(test_tags[0]), &map->cache_file);
+    struct tag_data_instance *tag_data = &map->cache_file.tag_data;
+    uint8_t *blocks = test_map_get_base_struct(map, 4);
+    Pointer32 blocks_address = tag_data->tags[4].base_address;
+
+    struct model *model = test_map_get_base_struct(map, 1);
+    model->geometries = test_map_reflexive(blocks_address + TEST_GEOMETRY_OFFSET, 1);
+    struct model_geometry *geometry = (struct model_geometry *)(blocks + TEST_GEOMETRY_OFFSET);
+    geometry->parts = test_map_reflexive(blocks_address + TEST_PART_OFFSET, 1);
+    map->part = (struct model_geometry_part *)(blocks + TEST_PART_OFFSET);
+    map->part->vertex_buffer = (struct vertex_buffer){
+        .type = RASTERIZER_VERTEX_TYPE_MODEL_COMPRESSED,
+        .count = TEST_VERTEX_COUNT,
+        .base_address = blocks_address + TEST_VERTICES_OFFSET
+    };
+
+    struct sound *sound = test_map_get_base_struct(map, 2);
+    sound->pitch_ranges = test_map_reflexive(blocks_address + TEST_PITCH_RANGE_OFFSET, 1);
+    struct sound_pitch_range *pitch_range = (struct sound_pitch_range *)(blocks + TEST_PITCH_RANGE_OFFSET);
+    pitch_range->permutations = test_map_reflexive(blocks_address + TEST_PERMUTATION_OFFSET, 1);
+    map->permutation = (struct sound_permutation *)(blocks + TEST_PERMUTATION_OFFSET);
+    map->permutation->cache_base_address = TEST_SOUND_CACHE_INDEX;
+
+    struct tag_instance *bsp_tag = &tag_data->tags[3];
+    bsp_tag->primary_group = TAG_FOURCC_SCENARIO_STRUCTURE_BSP;
+    Pointer32 bsp_address = tag_data->data_load_address + TEST_BSP_ADDRESS_OFFSET;
+    struct scenario *scenario = test_map_get_base_struct(map, 0);
+    scenario->structure_bsp_references = test_map_reflexive(blocks_address + TEST_BSP_REFERENCE_OFFSET, 1);
+    *(struct scenario_structure_bsp_reference *)(blocks + TEST_BSP_REFERENCE_OFFSET) = (struct scenario_structure_bsp_reference){
+        .offset = blocks + TEST_BSP_OFFSET - map->cache_file.data,
+        .size = TEST_BSP_SIZE,
+        .address = bsp_address,
+        .structure_bsp = { bsp_tag->primary_group, bsp_tag->name_address, strlen(test_tags[3].path), bsp_tag->tag_id }
+    };
+
+    uint8_t *bsp_data = blocks + TEST_BSP_OFFSET;
+    *(struct cache_file_structure_bsp_header *)bsp_data = (struct cache_file_structure_bsp_header){
+        .structure_bsp = bsp_address + TEST_BSP_STRUCT_OFFSET,
+        .signature = TAG_FOURCC_SCENARIO_STRUCTURE_BSP
+    };
+    struct structure_bsp *bsp = (struct structure_bsp *)(bsp_data + TEST_BSP_STRUCT_OFFSET);
+    bsp->lightmaps = test_map_reflexive(bsp_address + TEST_LIGHTMAP_OFFSET, 1);
+    struct structure_lightmap *lightmap = (struct structure_lightmap *)(bsp_data + TEST_LIGHTMAP_OFFSET);
+    lightmap->materials = test_map_reflexive(bsp_address + TEST_MATERIAL_OFFSET, 1);
+    map->material = (struct structure_material *)(bsp_data + TEST_MATERIAL_OFFSET);
+    map->material->vertices = (struct vertex_buffer){
+        .type = RASTERIZER_VERTEX_TYPE_ENVIRONMENT_COMPRESSED,
+        .count = TEST_VERTEX_COUNT,
+        .base_address = blocks_address + TEST_VERTICES_OFFSET,
+        .hardware_format = TEST_HARDWARE_FORMAT
+    };
+    map->material->lightmap_vertices = (struct vertex_buffer){
+        .type = RASTERIZER_VERTEX_TYPE_ENVIRONMENT_LIGHTMAP_COMPRESSED,
+        .count = TEST_VERTEX_COUNT,
+        .base_address = blocks_address + TEST_VERTICES_OFFSET,
+        .hardware_format = TEST_HARDWARE_FORMAT
+    };
+}
+
+// Xbox maps keep their compressed vertex buffers and the pointers the game uses, even with --zero-pointers
+static void test_xbox_vertex_buffers_are_kept(void) {
+    struct test_map map;
+    load_test_map(CACHE_FILE_VERSION_XBOX, &map);
+    Pointer32 vertices_address = map.part->vertex_buffer.base_address;
+
+    CHECK(postprocess_tag_data(&map.cache_file));
+    CHECK(map.part->vertex_buffer.type == RASTERIZER_VERTEX_TYPE_MODEL_COMPRESSED);
+    CHECK(map.part->vertex_buffer.base_address == vertices_address);
+    CHECK(map.material->vertices.type == RASTERIZER_VERTEX_TYPE_ENVIRONMENT_COMPRESSED);
+    CHECK(map.material->vertices.base_address == vertices_address);
+    CHECK(map.material->vertices.hardware_format == TEST_HARDWARE_FORMAT);
+    CHECK(map.material->lightmap_vertices.type == RASTERIZER_VERTEX_TYPE_ENVIRONMENT_LIGHTMAP_COMPRESSED);
+    CHECK(map.material->lightmap_vertices.base_address == vertices_address);
+    CHECK(map.material->lightmap_vertices.hardware_format == TEST_HARDWARE_FORMAT);
+    CHECK(map.permutation->cache_base_address == TEST_SOUND_CACHE_INDEX);
+    cache_file_unload(&map.cache_file);
+}
+
+// On PC, the same vertex buffers are left from a previous load
+static void test_pc_vertex_buffers_are_reset(void) {
+    struct test_map map;
+    load_test_map(CACHE_FILE_VERSION_CUSTOM_EDITION, &map);
+
+    CHECK(postprocess_tag_data(&map.cache_file));
+    CHECK(map.part->vertex_buffer.base_address == 0);
+    CHECK(map.material->vertices.type == RASTERIZER_VERTEX_TYPE_ENVIRONMENT_UNCOMPRESSED);
+    CHECK(map.material->vertices.base_address == 0);
+    CHECK(map.material->vertices.hardware_format == 0);
+    CHECK(map.material->lightmap_vertices.type == RASTERIZER_VERTEX_TYPE_ENVIRONMENT_LIGHTMAP_UNCOMPRESSED);
+    CHECK(map.material->lightmap_vertices.base_address == 0);
+    CHECK(map.material->lightmap_vertices.hardware_format == 0);
+    cache_file_unload(&map.cache_file);
+}
+
+int main(void) {
+    SET_FLAG(global_option_flags, GLOBAL_OPTON_FLAGS_ZERO_POINTERS_BIT, true);
+    test_xbox_vertex_buffers_are_kept();
+    test_pc_vertex_buffers_are_reset();
+    remove(TEST_MAP_PATH);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,117 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test_map.h"
+
+#include "../src/cache/cache.h"
+#include "../src/tag/tag.h"
+#include "../src/tag/tag_fix_plan.h"
+#include "../src/tag/tag_fourcc.h"
+#include "../src/tag/tag_path_table.h"
+#include "../src/tag/tag_reference_graph.h"
+#include "../src/tag_groups/bitmap.h"
+#include "../src/tag_groups/lens_flare.h"
+#include "../src/tag_groups/scenario.h"
+
+#define TEST_MAP_PATH "tag_path_table_test.map"
+
+// Only the lens flare references the bitmap, and nothing references the lens flare, so pruning removes both and moves
+// the sky into the lens flare's slot
+static const struct test_map_tag test_tags[] = {
+    { TAG_FOURCC_SCENARIO, "levels\\test\\test\\test", sizeof(struct scenario) },
+    { TAG_FOURCC_LENS_FLARE, "test\\orphans\\flare", sizeof(struct lens_flare) },
+    { TAG_FOURCC_BITMAP, "test\\orphans\\bitmap", sizeof(struct bitmap) },
+    { TAG_FOURCC_SKY, "test\\sky\\sky", 16 }
+};
+
+static struct tag_reference test_reference(const struct tag_instance *tag) {
+    return (struct tag_reference){ tag->primary_group, tag->name_address, strlen(test_tags[tag->tag_id.index].path), tag->tag_id };
+}
+
+static struct scenario *load_test_map(struct cache_file_instance *cache_file) {
+    test_map_load(TEST_MAP_PATH, CACHE_FILE_VERSION_CUSTOM_EDITION, test_tags, sizeof(test_tags) / sizeof(test_tags[0]), cache_file);
+    struct tag_data_instance *tag_data = &cache_file->tag_data;
+    struct scenario *scenario = tag_get(tag_data->header->scenario_tag, TAG_FOURCC_SCENARIO, tag_data);
+    CHECK(scenario);
+
+    struct lens_flare *lens_flare = tag_get(tag_data->tags[1].tag_id, TAG_FOURCC_LENS_FLARE, tag_data);
+    CHECK(lens_flare);
+    scenario->unused_sky = test_reference(&tag_data->tags[3]);
+    lens_flare->primary_map = test_reference(&tag_data->tags[2]);
+    return scenario;
+}
+
+static size_t prune(struct cache_file_instance *cache_file) {
+    struct tag_reference_graph graph;
+    struct tag_fix_plan plan;
+    CHECK(tag_reference_graph_build(&graph, cache_file));
+    tag_fix_plan_init(&plan, cache_file->data, cache_file->tag_data.header->scenario_tag);
+    size_t removed_count = tag_reference_graph_plan_prune(&graph, cache_file, &plan);
+    tag_fix_plan_apply(&plan);
+    tag_fix_plan_free(&plan);
+    tag_reference_graph_free(&graph);
+    return removed_count;
+}
+
+static void pack(struct cache_file_instance *cache_file, struct tag_path_table_result *result) {
+    struct tag_fix_plan plan;
+    tag_fix_plan_init(&plan, cache_file->data, cache_file->tag_data.header->scenario_tag);
+    tag_path_table_plan(cache_file, &plan, result);
+    tag_fix_plan_apply(&plan);
+    tag_fix_plan_free(&plan);
+}
+
+// The paths of pruned tags are left between the others, and the data of the lens flare still points to the bitmap's, but
+// they are dropped with the old table anyway
+static void test_prune_then_pack(void) {
+    struct cache_file_instance cache_file;
+    struct scenario *scenario = load_test_map(&cache_file);
+    struct tag_data_instance *tag_data = &cache_file.tag_data;
+    uint8_t *table = tag_data->data + (tag_data->tags[0].name_address - tag_data->data_load_address);
+
+    CHECK(prune(&cache_file) == 2);
+    CHECK(tag_data->header->tag_count == 2);
+
+    struct tag_path_table_result result;
+    pack(&cache_file, &result);
+    CHECK(result.path_count == 2);
+    CHECK(result.new_size < result.old_size);
+    CHECK(result.new_size == strlen(test_tags[0].path) + 1 + strlen(test_tags[3].path) + 1);
+    for(uint32_t i = result.new_size; i < result.old_size; i++) {
+        CHECK(table[i] == 0);
+    }
+
+    CHECK(strcmp(tag_path_get(tag_data->header->scenario_tag, tag_data), test_tags[0].path) == 0);
+    CHECK(strcmp(tag_path_get(tag_data->tags[1].tag_id, tag_data), test_tags[3].path) == 0);
+    CHECK(scenario->unused_sky.index.whole_id == tag_data->tags[1].tag_id.whole_id);
+    CHECK(scenario->unused_sky.name == tag_data->tags[1].name_address);
+
+    cache_file_unload(&cache_file);
+}
+
+// Something the schema does not know about still points at a pruned tag's path, so it has to stay where it is
+static void test_pruned_path_still_pointed_to(void) {
+    struct cache_file_instance cache_file;
+    struct scenario *scenario = load_test_map(&cache_file);
+    struct tag_data_instance *tag_data = &cache_file.tag_data;
+    Pointer32 flare_name = tag_data->tags[1].name_address;
+    memcpy(&scenario->unused1[0], &flare_name, sizeof(flare_name));
+
+    CHECK(prune(&cache_file) == 2);
+
+    struct tag_path_table_result result;
+    pack(&cache_file, &result);
+    CHECK(result.new_size == result.old_size);
+    CHECK(strcmp(tag_path_resolve(flare_name, tag_data), test_tags[1].path) == 0);
+
+    cache_file_unload(&cache_file);
+}
+
+int main(void) {
+    test_prune_then_pack();
+    test_pruned_path_still_pointed_to();
+    remove(TEST_MAP_PATH);
+    return EXIT_SUCCESS;
+}
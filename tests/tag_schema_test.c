@@ -0,0 +1,96 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "test_map.h"
+
+#include "../src/tag/tag_fourcc.h"
+#include "../src/tag/tag_schema.h"
+#include "../src/tag_groups/tag_groups.h"
+
+// Every group with a struct defined under src/tag_groups, and the struct that starts its base struct
+static const struct {
+    uint32_t group;
+    size_t size;
+    bool whole; // The struct is the whole base struct
+} test_defined_groups[] = {
+    { TAG_FOURCC_ACTOR_VARIANT, sizeof(struct actor_variant), true },
+    { TAG_FOURCC_BITMAP, sizeof(struct bitmap), true },
+    { TAG_FOURCC_DECAL, sizeof(struct decal), true },
+    { TAG_FOURCC_GRENADE_HUD_INTERFACE, sizeof(struct grenade_hud_interface), true },
+    { TAG_FOURCC_HUD_NUMBER, sizeof(struct hud_number), true },
+    { TAG_FOURCC_HUD_GLOBALS, sizeof(struct hud_globals), true },
+    { TAG_FOURCC_LENS_FLARE, sizeof(struct lens_flare), true },
+    { TAG_FOURCC_METER, sizeof(struct meter), true },
+    { TAG_FOURCC_GBXMODEL, sizeof(struct model), true },
+    { TAG_FOURCC_MODEL, sizeof(struct model), true },
+    { TAG_FOURCC_SCENARIO, sizeof(struct scenario), true },
+    { TAG_FOURCC_SCENARIO_STRUCTURE_BSP, sizeof(struct structure_bsp), false },
+    { TAG_FOURCC_SHADER, sizeof(struct shader), true },
+    { TAG_FOURCC_SHADER_ENVIRONMENT, sizeof(struct shader), false },
+    { TAG_FOURCC_SHADER_MODEL, sizeof(struct shader_model), true },
+    { TAG_FOURCC_SHADER_TRANSPARENT_CHICAGO, sizeof(struct shader), false },
+    { TAG_FOURCC_SHADER_TRANSPARENT_CHICAGO_EXTENDED, sizeof(struct shader), false },
+    { TAG_FOURCC_SHADER_TRANSPARENT_GENERIC, sizeof(struct shader), false },
+    { TAG_FOURCC_SHADER_TRANSPARENT_GLASS, sizeof(struct shader), false },
+    { TAG_FOURCC_SHADER_TRANSPARENT_METER, sizeof(struct shader), false },
+    { TAG_FOURCC_SHADER_TRANSPARENT_PLASMA, sizeof(struct shader), false },
+    { TAG_FOURCC_SHADER_TRANSPARENT_WATER, sizeof(struct shader), false },
+    { TAG_FOURCC_SOUND, sizeof(struct sound), true },
+    { TAG_FOURCC_UNIT_HUD_INTERFACE, sizeof(struct unit_hud_interface), true },
+    { TAG_FOURCC_WEAPON_HUD_INTERFACE, sizeof(struct weapon_hud_interface), true },
+    { TAG_FOURCC_OBJECT, sizeof(struct object), true },
+    { TAG_FOURCC_DEVICE, sizeof(struct object), false },
+    { TAG_FOURCC_DEVICE_CONTROL, sizeof(struct object), false },
+    { TAG_FOURCC_DEVICE_LIGHT_FIXTURE, sizeof(struct object), false },
+    { TAG_FOURCC_DEVICE_MACHINE, sizeof(struct object), false },
+    { TAG_FOURCC_EQUIPMENT, sizeof(struct object), false },
+    { TAG_FOURCC_GARBAGE, sizeof(struct object), false },
+    { TAG_FOURCC_ITEM, sizeof(struct object), false },
+    { TAG_FOURCC_PLACEHOLDER, sizeof(struct object), false },
+    { TAG_FOURCC_PROJECTILE, sizeof(struct object), false },
+    { TAG_FOURCC_SCENERY, sizeof(struct object), false },
+    { TAG_FOURCC_SOUND_SCENERY, sizeof(struct object), false },
+    { TAG_FOURCC_WEAPON, sizeof(struct object), false },
+    { TAG_FOURCC_UNIT, sizeof(struct unit), true },
+    { TAG_FOURCC_BIPED, sizeof(struct unit), false },
+    { TAG_FOURCC_VEHICLE, sizeof(struct unit), false }
+};
+
+// Consumers only move and change what the schema knows all of, so losing an entry would quietly stop them
+static void test_defined_groups_have_layouts(void) {
+    for(size_t g = 0; g < sizeof(test_defined_groups) / sizeof(test_defined_groups[0]); g++) {
+        const struct tag_schema_group *group = tag_schema_get_group(test_defined_groups[g].group);
+        if(!group || !group->schema || group->schema->size != test_defined_groups[g].size) {
+            fprintf(stderr, "%s has no layout for its struct\n", tag_fourcc_to_extension(test_defined_groups[g].group));
+            exit(EXIT_FAILURE);
+        }
+        if(test_defined_groups[g].whole) {
+            CHECK(group->schema->size == tag_fourcc_get_base_struct_size(test_defined_groups[g].group));
+        }
+    }
+}
+
+static void test_opaque_blocks_are_unknown(void) {
+    struct tag_schema_block block = { .type = TAG_SCHEMA_BLOCK_TYPE_BASE_STRUCT, .tag_group = TAG_FOURCC_SKY };
+    CHECK(!tag_schema_block_is_known(&block));
+
+    // Part of an object's base struct is not described
+    block.tag_group = TAG_FOURCC_SCENERY;
+    CHECK(!tag_schema_block_is_known(&block));
+
+    block.tag_group = TAG_FOURCC_BITMAP;
+    CHECK(tag_schema_block_is_known(&block) == tag_schema_group_is_complete(tag_schema_get_group(TAG_FOURCC_BITMAP)));
+
+    block = (struct tag_schema_block){ .type = TAG_SCHEMA_BLOCK_TYPE_REFLEXIVE, .schema = nullptr };
+    CHECK(!tag_schema_block_is_known(&block));
+
+    block = (struct tag_schema_block){ .type = TAG_SCHEMA_BLOCK_TYPE_DATA };
+    CHECK(tag_schema_block_is_known(&block));
+}
+
+int main(void) {
+    test_defined_groups_have_layouts();
+    test_opaque_blocks_are_unknown();
+    return EXIT_SUCCESS;
+}
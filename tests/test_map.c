@@ -0,0 +1,117 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "test_map.h"
+
+#include "../src/data_types.h"
+#include "../src/cache/cache.h"
+#include "../src/cache/cache_compression.h"
+#include "../src/crc/crc.h"
+#include "../src/file/file.h"
+#include "../src/tag/tag.h"
+#include "../src/tag/tag_fourcc.h"
+
+#define TEST_MAP_TAG_DATA_SIGNATURE 0x74616773 // tags
+#define TEST_MAP_TAG_ID_SALT 0xE174
+
+static uint32_t test_map_align(uint32_t size) {
+    return (size + 3) & ~3U;
+}
+
+void test_map_load(const char *path, uint32_t version, const struct test_map_tag *tags, size_t tag_count, struct cache_file_instance *cache_file) {
+    assert(path && tags && tag_count > 0 && tags[0].group == TAG_FOURCC_SCENARIO && cache_file);
+    bool xbox = version == CACHE_FILE_VERSION_XBOX;
+    Pointer32 load_address = xbox ? TAG_DATA_LOAD_ADDRESS_XBOX : TAG_DATA_LOAD_ADDRESS;
+
+    uint32_t array_offset = xbox ? sizeof(struct tag_data_header_xbox) : sizeof(struct tag_data_header);
+    uint32_t paths_offset = array_offset + tag_count * sizeof(struct tag_instance);
+    uint32_t blocks_offset = paths_offset;
+    for(size_t t = 0; t < tag_count; t++) {
+        blocks_offset += strlen(tags[t].path) + 1;
+    }
+    blocks_offset = test_map_align(blocks_offset);
+    uint32_t tags_size = blocks_offset;
+    for(size_t t = 0; t < tag_count; t++) {
+        tags_size += test_map_align(tags[t].size);
+    }
+    tags_size = MAX(tags_size, CACHE_FILE_MINIMUM_SIZE - sizeof(struct cache_file_header));
+
+    size_t size = sizeof(struct cache_file_header) + tags_size;
+    uint8_t *data = calloc(size, 1);
+    if(!data) {
+        abort();
+    }
+    struct cache_file_header *header = (struct cache_file_header *)data;
+    uint8_t *tag_data = data + sizeof(struct cache_file_header);
+    struct tag_instance *instances = (struct tag_instance *)(tag_data + array_offset);
+
+    uint32_t path_offset = paths_offset;
+    uint32_t block_offset = blocks_offset;
+    for(size_t t = 0; t < tag_count; t++) {
+        size_t length = strlen(tags[t].path);
+        memcpy(tag_data + path_offset, tags[t].path, length);
+        instances[t] = (struct tag_instance){
+            .primary_group = tags[t].group,
+            .secondary_group = TAG_FOURCC_NONE,
+            .tertiary_group = TAG_FOURCC_NONE,
+            .tag_id = { .index = t, .id = TEST_MAP_TAG_ID_SALT + t },
+            .name_address = load_address + path_offset,
+            .base_address = load_address + block_offset
+        };
+        path_offset += length + 1;
+        block_offset += test_map_align(tags[t].size);
+    }
+
+    if(xbox) {
+        *(struct tag_data_header_xbox *)tag_data = (struct tag_data_header_xbox){
+            .tag_instances = load_address + array_offset,
+            .scenario_tag = instances[0].tag_id,
+            .tag_count = tag_count,
+            .signature = TEST_MAP_TAG_DATA_SIGNATURE
+        };
+    }
+    else {
+        *(struct tag_data_header *)tag_data = (struct tag_data_header){
+            .tag_instances = load_address + array_offset,
+            .scenario_tag = instances[0].tag_id,
+            .tag_count = tag_count,
+            .vertex_buffers_offset = sizeof(struct cache_file_header),
+            .signature = TEST_MAP_TAG_DATA_SIGNATURE
+        };
+    }
+
+    *header = (struct cache_file_header){
+        .header_signature = CACHE_FILE_HEADER_SIGNATURE,
+        .version = version,
+        .size = size,
+        .tags_offset = sizeof(struct cache_file_header),
+        .tags_size = tags_size,
+        .footer_signature = CACHE_FILE_FOOTER_SIGNATURE
+    };
+    strcpy(header->name, "test");
+    strcpy(header->build_number, cache_file_tracked_builds[xbox ? CACHE_FILE_TRACKED_BUILD_XBOX : CACHE_FILE_TRACKED_BUILD_0609]);
+
+    // No BSPs or model data, so this is all of it
+    crc_new(&header->checksum);
+    crc_checksum_buffer(&header->checksum, tag_data, tags_size);
+
+    if(xbox) {
+        FILE *file = fopen(path, "wb");
+        uint64_t compressed_size;
+        CHECK(file);
+        CHECK(fwrite(header, sizeof(struct cache_file_header), 1, file) == 1);
+        CHECK(cache_compression_deflate(file, tag_data, tags_size, &compressed_size));
+        CHECK(fclose(file) == 0);
+    }
+    else {
+        CHECK(file_write_from_buffer(path, data, size));
+    }
+    free(data);
+
+    memset(cache_file, 0, sizeof(struct cache_file_instance));
+    cache_file_load(path, cache_file);
+    CHECK(cache_file->valid);
+}
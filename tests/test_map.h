@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../src/cache/cache.h"
+
+#define CHECK(condition) do { \
+    if(!(condition)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+        exit(EXIT_FAILURE); \
+    } \
+} while(0)
+
+// A tag in a synthetic map. The base struct is zeroed, so tests fill in what they need after loading.
+struct test_map_tag {
+    uint32_t group;
+    const char *path;
+    uint32_t size; // Of the base struct
+};
+
+// Writes a map laid out the way tool.exe does it to path and loads it: the header, then the tag data header, the tag
+// array, the paths one after another and the base structs. The first tag is the scenario. There are no BSPs and no
+// model data. Xbox maps are compressed.
+void test_map_load(const char *path, uint32_t version, const struct test_map_tag *tags, size_t tag_count, struct cache_file_instance *cache_file);